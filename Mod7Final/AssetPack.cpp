@@ -0,0 +1,351 @@
+#include "AssetPack.h"
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const int MIN_MATCH = 4;
+    const int LAST_LITERALS = 5;        // The format ends every block with at least this many literals
+    const int MATCH_START_LIMIT = 12;   // and starts no match closer than this to the end
+    const int HASH_BITS = 16;
+
+    uint64_t alignUp(uint64_t value)
+    {
+        return (value + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+    }
+
+    uint32_t read32(const uint8_t* bytes)
+    {
+        uint32_t value;
+        memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    // Lengths of 15 and more continue in bytes of 255 and a final byte below it
+    void writeLength(std::vector<uint8_t>& output, size_t length)
+    {
+        for (; length >= 255; length -= 255)
+            output.push_back(255);
+        output.push_back((uint8_t)length);
+    }
+
+    bool readLength(const uint8_t*& in, const uint8_t* end, size_t& length)
+    {
+        uint8_t byte;
+        do
+        {
+            if (in == end)
+                return false;
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    void writeSequence(std::vector<uint8_t>& output, const uint8_t* literals, size_t literalCount, uint32_t offset, size_t matchLength)
+    {
+        size_t matchCode = matchLength - MIN_MATCH;
+        output.push_back((uint8_t)((literalCount < 15 ? literalCount : 15) << 4 | (offset == 0 ? 0 : matchCode < 15 ? matchCode : 15)));
+        if (literalCount >= 15)
+            writeLength(output, literalCount - 15);
+        output.insert(output.end(), literals, literals + literalCount);
+        if (offset == 0)
+            return;     // Last sequence: literals only
+        output.push_back((uint8_t)offset);
+        output.push_back((uint8_t)(offset >> 8));
+        if (matchCode >= 15)
+            writeLength(output, matchCode - 15);
+    }
+}
+
+AssetPack::AssetPack() : data(nullptr), size(0)
+#ifdef _WIN32
+    , fileHandle(nullptr), mappingHandle(nullptr)
+#endif
+{
+}
+
+AssetPack::~AssetPack() {
+    close();
+}
+
+bool AssetPack::open(const char* path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    fileHandle = file;
+    mappingHandle = mapping;
+    size = (size_t)fileSize.QuadPart;
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);    // The mapping keeps the file alive
+    if (mapped == MAP_FAILED)
+        return false;
+    madvise(mapped, (size_t)info.st_size, MADV_RANDOM);    // Entries are read in the order decoders ask, and prefetched explicitly
+    data = static_cast<const unsigned char*>(mapped);
+    size = (size_t)info.st_size;
+#endif
+    if (data == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    // Validate header and make sure every entry lies inside the file
+    const AssetPackHeader* header = reinterpret_cast<const AssetPackHeader*>(data);
+    if (size < sizeof(AssetPackHeader) || header->magic != ASSET_PACK_MAGIC || header->version != ASSET_PACK_VERSION
+        || header->entryOffset + (uint64_t)header->entryCount * sizeof(AssetPackEntry) > size)
+    {
+        close();
+        return false;
+    }
+    for (uint32_t i = 0; i < header->entryCount; i++)
+    {
+        const AssetPackEntry& e = entry(i);
+        if (e.offset % ASSET_PACK_ALIGNMENT != 0 || e.offset + e.storedBytes > size || memchr(e.name, 0, sizeof(e.name)) == nullptr
+            || (e.compression == AssetCompression::None && e.storedBytes != e.size) || (e.compression != AssetCompression::None && e.compression != AssetCompression::LZ4))
+        {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void AssetPack::close() {
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+#else
+    if (data)
+        munmap(const_cast<unsigned char*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+uint32_t AssetPack::entryCount() const {
+    return data ? reinterpret_cast<const AssetPackHeader*>(data)->entryCount : 0;
+}
+
+const AssetPackEntry& AssetPack::entry(uint32_t asset) const {
+    const AssetPackHeader* header = reinterpret_cast<const AssetPackHeader*>(data);
+    return reinterpret_cast<const AssetPackEntry*>(data + header->entryOffset)[asset];
+}
+
+int AssetPack::find(const char* name) const {
+    for (uint32_t i = 0; i < entryCount(); i++)
+    {
+        if (strncmp(entry(i).name, name, sizeof(entry(i).name)) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+std::span<const uint8_t> AssetPack::contents(uint32_t asset, std::vector<uint8_t>& storage) const {
+    const AssetPackEntry& e = entry(asset);
+    std::span<const uint8_t> stored(data + e.offset, (size_t)e.storedBytes);
+    if (e.compression == AssetCompression::None)
+        return stored;
+    storage.resize((size_t)e.size);
+    if (!decompress(stored, storage.data(), storage.size()))
+    {
+        storage.clear();
+        return {};
+    }
+    return storage;
+}
+
+void AssetPack::prefetch(uint32_t asset) const {
+    const AssetPackEntry& e = entry(asset);
+    if (e.storedBytes == 0)
+        return;
+#ifdef _WIN32
+    WIN32_MEMORY_RANGE_ENTRY range{ const_cast<unsigned char*>(data + e.offset), (SIZE_T)e.storedBytes };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    // Entries start on page boundaries, which madvise requires
+    madvise(const_cast<unsigned char*>(data + e.offset), (size_t)e.storedBytes, MADV_WILLNEED);
+#endif
+}
+
+bool AssetPack::verify(uint32_t asset) const {
+    std::vector<uint8_t> storage;
+    std::span<const uint8_t> bytes = contents(asset, storage);
+    return bytes.size() == entry(asset).size && hash(bytes) == entry(asset).hash;
+}
+
+bool AssetPack::write(const char* path, std::span<const AssetPackSource> assets) {
+    std::vector<AssetPackEntry> entries(assets.size());
+    std::vector<std::vector<uint8_t>> compressed(assets.size());
+
+    uint64_t offset = alignUp(sizeof(AssetPackHeader) + sizeof(AssetPackEntry) * assets.size());
+    for (size_t a = 0; a < assets.size(); a++)
+    {
+        const AssetPackSource& source = assets[a];
+        AssetPackEntry& e = entries[a];
+        memset(&e, 0, sizeof(e));
+        if (source.name.size() >= sizeof(e.name))
+            return false;
+        memcpy(e.name, source.name.c_str(), source.name.size());
+        e.size = source.data.size();
+        e.hash = hash(source.data);
+
+        // Kept compressed only when it saves an eighth; already compressed images (JPEG, PNG) stay views of the mapping
+        e.compression = AssetCompression::None;
+        e.storedBytes = e.size;
+        if (source.compress)
+        {
+            compress(source.data, compressed[a]);
+            if (compressed[a].size() < e.size - e.size / 8)
+            {
+                e.compression = AssetCompression::LZ4;
+                e.storedBytes = compressed[a].size();
+            }
+            else
+                compressed[a] = std::vector<uint8_t>();
+        }
+        e.offset = offset;
+        offset = alignUp(offset + e.storedBytes);
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    AssetPackHeader header{ ASSET_PACK_MAGIC, ASSET_PACK_VERSION, (uint32_t)assets.size(), sizeof(AssetPackHeader) };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), sizeof(AssetPackEntry) * entries.size());
+
+    // Pad up to each entry's aligned offset before writing it
+    auto padTo = [&out](uint64_t target) {
+        static const char zeros[ASSET_PACK_ALIGNMENT] = {};
+        uint64_t position = (uint64_t)out.tellp();
+        if (target > position)
+            out.write(zeros, (std::streamsize)(target - position));
+    };
+    for (size_t a = 0; a < assets.size(); a++)
+    {
+        padTo(entries[a].offset);
+        const uint8_t* stored = entries[a].compression == AssetCompression::None ? assets[a].data.data() : compressed[a].data();
+        out.write(reinterpret_cast<const char*>(stored), (std::streamsize)entries[a].storedBytes);
+    }
+    padTo(offset);
+    return (bool)out;
+}
+
+uint64_t AssetPack::hash(std::span<const uint8_t> data) {
+    uint64_t hash = 1469598103934665603ull;    // FNV-1a
+    for (uint8_t byte : data)
+        hash = (hash ^ byte) * 1099511628211ull;
+    return hash;
+}
+
+void AssetPack::compress(std::span<const uint8_t> input, std::vector<uint8_t>& output) {
+    output.clear();
+    output.reserve(input.size() + input.size() / 255 + 16);
+    const uint8_t* source = input.data();
+    const size_t length = input.size();
+    size_t anchor = 0;      // First byte not yet written
+
+    if (length > MATCH_START_LIMIT)
+    {
+        // Last position each 4-byte sequence was seen at, plus one (0 = never)
+        std::vector<uint32_t> table((size_t)1 << HASH_BITS, 0);
+        const size_t matchStartEnd = length - MATCH_START_LIMIT, matchEnd = length - LAST_LITERALS;
+        size_t position = 0, misses = 0;
+        while (position < matchStartEnd)
+        {
+            uint32_t sequence = read32(source + position);
+            uint32_t& slot = table[(sequence * 2654435761u) >> (32 - HASH_BITS)];
+            size_t candidate = slot;
+            slot = (uint32_t)position + 1;
+            if (candidate == 0 || position + 1 - candidate > 65535 || read32(source + candidate - 1) != sequence)
+            {
+                position += 1 + (misses++ >> 6);    // Step faster through data that does not compress
+                continue;
+            }
+            candidate--;
+            size_t match = MIN_MATCH;
+            while (position + match < matchEnd && source[candidate + match] == source[position + match])
+                match++;
+            writeSequence(output, source + anchor, position - anchor, (uint32_t)(position - candidate), match);
+            position += match;
+            anchor = position;
+            misses = 0;
+        }
+    }
+    writeSequence(output, source + anchor, length - anchor, 0, MIN_MATCH);
+}
+
+bool AssetPack::decompress(std::span<const uint8_t> input, uint8_t* output, size_t size) {
+    const uint8_t* in = input.data();
+    const uint8_t* end = in + input.size();
+    size_t written = 0;
+    while (in < end)
+    {
+        uint8_t token = *in++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !readLength(in, end, literals))
+            return false;
+        if (literals > (size_t)(end - in) || literals > size - written)
+            return false;
+        memcpy(output + written, in, literals);
+        in += literals;
+        written += literals;
+        if (in == end)
+            break;      // The last sequence has no match
+
+        if (end - in < 2)
+            return false;
+        size_t offset = in[0] | (size_t)in[1] << 8;
+        in += 2;
+        size_t match = (token & 15);
+        if (match == 15 && !readLength(in, end, match))
+            return false;
+        match += MIN_MATCH;
+        if (offset == 0 || offset > written || match > size - written)
+            return false;
+        // Byte by byte: a match may overlap the bytes it produces
+        for (size_t i = 0; i < match; i++, written++)
+            output[written] = output[written - offset];
+    }
+    return written == size;
+}
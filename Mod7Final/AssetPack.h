@@ -0,0 +1,95 @@
+#pragma once
+# include <cstdint>
+# include <cstddef>
+# include <span>
+# include <string>
+# include <vector>
+
+/* Single-file asset archive. Everything is little-endian and every entry starts on an ASSET_PACK_ALIGNMENT (page)
+boundary, so a memory mapped pack hands decoders views of the stored bytes and each entry can be prefetched alone:
+
+	[AssetPackHeader][AssetPackEntry x entryCount][entry data][entry data]...
+*/
+const uint32_t ASSET_PACK_MAGIC = 0x4B415041;	// "APAK"
+const uint32_t ASSET_PACK_VERSION = 1;
+const uint32_t ASSET_PACK_ALIGNMENT = 4096;
+
+enum class AssetCompression : uint32_t
+{
+	None = 0,
+	LZ4 = 1,					// LZ4 block format, no frame
+};
+
+struct AssetPackHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t entryOffset;		// Byte offset of the first AssetPackEntry
+};
+
+struct AssetPackEntry
+{
+	char name[64];				// Path the asset is loaded by, e.g. "plane1.jpg"
+	AssetCompression compression;
+	uint32_t reserved;
+	uint64_t offset;
+	uint64_t storedBytes;		// Bytes in the pack
+	uint64_t size;				// Bytes of the asset itself
+	uint64_t hash;				// FNV-1a of the asset itself
+};
+
+static_assert(sizeof(AssetPackHeader) == 16, "AssetPackHeader layout changed");
+static_assert(sizeof(AssetPackEntry) == 104, "AssetPackEntry layout changed");
+
+// Input for writing one asset
+struct AssetPackSource
+{
+	std::string name;
+	std::span<const uint8_t> data;
+	bool compress;				// Stored compressed if that saves enough to be worth decompressing
+};
+
+// Class to memory map an asset pack and hand out views of its entries
+class AssetPack
+{
+public:
+	AssetPack();
+	~AssetPack();
+	AssetPack(const AssetPack&) = delete;
+	AssetPack& operator=(const AssetPack&) = delete;
+
+	// Maps the file and validates its header and entries. Returns false on any error
+	bool open(const char* path);
+	void close();
+
+	uint32_t entryCount() const;
+	const AssetPackEntry& entry(uint32_t asset) const;
+	int find(const char* name) const;	// Returns -1 if the asset is not in the pack
+
+	// Contents of an asset: a view of the mapping when it is stored as is, otherwise decompressed into storage.
+	// Empty if it does not decompress
+	std::span<const uint8_t> contents(uint32_t asset, std::vector<uint8_t>& storage) const;
+
+	// Asks the OS to start reading an asset's pages in, so they are resident by the time a decoder touches them
+	void prefetch(uint32_t asset) const;
+
+	// Checks an asset's contents against its hash
+	bool verify(uint32_t asset) const;
+
+	static bool write(const char* path, std::span<const AssetPackSource> assets);
+
+	static uint64_t hash(std::span<const uint8_t> data);
+
+	// LZ4 block format: greedy matches of 4+ bytes up to 64 KB back
+	static void compress(std::span<const uint8_t> input, std::vector<uint8_t>& output);
+	static bool decompress(std::span<const uint8_t> input, uint8_t* output, size_t size);
+
+private:
+	const unsigned char* data;
+	size_t size;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+};
@@ -0,0 +1,294 @@
+#include "AssetReader.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/io_uring.h>
+#endif
+
+namespace
+{
+    // Reads a whole file with blocking calls. Empty if it cannot be read
+    std::vector<uint8_t> readFile(const char* path)
+    {
+        std::vector<uint8_t> bytes;
+#ifdef _WIN32
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        bytes.resize(file ? (size_t)file.tellg() : 0);
+        file.seekg(0);
+        if (!file.read((char*)bytes.data(), (std::streamsize)bytes.size()))
+            bytes.clear();
+#else
+        int fd = open(path, O_RDONLY);
+        struct stat info;
+        if (fd < 0)
+            return bytes;
+        if (fstat(fd, &info) == 0)
+        {
+            bytes.resize((size_t)info.st_size);
+            size_t done = 0;
+            while (done < bytes.size())
+            {
+                ssize_t got = pread(fd, bytes.data() + done, bytes.size() - done, (off_t)done);
+                if (got <= 0)
+                    break;
+                done += (size_t)got;
+            }
+            if (done < bytes.size())
+                bytes.clear();
+        }
+        close(fd);
+#endif
+        return bytes;
+    }
+
+    // Each file read by one blocking job on a pool of I/O threads, which mostly wait on the disk
+    class PreadReader : public AssetReader
+    {
+    public:
+        explicit PreadReader(unsigned threads) : pool(threads) {}
+
+        void readAll(std::span<const char* const> paths, const FileCallback& done) override
+        {
+            std::mutex callbackMutex;
+            std::vector<std::future<void>> pending;
+            for (size_t i = 0; i < paths.size(); i++)
+                pending.push_back(pool.submit([&, i] {
+                    std::vector<uint8_t> bytes = readFile(paths[i]);
+                    std::lock_guard<std::mutex> lock(callbackMutex);
+                    done(i, bytes);
+                }));
+            for (std::future<void>& job : pending)
+                job.get();
+        }
+
+        const char* name() const override { return "pread"; }
+
+    private:
+        ThreadPool pool;
+    };
+
+#ifdef __linux__
+    /* Every read goes into one submission queue and a single io_uring_enter hands them all to the kernel. Short reads
+    are resubmitted for the rest of the file. Talks to the rings through the raw system calls, so liburing is not needed*/
+    class UringReader : public AssetReader
+    {
+    public:
+        ~UringReader() override
+        {
+            if (ring >= 0)
+                close(ring);
+            if (sqRing && sqRing != MAP_FAILED)
+                munmap(sqRing, sqRingBytes);
+            if (cqRing && cqRing != sqRing && cqRing != MAP_FAILED)
+                munmap(cqRing, cqRingBytes);
+            if (sqes && sqes != MAP_FAILED)
+                munmap(sqes, sqesBytes);
+        }
+
+        // False if the kernel has no io_uring or does not let this process use it
+        bool setup(unsigned entries)
+        {
+            io_uring_params params;
+            memset(&params, 0, sizeof(params));
+            ring = (int)syscall(__NR_io_uring_setup, entries, &params);
+            if (ring < 0 || !(params.features & IORING_FEAT_NODROP))
+                return false;   // NODROP (5.5) comes with everything used here but IORING_OP_READ, checked on first use
+            sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            if (params.features & IORING_FEAT_SINGLE_MMAP)
+                sqRingBytes = cqRingBytes = std::max(sqRingBytes, cqRingBytes);
+            sqRing = mmap(nullptr, sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+            if (sqRing == MAP_FAILED)
+                return false;
+            cqRing = params.features & IORING_FEAT_SINGLE_MMAP ? sqRing
+                : mmap(nullptr, cqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+            sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+            sqes = (io_uring_sqe*)mmap(nullptr, sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+            if (cqRing == MAP_FAILED || sqes == MAP_FAILED)
+                return false;
+
+            char* sq = (char*)sqRing;
+            char* cq = (char*)cqRing;
+            sqHead = (unsigned*)(sq + params.sq_off.head);
+            sqTail = (unsigned*)(sq + params.sq_off.tail);
+            sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+            sqArray = (unsigned*)(sq + params.sq_off.array);
+            cqHead = (unsigned*)(cq + params.cq_off.head);
+            cqTail = (unsigned*)(cq + params.cq_off.tail);
+            cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+            cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+            capacity = params.sq_entries;
+            return true;
+        }
+
+        void readAll(std::span<const char* const> paths, const FileCallback& done) override
+        {
+            struct File
+            {
+                int fd = -1;
+                std::vector<uint8_t> bytes;
+                size_t read = 0;
+            };
+            std::vector<File> files(paths.size());
+            std::vector<size_t> queued;     // Files with a read to submit
+            size_t remaining = 0;
+            for (size_t i = 0; i < paths.size(); i++)
+            {
+                File& file = files[i];
+                struct stat info;
+                file.fd = open(paths[i], O_RDONLY);
+                if (file.fd >= 0 && fstat(file.fd, &info) == 0 && info.st_size > 0)
+                {
+                    file.bytes.resize((size_t)info.st_size);
+                    queued.push_back(i);
+                    remaining++;
+                    continue;
+                }
+                finish(file, i, false, done);     // Missing or empty: nothing to read
+            }
+
+            size_t inFlight = 0;
+            while (remaining > 0)
+            {
+                // Queue as many reads as the ring takes, then submit them together and wait for at least one
+                unsigned tail = *sqTail;
+                unsigned added = 0;
+                while (!queued.empty() && inFlight + added < capacity)
+                {
+                    size_t i = queued.back();
+                    queued.pop_back();
+                    File& file = files[i];
+                    unsigned slot = (tail + added) & sqMask;
+                    io_uring_sqe& sqe = sqes[slot];
+                    memset(&sqe, 0, sizeof(sqe));
+                    sqe.opcode = IORING_OP_READ;
+                    sqe.fd = file.fd;
+                    sqe.addr = (uint64_t)(uintptr_t)(file.bytes.data() + file.read);
+                    sqe.len = (uint32_t)std::min<size_t>(file.bytes.size() - file.read, 1u << 30);
+                    sqe.off = file.read;
+                    sqe.user_data = i;
+                    sqArray[slot] = slot;
+                    added++;
+                }
+                std::atomic_ref<unsigned>(*sqTail).store(tail + added, std::memory_order_release);
+                inFlight += added;
+
+                // Everything the kernel has not taken yet, including entries an interrupted call left behind
+                unsigned pending = tail + added - std::atomic_ref<unsigned>(*sqHead).load(std::memory_order_acquire);
+                if (syscall(__NR_io_uring_enter, ring, pending, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0
+                    && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                    break;      // Rejected outright, before taking any entry
+
+                unsigned head = *cqHead;
+                unsigned end = std::atomic_ref<unsigned>(*cqTail).load(std::memory_order_acquire);
+                for (; head != end; head++)
+                {
+                    const io_uring_cqe& cqe = cqes[head & cqMask];
+                    size_t i = (size_t)cqe.user_data;
+                    File& file = files[i];
+                    inFlight--;
+                    if (cqe.res == -EINVAL && file.read == 0)
+                    {
+                        // IORING_OP_READ needs 5.6: this one file is read the blocking way
+                        file.bytes = readFile(paths[i]);
+                        finish(file, i, !file.bytes.empty(), done);
+                        remaining--;
+                    }
+                    else if (cqe.res <= 0)
+                    {
+                        finish(file, i, false, done);
+                        remaining--;
+                    }
+                    else if ((file.read += (size_t)cqe.res) < file.bytes.size())
+                        queued.push_back(i);    // Short read: the rest goes in the next batch
+                    else
+                    {
+                        finish(file, i, true, done);
+                        remaining--;
+                    }
+                }
+                std::atomic_ref<unsigned>(*cqHead).store(head, std::memory_order_release);
+            }
+
+            // Only reached early if the ring was rejected: what is left is read the blocking way. Buffers of reads the
+            // kernel may still complete are kept until the ring is closed
+            for (size_t i = 0; i < files.size(); i++)
+                if (files[i].fd >= 0)
+                {
+                    abandoned.push_back(std::move(files[i].bytes));
+                    files[i].bytes = readFile(paths[i]);
+                    finish(files[i], i, !files[i].bytes.empty(), done);
+                }
+        }
+
+        const char* name() const override { return "io_uring"; }
+
+    private:
+        template <typename File>
+        static void finish(File& file, size_t index, bool ok, const FileCallback& done)
+        {
+            if (file.fd >= 0)
+                close(file.fd);
+            file.fd = -1;
+            if (!ok)
+                file.bytes.clear();
+            done(index, file.bytes);
+            file.bytes = std::vector<uint8_t>();
+        }
+
+        int ring = -1;
+        void* sqRing = nullptr;
+        void* cqRing = nullptr;
+        io_uring_sqe* sqes = nullptr;
+        size_t sqRingBytes = 0, cqRingBytes = 0, sqesBytes = 0;
+        unsigned* sqHead = nullptr;
+        unsigned* sqTail = nullptr;
+        unsigned* sqArray = nullptr;
+        unsigned sqMask = 0;
+        unsigned* cqHead = nullptr;
+        unsigned* cqTail = nullptr;
+        unsigned cqMask = 0;
+        io_uring_cqe* cqes = nullptr;
+        unsigned capacity = 0;
+        std::vector<std::vector<uint8_t>> abandoned;
+    };
+#endif
+}
+
+std::unique_ptr<AssetReader> AssetReader::create(AssetBackend backend, unsigned threads) {
+#ifdef __linux__
+    if (backend == AssetBackend::Uring)
+    {
+        auto reader = std::make_unique<UringReader>();
+        if (reader->setup(64))
+            return reader;
+    }
+#endif
+    return std::make_unique<PreadReader>(threads);
+}
+
+bool AssetReader::evict(const char* path) {
+#ifdef _WIN32
+    return false;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    bool evicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;     // Clean pages of the file leave the cache
+    close(fd);
+    return evicted;
+#endif
+}
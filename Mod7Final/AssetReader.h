@@ -0,0 +1,35 @@
+#pragma once
+# include <cstddef>
+# include <cstdint>
+# include <functional>
+# include <memory>
+# include <span>
+# include <vector>
+
+enum class AssetBackend
+{
+	Uring,						// One io_uring batch for every file (Linux 5.6+), pread when the kernel refuses it
+	Pread,						// Blocking reads on a few I/O threads
+};
+
+/* Interface to read a set of asset files into memory at once, so a cold disk sees every request together instead of
+one decoder's read after another. Each file is handed over as soon as it is in, and decoders take it from memory*/
+class AssetReader
+{
+public:
+	// Receives the bytes of paths[index], which it may move from; empty if the file could not be read
+	using FileCallback = std::function<void(size_t index, std::vector<uint8_t>& bytes)>;
+
+	virtual ~AssetReader() = default;
+
+	// Reads every file and returns once done has been called for each. Calls to done never overlap
+	virtual void readAll(std::span<const char* const> paths, const FileCallback& done) = 0;
+
+	virtual const char* name() const = 0;
+
+	// The backend asked for, or the pread reader if it is not available here
+	static std::unique_ptr<AssetReader> create(AssetBackend backend, unsigned threads = 4);
+
+	// Asks the OS to drop its cached pages of a file, so the next read comes from the disk. False where unsupported
+	static bool evict(const char* path);
+};
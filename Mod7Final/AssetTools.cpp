@@ -0,0 +1,175 @@
+#include "AssetTools.h"
+#include "AssetPack.h"
+#include "ImageTools.h"
+#include "JpegDecoder.h"
+#include "KtxFile.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+#include "stb_image.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+bool AssetTools::bakeTextures(std::span<const TextureRequest> requests, BlockFormat format) {
+    ThreadPool pool;
+    bool allBaked = true;
+    for (const TextureRequest& request : requests)
+    {
+        int width, height, channels;
+        stbi_set_flip_vertically_on_load_thread(request.flip);
+        unsigned char* pixels = stbi_load(request.filename, &width, &height, &channels, 0);
+        if (!pixels)
+        {
+            cout << "Failed to load texture " << request.filename << endl;
+            allBaked = false;
+            continue;
+        }
+
+        auto start = chrono::steady_clock::now();
+        CompressedTexture texture;
+        int dropped = ImageTools::levelsAbove(width, height, request.detailWidth, request.detailHeight);
+        bool encoded = TextureCompressor::compress(pixels, width, height, channels, format, &pool, texture, dropped);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        string path = KtxFile::bakedPath(request.filename);
+        if (!encoded || !KtxFile::write(path.c_str(), texture))
+        {
+            cout << "Failed to bake " << path << endl;
+            stbi_image_free(pixels);
+            allBaked = false;
+            continue;
+        }
+
+        // Compare the top level with the source, both as RGBA
+        vector<uint8_t> source((size_t)width * height * 4), decoded;
+        for (size_t p = 0; p < (size_t)width * height; p++)
+        {
+            for (int c = 0; c < 4; c++)
+                source[p * 4 + c] = c < channels ? pixels[p * channels + c] : 255;
+        }
+        vector<vector<uint8_t>> mips;
+        const uint8_t* reference = source.data();
+        if (dropped > 0)
+        {
+            ImageTools::buildMipChain(source.data(), width, height, 4, MipFilter::Lanczos, true, &pool, mips);
+            reference = mips[dropped - 1].data();
+        }
+        TextureCompressor::decode(texture.levels[0].data(), texture.width, texture.height, format, decoded);
+        double psnr = TextureCompressor::psnr(reference, decoded.data(), (size_t)texture.width * texture.height, channels);
+        stbi_image_free(pixels);
+
+        size_t bytes = 0;
+        for (const vector<uint8_t>& level : texture.levels)
+            bytes += level.size();
+        cout << "Baked " << path << ": " << texture.width << "x" << texture.height << ", " << texture.levels.size() << " levels, " << bytes / 1024 << " KB (was "
+            << (size_t)width * height * channels * 4 / 3 / 1024 << " KB), " << ms << " ms, PSNR " << psnr << " dB" << endl;
+    }
+    return allBaked;
+}
+
+bool AssetTools::addRestartMarkers(std::span<const TextureRequest> requests) {
+    bool allWritten = true;
+    for (const TextureRequest& request : requests)
+    {
+        ifstream file(request.filename, ios::binary | ios::ate);
+        vector<uint8_t> data(file ? (size_t)file.tellg() : 0);
+        file.seekg(0);
+        if (!file || !file.read((char*)data.data(), (streamsize)data.size()))
+        {
+            cout << "Failed to read " << request.filename << endl;
+            allWritten = false;
+            continue;
+        }
+        file.close();
+        JpegDecoder jpeg;
+        if (!jpeg.open(data.data(), data.size()))
+        {
+            cout << "Skipped " << request.filename << ": not a baseline JPEG" << endl;
+            continue;
+        }
+        const JpegInfo& info = jpeg.info();
+        if (info.restartInterval && info.rowMcus % info.restartInterval == 0)
+        {
+            cout << request.filename << " already has restart markers on every row" << endl;
+            continue;
+        }
+
+        // Written next to the image first, so a failure leaves the original intact
+        vector<uint8_t> rewritten;
+        string temporary = string(request.filename) + ".tmp";
+        ofstream out(temporary, ios::binary);
+        if (!jpeg.addRestartMarkers(rewritten) || !out.write((const char*)rewritten.data(), (streamsize)rewritten.size()))
+        {
+            cout << "Failed to rewrite " << request.filename << endl;
+            allWritten = false;
+            continue;
+        }
+        out.close();
+        error_code error;
+        filesystem::rename(temporary, request.filename, error);
+        if (error)
+        {
+            cout << "Failed to replace " << request.filename << ": " << error.message() << endl;
+            allWritten = false;
+            continue;
+        }
+        cout << "Restart markers added to " << request.filename << ": every " << info.rowMcus << " MCUs, " << rewritten.size() / 1024
+            << " KB (was " << data.size() / 1024 << " KB)" << endl;
+    }
+    return allWritten;
+}
+
+bool AssetTools::packAssets(std::span<const TextureRequest> requests, const char* path) {
+    vector<vector<uint8_t>> files;
+    bool allFound = true;
+    for (const TextureRequest& request : requests)
+    {
+        ifstream file(request.filename, ios::binary | ios::ate);
+        vector<uint8_t> data(file ? (size_t)file.tellg() : 0);
+        file.seekg(0);
+        if (!file || !file.read((char*)data.data(), (streamsize)data.size()))
+        {
+            cout << "Missing asset " << request.filename << endl;
+            allFound = false;
+        }
+        files.push_back(std::move(data));
+    }
+    if (!allFound)
+    {
+        cout << "Asset pack " << path << " not written" << endl;
+        return false;
+    }
+
+    vector<AssetPackSource> sources;
+    for (size_t j = 0; j < files.size(); j++)
+        sources.push_back({ requests[j].filename, files[j], true });
+    string temporary = string(path) + ".tmp";
+    error_code error;
+    if (!AssetPack::write(temporary.c_str(), sources) || (filesystem::rename(temporary, path, error), error))
+    {
+        cout << "Failed to write asset pack " << path << endl;
+        return false;
+    }
+
+    AssetPack pack;
+    if (!pack.open(path))
+    {
+        cout << "Failed to read back asset pack " << path << endl;
+        return false;
+    }
+    bool allVerified = true;
+    for (uint32_t asset = 0; asset < pack.entryCount(); asset++)
+    {
+        const AssetPackEntry& entry = pack.entry(asset);
+        bool verified = pack.verify(asset);
+        allVerified = allVerified && verified;
+        cout << "  " << entry.name << ": " << entry.size / 1024 << " KB" << (entry.compression == AssetCompression::LZ4 ? ", LZ4 to " + to_string(entry.storedBytes / 1024) + " KB" : "")
+            << (verified ? "" : ", hash mismatch") << endl;
+    }
+    cout << "Packed " << pack.entryCount() << " assets into " << path << " (" << filesystem::file_size(path, error) / 1024 << " KB)" << endl;
+    return allVerified;
+}
@@ -0,0 +1,25 @@
+#pragma once
+# include <span>
+# include "TextureCompressor.h"
+
+struct TextureRequest;
+
+// Class to run the command-line asset tools (--bake-textures, --add-restarts, --pack-assets). Each returns false if any file failed
+class AssetTools
+{
+public:
+	/* Bakes each image into a block compressed .ktx2 file with a full mip chain, next to the image, leaving out the levels
+	above the request's detail size. Blocks are encoded on all cores; the PSNR of the top level against the same level
+	filtered from the source image is reported*/
+	static bool bakeTextures(std::span<const TextureRequest> requests, BlockFormat format);
+
+	/* Rewrites each JPEG with a restart marker after every row of blocks, so the loader can decode one image in bands on
+	several cores. The coefficients are copied as they are, so the pixels do not change; the Huffman tables are rebuilt
+	for the new data, which usually makes the file smaller. Files that already restart at every row, and images that are
+	not baseline JPEGs, are left alone*/
+	static bool addRestartMarkers(std::span<const TextureRequest> requests);
+
+	/* Writes the images into one asset pack, compressing the ones that shrink enough. Nothing is written if an image is
+	missing. The pack is written next to path first and read back to check every hash*/
+	static bool packAssets(std::span<const TextureRequest> requests, const char* path);
+};
@@ -0,0 +1,600 @@
+#include "Benchmarks.h"
+#include "AssetReader.h"
+#include "ImageTools.h"
+#include "JpegDecoder.h"
+#include "MeshGenerator.h"
+#include "MeshImporter.h"
+#include "PathTracer.h"
+#include "SoftwareRenderer.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+#include "stb_image.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+    // Thread counts 1, 2, 4, ... up to the number of hardware threads
+    vector<unsigned> threadCounts()
+    {
+        unsigned hardware = max(1u, thread::hardware_concurrency());
+        vector<unsigned> counts;
+        for (unsigned n = 1; n < hardware; n *= 2)
+            counts.push_back(n);
+        counts.push_back(hardware);
+        return counts;
+    }
+
+    // Builds a wavy grid with at least the requested number of triangles
+    void makeGrid(size_t triangles, size_t& side, vector<float>& positions, vector<float>& normals, vector<float>& uvs, vector<uint32_t>& indices)
+    {
+        side = 2;
+        while ((side - 1) * (side - 1) * 2 < triangles)
+            side++;
+        for (size_t y = 0; y < side; y++)
+        {
+            for (size_t x = 0; x < side; x++)
+            {
+                float u = (float)x / (side - 1), v = (float)y / (side - 1);
+                positions.insert(positions.end(), { u * 10.0f, 0.1f * std::sin(u * 40.0f) * std::cos(v * 40.0f), v * 10.0f });
+                normals.insert(normals.end(), { 0.0f, 1.0f, 0.0f });
+                uvs.insert(uvs.end(), { u, v });
+            }
+        }
+        for (size_t y = 0; y + 1 < side; y++)
+        {
+            for (size_t x = 0; x + 1 < side; x++)
+            {
+                uint32_t a = (uint32_t)(y * side + x), b = a + 1, c = a + (uint32_t)side, d = c + 1;
+                indices.insert(indices.end(), { a, c, b, b, c, d });
+            }
+        }
+    }
+
+    void writeObj(const string& path, const vector<float>& positions, const vector<float>& normals, const vector<float>& uvs, const vector<uint32_t>& indices)
+    {
+        ofstream out(path, ios::binary | ios::trunc);
+        char line[128];
+        for (size_t i = 0; i < positions.size() / 3; i++)
+        {
+            out.write(line, snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]));
+            out.write(line, snprintf(line, sizeof(line), "vt %.6f %.6f\n", uvs[i * 2], uvs[i * 2 + 1]));
+            out.write(line, snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]));
+        }
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            uint32_t a = indices[i] + 1, b = indices[i + 1] + 1, c = indices[i + 2] + 1;
+            out.write(line, snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c));
+        }
+    }
+
+    void writeGlb(const string& path, const vector<float>& positions, const vector<float>& normals, const vector<float>& uvs, const vector<uint32_t>& indices)
+    {
+        size_t vertexCount = positions.size() / 3;
+        size_t positionBytes = positions.size() * 4, normalBytes = normals.size() * 4, uvBytes = uvs.size() * 4, indexBytes = indices.size() * 4;
+        size_t binBytes = positionBytes + normalBytes + uvBytes + indexBytes;
+
+        string json = "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":" + to_string(binBytes) + "}],\"bufferViews\":["
+            "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" + to_string(positionBytes) + "},"
+            "{\"buffer\":0,\"byteOffset\":" + to_string(positionBytes) + ",\"byteLength\":" + to_string(normalBytes) + "},"
+            "{\"buffer\":0,\"byteOffset\":" + to_string(positionBytes + normalBytes) + ",\"byteLength\":" + to_string(uvBytes) + "},"
+            "{\"buffer\":0,\"byteOffset\":" + to_string(positionBytes + normalBytes + uvBytes) + ",\"byteLength\":" + to_string(indexBytes) + "}],"
+            "\"accessors\":["
+            "{\"bufferView\":0,\"componentType\":5126,\"count\":" + to_string(vertexCount) + ",\"type\":\"VEC3\"},"
+            "{\"bufferView\":1,\"componentType\":5126,\"count\":" + to_string(vertexCount) + ",\"type\":\"VEC3\"},"
+            "{\"bufferView\":2,\"componentType\":5126,\"count\":" + to_string(vertexCount) + ",\"type\":\"VEC2\"},"
+            "{\"bufferView\":3,\"componentType\":5125,\"count\":" + to_string(indices.size()) + ",\"type\":\"SCALAR\"}],"
+            "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}]}";
+        while (json.size() % 4)
+            json += ' ';
+
+        auto write32 = [](ofstream& out, uint32_t value) { out.write(reinterpret_cast<const char*>(&value), 4); };
+        ofstream out(path, ios::binary | ios::trunc);
+        write32(out, 0x46546C67);
+        write32(out, 2);
+        write32(out, (uint32_t)(12 + 8 + json.size() + 8 + binBytes));
+        write32(out, (uint32_t)json.size());
+        write32(out, 0x4E4F534A);
+        out.write(json.data(), json.size());
+        write32(out, (uint32_t)binBytes);
+        write32(out, 0x004E4942);
+        out.write(reinterpret_cast<const char*>(positions.data()), positionBytes);
+        out.write(reinterpret_cast<const char*>(normals.data()), normalBytes);
+        out.write(reinterpret_cast<const char*>(uvs.data()), uvBytes);
+        out.write(reinterpret_cast<const char*>(indices.data()), indexBytes);
+    }
+}
+
+int Benchmarks::importer(size_t triangles) {
+    size_t side;
+    vector<float> positions, normals, uvs;
+    vector<uint32_t> indices;
+    makeGrid(triangles, side, positions, normals, uvs, indices);
+
+    filesystem::path directory = filesystem::temp_directory_path();
+    string objPath = (directory / "mod7_bench_import.obj").string();
+    string glbPath = (directory / "mod7_bench_import.glb").string();
+    writeObj(objPath, positions, normals, uvs, indices);
+    writeGlb(glbPath, positions, normals, uvs, indices);
+    cout << "Import benchmark: " << indices.size() / 3 << " triangles" << endl;
+
+    bool ok = true;
+    for (const string& path : { objPath, glbPath })
+    {
+        for (unsigned threads : threadCounts())
+        {
+            ThreadPool pool(threads);
+            vector<GLfloat> vertices;
+            ImportStats stats;
+            ImportStats best;
+            for (int run = 0; run < 3; run++)   // Best of three to hide page cache warm-up
+            {
+                if (!MeshImporter::load(path.c_str(), vertices, pool, stats))
+                {
+                    cout << "  failed to import " << path << endl;
+                    ok = false;
+                    break;
+                }
+                if (run == 0 || stats.seconds < best.seconds)
+                    best = stats;
+            }
+            if (best.seconds > 0.0)
+            {
+                cout << "  " << filesystem::path(path).extension().string() << " threads " << threads
+                    << ": " << best.bytes / 1e6 / best.seconds << " MB/s, "
+                    << best.triangles / 1e6 / best.seconds << " M triangles/s" << endl;
+            }
+        }
+        filesystem::remove(path);
+    }
+    return ok ? 0 : 1;
+}
+
+int Benchmarks::generator(int maxSegments) {
+    cout << "Generator benchmark: torus with rings = sides = segments" << endl;
+    for (int segments = 64; segments <= maxSegments; segments *= 2)
+    {
+        double seconds[2] = {};
+        size_t vertexCount = 0;
+        for (int simd = 0; simd < 2; simd++)
+        {
+            if (simd && !MeshGenerator::simdAvailable())
+                break;
+            MeshGenerator::setSimd(simd != 0);
+            vector<GLfloat> vertices;
+            vertices.reserve((size_t)segments * segments * 6 * 8);
+            for (int run = 0; run < 3; run++)   // Best of three
+            {
+                vertices.clear();
+                auto start = chrono::steady_clock::now();
+                MeshGenerator::torus(3.0f, 1.0f, 2.0f, segments, segments, glm::vec3(0.0f), glm::vec2(0.0f), glm::vec2(1.0f), vertices);
+                double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                seconds[simd] = run == 0 ? elapsed : min(seconds[simd], elapsed);
+            }
+            vertexCount = vertices.size() / 8;
+        }
+        MeshGenerator::setSimd(true);
+
+        cout << "  " << segments << " segments, " << vertexCount << " vertices: scalar " << vertexCount / 1e6 / seconds[0] << " M vertices/s";
+        if (seconds[1] > 0.0)
+            cout << ", SSE " << vertexCount / 1e6 / seconds[1] << " M vertices/s (" << seconds[0] / seconds[1] << "x)";
+        cout << endl;
+    }
+    return 0;
+}
+
+int Benchmarks::textures(std::span<const TextureRequest> requests) {
+    cout << "Texture decode benchmark: " << requests.size() << " images" << endl;
+    double serialMs = 0.0;
+    for (unsigned threads : threadCounts())
+    {
+        // Best of three, timed from the first submit until the last image has been picked up
+        double bestMs = 0.0;
+        size_t failed = 0;
+        for (int run = 0; run < 3; run++)
+        {
+            ThreadPool pool(threads);
+            auto start = chrono::steady_clock::now();
+            TextureLoader loader(requests, pool);
+            DecodedImage image;
+            failed = 0;
+            while (loader.next(image))
+            {
+                failed += image.pixels == nullptr;
+                TextureLoader::release(image);
+            }
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            bestMs = run == 0 ? ms : min(bestMs, ms);
+        }
+        if (threads == 1)
+            serialMs = bestMs;
+
+        cout << "  " << threads << " threads: " << bestMs << " ms (" << serialMs / bestMs << "x)";
+        if (failed > 0)
+            cout << ", " << failed << " images failed to load";
+        cout << endl;
+    }
+    return 0;
+}
+
+int Benchmarks::mipmaps(size_t size) {
+    // Smooth gradients with a high frequency pattern on top, so both filters have something to do
+    const uint32_t side = (uint32_t)max<size_t>(size, 1);
+    vector<uint8_t> rgba((size_t)side * side * 4);
+    for (uint32_t y = 0; y < side; y++)
+        for (uint32_t x = 0; x < side; x++)
+        {
+            uint8_t* p = &rgba[((size_t)y * side + x) * 4];
+            p[0] = (uint8_t)(x * 255 / side);
+            p[1] = (uint8_t)(y * 255 / side);
+            p[2] = ((x ^ y) & 4) ? 230 : 20;
+            p[3] = 255;
+        }
+
+    cout << "Mipmap benchmark: " << side << "x" << side << " RGBA, sRGB, full chain" << endl;
+    ThreadPool pool;
+    for (MipFilter filter : { MipFilter::Box, MipFilter::Lanczos })
+    {
+        cout << "  " << (filter == MipFilter::Box ? "box" : "Lanczos-3") << ":";
+        double scalarSeconds = 0.0;
+        for (int config = 0; config < 3; config++)     // Scalar, SSE, SSE on every thread
+        {
+            bool simd = config > 0;
+            if (simd && !ImageTools::simdAvailable())
+                break;
+            ImageTools::setSimd(simd);
+            double best = 0.0;
+            for (int run = 0; run < 3; run++)   // Best of three
+            {
+                vector<vector<uint8_t>> levels;
+                auto start = chrono::steady_clock::now();
+                ImageTools::buildMipChain(rgba.data(), side, side, 4, filter, true, config == 2 ? &pool : nullptr, levels);
+                double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                best = run == 0 ? elapsed : min(best, elapsed);
+            }
+            if (config == 0)
+                scalarSeconds = best;
+            const char* names[] = { "scalar", "SSE", "SSE threaded" };
+            cout << " " << names[config] << " " << best * 1000.0 << " ms (" << scalarSeconds / best << "x)";
+        }
+        ImageTools::setSimd(true);
+        cout << endl;
+    }
+    cout << "  " << pool.size() << " threads" << endl;
+    return 0;
+}
+
+int Benchmarks::jpeg(const char* path) {
+    ifstream file(path, ios::binary | ios::ate);
+    vector<uint8_t> data(file ? (size_t)file.tellg() : 0);
+    file.seekg(0);
+    JpegDecoder decoder;
+    if (!file.read((char*)data.data(), (streamsize)data.size()) || !decoder.open(data.data(), data.size()))
+    {
+        cout << "Cannot read " << path << " as a baseline JPEG" << endl;
+        return 1;
+    }
+    const JpegInfo& info = decoder.info();
+    cout << "JPEG benchmark: " << path << ", " << info.width << "x" << info.height << ", " << data.size() / 1024 << " KB file" << endl;
+
+    // Reference: stb_image decodes every pixel, then box filtering halves it down to the size asked for
+    int width, height, channels;
+    vector<uint8_t> full;
+    vector<vector<uint8_t>> levels;
+    double fullMs = 0.0;
+    for (int run = 0; run < 3; run++)   // Best of three
+    {
+        auto start = chrono::steady_clock::now();
+        stbi_uc* pixels = stbi_load_from_memory(data.data(), (int)data.size(), &width, &height, &channels, 0);
+        levels.clear();
+        ImageTools::buildMipChain(pixels, width, height, channels, MipFilter::Box, true, nullptr, levels);
+        full.assign(pixels, pixels + (size_t)width * height * channels);
+        stbi_image_free(pixels);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        fullMs = run == 0 ? ms : min(fullMs, ms);
+    }
+    size_t fullBytes = (size_t)width * height * channels + ImageTools::mipChainBytes(width, height, channels);
+
+    if (info.restartInterval)
+        cout << "  Restart markers every " << info.restartInterval << " MCUs (" << info.rowMcus << " per row)" << endl;
+    else
+        cout << "  No restart markers: decoded on one thread (--add-restarts rewrites the scene textures)" << endl;
+    ThreadPool pool;
+
+    for (int scale : { 1, 2, 4, 8 })
+    {
+        int scaledWidth = JpegDecoder::scaledSize(info.width, scale), scaledHeight = JpegDecoder::scaledSize(info.height, scale);
+        vector<uint8_t> pixels((size_t)scaledWidth * scaledHeight * info.components);
+        double best = 0.0;
+        for (int run = 0; run < 3; run++)
+        {
+            auto start = chrono::steady_clock::now();
+            decoder.decode(scale, false, pixels.data());
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            best = run == 0 ? ms : min(best, ms);
+        }
+        double bandsMs = 0.0;
+        for (int run = 0; run < 3 && info.restartInterval; run++)
+        {
+            auto start = chrono::steady_clock::now();
+            decoder.decode(scale, false, pixels.data(), &pool);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            bandsMs = run == 0 ? ms : min(bandsMs, ms);
+        }
+
+        // PSNR against the average of each scale x scale area of the full decode. Mip levels are not used here because
+        // they round odd sizes down while the scaled decode rounds them up
+        double squared = 0.0;
+        for (int y = 0; y < scaledHeight; y++)
+            for (int x = 0; x < scaledWidth; x++)
+                for (int c = 0; c < channels; c++)
+                {
+                    int sum = 0, count = 0;
+                    for (int fy = y * scale; fy < min(height, (y + 1) * scale); fy++)
+                        for (int fx = x * scale; fx < min(width, (x + 1) * scale); fx++, count++)
+                            sum += full[((size_t)fy * width + fx) * channels + c];
+                    double d = (double)pixels[((size_t)y * scaledWidth + x) * channels + c] - (double)sum / count;
+                    squared += d * d;
+                }
+        double psnr = squared > 0.0 ? 10.0 * log10(255.0 * 255.0 * pixels.size() / squared) : 99.0;
+
+        size_t scaledBytes = pixels.size() + decoder.workingBytes();
+        cout << "  1/" << scale << " (" << scaledWidth << "x" << scaledHeight << "): " << best << " ms, " << scaledBytes / 1024
+            << " KB; full decode + downsample " << fullMs << " ms, " << fullBytes / 1024 << " KB (" << fullMs / best << "x faster, "
+            << (double)fullBytes / scaledBytes << "x less memory), PSNR " << psnr << " dB" << endl;
+        if (bandsMs > 0.0)
+            cout << "      in bands on " << pool.size() << " threads: " << bandsMs << " ms (" << best / bandsMs << "x)" << endl;
+    }
+    return 0;
+}
+
+int Benchmarks::strips(std::span<const TextureRequest> requests, size_t capBytes) {
+    cout << "Strip decode benchmark: " << requests.size() << " images, " << capBytes / 1024 << " KB cap" << endl;
+    ThreadPool pool;
+    auto start = chrono::steady_clock::now();
+    TextureLoader loader(requests, pool, false, nullptr, nullptr, capBytes);
+
+    // Strips are copied into whole levels here, standing in for the texture the GL thread would upload them to
+    vector<vector<vector<uint8_t>>> textures(requests.size());
+    vector<DecodedImage> images;
+    TextureStrip strip;
+    DecodedImage image;
+    while (!loader.done())
+    {
+        bool busy = false;
+        while (loader.tryNextStrip(strip))
+        {
+            vector<vector<uint8_t>>& levels = textures[strip.index];
+            if (levels.empty())
+                for (int level = 0; level < strip.levels; level++)
+                    levels.emplace_back((size_t)max(1, strip.width >> level) * max(1, strip.height >> level) * strip.channels);
+            size_t rowBytes = (size_t)max(1, strip.width >> strip.level) * strip.channels;
+            memcpy(levels[strip.level].data() + strip.row * rowBytes, strip.pixels.data(), strip.pixels.size());
+            loader.returnStrip(strip);
+            busy = true;
+        }
+        while (loader.tryNext(image))
+        {
+            images.push_back(image);
+            busy = true;
+        }
+        if (!busy)
+            this_thread::yield();
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    StripStats stats = loader.stripStats();
+
+    int result = 0;
+    for (DecodedImage& decoded : images)
+    {
+        const TextureRequest& request = requests[decoded.index];
+        cout << "  " << request.filename << ": ";
+        if (!decoded.stripped)
+        {
+            if (decoded.overCapBytes > 0)
+                cout << "not loaded, needs at least " << decoded.overCapBytes / 1024 << " KB more than the cap" << endl;
+            else
+                cout << "not streamed (not a baseline JPEG, or unreadable)" << endl;
+            TextureLoader::release(decoded);
+            continue;
+        }
+
+        // Reference: the whole image at the same scale, its mip chain, each level flipped as the request asks
+        vector<uint8_t> pixels;
+        int width, height, channels;
+        vector<vector<uint8_t>> levels;
+        if (!JpegDecoder::load(request.filename, decoded.decodeScale, false, pixels, width, height, channels))
+        {
+            cout << "reference decode failed" << endl;
+            result = 1;
+            continue;
+        }
+        ImageTools::buildMipChain(pixels.data(), width, height, channels, MipFilter::Box, true, nullptr, levels);
+        levels.insert(levels.begin(), std::move(pixels));
+        int maxDiff = 0;
+        for (size_t level = 0; level < textures[decoded.index].size(); level++)
+        {
+            const vector<uint8_t>& expected = levels[level + decoded.firstLevel];
+            const vector<uint8_t>& streamed = textures[decoded.index][level];
+            int rows = max(1, height >> (level + decoded.firstLevel));
+            size_t rowBytes = expected.size() / rows;
+            for (int row = 0; row < rows; row++)
+            {
+                int source = request.flip ? rows - 1 - row : row;
+                for (size_t i = 0; i < rowBytes; i++)
+                    maxDiff = max(maxDiff, abs((int)streamed[row * rowBytes + i] - (int)expected[source * rowBytes + i]));
+            }
+        }
+        size_t wholeBytes = (size_t)width * height * channels + ImageTools::mipChainBytes(width, height, channels);
+        cout << width << "x" << height << " at 1/" << decoded.decodeScale << ", " << textures[decoded.index].size() << " levels, largest difference "
+            << maxDiff << " (a whole decode holds " << wholeBytes / 1024 << " KB)" << endl;
+        if (maxDiff > 1)
+            result = 1;
+    }
+
+    cout << "  " << ms << " ms, " << stats.strips << " strips, peak " << stats.peakBytes / 1024 << " KB of the " << stats.capBytes / 1024 << " KB cap, "
+        << stats.stalls << " waits for uploads (" << stats.stallMs << " ms)" << endl;
+    if (stats.peakBytes > stats.capBytes)
+    {
+        cout << "  Cap exceeded" << endl;
+        result = 1;
+    }
+    return result;
+}
+
+int Benchmarks::io(std::span<const TextureRequest> requests) {
+    vector<const char*> paths;
+    for (const TextureRequest& request : requests)
+        paths.push_back(request.filename);
+    bool canEvict = false;     // Missing files aside
+    auto evictAll = [&] {
+        for (const char* path : paths)
+            canEvict = AssetReader::evict(path) || canEvict;
+    };
+    evictAll();
+    cout << "Asset I/O benchmark: " << requests.size() << " images" << (canEvict ? "" : " (cannot evict files from the cache here: cold runs are warm)") << endl;
+
+    ThreadPool pool;
+    const char* names[] = { "decoder reads", "pread", "io_uring" };
+    for (int backend = 0; backend < 3; backend++)
+    {
+        unique_ptr<AssetReader> reader = backend == 0 ? nullptr : AssetReader::create(backend == 1 ? AssetBackend::Pread : AssetBackend::Uring);
+        if (reader && string(reader->name()) != names[backend])
+        {
+            cout << "  " << names[backend] << ": not available, " << reader->name() << " is used instead" << endl;
+            continue;
+        }
+        cout << "  " << names[backend] << ":";
+        for (bool cold : { true, false })
+        {
+            // Reads alone (not for decoder reads, which only happen inside the decodes), then the whole load
+            double readMs = 0.0, loadMs = 0.0;
+            size_t bytes = 0;
+            for (int run = 0; run < (cold ? 1 : 3); run++)     // Best of three when warm
+            {
+                if (reader)
+                {
+                    if (cold)
+                        evictAll();
+                    bytes = 0;
+                    auto start = chrono::steady_clock::now();
+                    reader->readAll(paths, [&](size_t, vector<uint8_t>& data) { bytes += data.size(); });
+                    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                    readMs = run == 0 ? ms : min(readMs, ms);
+                }
+
+                if (cold)
+                    evictAll();
+                auto start = chrono::steady_clock::now();
+                {
+                    TextureLoader loader(requests, pool, false, nullptr, nullptr, 0, reader.get());
+                    DecodedImage image;
+                    while (loader.next(image))
+                        TextureLoader::release(image);
+                }
+                double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                loadMs = run == 0 ? ms : min(loadMs, ms);
+            }
+            cout << (cold ? " cold " : ", warm ");
+            if (reader)
+                cout << "read " << readMs << " ms (" << bytes / (1024.0 * 1024.0) / (readMs / 1000.0) << " MB/s), ";
+            cout << "load " << loadMs << " ms";
+        }
+        cout << endl;
+    }
+    cout << "  " << pool.size() << " decode threads" << endl;
+    return 0;
+}
+
+int Benchmarks::software(const SoftwareScene& scene, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPosition,
+    int width, int height) {
+    cout << "Software renderer benchmark: " << width << "x" << height << ", " << scene.objects.size() << " objects, "
+        << scene.lights.size() << " lights" << endl;
+    double pixels = (double)width * height;
+    double serialMs = 0.0;
+    vector<unsigned> counts = threadCounts();
+    for (int config = 0; config <= (int)counts.size(); config++)   // Each thread count, then scalar on all threads
+    {
+        bool simd = config < (int)counts.size() && SoftwareRenderer::simdAvailable();
+        unsigned threads = config < (int)counts.size() ? counts[config] : counts.back();
+        ThreadPool pool(threads);
+        SoftwareRenderer renderer(width, height, &pool);
+        SoftwareRenderer::setSimd(simd);
+        renderer.render(scene, view, projection, viewPosition);     // Warm up the bins
+        double bestMs = 0.0;
+        SoftwareFrameStats best;
+        for (int run = 0; run < 5; run++)   // Best of five
+        {
+            auto start = chrono::steady_clock::now();
+            renderer.render(scene, view, projection, viewPosition);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            if (run == 0 || ms < bestMs)
+            {
+                bestMs = ms;
+                best = renderer.stats();
+            }
+        }
+        if (config == 0)
+            serialMs = bestMs;
+
+        cout << "  " << (simd ? "AVX2" : "scalar") << ", " << threads << " threads: " << bestMs << " ms (" << pixels / bestMs / 1000.0
+            << " Mpixels/s, " << serialMs / bestMs << "x); geometry " << best.geometryMs << " ms, tiles " << best.rasterMs << " ms" << endl;
+        if (config == 0)
+        {
+            cout << "    " << best.triangles << " triangles, " << best.binned << " after clipping and culling, "
+                << best.fragments << " fragments shaded" << endl;
+        }
+    }
+    SoftwareRenderer::setSimd(true);
+    return 0;
+}
+
+int Benchmarks::reference(const SoftwareScene& scene, const glm::mat4& view, const glm::mat4& projection, int width, int height) {
+    PathTracerSettings settings;
+    settings.samplesPerPixel = 4;
+    settings.samplesPerPass = 4;
+    settings.noiseTarget = 0.0f;    // The same work every run
+    cout << "Path tracer benchmark: " << width << "x" << height << ", " << settings.samplesPerPixel << " samples per pixel, "
+        << settings.maxBounces << " bounces" << endl;
+    double serialRate = 0.0;
+    vector<unsigned> counts = threadCounts();
+    vector<uint8_t> image;
+    for (int config = 0; config <= (int)counts.size(); config++)   // Each thread count, then single rays on all threads
+    {
+        bool packets = config < (int)counts.size() && PathTracer::packetsAvailable();
+        unsigned threads = config < (int)counts.size() ? counts[config] : counts.back();
+        ThreadPool pool(threads);
+        PathTracer tracer(scene, &pool);
+        PathTracer::setPackets(packets);
+        if (config == 0)
+        {
+            cout << "  BVH: " << tracer.stats().triangles << " triangles, " << tracer.stats().nodes << " nodes, depth "
+                << tracer.stats().depth << ", built in " << tracer.stats().buildMs << " ms" << endl;
+        }
+        PathTracerStats best;
+        for (int run = 0; run < 3; run++)   // Best of three
+        {
+            tracer.render(view, projection, width, height, settings, image);
+            if (run == 0 || tracer.stats().renderMs < best.renderMs)
+                best = tracer.stats();
+        }
+        double rate = best.rays / best.renderMs / 1000.0;
+        if (config == 0)
+            serialRate = rate;
+        cout << "  " << (packets ? "packets" : "single rays") << ", " << threads << " threads: " << best.renderMs << " ms, "
+            << best.rays << " rays (" << rate << " Mrays/s, " << rate / serialRate << "x), " << best.steals << " steals" << endl;
+    }
+    PathTracer::setPackets(true);
+    return 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+# include <cstddef>
+# include <span>
+# include <glm/glm.hpp>
+
+struct TextureRequest;
+struct SoftwareScene;
+enum class AssetBackend;
+
+// Class to run the command-line benchmarks (--bench-*). Each returns a process exit code
+class Benchmarks
+{
+public:
+	// Generates synthetic OBJ and GLB files of the given size and reports import throughput per thread count
+	static int importer(size_t triangles);
+
+	// Times torus generation at increasing tessellation with the SSE and scalar kernels
+	static int generator(int maxSegments);
+
+	// Decodes the given images on 1, 2, 4, ... worker threads and reports the speedup over one thread
+	static int textures(std::span<const TextureRequest> requests);
+
+	// Builds the mip chain of a synthetic size x size RGBA image with each filter, scalar and SSE, on one and all threads
+	static int mipmaps(size_t size);
+
+	/* Decodes a JPEG at 1/1, 1/2, 1/4 and 1/8 scale and compares time and memory with a full decode plus box
+	downsampling; files with restart markers are also decoded in bands on every core*/
+	static int jpeg(const char* path);
+
+	/* Streams the JPEGs among the images through the strip path under a memory cap, rebuilds their levels from the
+	strips and checks them against a whole-image decode. Fails if the path held more than the cap or a level differs;
+	images that cannot fit under the cap are only reported*/
+	static int strips(std::span<const TextureRequest> requests, size_t capBytes);
+
+	/* Loads the images with each decoder reading its own file, then through each asset reader, with the files evicted
+	from the page cache first (cold) and again with them cached (warm). Reports read-only and full decode times*/
+	static int io(std::span<const TextureRequest> requests);
+
+	/* Renders the scene from one view on the CPU with 1, 2, 4, ... threads, then with the scalar kernels on all of them.
+	Reports frame time, megapixels per second and the speedup over one thread*/
+	static int software(const SoftwareScene& scene, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPosition,
+		int width, int height);
+
+	/* Path traces the scene from one view at a fixed sample count with 1, 2, 4, ... threads in ray packets, then with
+	single rays on all of them. Reports rays per second, the speedup over one thread and how often tiles were stolen*/
+	static int reference(const SoftwareScene& scene, const glm::mat4& view, const glm::mat4& projection, int width, int height);
+};
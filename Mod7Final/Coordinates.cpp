@@ -1,9 +1,36 @@
 #include "Coordinates.h"
-# include <vector>
+#include "MeshGenerator.h"
+#include <vector>
 
-std::vector<GLfloat>* Coordinates::getPlaneCoords() {
+namespace
+{
+    // Procedural replacements, empty while the hand-typed coordinates are in use
+    std::vector<GLfloat> gDonut, gGlassTop, gGlassSide, gCapTop, gCapSide;
+}
+
+void Coordinates::setTessellation(int segments) {
+    gDonut.clear();
+    gGlassTop.clear();
+    gGlassSide.clear();
+    gCapTop.clear();
+    gCapSide.clear();
+    if (segments <= 0)
+        return;
+
+    /* Each radius gives the circle the area of the hand-typed octagon it replaces, so the shapes keep their size. Texture
+    coordinates stay in the atlas cells the hand-typed ones used: the donut's outer side, top and inner side in the upper
+    right quarter, the glass milk in the top left cell, rims of the disks at the top of their cell, one wall texture per
+    eighth of the glass and cap*/
+    MeshGenerator::torus(2.64f, 1.58f, 2.0f, segments, segments / 2, glm::vec3(5.5f, 1.0f, 10.5f), glm::vec2(0.5f), glm::vec2(1.0f), gDonut);
+    MeshGenerator::cylinder(3.17f, 5.11f, 10.0f, segments, 8.0f, glm::vec3(-12.0f, 0.0f, 7.0f), gGlassSide);
+    MeshGenerator::disk(5.11f, segments, true, glm::vec3(-12.0f, 10.0f, 7.0f), glm::vec2(0.05f, 0.5f), glm::vec2(0.3f, 1.0f), gGlassTop);
+    MeshGenerator::cylinder(1.06f, 1.06f, 1.0f, segments, 8.0f, glm::vec3(0.0f), gCapSide);
+    MeshGenerator::disk(1.06f, segments, false, glm::vec3(0.0f), glm::vec2(0.0f), glm::vec2(1.0f), gCapTop);
+}
+
+std::span<const GLfloat, 48> Coordinates::getPlaneCoords() {
     // Define vertex data for plane
-    std::vector<GLfloat>* plane = new std::vector<GLfloat>
+    static constexpr GLfloat plane[] =
     {  // poistion x, y, z	     normals x, y, z    textcoordinates x, y     
         -25.0f, 0.0f, -20.0f,	0.0f, 1.0f, 0.0f,		0.0f, 1.0f,
          25.0f, 0.0f, -20.0f,	0.0f, 1.0f, 0.0f,		1.0f, 1.0f,
@@ -15,9 +42,9 @@ std::vector<GLfloat>* Coordinates::getPlaneCoords() {
     return plane;
 }
 
-std::vector<GLfloat>* Coordinates::getMilkBotCoords() {
+std::span<const GLfloat, 192> Coordinates::getMilkBotCoords() {
     // Define vertex data for milk bottom
-    std::vector<GLfloat>* milkBottom = new std::vector<GLfloat>
+    static constexpr GLfloat milkBottom[] =
     {
         -13.0f, 18.0f,  -3.0f,	    0.0f, 0.0f, 1.0f,		0.0f, 0.5f,	 //8
         -13.0f,  0.0f,  -3.0f,	    0.0f, 0.0f, 1.0f,		0.0f, 0.0f,	 //4
@@ -40,19 +67,19 @@ std::vector<GLfloat>* Coordinates::getMilkBotCoords() {
         -13.0f,  0.0f, -15.0f,	   -1.0f, 0.0f, 0.0f,		0.2f, 0.0f,  //1
         -13.0f,  0.0f,  -3.0f,	   -1.0f, 0.0f, 0.0f,		0.4f, 0.0f,  //4
 
-        -1.0f,  18.0f, -15.0f,  	0.0f, 0.0f, 1.0f,		0.6f, 0.5f,  //6
-        -1.0f,  18.0f,  -3.0f,	    0.0f, 0.0f, 1.0f,		0.4f, 0.5f,  //7 
-        -1.0f,   0.0f,  -3.0f,	    0.0f, 0.0f, 1.0f,		0.4f, 0.0f,  //3	Right side of Almond Milk cube
-        -1.0f,  18.0f, -15.0f,	    0.0f, 0.0f, 1.0f,		0.6f, 0.5f,  //6
-        -1.0f,   0.0f, -15.0f,	    0.0f, 0.0f, 1.0f,		0.6f, 0.0f,  //2
-        -1.0f,   0.0f,  -3.0f,	    0.0f, 0.0f, 1.0f,		0.4f, 0.0f   //3
+        -1.0f,  18.0f, -15.0f,  	1.0f, 0.0f, 0.0f,		0.6f, 0.5f,  //6
+        -1.0f,  18.0f,  -3.0f,	    1.0f, 0.0f, 0.0f,		0.4f, 0.5f,  //7 
+        -1.0f,   0.0f,  -3.0f,	    1.0f, 0.0f, 0.0f,		0.4f, 0.0f,  //3	Right side of Almond Milk cube
+        -1.0f,  18.0f, -15.0f,	    1.0f, 0.0f, 0.0f,		0.6f, 0.5f,  //6
+        -1.0f,   0.0f, -15.0f,	    1.0f, 0.0f, 0.0f,		0.6f, 0.0f,  //2
+        -1.0f,   0.0f,  -3.0f,	    1.0f, 0.0f, 0.0f,		0.4f, 0.0f   //3
     };
     return milkBottom;
 }
 
-std::vector<GLfloat>* Coordinates::getMilkTopCoords() {
+std::span<const GLfloat, 144> Coordinates::getMilkTopCoords() {
     // Define vertex data for milk top
-    std::vector<GLfloat>* milkTop = new std::vector<GLfloat>
+    static constexpr GLfloat milkTop[] =
     {
         -13.0f, 18.0f, -15.0f,	   -1.0f, 0.0f, 0.0f,		0.5f,  0.55f, //5
         -13.0f, 18.0f,  -3.0f,	   -1.0f, 0.0f, 0.0f,		1.0f,  0.55f, //8
@@ -78,9 +105,12 @@ std::vector<GLfloat>* Coordinates::getMilkTopCoords() {
     };
     return milkTop;
 }
-std::vector<GLfloat>* Coordinates::getCapTopCoords() {
+std::span<const GLfloat> Coordinates::getCapTopCoords() {
+    if (!gCapTop.empty())
+        return gCapTop;
+
     // Define vertex data for cap top
-    std::vector<GLfloat>* capTop = new std::vector<GLfloat>
+    static constexpr GLfloat capTop[] =
     {
         -1.0f, 0.0f, -0.5f,     0.0f, -1.0f, 0.0f,		0.0f, 1.0f, //1
         -0.5f, 0.0f, -1.0f, 	0.0f, -1.0f, 0.0f,		1.0f, 1.0f, //2
@@ -116,9 +146,12 @@ std::vector<GLfloat>* Coordinates::getCapTopCoords() {
     };
     return capTop;
 }
-std::vector<GLfloat>* Coordinates::getCapSideCoords() {
+std::span<const GLfloat> Coordinates::getCapSideCoords() {
+    if (!gCapSide.empty())
+        return gCapSide;
+
     // Define vertex data for cap sides
-    std::vector<GLfloat>* capSide = new std::vector<GLfloat>
+    static constexpr GLfloat capSide[] =
     {
         -1.0f, 1.0f, -0.5f,     -1.0, 0.0f, -1.0f,      0.0f, 0.5f, //1
         -0.5f, 1.0f, -1.0f,     -1.0, 0.0f, -1.0f,      0.5f, 1.0f, //2
@@ -178,9 +211,9 @@ std::vector<GLfloat>* Coordinates::getCapSideCoords() {
     };
     return capSide;
 }
-std::vector<GLfloat>* Coordinates::getMilkPlaneCoords() {
+std::span<const GLfloat, 48> Coordinates::getMilkPlaneCoords() {
     // Define vertex data for milk plane on top of carton
-    std::vector<GLfloat>* plane = new std::vector<GLfloat>
+    static constexpr GLfloat plane[] =
     {  // poistion x, y, z	     normals x, y, z    textcoordinates x, y     
         -4.0f, 24.0f, -9.0f,	0.0f, 0.0f, 1.0f,		1.0f, 0.0f,
         -10.0f, 24.0f, -9.0f,	0.0f, 0.0f, 1.0f,		0.0f, 0.0f,
@@ -192,9 +225,9 @@ std::vector<GLfloat>* Coordinates::getMilkPlaneCoords() {
     };
     return plane;
 }
-std::vector<GLfloat>* Coordinates::getBoxCoords() {
+std::span<const GLfloat, 240> Coordinates::getBoxCoords() {
     // Define vertex data for donut box
-    std::vector<GLfloat>* box = new std::vector<GLfloat>
+    static constexpr GLfloat box[] =
     {
         11.0f, 5.0f, -12.0f,    -1.0f, 0.0f, -1.0f,		0.5f, 0.75f, //5
          6.0f, 5.0f,  -7.0f,	-1.0f, 0.0f, -1.0f,		1.0f, 0.75f, //8
@@ -234,9 +267,12 @@ std::vector<GLfloat>* Coordinates::getBoxCoords() {
     };
     return box;
 }
-std::vector<GLfloat>* Coordinates::getDonutCoords() {
+std::span<const GLfloat> Coordinates::getDonutCoords() {
+    if (!gDonut.empty())
+        return gDonut;
+
     // Define vertex data for DONUT
-    std::vector<GLfloat>* donut = new std::vector<GLfloat>
+    static constexpr GLfloat donut[] =
     {	// Top of donut (sprinkles)
         2.0f, 2.0f, 9.0f,    0.0f, 1.0f, 0.0f,		1.0f, 0.65f, //1
         4.0f, 2.0f, 7.0f,    0.0f, 1.0f, 0.0f,	    0.5f, 0.65f, //2
@@ -639,9 +675,12 @@ std::vector<GLfloat>* Coordinates::getDonutCoords() {
     };
     return donut;
 }
-std::vector<GLfloat>* Coordinates::getGlassTopcoords() {
+std::span<const GLfloat> Coordinates::getGlassTopcoords() {
+    if (!gGlassTop.empty())
+        return gGlassTop;
+
     // Define vertex data for glass top
-    std::vector<GLfloat>* glassTop = new std::vector<GLfloat>
+    static constexpr GLfloat glassTop[] =
     {
         -17.0f, 10.0f, 5.0f,	0.0f, 0.0f, 1.0f,		0.05f, 1.0, //A
         -14.0f, 10.0f, 2.0f,	0.0f, 0.0f, 1.0f,		0.3f,  1.0, //B
@@ -677,9 +716,12 @@ std::vector<GLfloat>* Coordinates::getGlassTopcoords() {
     };
     return glassTop;
 }
-std::vector<GLfloat>* Coordinates::getGlassSideCoords() {
+std::span<const GLfloat> Coordinates::getGlassSideCoords() {
+    if (!gGlassSide.empty())
+        return gGlassSide;
+
     // Define vertex data for glass side
-    std::vector<GLfloat>* glassSide = new std::vector<GLfloat>
+    static constexpr GLfloat glassSide[] =
     {
         -17.0f, 10.0f,  5.0f,   -1.0f, 0.0f, -1.0f,		0.0f, 1.0f, //A
         -14.0f, 10.0f,  2.0f,	-1.0f, 0.0f, -1.0f,		1.0f, 1.0f, //B
@@ -739,9 +781,9 @@ std::vector<GLfloat>* Coordinates::getGlassSideCoords() {
     };
     return glassSide;
 }
-std::vector<GLfloat>* Coordinates::getLightCoords() {
+std::span<const GLfloat, 108> Coordinates::getLightCoords() {
     // Define vertex data for lights
-    std::vector<GLfloat>* light = new std::vector<GLfloat>
+    static constexpr GLfloat light[] =
     {
         -1.0f, 0.0f, -1.0f,    // Base Triangle 1 (bottom)
         -1.0f, 0.0f,  1.0f,
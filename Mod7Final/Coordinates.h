@@ -1,21 +1,26 @@
 #pragma once
-# include <vector>
+# include <span>
 # include <GL/glew.h> 
 
 // Class to hold position, normal, and texture coordinates for each primitve object
 class Coordinates
 {
 public:
-	// Functions return coordinates for objects
-	static std::vector<GLfloat>* getPlaneCoords();
-	static std::vector<GLfloat>* getMilkBotCoords();
-	static std::vector<GLfloat>* getMilkTopCoords();
-	static std::vector<GLfloat>* getCapTopCoords();
-	static std::vector<GLfloat>* getCapSideCoords();
-	static std::vector<GLfloat>* getMilkPlaneCoords();
-	static std::vector<GLfloat>* getBoxCoords();
-	static std::vector<GLfloat>* getDonutCoords();
-	static std::vector<GLfloat>* getGlassTopcoords();
-	static std::vector<GLfloat>* getGlassSideCoords();
-	static std::vector<GLfloat>* getLightCoords();
+	// Functions return views of the static coordinate arrays for objects (no copies or heap allocations), sized to the array
+	static std::span<const GLfloat, 48> getPlaneCoords();
+	static std::span<const GLfloat, 192> getMilkBotCoords();
+	static std::span<const GLfloat, 144> getMilkTopCoords();
+	static std::span<const GLfloat, 48> getMilkPlaneCoords();
+	static std::span<const GLfloat, 240> getBoxCoords();
+	static std::span<const GLfloat, 108> getLightCoords();
+
+	// These return the procedural meshes instead while a tessellation is set, so their size is only known at run time
+	static std::span<const GLfloat> getCapTopCoords();
+	static std::span<const GLfloat> getCapSideCoords();
+	static std::span<const GLfloat> getDonutCoords();
+	static std::span<const GLfloat> getGlassTopcoords();
+	static std::span<const GLfloat> getGlassSideCoords();
+
+	// Replace the hand-typed donut, glass and cap with procedural meshes of the given segment count (0 restores them)
+	static void setTessellation(int segments);
 }; 
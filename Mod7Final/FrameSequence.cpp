@@ -0,0 +1,155 @@
+#include "FrameSequence.h"
+#include "PngFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+
+namespace
+{
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool writeFile(const std::string& path, const uint8_t* data, size_t size)
+    {
+        FILE* file = std::fopen(path.c_str(), "wb");
+        bool written = file && std::fwrite(data, 1, size, file) == size;
+        if (file && std::fclose(file) != 0)
+            written = false;
+        if (!written)
+            std::cout << "Failed to write " << path << std::endl;
+        return written;
+    }
+}
+
+FrameSequence::FrameSequence(const std::string& directory, int width, int height, FrameFormat format, ThreadPool& pool, int ringSize)
+    : directory(directory), width(width), height(height), format(format), pool(pool), maxInFlight(2 * (size_t)pool.size()),
+    ring(std::max(ringSize, 1)), lastCapture(std::chrono::steady_clock::now()) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    for (Slot& slot : ring)
+    {
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+FrameSequence::~FrameSequence() {
+    for (std::future<Encoded>& job : encoding)
+        job.wait();
+    for (Slot& slot : ring)
+    {
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.buffer);
+    }
+}
+
+void FrameSequence::capture() {
+    sequenceStats.renderMs += millisecondsSince(lastCapture);
+    Slot& slot = ring[next];
+    if (slot.frame >= 0)
+        collect(slot);      // The oldest frame, drawn ring.size() - 1 frames ago
+
+    auto start = std::chrono::steady_clock::now();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);     // Into the buffer, so it returns at once
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = sequenceStats.frames++;
+    next = (next + 1) % ring.size();
+    sequenceStats.readMs += millisecondsSince(start);
+    lastCapture = std::chrono::steady_clock::now();
+}
+
+bool FrameSequence::finish() {
+    for (size_t i = 0; i < ring.size(); i++)
+    {
+        Slot& slot = ring[(next + i) % ring.size()];    // Oldest first
+        if (slot.frame >= 0)
+            collect(slot);
+    }
+    while (!encoding.empty())
+        retire();
+    return failed == 0;
+}
+
+void FrameSequence::collect(Slot& slot) {
+    auto start = std::chrono::steady_clock::now();
+    if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+    {
+        sequenceStats.stalls++;
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    int frame = slot.frame;
+    slot.frame = -1;
+
+    size_t bytes = (size_t)width * height * 4;
+    auto pixels = std::make_shared<std::vector<uint8_t>>(bytes);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)bytes, GL_MAP_READ_BIT);
+    if (mapped)
+    {
+        std::memcpy(pixels->data(), mapped, bytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    sequenceStats.mapMs += millisecondsSince(start);
+    if (!mapped)
+    {
+        std::cout << "Failed to map the pixels of frame " << frame << std::endl;
+        failed++;
+        return;
+    }
+
+    // Frames wait in memory while every encoder is busy; past maxInFlight the GL thread waits too
+    auto queued = std::chrono::steady_clock::now();
+    while (encoding.size() >= maxInFlight)
+        retire();
+    sequenceStats.queueMs += millisecondsSince(queued);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), format == FrameFormat::Png ? "frame-%05d.png" : "frame-%05d.rgba", frame);
+    std::string path = (std::filesystem::path(directory) / name).string();
+    encoding.push_back(pool.submit([path, pixels, width = width, height = height, format = format] {
+        auto start = std::chrono::steady_clock::now();
+        Encoded result = {};
+        if (format == FrameFormat::Png)
+        {
+            std::vector<uint8_t> png;
+            PngFile::encode(pixels->data(), (uint32_t)width, (uint32_t)height, 4, true, png);
+            result.written = writeFile(path, png.data(), png.size());
+            result.bytes = png.size();
+        }
+        else
+        {
+            // glReadPixels rows go bottom to top; files go top to bottom like the PNGs
+            size_t rowBytes = (size_t)width * 4;
+            for (int y = 0; y < height / 2; y++)
+                std::swap_ranges(pixels->begin() + y * rowBytes, pixels->begin() + (y + 1) * rowBytes, pixels->begin() + (height - 1 - y) * rowBytes);
+            result.written = writeFile(path, pixels->data(), pixels->size());
+            result.bytes = pixels->size();
+        }
+        result.ms = millisecondsSince(start);
+        return result;
+    }));
+}
+
+void FrameSequence::retire() {
+    Encoded result = encoding.front().get();
+    encoding.pop_front();
+    sequenceStats.encodeMs += result.ms;
+    if (result.written)
+        sequenceStats.bytes += result.bytes;
+    else
+        failed++;
+}
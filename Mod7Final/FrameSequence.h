@@ -0,0 +1,83 @@
+#pragma once
+# include <GL/glew.h>
+# include <chrono>
+# include <cstddef>
+# include <cstdint>
+# include <deque>
+# include <future>
+# include <string>
+# include <vector>
+
+class ThreadPool;
+
+// File format of the frames of a sequence
+enum class FrameFormat
+{
+	Png,
+	Raw,	// RGBA8 rows top to bottom with no header (ffmpeg -f rawvideo -pix_fmt rgba -s WxH)
+};
+
+// Where the time of a sequence went, summed over its frames
+struct FrameSequenceStats
+{
+	int frames = 0;
+	double renderMs = 0.0;		// GL thread: between one capture and the next, drawing the frame
+	double readMs = 0.0;		// GL thread: starting the copies into the pixel pack buffers
+	double mapMs = 0.0;			// GL thread: waiting for copies to land and copying them out of the buffers
+	size_t stalls = 0;			// Frames whose copy was not done when the ring came back around to them
+	double queueMs = 0.0;		// GL thread: waiting for an encoder because too many frames were in flight
+	double encodeMs = 0.0;		// Encoder threads, summed: encoding and writing the files
+	size_t bytes = 0;			// Written to disk
+};
+
+/* Class to write the frames of an offline render to numbered files without ever waiting on the GPU for the frame just
+drawn. Each frame is copied from the bound framebuffer into the next of a ring of pixel pack buffers and fenced; a
+buffer is only mapped when the ring comes back around to it, ringSize - 1 frames later. The pixels then go to the pool
+to be encoded and written while the GL thread draws on. GL thread only*/
+class FrameSequence
+{
+public:
+	FrameSequence(const std::string& directory, int width, int height, FrameFormat format, ThreadPool& pool, int ringSize = 3);
+	~FrameSequence();
+
+	FrameSequence(const FrameSequence&) = delete;
+	FrameSequence& operator=(const FrameSequence&) = delete;
+
+	// After each frame is drawn into the bound framebuffer
+	void capture();
+
+	// Reads back the frames still in the ring and waits for every file. False (with a message) if any could not be written
+	bool finish();
+
+	const FrameSequenceStats& stats() const { return sequenceStats; }
+
+private:
+	struct Slot
+	{
+		GLuint buffer = 0;
+		GLsync fence = nullptr;
+		int frame = -1;			// Frame being copied into the buffer, -1 when free
+	};
+
+	struct Encoded
+	{
+		bool written;
+		double ms;
+		size_t bytes;
+	};
+
+	void collect(Slot& slot);	// Maps the slot's frame and hands it to an encoder
+	void retire();				// Waits for the oldest encoder job
+
+	const std::string directory;
+	const int width, height;
+	const FrameFormat format;
+	ThreadPool& pool;
+	const size_t maxInFlight;	// Frames held by encoders at once, which bounds memory
+	std::vector<Slot> ring;
+	size_t next = 0;			// Slot the next frame is copied into
+	std::deque<std::future<Encoded>> encoding;
+	std::chrono::steady_clock::time_point lastCapture;
+	int failed = 0;
+	FrameSequenceStats sequenceStats;
+};
@@ -0,0 +1,88 @@
+#include "GoldenImages.h"
+#include "ImageCompare.h"
+#include "PngFile.h"
+#include "ThreadPool.h"
+#include "stb_image.h"
+#include <cstdio>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+namespace
+{
+    // How far a frame may stray from its golden: mean SSIM, the share of pixels whose window falls under
+    // GOLDEN_LOCAL_SSIM (a small spot that changed), and the mean color difference that SSIM of the luma misses
+    const double GOLDEN_MIN_SSIM = 0.99;
+    const float GOLDEN_LOCAL_SSIM = 0.9f;
+    const double GOLDEN_OUTLIER_TOLERANCE = 0.002;
+    const double GOLDEN_MEAN_TOLERANCE = 1.0;
+}
+
+bool GoldenImages::check(const char* directory, bool update, const vector<vector<uint8_t>>& frames, int width, int height) {
+    filesystem::path goldens = directory;
+    error_code error;
+    if (update)
+        filesystem::create_directories(goldens, error);
+
+    ThreadPool pool;
+    vector<future<pair<bool, string>>> results;
+    for (size_t f = 0; f < frames.size(); f++)
+    {
+        results.push_back(pool.submit([&frames, &goldens, update, f, width, height] {
+            char name[32];
+            snprintf(name, sizeof(name), "frame-%03zu", f);
+            string golden = (goldens / (string(name) + ".png")).string();
+            string heatmapPath = (goldens / (string(name) + "-diff.png")).string();
+            ostringstream report;
+            if (update)
+            {
+                bool written = PngFile::write(golden.c_str(), frames[f].data(), width, height, 4, true);
+                report << "Frame " << f << ": " << (written ? "wrote " : "could not write ") << golden;
+                return make_pair(written, report.str());
+            }
+
+            int goldenWidth, goldenHeight, channels;
+            stbi_set_flip_vertically_on_load_thread(true);  // Rows bottom to top, like the frames
+            unsigned char* pixels = stbi_load(golden.c_str(), &goldenWidth, &goldenHeight, &channels, 4);
+            if (!pixels || goldenWidth != width || goldenHeight != height)
+            {
+                stbi_image_free(pixels);
+                report << "Frame " << f << ": no " << width << "x" << height << " golden at " << golden;
+                return make_pair(false, report.str());
+            }
+            vector<uint8_t> heatmap;
+            ImageDifference difference = ImageCompare::compare(pixels, frames[f].data(), width, height, GOLDEN_LOCAL_SSIM, &heatmap);
+            stbi_image_free(pixels);
+            bool matches = difference.ssim >= GOLDEN_MIN_SSIM && difference.outliers <= GOLDEN_OUTLIER_TOLERANCE
+                && difference.meanError <= GOLDEN_MEAN_TOLERANCE;
+            report << "Frame " << f << ": SSIM " << difference.ssim << ", " << difference.outliers * 100.0 << "% of pixels under "
+                << GOLDEN_LOCAL_SSIM << ", mean difference " << difference.meanError;
+            error_code removed;
+            if (matches)
+                filesystem::remove(heatmapPath, removed);   // From an earlier failure
+            else if (PngFile::write(heatmapPath.c_str(), heatmap.data(), width, height, 3, true))
+                report << " - beyond tolerance, see " << heatmapPath;
+            else
+                report << " - beyond tolerance";
+            return make_pair(matches, report.str());
+        }));
+    }
+    int failed = 0;
+    for (future<pair<bool, string>>& result : results)
+    {
+        pair<bool, string> outcome = result.get();
+        cout << outcome.second << endl;
+        failed += !outcome.first;
+    }
+    if (!update)
+    {
+        cout << "Goldens in " << directory << ": " << (failed == 0 ? "all match, " : "") << failed << " of " << frames.size()
+            << " frames beyond tolerance or missing" << endl;
+    }
+    return failed == 0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+# include <cstdint>
+# include <vector>
+
+/* Class to keep rendered frames from drifting: frame N is compared with frame-NNN.png in a golden directory by SSIM
+(see ImageCompare), within the tolerances documented in goldens/README.md*/
+class GoldenImages
+{
+public:
+	/* Compares each RGBA8 frame of width x height (rows bottom to top, as glReadPixels returns them) with its golden,
+	or with update writes the frames as the goldens instead. Frames are spread over every core. A frame beyond tolerance
+	gets a heatmap of where it differs, frame-NNN-diff.png, next to its golden. False if any frame differs, has no
+	golden or cannot be written*/
+	static bool check(const char* directory, bool update, const std::vector<std::vector<uint8_t>>& frames, int width, int height);
+};
@@ -0,0 +1,151 @@
+#include "HeadlessContext.h"
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace
+{
+    // True if the space separated extension list has name
+    bool hasExtension(const char* extensions, const char* name)
+    {
+        size_t length = std::strlen(name);
+        for (const char* at = extensions; at && (at = std::strstr(at, name)) != nullptr; at += length)
+        {
+            if ((at == extensions || at[-1] == ' ') && (at[length] == ' ' || at[length] == '\0'))
+                return true;
+        }
+        return false;
+    }
+}
+
+HeadlessContext::~HeadlessContext() {
+    destroy();
+}
+
+#ifdef _WIN32
+bool HeadlessContext::create(int, int) {
+    std::cout << "Headless rendering needs EGL, which this build does not have" << std::endl;
+    return false;
+}
+
+void HeadlessContext::destroy() {
+}
+#else
+bool HeadlessContext::create(int width, int height) {
+    // Mesa's surfaceless platform needs no X or Wayland server, or even a GPU device; fall back to the default display
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    if (getPlatformDisplay && hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (eglDisplay == EGL_NO_DISPLAY)
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major, minor;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor))
+    {
+        std::cout << "Failed to initialize EGL (error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        return false;
+    }
+    display = eglDisplay;
+
+    // The scene draws into its own framebuffer, so the config only has to make a desktop GL context
+    bool surfaceless = hasExtension(eglQueryString(eglDisplay, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, surfaceless ? EGL_DONT_CARE : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configs = 0;
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 4,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    if (!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configs) || configs == 0 || !eglBindAPI(EGL_OPENGL_API)
+        || (context = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes)) == EGL_NO_CONTEXT)
+    {
+        std::cout << "Failed to create an OpenGL 4.4 core context through EGL " << major << "." << minor << " (error 0x"
+            << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        context = nullptr;
+        destroy();
+        return false;
+    }
+    if (!surfaceless)
+    {
+        const EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(eglDisplay, config, pbufferAttributes);
+    }
+    if ((!surfaceless && surface == EGL_NO_SURFACE) || !eglMakeCurrent(eglDisplay, (EGLSurface)surface, (EGLSurface)surface, (EGLContext)context))
+    {
+        std::cout << "Failed to make the EGL context current (error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        destroy();
+        return false;
+    }
+
+    // glewInit() also looks for a GLX display, which a headless machine lacks; the context's own functions are all it needs
+    glewExperimental = GL_TRUE;
+    GLenum glewResult = glewContextInit();
+    if (glewResult != GLEW_OK)
+    {
+        std::cout << "Failed to load OpenGL functions: " << glewGetErrorString(glewResult) << std::endl;
+        destroy();
+        return false;
+    }
+
+    // Everything is drawn into this framebuffer, which stays bound
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Offscreen framebuffer of " << width << "x" << height << " is incomplete" << std::endl;
+        destroy();
+        return false;
+    }
+    glViewport(0, 0, width, height);
+    frameWidth = width;
+    frameHeight = height;
+    std::cout << "Rendering headless on " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")" << std::endl;
+    return true;
+}
+
+void HeadlessContext::destroy() {
+    if (context && framebuffer)
+    {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+    }
+    framebuffer = colorBuffer = depthBuffer = 0;
+    if (display)
+    {
+        eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (surface)
+            eglDestroySurface((EGLDisplay)display, (EGLSurface)surface);
+        if (context)
+            eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+        eglTerminate((EGLDisplay)display);
+    }
+    display = context = surface = nullptr;
+    frameWidth = frameHeight = 0;
+}
+#endif
+
+void HeadlessContext::readPixels(std::vector<uint8_t>& rgba) const {
+    rgba.resize((size_t)frameWidth * frameHeight * 4);
+    glReadPixels(0, 0, frameWidth, frameHeight, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+}
@@ -0,0 +1,32 @@
+#pragma once
+# include <GL/glew.h>
+# include <cstdint>
+# include <vector>
+
+/* Class to render without a window or display: an OpenGL 4.4 core context made through EGL (surfaceless where the
+driver offers it, on a small pbuffer otherwise) and a framebuffer object the scene is drawn into instead of a window's
+back buffer. Works on machines with only a software rasterizer such as Mesa's llvmpipe. Not available on Windows*/
+class HeadlessContext
+{
+public:
+	~HeadlessContext();
+
+	/* Creates the context, makes it current on this thread, loads the GL functions and binds a width x height
+	framebuffer with color and depth. False (with a message) if EGL or the context cannot be had*/
+	bool create(int width, int height);
+	void destroy();
+
+	// Copies the last frame out as RGBA8, rows bottom to top, waiting for it to finish
+	void readPixels(std::vector<uint8_t>& rgba) const;
+
+	int width() const { return frameWidth; }
+	int height() const { return frameHeight; }
+
+private:
+	void* display = nullptr;		// EGLDisplay, EGLContext and EGLSurface, kept out of this header
+	void* context = nullptr;
+	void* surface = nullptr;		// Only when the driver cannot make a context current without one
+	GLuint framebuffer = 0;
+	GLuint colorBuffer = 0, depthBuffer = 0;
+	int frameWidth = 0, frameHeight = 0;
+};
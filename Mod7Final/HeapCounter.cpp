@@ -0,0 +1,48 @@
+#include "HeapCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<bool> gCounting{ false };
+    std::atomic<size_t> gAllocations{ 0 };
+    std::atomic<size_t> gBytes{ 0 };
+}
+
+// Array, nothrow and sized forms all end up in these through the standard library's defaults
+void* operator new(std::size_t size)
+{
+    if (gCounting.load(std::memory_order_relaxed))
+    {
+        gAllocations.fetch_add(1, std::memory_order_relaxed);
+        gBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    if (void* memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void HeapCounter::start() {
+    gAllocations.store(0, std::memory_order_relaxed);
+    gBytes.store(0, std::memory_order_relaxed);
+    gCounting.store(true, std::memory_order_relaxed);
+}
+
+HeapUsage HeapCounter::stop() {
+    gCounting.store(false, std::memory_order_relaxed);
+    HeapUsage usage;
+    usage.allocations = gAllocations.load(std::memory_order_relaxed);
+    usage.bytes = gBytes.load(std::memory_order_relaxed);
+    return usage;
+}
@@ -0,0 +1,22 @@
+#pragma once
+# include <cstddef>
+
+// Heap use between HeapCounter::start and HeapCounter::stop
+struct HeapUsage
+{
+	size_t allocations = 0;		// Calls to operator new
+	size_t bytes = 0;			// Bytes they asked for (frees are not subtracted)
+};
+
+/* Class to measure heap traffic: HeapCounter.cpp replaces the global operator new and delete with malloc and free.
+Allocations are only counted between start and stop; outside that window operator new costs one relaxed load more
+than malloc. Counts cover every thread, so measure code that runs while the workers are idle*/
+class HeapCounter
+{
+public:
+	// Zeroes the counts and starts counting
+	static void start();
+
+	// Stops counting and returns what was counted since start
+	static HeapUsage stop();
+};
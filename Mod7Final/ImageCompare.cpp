@@ -0,0 +1,248 @@
+#include "ImageCompare.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_COMPARE_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const int RADIUS = 5;                   // 11 taps per axis
+    const int TAPS = 2 * RADIUS + 1;
+    const float SIGMA = 1.5f;
+    const int MOMENTS = 5;                  // Window means of x, y, x^2, y^2 and x y, with x and y the two lumas
+    const float C1 = (0.01f * 255.0f) * (0.01f * 255.0f);  // Stabilize dark and flat windows, as in the paper
+    const float C2 = (0.03f * 255.0f) * (0.03f * 255.0f);
+
+    std::atomic<bool> gUseSimd{ true };
+
+    // Normalized Gaussian taps, built once
+    struct Gaussian
+    {
+        float weight[TAPS];
+
+        Gaussian()
+        {
+            float sum = 0.0f;
+            for (int k = 0; k < TAPS; k++)
+            {
+                float d = (float)(k - RADIUS);
+                weight[k] = std::exp(-d * d / (2.0f * SIGMA * SIGMA));
+                sum += weight[k];
+            }
+            for (int k = 0; k < TAPS; k++)
+                weight[k] /= sum;
+        }
+    };
+
+    const float* taps()
+    {
+        static const Gaussian gaussian;
+        return gaussian.weight;
+    }
+
+    float luma(const uint8_t* pixel)
+    {
+        return 0.2126f * pixel[0] + 0.7152f * pixel[1] + 0.0722f * pixel[2];
+    }
+
+    // Horizontal pass: out[i] = sum of weight[k] * in[i + k], in holding RADIUS extra values at each end
+    void filterRow(const float* in, uint32_t count, float* out)
+    {
+        const float* weight = taps();
+        uint32_t i = 0;
+#ifdef IMAGE_COMPARE_SSE
+        if (gUseSimd)
+        {
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128 sum = _mm_setzero_ps();
+                for (int k = 0; k < TAPS; k++)
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(in + i + k), _mm_set1_ps(weight[k])));
+                _mm_storeu_ps(out + i, sum);
+            }
+        }
+#endif
+        for (; i < count; i++)
+        {
+            float sum = 0.0f;
+            for (int k = 0; k < TAPS; k++)
+                sum += weight[k] * in[i + k];
+            out[i] = sum;
+        }
+    }
+
+    // Vertical pass: out[i] = sum of weight[k] * rows[k][i]
+    void filterColumns(const float* const* rows, uint32_t count, float* out)
+    {
+        const float* weight = taps();
+        uint32_t i = 0;
+#ifdef IMAGE_COMPARE_SSE
+        if (gUseSimd)
+        {
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128 sum = _mm_setzero_ps();
+                for (int k = 0; k < TAPS; k++)
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[k] + i), _mm_set1_ps(weight[k])));
+                _mm_storeu_ps(out + i, sum);
+            }
+        }
+#endif
+        for (; i < count; i++)
+        {
+            float sum = 0.0f;
+            for (int k = 0; k < TAPS; k++)
+                sum += weight[k] * rows[k][i];
+            out[i] = sum;
+        }
+    }
+
+    // SSIM of each pixel's window from its five moments
+    void similarityRow(const float* const* moments, uint32_t count, float* ssim)
+    {
+        uint32_t i = 0;
+#ifdef IMAGE_COMPARE_SSE
+        if (gUseSimd)
+        {
+            const __m128 two = _mm_set1_ps(2.0f), c1 = _mm_set1_ps(C1), c2 = _mm_set1_ps(C2);
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128 mx = _mm_loadu_ps(moments[0] + i), my = _mm_loadu_ps(moments[1] + i);
+                __m128 mxx = _mm_mul_ps(mx, mx), myy = _mm_mul_ps(my, my), mxy = _mm_mul_ps(mx, my);
+                __m128 sxx = _mm_sub_ps(_mm_loadu_ps(moments[2] + i), mxx);
+                __m128 syy = _mm_sub_ps(_mm_loadu_ps(moments[3] + i), myy);
+                __m128 sxy = _mm_sub_ps(_mm_loadu_ps(moments[4] + i), mxy);
+                __m128 numerator = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(two, mxy), c1), _mm_add_ps(_mm_mul_ps(two, sxy), c2));
+                __m128 denominator = _mm_mul_ps(_mm_add_ps(_mm_add_ps(mxx, myy), c1), _mm_add_ps(_mm_add_ps(sxx, syy), c2));
+                _mm_storeu_ps(ssim + i, _mm_div_ps(numerator, denominator));
+            }
+        }
+#endif
+        for (; i < count; i++)
+        {
+            float mx = moments[0][i], my = moments[1][i];
+            float sxx = moments[2][i] - mx * mx, syy = moments[3][i] - my * my, sxy = moments[4][i] - mx * my;
+            ssim[i] = (2.0f * mx * my + C1) * (2.0f * sxy + C2) / ((mx * mx + my * my + C1) * (sxx + syy + C2));
+        }
+    }
+
+    // Sum of absolute differences of the color channels, alpha left out
+    uint64_t colorDifference(const uint8_t* a, const uint8_t* b, size_t pixels)
+    {
+        uint64_t total = 0;
+        size_t i = 0;
+#ifdef IMAGE_COMPARE_SSE
+        if (gUseSimd)
+        {
+            const __m128i color = _mm_set1_epi32(0x00FFFFFF);
+            __m128i sum = _mm_setzero_si128();
+            for (; i + 4 <= pixels; i += 4)
+            {
+                __m128i pa = _mm_and_si128(_mm_loadu_si128((const __m128i*)(a + i * 4)), color);
+                __m128i pb = _mm_and_si128(_mm_loadu_si128((const __m128i*)(b + i * 4)), color);
+                sum = _mm_add_epi64(sum, _mm_sad_epu8(pa, pb));     // Two 64-bit sums, one per 8 bytes
+            }
+            uint64_t halves[2];
+            _mm_storeu_si128((__m128i*)halves, sum);
+            total = halves[0] + halves[1];
+        }
+#endif
+        for (; i < pixels; i++)
+        {
+            for (int c = 0; c < 3; c++)
+                total += std::abs(a[i * 4 + c] - b[i * 4 + c]);
+        }
+        return total;
+    }
+}
+
+ImageDifference ImageCompare::compare(const uint8_t* expected, const uint8_t* actual, uint32_t width, uint32_t height,
+    float localThreshold, std::vector<uint8_t>* heatmap) {
+    ImageDifference difference;
+    size_t pixels = (size_t)width * height;
+    if (pixels == 0)
+        return difference;
+
+    // Horizontal pass over the moments of each row, the edge pixels repeated so every window has all its taps
+    uint32_t padded = width + 2 * RADIUS;
+    std::vector<float> row((size_t)MOMENTS * padded);
+    std::vector<float> horizontal(MOMENTS * pixels);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t p = 0; p < padded; p++)
+        {
+            uint32_t x = (uint32_t)std::min(std::max((int)p - RADIUS, 0), (int)width - 1);
+            float a = luma(expected + ((size_t)y * width + x) * 4);
+            float b = luma(actual + ((size_t)y * width + x) * 4);
+            row[p] = a;
+            row[padded + p] = b;
+            row[2 * padded + p] = a * a;
+            row[3 * padded + p] = b * b;
+            row[4 * padded + p] = a * b;
+        }
+        for (int m = 0; m < MOMENTS; m++)
+            filterRow(&row[(size_t)m * padded], width, &horizontal[(m * (size_t)height + y) * width]);
+    }
+
+    // Vertical pass a row at a time, then the similarity of every window in it
+    std::vector<float> filtered((size_t)MOMENTS * width);
+    std::vector<float> ssim(width);
+    if (heatmap)
+        heatmap->resize(pixels * 3);
+    double sum = 0.0;
+    size_t outliers = 0;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const float* moments[MOMENTS];
+        for (int m = 0; m < MOMENTS; m++)
+        {
+            const float* rows[TAPS];
+            for (int k = 0; k < TAPS; k++)
+            {
+                uint32_t source = (uint32_t)std::min(std::max((int)y + k - RADIUS, 0), (int)height - 1);
+                rows[k] = &horizontal[(m * (size_t)height + source) * width];
+            }
+            filterColumns(rows, width, &filtered[(size_t)m * width]);
+            moments[m] = &filtered[(size_t)m * width];
+        }
+        similarityRow(moments, width, ssim.data());
+
+        double rowSum = 0.0;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            rowSum += ssim[x];
+            outliers += ssim[x] < localThreshold;
+            if (!heatmap)
+                continue;
+            float heat = localThreshold < 1.0f ? (1.0f - ssim[x]) / (1.0f - localThreshold) : (ssim[x] < 1.0f ? 1.0f : 0.0f);
+            heat = std::min(std::max(heat, 0.0f), 1.0f);
+            float gray = 0.25f * luma(expected + ((size_t)y * width + x) * 4);
+            uint8_t* out = &(*heatmap)[((size_t)y * width + x) * 3];
+            out[0] = (uint8_t)std::lrint(gray + (255.0f - gray) * std::min(2.0f * heat, 1.0f));
+            out[1] = (uint8_t)std::lrint(gray + (255.0f - gray) * std::max(2.0f * heat - 1.0f, 0.0f));
+            out[2] = (uint8_t)std::lrint(gray * (1.0f - heat));
+        }
+        sum += rowSum;
+    }
+    difference.ssim = sum / pixels;
+    difference.outliers = (double)outliers / pixels;
+    difference.meanError = (double)colorDifference(expected, actual, pixels) / (pixels * 3);
+    return difference;
+}
+
+void ImageCompare::setSimd(bool enabled) {
+    gUseSimd = enabled;
+}
+
+bool ImageCompare::simdAvailable() {
+#ifdef IMAGE_COMPARE_SSE
+    return true;
+#else
+    return false;
+#endif
+}
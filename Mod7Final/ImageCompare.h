@@ -0,0 +1,29 @@
+#pragma once
+# include <cstddef>
+# include <cstdint>
+# include <vector>
+
+// How far one image is from another, from ImageCompare::compare
+struct ImageDifference
+{
+	double ssim = 1.0;			// Mean structural similarity of the luma (1 = the same, 0 = unrelated)
+	double outliers = 0.0;		// Share of pixels whose own window is less similar than the local threshold
+	double meanError = 0.0;		// Mean absolute difference per color channel, in 8-bit levels (what luma alone misses)
+};
+
+/* Class to compare rendered images the way a viewer would notice: SSIM (Wang et al. 2004) of the luma over 11x11
+Gaussian windows, which shrugs off tiny shifts of brightness but not lost edges, texture or shading detail. The window
+sums are separable filters over whole rows of floats, four pixels per SSE register*/
+class ImageCompare
+{
+public:
+	/* Compares two RGBA8 images of width x height. Pixels whose window's similarity is under localThreshold count as
+	outliers. heatmap, when given, gets an RGB8 image in the same row order: the expected image dimmed to gray, with
+	red through yellow where it differs, full yellow at the threshold*/
+	static ImageDifference compare(const uint8_t* expected, const uint8_t* actual, uint32_t width, uint32_t height,
+		float localThreshold, std::vector<uint8_t>* heatmap = nullptr);
+
+	// Switch between the SSE and scalar kernels
+	static void setSimd(bool enabled);
+	static bool simdAvailable();
+};
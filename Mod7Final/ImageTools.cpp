@@ -0,0 +1,437 @@
+#include "ImageTools.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <deque>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define IMAGE_TOOLS_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+    const uint32_t BAND_ROWS = 32;          // Destination rows per job
+    const int LINEAR_TO_SRGB_SIZE = 16384;  // Entries of the linear to 8-bit sRGB table
+
+    std::atomic<bool> gUseSimd{ true };
+
+    // 8-bit sRGB to linear and linear back to 8-bit sRGB, built once
+    struct SrgbTables
+    {
+        float toLinear[256];
+        uint8_t toSrgb[LINEAR_TO_SRGB_SIZE];
+
+        SrgbTables()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                float c = i / 255.0f;
+                toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int i = 0; i < LINEAR_TO_SRGB_SIZE; i++)
+            {
+                float l = (i + 0.5f) / LINEAR_TO_SRGB_SIZE;
+                float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                toSrgb[i] = (uint8_t)std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f);
+            }
+        }
+    };
+
+    const SrgbTables& srgbTables()
+    {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    // Source pixels and weights for every destination pixel along one axis, padded to the same count
+    struct Taps
+    {
+        int count = 0;
+        std::vector<uint32_t> index;
+        std::vector<float> weight;
+    };
+
+    float lanczos3(float t)
+    {
+        const float pi = 3.14159265f;
+        t = std::fabs(t);
+        if (t < 1e-5f)
+            return 1.0f;
+        if (t >= 3.0f)
+            return 0.0f;
+        return 3.0f * std::sin(pi * t) * std::sin(pi * t / 3.0f) / (pi * pi * t * t);
+    }
+
+    // Filter footprint for shrinking sourceSize to targetSize; samples past the edge repeat the edge
+    Taps makeTaps(uint32_t sourceSize, uint32_t targetSize, MipFilter filter)
+    {
+        const float scale = (float)sourceSize / targetSize;
+        const float support = filter == MipFilter::Box ? 0.5f : 3.0f;
+        const float radius = support * std::max(scale, 1.0f);
+
+        std::vector<std::vector<std::pair<uint32_t, float>>> perPixel(targetSize);
+        Taps taps;
+        for (uint32_t x = 0; x < targetSize; x++)
+        {
+            float center = (x + 0.5f) * scale - 0.5f;
+            int first = (int)std::ceil(center - radius), last = (int)std::floor(center + radius);
+            float total = 0.0f;
+            for (int s = first; s <= last; s++)
+            {
+                float t = (s - center) / std::max(scale, 1.0f);
+                float w = filter == MipFilter::Box ? (std::fabs(t) < 0.5f ? 1.0f : std::fabs(t) == 0.5f ? 0.5f : 0.0f) : lanczos3(t);
+                if (w == 0.0f)
+                    continue;
+                perPixel[x].push_back({ (uint32_t)std::clamp(s, 0, (int)sourceSize - 1), w });
+                total += w;
+            }
+            for (auto& tap : perPixel[x])
+                tap.second /= total;
+            taps.count = std::max(taps.count, (int)perPixel[x].size());
+        }
+
+        taps.index.assign((size_t)targetSize * taps.count, 0);
+        taps.weight.assign((size_t)targetSize * taps.count, 0.0f);
+        for (uint32_t x = 0; x < targetSize; x++)
+        {
+            for (size_t t = 0; t < perPixel[x].size(); t++)
+            {
+                taps.index[(size_t)x * taps.count + t] = perPixel[x][t].first;
+                taps.weight[(size_t)x * taps.count + t] = perPixel[x][t].second;
+            }
+        }
+        return taps;
+    }
+
+    // Expands one 8-bit row to linear RGBA floats (missing channels: gray for 1-2 channels, opaque alpha)
+    void loadRow(const uint8_t* row, uint32_t width, int channels, bool srgb, float* out)
+    {
+        const float* toLinear = srgbTables().toLinear;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const uint8_t* p = row + (size_t)x * channels;
+            float* o = out + (size_t)x * 4;
+            int colorChannels = channels >= 3 ? 3 : 1;
+            for (int c = 0; c < 3; c++)
+            {
+                uint8_t v = p[colorChannels == 3 ? c : 0];
+                o[c] = srgb ? toLinear[v] : v / 255.0f;
+            }
+            o[3] = (channels == 2 || channels == 4) ? p[channels - 1] / 255.0f : 1.0f;
+        }
+    }
+
+    // Packs linear RGBA floats back into the source channel layout
+    void storeRow(const float* row, uint32_t width, int channels, bool srgb, uint8_t* out)
+    {
+        const uint8_t* toSrgb = srgbTables().toSrgb;
+        auto color = [&](float v) {
+            v = std::clamp(v, 0.0f, 1.0f);
+            return srgb ? toSrgb[std::min((int)(v * LINEAR_TO_SRGB_SIZE), LINEAR_TO_SRGB_SIZE - 1)] : (uint8_t)std::lround(v * 255.0f);
+        };
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const float* p = row + (size_t)x * 4;
+            uint8_t* o = out + (size_t)x * channels;
+            if (channels >= 3)
+            {
+                for (int c = 0; c < 3; c++)
+                    o[c] = color(p[c]);
+            }
+            else
+                o[0] = color(p[0]);
+            if (channels == 2 || channels == 4)
+                o[channels - 1] = (uint8_t)std::lround(std::clamp(p[3], 0.0f, 1.0f) * 255.0f);
+        }
+    }
+
+    /*Weighted sum of RGBA pixels: out[x] = sum over t of weight[x][t] * rows[t][index[x][t]]. The horizontal
+    pass uses one row and per-pixel indices; the vertical pass passes one row per tap and the identity index*/
+    void filterPixels(const float* const* rows, bool rowPerTap, const Taps& taps, const uint32_t* identity, uint32_t count, float* out)
+    {
+#ifdef IMAGE_TOOLS_SSE
+        if (gUseSimd)
+        {
+            for (uint32_t x = 0; x < count; x++)
+            {
+                const uint32_t* index = rowPerTap ? identity : &taps.index[(size_t)x * taps.count];
+                const float* weight = &taps.weight[(size_t)(rowPerTap ? 0 : x) * taps.count];
+                __m128 sum = _mm_setzero_ps();
+                for (int t = 0; t < taps.count; t++)
+                {
+                    const float* row = rows[rowPerTap ? t : 0];
+                    uint32_t source = rowPerTap ? x : index[t];
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + (size_t)source * 4), _mm_set1_ps(weight[t])));
+                }
+                _mm_storeu_ps(out + (size_t)x * 4, sum);
+            }
+            return;
+        }
+#endif
+        for (uint32_t x = 0; x < count; x++)
+        {
+            const uint32_t* index = rowPerTap ? identity : &taps.index[(size_t)x * taps.count];
+            const float* weight = &taps.weight[(size_t)(rowPerTap ? 0 : x) * taps.count];
+            float sum[4] = {};
+            for (int t = 0; t < taps.count; t++)
+            {
+                const float* row = rows[rowPerTap ? t : 0];
+                uint32_t source = rowPerTap ? x : index[t];
+                for (int c = 0; c < 4; c++)
+                    sum[c] += row[(size_t)source * 4 + c] * weight[t];
+            }
+            for (int c = 0; c < 4; c++)
+                out[(size_t)x * 4 + c] = sum[c];
+        }
+    }
+
+    // Shrinks one level into the next, splitting the destination rows into bands
+    void downsample(const uint8_t* source, uint32_t width, uint32_t height, int channels, uint8_t* target, uint32_t targetWidth, uint32_t targetHeight,
+        MipFilter filter, bool srgb, ThreadPool* pool)
+    {
+        const Taps horizontal = makeTaps(width, targetWidth, filter);
+        const Taps vertical = makeTaps(height, targetHeight, filter);
+
+        auto band = [&](size_t bandIndex) {
+            uint32_t y0 = (uint32_t)bandIndex * BAND_ROWS, y1 = std::min(y0 + BAND_ROWS, targetHeight);
+
+            // Source rows this band reads
+            uint32_t firstRow = height, lastRow = 0;
+            for (size_t i = (size_t)y0 * vertical.count; i < (size_t)y1 * vertical.count; i++)
+            {
+                firstRow = std::min(firstRow, vertical.index[i]);
+                lastRow = std::max(lastRow, vertical.index[i]);
+            }
+
+            // Horizontal pass over those rows, in linear light
+            std::vector<float> linearRow((size_t)width * 4);
+            std::vector<float> shrunk((size_t)(lastRow - firstRow + 1) * targetWidth * 4);
+            for (uint32_t r = firstRow; r <= lastRow; r++)
+            {
+                loadRow(source + (size_t)r * width * channels, width, channels, srgb, linearRow.data());
+                const float* row = linearRow.data();
+                filterPixels(&row, false, horizontal, nullptr, targetWidth, &shrunk[(size_t)(r - firstRow) * targetWidth * 4]);
+            }
+
+            // Vertical pass, one destination row at a time
+            std::vector<uint32_t> identity(targetWidth);
+            for (uint32_t x = 0; x < targetWidth; x++)
+                identity[x] = x;
+            std::vector<const float*> rows(vertical.count);
+            std::vector<float> outRow((size_t)targetWidth * 4);
+            Taps rowWeights;
+            rowWeights.count = vertical.count;
+            for (uint32_t y = y0; y < y1; y++)
+            {
+                for (int t = 0; t < vertical.count; t++)
+                    rows[t] = &shrunk[(size_t)(vertical.index[(size_t)y * vertical.count + t] - firstRow) * targetWidth * 4];
+                rowWeights.weight.assign(vertical.weight.begin() + (size_t)y * vertical.count, vertical.weight.begin() + (size_t)(y + 1) * vertical.count);
+                filterPixels(rows.data(), true, rowWeights, identity.data(), targetWidth, outRow.data());
+                storeRow(outRow.data(), targetWidth, channels, srgb, target + (size_t)y * targetWidth * channels);
+            }
+        };
+
+        size_t bands = (targetHeight + BAND_ROWS - 1) / BAND_ROWS;
+        if (pool && bands > 1)
+            pool->parallelFor(bands, band);
+        else
+            for (size_t b = 0; b < bands; b++)
+                band(b);
+    }
+}
+
+void ImageTools::buildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, int channels, MipFilter filter, bool srgb,
+    ThreadPool* pool, std::vector<std::vector<uint8_t>>& levels) {
+    if (!pixels || width == 0 || height == 0 || channels < 1 || channels > 4)
+        return;
+
+    // Every level is made from the one above it
+    const uint8_t* source = pixels;
+    while (width > 1 || height > 1)
+    {
+        uint32_t targetWidth = std::max(1u, width / 2), targetHeight = std::max(1u, height / 2);
+        levels.emplace_back((size_t)targetWidth * targetHeight * channels);
+        downsample(source, width, height, channels, levels.back().data(), targetWidth, targetHeight, filter, srgb, pool);
+        source = levels.back().data();
+        width = targetWidth;
+        height = targetHeight;
+    }
+}
+
+void ImageTools::buildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, int channels, MipFilter filter, bool srgb,
+    ThreadPool* pool, uint8_t* levels) {
+    if (!pixels || !levels || width == 0 || height == 0 || channels < 1 || channels > 4)
+        return;
+
+    const uint8_t* source = pixels;
+    while (width > 1 || height > 1)
+    {
+        uint32_t targetWidth = std::max(1u, width / 2), targetHeight = std::max(1u, height / 2);
+        downsample(source, width, height, channels, levels, targetWidth, targetHeight, filter, srgb, pool);
+        source = levels;
+        levels += (size_t)targetWidth * targetHeight * channels;
+        width = targetWidth;
+        height = targetHeight;
+    }
+}
+
+size_t ImageTools::mipChainBytes(uint32_t width, uint32_t height, int channels) {
+    size_t bytes = 0;
+    while (width > 1 || height > 1)
+    {
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+        bytes += (size_t)width * height * channels;
+    }
+    return bytes;
+}
+
+int ImageTools::mipLevelCount(uint32_t width, uint32_t height) {
+    int levels = 1;
+    while (width > 1 || height > 1)
+    {
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+        levels++;
+    }
+    return levels;
+}
+
+int ImageTools::levelsAbove(uint32_t width, uint32_t height, uint32_t detailWidth, uint32_t detailHeight) {
+    if (detailWidth == 0 || detailHeight == 0)
+        return 0;
+    int levels = 0;
+    while ((width > 1 || height > 1) && width / 2 >= detailWidth && height / 2 >= detailHeight)
+    {
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+        levels++;
+    }
+    return levels;
+}
+
+void ImageTools::setSimd(bool enabled) {
+    gUseSimd = enabled;
+}
+
+bool ImageTools::simdAvailable() {
+#ifdef IMAGE_TOOLS_SSE
+    return true;
+#else
+    return false;
+#endif
+}
+
+struct MipRowStream::Level
+{
+    uint32_t sourceWidth, sourceHeight;
+    uint32_t width, height;                 // Of the level this one makes
+    Taps horizontal, vertical;
+    std::deque<std::vector<float>> window;  // Horizontally filtered source rows, the first one being row windowFirst
+    uint32_t windowFirst = 0;
+    uint32_t rowsIn = 0;                    // Source rows received
+    uint32_t next = 0;                      // Next row to make
+    std::vector<const float*> rows;         // One per vertical tap
+    std::vector<uint32_t> identity;
+    std::vector<uint8_t> packed;            // The row just made, in the source channel layout
+
+    // First and last source rows the vertical filter of row y reads (padding taps have no weight)
+    std::pair<uint32_t, uint32_t> span(uint32_t y) const
+    {
+        uint32_t first = UINT32_MAX, last = 0;
+        for (int t = 0; t < vertical.count; t++)
+            if (vertical.weight[(size_t)y * vertical.count + t] != 0.0f)
+            {
+                first = std::min(first, vertical.index[(size_t)y * vertical.count + t]);
+                last = std::max(last, vertical.index[(size_t)y * vertical.count + t]);
+            }
+        return { first, last };
+    }
+};
+
+MipRowStream::MipRowStream(uint32_t width, uint32_t height, int channels, MipFilter filter, bool srgb, RowCallback emit)
+    : channels(channels), srgb(srgb), emit(std::move(emit)) {
+    linearRow.resize((size_t)width * 4);
+    filteredRow.resize((size_t)std::max(1u, width / 2) * 4);
+    working = (linearRow.size() + filteredRow.size()) * sizeof(float);
+    while (width > 1 || height > 1)
+    {
+        Level level;
+        level.sourceWidth = width;
+        level.sourceHeight = height;
+        level.width = std::max(1u, width / 2);
+        level.height = std::max(1u, height / 2);
+        level.horizontal = makeTaps(width, level.width, filter);
+        level.vertical = makeTaps(height, level.height, filter);
+        level.rows.resize(level.vertical.count);
+        level.identity.resize(level.width);
+        for (uint32_t x = 0; x < level.width; x++)
+            level.identity[x] = x;
+        level.packed.resize((size_t)level.width * channels);
+
+        // The window never holds more than the rows one output row reads
+        uint32_t windowRows = 0;
+        for (uint32_t y = 0; y < level.height; y++)
+        {
+            auto [first, last] = level.span(y);
+            windowRows = std::max(windowRows, last - first + 1);
+        }
+        working += (size_t)windowRows * level.width * 4 * sizeof(float) + level.packed.size()
+            + (level.horizontal.index.size() + level.vertical.index.size()) * (sizeof(uint32_t) + sizeof(float)) + level.identity.size() * sizeof(uint32_t);
+        levels.push_back(std::move(level));
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+    }
+}
+
+MipRowStream::~MipRowStream() = default;
+
+bool MipRowStream::push(const uint8_t* row) {
+    return emit(0, rowsIn++, row) && feed(0, row);
+}
+
+bool MipRowStream::feed(size_t index, const uint8_t* row) {
+    if (index == levels.size())
+        return true;    // Reached 1x1
+    Level& level = levels[index];
+
+    // Horizontal pass as soon as the row arrives; the window keeps the result
+    loadRow(row, level.sourceWidth, channels, srgb, linearRow.data());
+    const float* linear = linearRow.data();
+    std::vector<float> filtered((size_t)level.width * 4);
+    filterPixels(&linear, false, level.horizontal, nullptr, level.width, filtered.data());
+    level.window.push_back(std::move(filtered));
+    level.rowsIn++;
+
+    // Vertical pass for every row whose taps have all arrived
+    Taps rowWeights;
+    rowWeights.count = level.vertical.count;
+    while (level.next < level.height && level.span(level.next).second < level.rowsIn)
+    {
+        const uint32_t y = level.next;
+        for (int t = 0; t < level.vertical.count; t++)
+        {
+            size_t tap = (size_t)y * level.vertical.count + t;
+            bool weighted = level.vertical.weight[tap] != 0.0f;
+            level.rows[t] = level.window[weighted ? level.vertical.index[tap] - level.windowFirst : 0].data();
+        }
+        rowWeights.weight.assign(level.vertical.weight.begin() + (size_t)y * level.vertical.count,
+            level.vertical.weight.begin() + (size_t)(y + 1) * level.vertical.count);
+        filterPixels(level.rows.data(), true, rowWeights, level.identity.data(), level.width, filteredRow.data());
+        storeRow(filteredRow.data(), level.width, channels, srgb, level.packed.data());
+        level.next++;
+        if (!emit((int)index + 1, y, level.packed.data()) || !feed(index + 1, level.packed.data()))
+            return false;
+
+        // Rows no later output row reads
+        uint32_t keepFrom = level.next < level.height ? level.span(level.next).first : level.rowsIn;
+        while (level.windowFirst < keepFrom && !level.window.empty())
+        {
+            level.window.pop_front();
+            level.windowFirst++;
+        }
+    }
+    return true;
+}
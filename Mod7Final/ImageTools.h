@@ -0,0 +1,79 @@
+#pragma once
+# include <cstddef>
+# include <cstdint>
+# include <functional>
+# include <vector>
+
+class ThreadPool;
+
+// Reconstruction filter used to shrink one mip level into the next
+enum class MipFilter
+{
+	Box,		// 2x2 average, cheap
+	Lanczos,	// Lanczos-3 (12 taps per axis), sharper and less aliased
+};
+
+/* Class to build mip chains on the CPU. Filtering is separable and done in linear light when the image
+holds sRGB colors (alpha is always linear). Each pixel is one SSE register of RGBA floats; a level is
+split into bands of rows across the pool*/
+class ImageTools
+{
+public:
+	/* Appends levels 1, 2, ... down to 1x1 of an 8-bit image with 1 to 4 channels, each in the same
+	channel layout as the source. pool may be nullptr to stay on this thread*/
+	static void buildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, int channels, MipFilter filter, bool srgb,
+		ThreadPool* pool, std::vector<std::vector<uint8_t>>& levels);
+
+	// Same, but writes levels 1, 2, ... back to back into levels, which holds mipChainBytes() bytes
+	static void buildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, int channels, MipFilter filter, bool srgb,
+		ThreadPool* pool, uint8_t* levels);
+
+	// Bytes of levels 1, 2, ... of an image
+	static size_t mipChainBytes(uint32_t width, uint32_t height, int channels);
+
+	// Levels of a full chain, level 0 included
+	static int mipLevelCount(uint32_t width, uint32_t height);
+
+	// Top levels that can be dropped while the next one still has detailWidth x detailHeight texels (0 x 0 keeps them all)
+	static int levelsAbove(uint32_t width, uint32_t height, uint32_t detailWidth, uint32_t detailHeight);
+
+	// Switch between the SSE and scalar kernels (used by the benchmark)
+	static void setSimd(bool enabled);
+	static bool simdAvailable();
+};
+
+/* Class to build the same mip chain as ImageTools::buildMipChain from the rows of level 0 arriving top to bottom. Each
+level keeps only the horizontally filtered rows its vertical filter still needs, so memory grows with the width of the
+image and not with its area. Every row of every level, level 0 included, goes to the callback as soon as it exists*/
+class MipRowStream
+{
+public:
+	// Returning false from the callback stops the stream
+	using RowCallback = std::function<bool(int level, uint32_t row, const uint8_t* pixels)>;
+
+	MipRowStream(uint32_t width, uint32_t height, int channels, MipFilter filter, bool srgb, RowCallback emit);
+	~MipRowStream();
+
+	MipRowStream(const MipRowStream&) = delete;
+	MipRowStream& operator=(const MipRowStream&) = delete;
+
+	// Takes the next row of level 0. False once the callback has returned false
+	bool push(const uint8_t* row);
+
+	// Most memory the stream holds at any time, known from the start
+	size_t workingBytes() const { return working; }
+
+private:
+	struct Level;
+
+	bool feed(size_t level, const uint8_t* row);	// One row of the level above levels[level]
+
+	const int channels;
+	const bool srgb;
+	RowCallback emit;
+	std::vector<Level> levels;			// levels[i] makes mip level i + 1
+	std::vector<float> linearRow;		// Scratch, sized for the widest level
+	std::vector<float> filteredRow;
+	uint32_t rowsIn = 0;
+	size_t working = 0;
+};
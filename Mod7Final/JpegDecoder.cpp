@@ -0,0 +1,869 @@
+#include "JpegDecoder.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+namespace
+{
+    // Natural (row-major) position of each zigzag index; the padding absorbs runs past the end of corrupt blocks
+    const uint8_t ZIGZAG[64 + 16] = {
+        0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+        63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    };
+
+    uint16_t readU16(const uint8_t* p) { return (uint16_t)(p[0] << 8 | p[1]); }
+
+    uint8_t clampByte(float value) { return (uint8_t)std::min(std::max(value + 128.5f, 0.0f), 255.0f); }
+
+    /* 8x8 inverse DCT in floating point (Arai, Agui and Nakajima, as in libjpeg's jidctflt). The factors the algorithm
+    leaves out are folded into the dequantization table, so table = quantizer * scale(row) * scale(column)*/
+    void idct8(const int16_t* in, const float* table, uint8_t* out, size_t stride)
+    {
+        float ws[64];
+        for (int c = 0; c < 8; c++)
+        {
+            const int16_t* col = in + c;
+            const float* q = table + c;
+            float* w = ws + c;
+            if (!(col[8] | col[16] | col[24] | col[32] | col[40] | col[48] | col[56]))
+            {
+                float dc = col[0] * q[0];   // Flat column, common after quantization
+                for (int r = 0; r < 8; r++)
+                    w[r * 8] = dc;
+                continue;
+            }
+            float tmp0 = col[0] * q[0], tmp1 = col[16] * q[16], tmp2 = col[32] * q[32], tmp3 = col[48] * q[48];
+            float tmp10 = tmp0 + tmp2, tmp11 = tmp0 - tmp2;
+            float tmp13 = tmp1 + tmp3, tmp12 = (tmp1 - tmp3) * 1.414213562f - tmp13;
+            tmp0 = tmp10 + tmp13;
+            tmp3 = tmp10 - tmp13;
+            tmp1 = tmp11 + tmp12;
+            tmp2 = tmp11 - tmp12;
+
+            float tmp4 = col[8] * q[8], tmp5 = col[24] * q[24], tmp6 = col[40] * q[40], tmp7 = col[56] * q[56];
+            float z13 = tmp6 + tmp5, z10 = tmp6 - tmp5, z11 = tmp4 + tmp7, z12 = tmp4 - tmp7;
+            tmp7 = z11 + z13;
+            tmp11 = (z11 - z13) * 1.414213562f;
+            float z5 = (z10 + z12) * 1.847759065f;
+            tmp10 = 1.082392200f * z12 - z5;
+            tmp12 = -2.613125930f * z10 + z5;
+            tmp6 = tmp12 - tmp7;
+            tmp5 = tmp11 - tmp6;
+            tmp4 = tmp10 + tmp5;
+
+            w[0] = tmp0 + tmp7;
+            w[56] = tmp0 - tmp7;
+            w[8] = tmp1 + tmp6;
+            w[48] = tmp1 - tmp6;
+            w[16] = tmp2 + tmp5;
+            w[40] = tmp2 - tmp5;
+            w[32] = tmp3 + tmp4;
+            w[24] = tmp3 - tmp4;
+        }
+        for (int r = 0; r < 8; r++)
+        {
+            const float* w = ws + r * 8;
+            float tmp10 = w[0] + w[4], tmp11 = w[0] - w[4];
+            float tmp13 = w[2] + w[6], tmp12 = (w[2] - w[6]) * 1.414213562f - tmp13;
+            float tmp0 = tmp10 + tmp13, tmp3 = tmp10 - tmp13, tmp1 = tmp11 + tmp12, tmp2 = tmp11 - tmp12;
+
+            float z13 = w[5] + w[3], z10 = w[5] - w[3], z11 = w[1] + w[7], z12 = w[1] - w[7];
+            float tmp7 = z11 + z13;
+            tmp11 = (z11 - z13) * 1.414213562f;
+            float z5 = (z10 + z12) * 1.847759065f;
+            tmp10 = 1.082392200f * z12 - z5;
+            tmp12 = -2.613125930f * z10 + z5;
+            float tmp6 = tmp12 - tmp7, tmp5 = tmp11 - tmp6, tmp4 = tmp10 + tmp5;
+
+            uint8_t* o = out + r * stride;
+            o[0] = clampByte((tmp0 + tmp7) * 0.125f);
+            o[7] = clampByte((tmp0 - tmp7) * 0.125f);
+            o[1] = clampByte((tmp1 + tmp6) * 0.125f);
+            o[6] = clampByte((tmp1 - tmp6) * 0.125f);
+            o[2] = clampByte((tmp2 + tmp5) * 0.125f);
+            o[5] = clampByte((tmp2 - tmp5) * 0.125f);
+            o[4] = clampByte((tmp3 + tmp4) * 0.125f);
+            o[3] = clampByte((tmp3 - tmp4) * 0.125f);
+        }
+    }
+
+    /* n x n inverse DCT from the lowest n x n frequencies (n = 4 or 2): the n-point transform of a block 8 / n times
+    smaller, which is what the full transform followed by averaging would give up to the discarded frequencies.
+    basis[x][u] = c(u) / 2 * cos((2x + 1) u pi / 2n) has the normalization of the 8x8 transform, so levels match*/
+    template <int N>
+    void idctReduced(const int16_t* in, const float* table, uint8_t* out, size_t stride)
+    {
+        static const auto basis = [] {
+            std::array<float, N * N> b{};
+            for (int x = 0; x < N; x++)
+                for (int u = 0; u < N; u++)
+                    b[x * N + u] = (u == 0 ? std::sqrt(0.5f) : 1.0f) * 0.5f * std::cos((2 * x + 1) * u * 3.14159265f / (2 * N));
+            return b;
+        }();
+        float ws[N * N];    // Columns transformed: ws[y][u]
+        for (int u = 0; u < N; u++)
+            for (int y = 0; y < N; y++)
+            {
+                float sum = 0.0f;
+                for (int v = 0; v < N; v++)
+                    sum += basis[y * N + v] * in[v * 8 + u] * table[v * 8 + u];
+                ws[y * N + u] = sum;
+            }
+        for (int y = 0; y < N; y++)
+            for (int x = 0; x < N; x++)
+            {
+                float sum = 0.0f;
+                for (int u = 0; u < N; u++)
+                    sum += basis[x * N + u] * ws[y * N + u];
+                out[y * stride + x] = clampByte(sum);
+            }
+    }
+
+    // Code of each symbol of a Huffman table being written
+    struct HuffmanCode
+    {
+        uint16_t code[256] = {};
+        uint8_t length[256] = {};
+    };
+
+    /* Code lengths minimizing the coded size of symbols used frequency[symbol] times, limited to 16 bits and never
+    all ones (ITU T.81 annex K.2, as libjpeg's jpeg_gen_optimal_table). counts and symbols are in DHT layout*/
+    void optimalTable(const uint32_t frequency[256], uint8_t counts[16], std::vector<uint8_t>& symbols)
+    {
+        // Symbol 256 reserves the all-ones code
+        uint64_t weight[257];
+        int length[257] = {}, next[257];
+        for (int i = 0; i < 256; i++)
+            weight[i] = frequency[i];
+        weight[256] = 1;
+        std::fill(next, next + 257, -1);
+        for (;;)
+        {
+            // Merge the two least frequent subtrees; ties go to the larger symbol
+            int first = -1, second = -1;
+            for (int i = 0; i < 257; i++)
+                if (weight[i] && (first < 0 || weight[i] <= weight[first]))
+                    first = i;
+            for (int i = 0; i < 257; i++)
+                if (weight[i] && i != first && (second < 0 || weight[i] <= weight[second]))
+                    second = i;
+            if (second < 0)
+                break;
+            weight[first] += weight[second];
+            weight[second] = 0;
+            for (length[first]++; next[first] >= 0; length[first]++)
+                first = next[first];
+            next[first] = second;
+            for (length[second]++; next[second] >= 0; length[second]++)
+                second = next[second];
+        }
+
+        int perLength[33] = {};
+        for (int i = 0; i < 257; i++)
+            if (length[i])
+                perLength[std::min(length[i], 32)]++;
+        for (int i = 32; i > 16; i--)
+            while (perLength[i] > 0)
+            {
+                // Two codes of this length become one shorter, and a shorter code splits to make room for the other
+                int j = i - 2;
+                while (perLength[j] == 0)
+                    j--;
+                perLength[i] -= 2;
+                perLength[i - 1]++;
+                perLength[j + 1] += 2;
+                perLength[j]--;
+            }
+        int longest = 16;
+        while (perLength[longest] == 0)
+            longest--;
+        perLength[longest]--;   // The reserved symbol had the longest code
+        for (int i = 0; i < 16; i++)
+            counts[i] = (uint8_t)perLength[i + 1];
+
+        symbols.clear();
+        for (int bits = 1; bits <= 32; bits++)
+            for (int i = 0; i < 256; i++)
+                if (length[i] == bits)
+                    symbols.push_back((uint8_t)i);
+    }
+
+    // Canonical codes of a table in DHT layout
+    void assignCodes(const uint8_t counts[16], const std::vector<uint8_t>& symbols, HuffmanCode& codes)
+    {
+        int code = 0;
+        size_t index = 0;
+        for (int length = 1; length <= 16; length++, code <<= 1)
+            for (int i = 0; i < counts[length - 1] && index < symbols.size(); i++, code++, index++)
+            {
+                codes.code[symbols[index]] = (uint16_t)code;
+                codes.length[symbols[index]] = (uint8_t)length;
+            }
+    }
+
+    // Bits needed for the magnitude of a coefficient (its category)
+    int magnitudeBits(int value)
+    {
+        int bits = 0;
+        for (value = std::abs(value); value; value >>= 1)
+            bits++;
+        return bits;
+    }
+
+    /* Huffman codes one block (natural order, absolute DC) into sink, which takes symbol(class, table, symbol) and
+    bits(value, count). Counting the symbols and writing them go through the same path*/
+    template <typename Sink>
+    void encodeBlock(const int16_t* block, int& dcPrediction, int dcTable, int acTable, Sink& sink)
+    {
+        int difference = block[0] - dcPrediction;
+        dcPrediction = block[0];
+        int bits = magnitudeBits(difference);
+        sink.symbol(0, dcTable, bits);
+        if (bits)
+            sink.bits(difference < 0 ? difference - 1 : difference, bits);
+
+        int run = 0;
+        for (int k = 1; k < 64; k++)
+        {
+            int value = block[ZIGZAG[k]];
+            if (value == 0)
+            {
+                run++;
+                continue;
+            }
+            for (; run > 15; run -= 16)
+                sink.symbol(1, acTable, 0xF0);  // 16 zeros
+            bits = magnitudeBits(value);
+            sink.symbol(1, acTable, run << 4 | bits);
+            sink.bits(value < 0 ? value - 1 : value, bits);
+            run = 0;
+        }
+        if (run)
+            sink.symbol(1, acTable, 0x00);      // End of block
+    }
+
+    // Writes entropy coded bits, most significant first, stuffing a zero byte after every 0xFF
+    struct BitWriter
+    {
+        std::vector<uint8_t>& out;
+        uint32_t bits = 0;
+        int count = 0;
+
+        void put(int value, int n)
+        {
+            bits = bits << n | ((uint32_t)value & ((1u << n) - 1));
+            for (count += n; count >= 8; count -= 8)
+            {
+                uint8_t byte = (uint8_t)(bits >> (count - 8));
+                out.push_back(byte);
+                if (byte == 0xFF)
+                    out.push_back(0x00);
+            }
+        }
+
+        // Pads the last byte with ones, as required before a marker
+        void flush()
+        {
+            if (count)
+                put(0x7F, 8 - count);
+        }
+    };
+}
+
+// Reads the entropy coded bits, most significant first, removing stuffed zero bytes and stopping at markers
+struct JpegDecoder::BitReader
+{
+    const uint8_t* next;
+    const uint8_t* end;
+    uint32_t bits = 0;      // Left aligned
+    int count = 0;
+    bool atMarker = false;
+
+    void fill()
+    {
+        while (count <= 24)
+        {
+            uint32_t byte = 0;
+            if (!atMarker && next < end)
+            {
+                byte = *next;
+                if (byte == 0xFF)
+                {
+                    uint8_t following = next + 1 < end ? next[1] : 0xD9;
+                    if (following == 0x00)
+                        next += 2;
+                    else
+                    {
+                        atMarker = true;    // Feed zeros until the caller deals with the marker
+                        byte = 0;
+                    }
+                }
+                else
+                    next++;
+            }
+            bits |= byte << (24 - count);
+            count += 8;
+        }
+    }
+
+    int receive(int n)
+    {
+        if (count < n)
+            fill();
+        int value = (int)(bits >> (32 - n));
+        bits <<= n;
+        count -= n;
+        return value;
+    }
+
+    // Reads an n-bit magnitude and applies the sign convention of the JPEG coefficients
+    int extend(int n)
+    {
+        int value = receive(n);
+        return value < (1 << (n - 1)) ? value - (1 << n) + 1 : value;
+    }
+
+    // Skips to the restart marker that must come next and resets the reader past it
+    bool restart()
+    {
+        bits = 0;
+        count = 0;
+        if (!atMarker)
+            while (next + 1 < end && !(next[0] == 0xFF && next[1] != 0x00 && next[1] != 0xFF))
+                next++;     // Padding bits of the last byte were never read
+        atMarker = false;
+        if (next + 1 >= end || next[1] < 0xD0 || next[1] > 0xD7)
+            return false;
+        next += 2;
+        return true;
+    }
+};
+
+bool JpegDecoder::buildHuffman(Huffman& table, const uint8_t counts[16], const uint8_t* symbols) {
+    int total = 0;
+    for (int i = 0; i < 16; i++)
+        total += counts[i];
+    if (total > 256)
+        return false;
+    std::memcpy(table.symbols, symbols, total);
+    std::memset(table.fast, 0, sizeof(table.fast));
+
+    // Canonical codes: consecutive within a length, doubled going to the next length
+    int code = 0, index = 0;
+    for (int length = 1; length <= 16; length++)
+    {
+        table.delta[length] = index - code;
+        for (int i = 0; i < counts[length - 1]; i++, code++, index++)
+            if (length <= 9)
+                for (int fill = code << (9 - length); fill < (code + 1) << (9 - length); fill++)
+                    table.fast[fill] = (uint16_t)(length << 8 | symbols[index]);
+        table.maxCode[length] = counts[length - 1] ? code - 1 : -1;
+        if (code > (1 << length))
+            return false;
+        code <<= 1;
+    }
+    table.maxCode[17] = INT32_MAX;
+    table.defined = true;
+    return true;
+}
+
+int JpegDecoder::decodeSymbol(BitReader& reader, const Huffman& table) {
+    if (reader.count < 16)
+        reader.fill();
+    uint16_t fast = table.fast[reader.bits >> 23];
+    if (fast)
+    {
+        int length = fast >> 8;
+        reader.bits <<= length;
+        reader.count -= length;
+        return fast & 0xFF;
+    }
+    for (int length = 10; length <= 16; length++)
+    {
+        int code = (int)(reader.bits >> (32 - length));
+        if (code <= table.maxCode[length])
+        {
+            reader.bits <<= length;
+            reader.count -= length;
+            return table.symbols[code + table.delta[length]];
+        }
+    }
+    return -1;  // Not a code of this table: corrupt data
+}
+
+bool JpegDecoder::decodeBlock(BitReader& reader, const Huffman& dc, const Huffman& ac, int& dcPrediction, int n, int16_t* block) {
+    int size = decodeSymbol(reader, dc);
+    if (size < 0 || size > 11)
+        return false;
+    dcPrediction += size ? reader.extend(size) : 0;
+    block[0] = (int16_t)dcPrediction;
+
+    for (int k = 1; k < 64;)
+    {
+        int symbol = decodeSymbol(reader, ac);
+        if (symbol < 0)
+            return false;
+        int run = symbol >> 4, bits = symbol & 15;
+        if (bits == 0)
+        {
+            if (run != 15)
+                break;  // End of block
+            k += 16;
+            continue;
+        }
+        k += run;
+        int position = ZIGZAG[k++];
+        int value = reader.extend(bits);
+        if ((position & 7) < n && (position >> 3) < n)
+            block[position] = (int16_t)value;   // Frequencies above n are read past but never used
+    }
+    return true;
+}
+
+bool JpegDecoder::open(const uint8_t* data, size_t size) {
+    header = JpegInfo();
+    components.clear();
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+        return false;
+    fileData = data;
+    dataEnd = data + size;
+    const uint8_t* p = data + 2;
+    bool frame = false;
+    while (p + 4 <= dataEnd)
+    {
+        if (p[0] != 0xFF)
+            return false;
+        uint8_t marker = p[1];
+        if (marker == 0xFF)
+        {
+            p++;    // Fill byte
+            continue;
+        }
+        size_t length = readU16(p + 2);
+        const uint8_t* segment = p + 4;
+        if (length < 2 || segment + length - 2 > dataEnd)
+            return false;
+        const uint8_t* segmentEnd = p + 2 + length;
+
+        if (marker == 0xDB)         // Quantization tables
+        {
+            for (const uint8_t* q = segment; q < segmentEnd;)
+            {
+                int precision = q[0] >> 4, id = q[0] & 15;
+                if (id > 3 || q + 1 + 64 * (precision + 1) > segmentEnd)
+                    return false;
+                for (int k = 0; k < 64; k++)
+                    quantTables[id][k] = precision ? readU16(q + 1 + 2 * k) : q[1 + k];
+                quantDefined[id] = true;
+                q += 1 + 64 * (precision + 1);
+            }
+        }
+        else if (marker == 0xC4)    // Huffman tables
+        {
+            for (const uint8_t* h = segment; h < segmentEnd;)
+            {
+                int tableClass = h[0] >> 4, id = h[0] & 15;
+                if (tableClass > 1 || id > 3 || h + 17 > segmentEnd)
+                    return false;
+                int total = 0;
+                for (int i = 0; i < 16; i++)
+                    total += h[1 + i];
+                if (h + 17 + total > segmentEnd || !buildHuffman(tableClass ? acTables[id] : dcTables[id], h + 1, h + 17))
+                    return false;
+                h += 17 + total;
+            }
+        }
+        else if (marker == 0xC0 || marker == 0xC1)     // Baseline or extended sequential frame
+        {
+            int count = segment[5];
+            if (segment[0] != 8 || (count != 1 && count != 3) || length < 8u + 3u * count)
+                return false;
+            header.height = readU16(segment + 1);
+            header.width = readU16(segment + 3);
+            header.components = count;
+            for (int i = 0; i < count; i++)
+            {
+                const uint8_t* c = segment + 6 + 3 * i;
+                Component component{ c[0], c[1] >> 4, c[1] & 15, c[2], 0, 0 };
+                if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4 || component.quant > 3)
+                    return false;
+                if (count == 1)
+                    component.h = component.v = 1;  // A single component is never interleaved: one block per MCU
+                components.push_back(component);
+            }
+            frame = true;
+        }
+        else if ((marker >= 0xC2 && marker <= 0xCF) && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+            return false;           // Progressive, lossless or arithmetic coded
+        else if (marker == 0xDD)    // Restart interval
+            header.restartInterval = readU16(segment);
+        else if (marker == 0xDA)    // Start of scan: the entropy coded data follows the header
+        {
+            int count = segment[0];
+            if (!frame || count != header.components || header.width == 0 || header.height == 0)
+                return false;       // Several scans (non-interleaved), or no frame before the scan
+            for (int i = 0; i < count; i++)
+            {
+                auto found = std::find_if(components.begin(), components.end(), [&](const Component& c) { return c.id == segment[1 + 2 * i]; });
+                if (found == components.end())
+                    return false;
+                found->dcTable = segment[2 + 2 * i] >> 4;
+                found->acTable = segment[2 + 2 * i] & 15;
+                if (found->dcTable > 3 || found->acTable > 3 || !dcTables[found->dcTable].defined || !acTables[found->acTable].defined
+                    || !quantDefined[found->quant])
+                    return false;
+            }
+            hMax = vMax = 1;
+            for (const Component& c : components)
+            {
+                hMax = std::max(hMax, c.h);
+                vMax = std::max(vMax, c.v);
+            }
+            for (const Component& c : components)
+                if (hMax % c.h || vMax % c.v)
+                    return false;   // Fractional upsampling ratios
+            mcusX = (header.width + 8 * hMax - 1) / (8 * hMax);
+            mcusY = (header.height + 8 * vMax - 1) / (8 * vMax);
+            header.rowMcus = mcusX;
+            scanHeader = p;
+            scanData = segmentEnd;
+            return true;
+        }
+        p = segmentEnd;     // APPn, COM and anything else is skipped
+    }
+    return false;
+}
+
+struct JpegDecoder::Output
+{
+    int n;                      // Pixels per block side
+    int width, height, channels;
+    bool flip;
+    uint8_t* pixels;            // Whole image, or nullptr when rows go to sink
+    const StripSink* sink;
+    std::vector<std::array<float, 64>> tables;  // Dequantization per component
+    std::vector<std::vector<int>> columns;      // Column of the component's plane each output pixel samples
+    std::vector<int> strides, rowShift;         // Plane row length, and output rows per plane row
+};
+
+void JpegDecoder::prepare(Output& output) const {
+    // Dequantization in natural order; the 8x8 transform also takes its scale factors from the table
+    static const float AAN[8] = { 1.0f, 1.387039845f, 1.306562965f, 1.175875602f, 1.0f, 0.785694958f, 0.541196100f, 0.275899379f };
+    output.tables.resize(components.size());
+    for (size_t c = 0; c < components.size(); c++)
+        for (int k = 0; k < 64; k++)
+        {
+            int position = ZIGZAG[k];
+            output.tables[c][position] = quantTables[components[c].quant][k] * (output.n == 8 ? AAN[position >> 3] * AAN[position & 7] : 1.0f);
+        }
+
+    // The column each output pixel samples each component at
+    output.columns.resize(components.size());
+    for (size_t c = 0; c < components.size(); c++)
+    {
+        const Component& component = components[c];
+        output.strides.push_back(mcusX * component.h * output.n);
+        output.rowShift.push_back(vMax / component.v);
+        output.columns[c].resize(output.width);
+        for (int x = 0; x < output.width; x++)
+            output.columns[c][x] = x / (hMax / component.h);
+    }
+}
+
+bool JpegDecoder::decode(int scale, bool flip, uint8_t* pixels, ThreadPool* pool) {
+    if (!scanData || (scale != 1 && scale != 2 && scale != 4 && scale != 8))
+        return false;
+    Output output;
+    output.n = 8 / scale;
+    output.width = scaledSize(header.width, scale);
+    output.height = scaledSize(header.height, scale);
+    output.channels = header.components;
+    output.flip = flip;
+    output.pixels = pixels;
+    output.sink = nullptr;
+
+    prepare(output);
+    size_t planeBytes = 0;
+    working = 0;
+    for (size_t c = 0; c < components.size(); c++)
+    {
+        planeBytes += (size_t)output.strides[c] * components[c].v * output.n;
+        working += output.columns[c].size() * sizeof(int);
+    }
+
+    // A row whose first MCU starts a restart interval does not depend on the rows above, so with a pool the image is
+    // split into one band of rows per worker at such rows
+    std::vector<int> bandRows{ 0 };
+    std::vector<const uint8_t*> bandData{ scanData };
+    if (pool && pool->size() > 1 && header.restartInterval)
+    {
+        std::vector<const uint8_t*> intervals{ scanData };
+        for (const uint8_t* p = scanData; p + 1 < dataEnd && !(p[0] == 0xFF && p[1] == 0xD9); p++)
+            if (p[0] == 0xFF && p[1] >= 0xD0 && p[1] <= 0xD7)
+                intervals.push_back(p + 2);
+        for (int row = 1; row < mcusY; row++)
+        {
+            size_t mcu = (size_t)row * mcusX;
+            if (mcu % header.restartInterval == 0 && mcu / header.restartInterval < intervals.size()
+                && (size_t)row * pool->size() >= bandRows.size() * (size_t)mcusY)
+            {
+                bandRows.push_back(row);
+                bandData.push_back(intervals[mcu / header.restartInterval]);
+            }
+        }
+    }
+    bandRows.push_back(mcusY);
+
+    size_t bands = bandData.size();
+    std::vector<char> decoded(bands, 0);
+    auto decodeBand = [&](size_t band) { decoded[band] = decodeRows(output, bandData[band], bandRows[band], bandRows[band + 1]); };
+    if (bands > 1)
+        pool->parallelFor(bands, decodeBand);
+    else
+        decodeBand(0);
+    working += planeBytes * bands;
+    return std::find(decoded.begin(), decoded.end(), 0) == decoded.end();
+}
+
+bool JpegDecoder::decodeRows(const Output& output, const uint8_t* entropy, int firstRow, int endRow) const {
+    const int n = output.n, width = output.width, height = output.height, channels = output.channels;
+
+    // One MCU row of each component at the output scale, and of the output when it goes to a sink
+    std::vector<std::vector<uint8_t>> planes(components.size());
+    for (size_t c = 0; c < components.size(); c++)
+        planes[c].assign((size_t)output.strides[c] * components[c].v * n, 0);
+    std::vector<uint8_t> strip(output.sink ? (size_t)vMax * n * width * channels : 0);
+
+    BitReader reader{ entropy, dataEnd };
+    std::vector<int> predictions(components.size(), 0);
+    int16_t block[64];
+    int untilRestart = header.restartInterval;
+    for (int mcuY = firstRow; mcuY < endRow; mcuY++)
+    {
+        for (int mcuX = 0; mcuX < mcusX; mcuX++)
+        {
+            if (header.restartInterval && untilRestart-- == 0)
+            {
+                if (!reader.restart())
+                    return false;
+                std::fill(predictions.begin(), predictions.end(), 0);
+                untilRestart = header.restartInterval - 1;
+            }
+            for (size_t c = 0; c < components.size(); c++)
+            {
+                const Component& component = components[c];
+                const float* table = output.tables[c].data();
+                const int stride = output.strides[c];
+                for (int by = 0; by < component.v; by++)
+                    for (int bx = 0; bx < component.h; bx++)
+                    {
+                        std::memset(block, 0, sizeof(block));
+                        if (!decodeBlock(reader, dcTables[component.dcTable], acTables[component.acTable], predictions[c], n, block))
+                            return false;
+                        uint8_t* out = planes[c].data() + (size_t)by * n * stride + ((size_t)mcuX * component.h + bx) * n;
+                        if (n == 8)
+                            idct8(block, table, out, stride);
+                        else if (n == 4)
+                            idctReduced<4>(block, table, out, stride);
+                        else if (n == 2)
+                            idctReduced<2>(block, table, out, stride);
+                        else
+                            out[0] = clampByte(block[0] * table[0] * 0.125f);
+                    }
+            }
+        }
+
+        // Color convert the rows of this MCU row that are inside the image
+        int firstPixelRow = mcuY * vMax * n;
+        for (int y = firstPixelRow; y < std::min(height, firstPixelRow + vMax * n); y++)
+        {
+            uint8_t* out = output.sink ? strip.data() + (size_t)(y - firstPixelRow) * width * channels
+                : output.pixels + (size_t)(output.flip ? height - 1 - y : y) * width * channels;
+            const uint8_t* luma = planes[0].data() + (size_t)((y - firstPixelRow) / output.rowShift[0]) * output.strides[0];
+            if (channels == 1)
+            {
+                std::memcpy(out, luma, width);
+                continue;
+            }
+            const uint8_t* cb = planes[1].data() + (size_t)((y - firstPixelRow) / output.rowShift[1]) * output.strides[1];
+            const uint8_t* cr = planes[2].data() + (size_t)((y - firstPixelRow) / output.rowShift[2]) * output.strides[2];
+            const int* lumaColumn = output.columns[0].data();
+            const int* cbColumn = output.columns[1].data();
+            const int* crColumn = output.columns[2].data();
+            for (int x = 0; x < width; x++, out += 3)
+            {
+                // JFIF YCbCr to RGB in 16.16 fixed point
+                int l = (luma[lumaColumn[x]] << 16) + 32768, b = cb[cbColumn[x]] - 128, r = cr[crColumn[x]] - 128;
+                out[0] = (uint8_t)std::clamp((l + 91881 * r) >> 16, 0, 255);
+                out[1] = (uint8_t)std::clamp((l - 22554 * b - 46802 * r) >> 16, 0, 255);
+                out[2] = (uint8_t)std::clamp((l + 116130 * b) >> 16, 0, 255);
+            }
+        }
+        int count = std::min(height - firstPixelRow, vMax * n);
+        if (output.sink && count > 0 && !(*output.sink)(strip.data(), firstPixelRow, count))
+            return false;
+    }
+    return true;
+}
+
+bool JpegDecoder::decodeStrips(int scale, const StripSink& sink) {
+    if (!scanData || (scale != 1 && scale != 2 && scale != 4 && scale != 8))
+        return false;
+    Output output;
+    output.n = 8 / scale;
+    output.width = scaledSize(header.width, scale);
+    output.height = scaledSize(header.height, scale);
+    output.channels = header.components;
+    output.flip = false;
+    output.pixels = nullptr;
+    output.sink = &sink;
+    prepare(output);
+    working = stripWorkingBytes(scale);
+    return decodeRows(output, scanData, 0, mcusY);
+}
+
+size_t JpegDecoder::stripWorkingBytes(int scale) const {
+    const int n = 8 / scale, width = scaledSize(header.width, scale);
+    size_t bytes = (size_t)vMax * n * width * header.components;    // The strip
+    for (const Component& component : components)
+        bytes += (size_t)mcusX * component.h * n * component.v * n + (size_t)width * sizeof(int);
+    return bytes;
+}
+
+bool JpegDecoder::load(const char* path, int scale, bool flip, std::vector<uint8_t>& pixels, int& width, int& height, int& components) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+    std::vector<uint8_t> data((size_t)file.tellg());
+    file.seekg(0);
+    if (!file.read((char*)data.data(), (std::streamsize)data.size()))
+        return false;
+
+    JpegDecoder decoder;
+    if (!decoder.open(data.data(), data.size()))
+        return false;
+    width = scaledSize(decoder.info().width, scale);
+    height = scaledSize(decoder.info().height, scale);
+    components = decoder.info().components;
+    pixels.resize((size_t)width * height * components);
+    return decoder.decode(scale, flip, pixels.data());
+}
+
+bool JpegDecoder::addRestartMarkers(std::vector<uint8_t>& output) const {
+    if (!scanData)
+        return false;
+
+    // Visits every block in scan order with its coefficients, DC undone from the original prediction
+    auto scan = [this](auto visit) {
+        BitReader reader{ scanData, dataEnd };
+        std::vector<int> predictions(components.size(), 0);
+        int16_t block[64];
+        int untilRestart = header.restartInterval;
+        for (int mcuY = 0; mcuY < mcusY; mcuY++)
+            for (int mcuX = 0; mcuX < mcusX; mcuX++)
+            {
+                if (header.restartInterval && untilRestart-- == 0)
+                {
+                    if (!reader.restart())
+                        return false;
+                    std::fill(predictions.begin(), predictions.end(), 0);
+                    untilRestart = header.restartInterval - 1;
+                }
+                for (size_t c = 0; c < components.size(); c++)
+                    for (int b = 0; b < components[c].h * components[c].v; b++)
+                    {
+                        std::memset(block, 0, sizeof(block));
+                        if (!decodeBlock(reader, dcTables[components[c].dcTable], acTables[components[c].acTable], predictions[c], 8, block))
+                            return false;
+                        visit(mcuX == 0 && c == 0 && b == 0, c, block);
+                    }
+            }
+        return true;
+    };
+
+    // First pass: how often each symbol occurs once the DC prediction restarts at every row
+    struct Counter
+    {
+        uint32_t frequency[2][4][256] = {};
+        void symbol(int tableClass, int table, int symbol) { frequency[tableClass][table][symbol]++; }
+        void bits(int, int) {}
+    };
+    auto counter = std::make_unique<Counter>();
+    std::vector<int> predictions(components.size(), 0);
+    bool counted = scan([&](bool rowStart, size_t c, const int16_t* block) {
+        if (rowStart)
+            std::fill(predictions.begin(), predictions.end(), 0);
+        encodeBlock(block, predictions[c], components[c].dcTable, components[c].acTable, *counter);
+    });
+    if (!counted)
+        return false;
+
+    // Every marker segment up to the scan except the Huffman tables and restart interval, which are replaced
+    output.clear();
+    output.insert(output.end(), fileData, fileData + 2);
+    for (const uint8_t* p = fileData + 2; p < scanHeader;)
+    {
+        if (p[1] == 0xFF)
+        {
+            p++;
+            continue;
+        }
+        const uint8_t* segmentEnd = p + 2 + readU16(p + 2);
+        if (p[1] != 0xC4 && p[1] != 0xDD)
+            output.insert(output.end(), p, segmentEnd);
+        p = segmentEnd;
+    }
+
+    HuffmanCode codes[2][4];
+    std::vector<uint8_t> tables;
+    for (int tableClass = 0; tableClass < 2; tableClass++)
+        for (int table = 0; table < 4; table++)
+        {
+            bool used = std::any_of(components.begin(), components.end(),
+                [&](const Component& c) { return (tableClass ? c.acTable : c.dcTable) == table; });
+            if (!used)
+                continue;
+            uint8_t counts[16];
+            std::vector<uint8_t> symbols;
+            optimalTable(counter->frequency[tableClass][table], counts, symbols);
+            assignCodes(counts, symbols, codes[tableClass][table]);
+            tables.push_back((uint8_t)(tableClass << 4 | table));
+            tables.insert(tables.end(), counts, counts + 16);
+            tables.insert(tables.end(), symbols.begin(), symbols.end());
+        }
+    output.insert(output.end(), { 0xFF, 0xC4, (uint8_t)((tables.size() + 2) >> 8), (uint8_t)(tables.size() + 2) });
+    output.insert(output.end(), tables.begin(), tables.end());
+    output.insert(output.end(), { 0xFF, 0xDD, 0x00, 0x04, (uint8_t)(mcusX >> 8), (uint8_t)mcusX });
+    output.insert(output.end(), scanHeader, scanData);
+
+    // Second pass: the same coefficients, with a marker after every row
+    struct Writer
+    {
+        const HuffmanCode (&codes)[2][4];
+        BitWriter& out;
+        void symbol(int tableClass, int table, int symbol) { out.put(codes[tableClass][table].code[symbol], codes[tableClass][table].length[symbol]); }
+        void bits(int value, int count) { out.put(value, count); }
+    };
+    BitWriter bits{ output };
+    Writer writer{ codes, bits };
+    int row = 0;
+    std::fill(predictions.begin(), predictions.end(), 0);
+    bool written = scan([&](bool rowStart, size_t c, const int16_t* block) {
+        if (rowStart && row++ > 0)
+        {
+            bits.flush();
+            output.insert(output.end(), { 0xFF, (uint8_t)(0xD0 + (row - 2) % 8) });
+            std::fill(predictions.begin(), predictions.end(), 0);
+        }
+        encodeBlock(block, predictions[c], components[c].dcTable, components[c].acTable, writer);
+    });
+    bits.flush();
+    output.insert(output.end(), { 0xFF, 0xD9 });
+    return written;
+}
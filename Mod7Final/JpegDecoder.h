@@ -0,0 +1,100 @@
+#pragma once
+# include <cstddef>
+# include <cstdint>
+# include <functional>
+# include <vector>
+
+class ThreadPool;
+
+// Header facts of a JPEG this decoder can handle
+struct JpegInfo
+{
+	int width = 0, height = 0;
+	int components = 0;			// 1 (gray) or 3 (YCbCr, decoded to RGB)
+	int restartInterval = 0;	// MCUs between restart markers, 0 without them
+	int rowMcus = 0;			// MCUs (8 or 16 pixel squares) across the image
+};
+
+/* Class to decode baseline (sequential, Huffman coded, 8-bit) JPEG files, the kind every scene texture is, at full size
+or scaled by 1/2, 1/4 or 1/8 in the DCT domain: each block is transformed straight to 4x4, 2x2 or 1x1 pixels from its
+lowest frequencies, so the detail a smaller texture would throw away is never computed and the full image never exists.
+Chroma is upsampled by replication. Progressive and arithmetic coded files are left to stb_image. Files with restart
+markers at the start of MCU rows (see addRestartMarkers) can be decoded in bands of rows on several threads*/
+class JpegDecoder
+{
+public:
+	// Parses the headers of a file held in memory, which must outlive the decoder. False if this decoder cannot handle it
+	bool open(const uint8_t* data, size_t size);
+	const JpegInfo& info() const { return header; }
+
+	// Width or height of the image decoded at 1/scale
+	static int scaledSize(int size, int scale) { return (size + scale - 1) / scale; }
+
+	/* Decodes the image at 1/scale (1, 2, 4 or 8) into pixels, which holds scaledSize(width) x scaledSize(height) pixels
+	of components bytes each. Rows go top to bottom, or bottom to top (OpenGL order) with flip. Given a pool, bands of
+	rows starting at restart markers are decoded in parallel; the pool must not be running the caller*/
+	bool decode(int scale, bool flip, uint8_t* pixels, ThreadPool* pool = nullptr);
+
+	// Bytes of working memory the last decode() needed besides its output
+	size_t workingBytes() const { return working; }
+
+	// Receives count rows of width x components bytes, the first being image row firstRow. False stops decoding
+	using StripSink = std::function<bool(const uint8_t* rows, int firstRow, int count)>;
+
+	/* Decodes the image at 1/scale one row of MCUs (8 or 16 rows, fewer when scaled) at a time, top to bottom, handing
+	each strip to sink instead of writing the whole image anywhere*/
+	bool decodeStrips(int scale, const StripSink& sink);
+
+	// Working memory decodeStrips(scale) needs, known before decoding
+	size_t stripWorkingBytes(int scale) const;
+
+	/* Writes the file with a restart marker after every MCU row, so each row can start a band, and Huffman tables
+	optimized for the result. The coefficients are copied as they are, so the decoded pixels do not change*/
+	bool addRestartMarkers(std::vector<uint8_t>& output) const;
+
+	// Reads a file and decodes it; false if it cannot be read or is not a baseline JPEG
+	static bool load(const char* path, int scale, bool flip, std::vector<uint8_t>& pixels, int& width, int& height, int& components);
+
+private:
+	// Canonical Huffman table with a 9-bit lookup for the short codes
+	struct Huffman
+	{
+		uint16_t fast[512];			// (code length << 8) | symbol, or 0 when the code is longer than 9 bits
+		int32_t maxCode[18];		// Largest code of each length, -1 if none
+		int32_t delta[17];			// Index of a code's symbol minus the code, per length
+		uint8_t symbols[256];
+		bool defined = false;
+	};
+
+	struct Component
+	{
+		int id;
+		int h, v;					// Sampling factors
+		int quant;					// Quantization table
+		int dcTable, acTable;
+	};
+
+	struct BitReader;
+	struct Output;		// Tables and destination shared by the bands of one decode()
+
+	static bool buildHuffman(Huffman& table, const uint8_t counts[16], const uint8_t* symbols);
+	static int decodeSymbol(BitReader& reader, const Huffman& table);
+	// Reads the next block's coefficients into block (natural order, not dequantized), keeping only the first n x n
+	static bool decodeBlock(BitReader& reader, const Huffman& dc, const Huffman& ac, int& dcPrediction, int n, int16_t* block);
+	void prepare(Output& output) const;		// Fills the tables and sampling columns for output's scale
+	// Decodes MCU rows [firstRow, endRow), whose entropy coded data starts at entropy
+	bool decodeRows(const Output& output, const uint8_t* entropy, int firstRow, int endRow) const;
+
+	const uint8_t* fileData = nullptr;
+	const uint8_t* scanHeader = nullptr;	// SOS marker
+	const uint8_t* scanData = nullptr;	// Entropy coded data after the SOS header
+	const uint8_t* dataEnd = nullptr;
+	JpegInfo header;
+	uint16_t quantTables[4][64];		// Zigzag order
+	bool quantDefined[4] = {};
+	Huffman dcTables[4], acTables[4];
+	std::vector<Component> components;
+	int hMax = 1, vMax = 1;
+	int mcusX = 0, mcusY = 0;
+	size_t working = 0;
+};
@@ -0,0 +1,171 @@
+#include "KtxFile.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+    const uint8_t KTX_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+    uint32_t vkFormat(BlockFormat format)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1: return KTX_VK_FORMAT_BC1_RGB_UNORM;
+        case BlockFormat::BC3: return KTX_VK_FORMAT_BC3_UNORM;
+        default: return KTX_VK_FORMAT_BC7_UNORM;
+        }
+    }
+
+    bool blockFormat(uint32_t vkFormat, BlockFormat& format)
+    {
+        switch (vkFormat)
+        {
+        case KTX_VK_FORMAT_BC1_RGB_UNORM: format = BlockFormat::BC1; return true;
+        case KTX_VK_FORMAT_BC3_UNORM: format = BlockFormat::BC3; return true;
+        case KTX_VK_FORMAT_BC7_UNORM: format = BlockFormat::BC7; return true;
+        default: return false;
+        }
+    }
+
+    void put32(std::vector<uint8_t>& out, uint32_t value)
+    {
+        for (int i = 0; i < 4; i++)
+            out.push_back((uint8_t)(value >> (i * 8)));
+    }
+
+    /*Basic data format descriptor: color model of the block format, BT.709 primaries, linear transfer,
+    4x4 texel blocks and one sample per independently coded part of the block*/
+    std::vector<uint8_t> dataFormatDescriptor(BlockFormat format)
+    {
+        struct Sample { uint32_t bitOffset, bitLength, channel; };
+        uint8_t colorModel;
+        std::vector<Sample> samples;
+        switch (format)
+        {
+        case BlockFormat::BC1:
+            colorModel = 128;   // KHR_DF_MODEL_BC1A
+            samples = { { 0, 64, 0 } };
+            break;
+        case BlockFormat::BC3:
+            colorModel = 130;   // KHR_DF_MODEL_BC3
+            samples = { { 0, 64, 15 }, { 64, 64, 0 } };     // Alpha, then color
+            break;
+        default:
+            colorModel = 134;   // KHR_DF_MODEL_BC7
+            samples = { { 0, 128, 0 } };
+            break;
+        }
+        uint32_t blockSize = 24 + 16 * (uint32_t)samples.size();
+
+        std::vector<uint8_t> dfd;
+        put32(dfd, 4 + blockSize);                  // Total size
+        put32(dfd, 0);                              // Khronos vendor, basic descriptor type
+        put32(dfd, 2 | (blockSize << 16));          // Version 2
+        dfd.insert(dfd.end(), { colorModel, 1, 1, 0 });     // BT.709 primaries, linear transfer, straight alpha
+        dfd.insert(dfd.end(), { 3, 3, 0, 0 });      // 4x4x1x1 texel block (stored minus one)
+        dfd.insert(dfd.end(), { (uint8_t)TextureCompressor::blockBytes(format), 0, 0, 0, 0, 0, 0, 0 });
+        for (const Sample& sample : samples)
+        {
+            put32(dfd, sample.bitOffset | ((sample.bitLength - 1) << 16) | (sample.channel << 24));
+            put32(dfd, 0);                          // Sample position
+            put32(dfd, 0);                          // Lower
+            put32(dfd, 0xFFFFFFFF);                 // Upper
+        }
+        return dfd;
+    }
+
+    uint32_t levelSize(uint32_t size, size_t level)
+    {
+        size >>= level;
+        return size ? size : 1;
+    }
+}
+
+bool KtxFile::write(const char* path, const CompressedTexture& texture) {
+    if (texture.levels.empty())
+        return false;
+    const uint32_t levelCount = (uint32_t)texture.levels.size();
+    const uint64_t alignment = TextureCompressor::blockBytes(texture.format);   // lcm(block size, 4)
+    std::vector<uint8_t> dfd = dataFormatDescriptor(texture.format);
+
+    KtxHeader header{};
+    header.vkFormat = vkFormat(texture.format);
+    header.typeSize = 1;
+    header.pixelWidth = texture.width;
+    header.pixelHeight = texture.height;
+    header.faceCount = 1;
+    header.levelCount = levelCount;
+    header.dfdByteOffset = (uint32_t)(sizeof(KTX_IDENTIFIER) + sizeof(KtxHeader) + sizeof(KtxLevel) * levelCount);
+    header.dfdByteLength = (uint32_t)dfd.size();
+
+    // Smallest level first, so a reader streaming the file gets a usable image early
+    std::vector<KtxLevel> levels(levelCount);
+    uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+    for (size_t l = levelCount; l-- > 0;)
+    {
+        offset = (offset + alignment - 1) / alignment * alignment;
+        levels[l] = { offset, texture.levels[l].size(), texture.levels[l].size() };
+        offset += texture.levels[l].size();
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    out.write(reinterpret_cast<const char*>(KTX_IDENTIFIER), sizeof(KTX_IDENTIFIER));
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(levels.data()), sizeof(KtxLevel) * levelCount);
+    out.write(reinterpret_cast<const char*>(dfd.data()), dfd.size());
+    for (size_t l = levelCount; l-- > 0;)
+    {
+        static const char zeros[16] = {};
+        out.write(zeros, (std::streamsize)(levels[l].byteOffset - (uint64_t)out.tellp()));
+        out.write(reinterpret_cast<const char*>(texture.levels[l].data()), texture.levels[l].size());
+    }
+    return (bool)out;
+}
+
+bool KtxFile::read(const char* path, CompressedTexture& texture) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+        return false;
+    std::vector<uint8_t> file((size_t)in.tellg());
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char*>(file.data()), file.size()))
+        return false;
+
+    KtxHeader header;
+    if (file.size() < sizeof(KTX_IDENTIFIER) + sizeof(header) || memcmp(file.data(), KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0)
+        return false;
+    memcpy(&header, file.data() + sizeof(KTX_IDENTIFIER), sizeof(header));
+    if (!blockFormat(header.vkFormat, texture.format) || header.supercompressionScheme != 0 || header.pixelDepth > 1
+        || header.layerCount > 1 || header.faceCount != 1 || header.pixelWidth == 0 || header.pixelHeight == 0 || header.levelCount == 0)
+        return false;
+
+    size_t levelTable = sizeof(KTX_IDENTIFIER) + sizeof(header);
+    if (file.size() < levelTable + sizeof(KtxLevel) * header.levelCount)
+        return false;
+
+    texture.width = header.pixelWidth;
+    texture.height = header.pixelHeight;
+    texture.levels.assign(header.levelCount, {});
+    for (size_t l = 0; l < header.levelCount; l++)
+    {
+        KtxLevel level;
+        memcpy(&level, file.data() + levelTable + sizeof(KtxLevel) * l, sizeof(level));
+        size_t expected = TextureCompressor::imageBytes(texture.format, levelSize(texture.width, l), levelSize(texture.height, l));
+        if (level.byteLength != expected || level.byteOffset > file.size() || level.byteLength > file.size() - level.byteOffset)
+            return false;
+        texture.levels[l].assign(file.begin() + level.byteOffset, file.begin() + level.byteOffset + level.byteLength);
+    }
+    return true;
+}
+
+std::string KtxFile::bakedPath(const char* imagePath) {
+    std::string path = imagePath;
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+        path.erase(dot);
+    return path + ".ktx2";
+}
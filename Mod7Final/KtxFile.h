@@ -0,0 +1,59 @@
+#pragma once
+# include <cstdint>
+# include <string>
+# include "TextureCompressor.h"
+
+/* KTX 2.0 container for block compressed textures (Khronos KTX File Format 2.0). Only what the baker
+writes is read back: one 2D image with a full mip chain, BC1/BC3/BC7, no supercompression:
+
+	[identifier][KtxHeader][KtxLevel x levelCount][data format descriptor][mip data, smallest level first]
+*/
+const uint32_t KTX_VK_FORMAT_BC1_RGB_UNORM = 131;
+const uint32_t KTX_VK_FORMAT_BC3_UNORM = 137;
+const uint32_t KTX_VK_FORMAT_BC7_UNORM = 145;
+
+// Packed to 4 bytes: the 64-bit fields follow 13 32-bit ones in the file
+#pragma pack(push, 4)
+struct KtxHeader
+{
+	uint32_t vkFormat;
+	uint32_t typeSize;				// 1 for block compressed formats
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;			// 0 for 2D
+	uint32_t layerCount;			// 0 when not an array
+	uint32_t faceCount;
+	uint32_t levelCount;
+	uint32_t supercompressionScheme;
+	uint32_t dfdByteOffset;
+	uint32_t dfdByteLength;
+	uint32_t kvdByteOffset;
+	uint32_t kvdByteLength;
+	uint64_t sgdByteOffset;
+	uint64_t sgdByteLength;
+};
+#pragma pack(pop)
+
+// Where one mip level lives in the file
+struct KtxLevel
+{
+	uint64_t byteOffset;
+	uint64_t byteLength;
+	uint64_t uncompressedByteLength;
+};
+
+static_assert(sizeof(KtxHeader) == 68, "KtxHeader layout changed");
+static_assert(sizeof(KtxLevel) == 24, "KtxLevel layout changed");
+
+// Class to write and read baked textures
+class KtxFile
+{
+public:
+	static bool write(const char* path, const CompressedTexture& texture);
+
+	// Reads and validates the file. Returns false on any error or unsupported content
+	static bool read(const char* path, CompressedTexture& texture);
+
+	// Path of the baked copy of an image: the same name with the extension replaced by .ktx2
+	static std::string bakedPath(const char* imagePath);
+};
@@ -0,0 +1,267 @@
+#include "MeshFile.h"
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    uint64_t alignUp(uint64_t value)
+    {
+        return (value + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+    }
+
+    // Hash the raw bytes of one vertex so identical vertices collapse to one index
+    struct VertexKey
+    {
+        const float* values;
+        uint32_t count;
+
+        bool operator==(const VertexKey& other) const
+        {
+            return memcmp(values, other.values, sizeof(float) * count) == 0;
+        }
+    };
+
+    struct VertexKeyHash
+    {
+        size_t operator()(const VertexKey& key) const
+        {
+            uint64_t hash = 1469598103934665603ull;    // FNV-1a
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(key.values);
+            for (size_t i = 0; i < sizeof(float) * key.count; i++)
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            return (size_t)hash;
+        }
+    };
+
+    // Describe position / normal / texture attributes the same way UCreateMeshBuffer lays them out
+    void describeLayout(uint32_t floatsPerVertex, MeshFileEntry& entry)
+    {
+        const uint32_t sizes[3] = { 3, 3, floatsPerVertex > 6 ? floatsPerVertex - 6 : 0 };
+        uint32_t offset = 0;
+        entry.attributeCount = 0;
+        for (uint32_t location = 0; location < 3 && offset < floatsPerVertex; location++)
+        {
+            MeshAttribute& attribute = entry.attributes[entry.attributeCount++];
+            attribute.location = location;
+            attribute.components = sizes[location];
+            attribute.offset = offset * sizeof(float);
+            offset += sizes[location];
+        }
+        entry.vertexStride = floatsPerVertex * sizeof(float);
+    }
+}
+
+MeshFile::MeshFile() : data(nullptr), size(0)
+#ifdef _WIN32
+    , fileHandle(nullptr), mappingHandle(nullptr)
+#endif
+{
+}
+
+MeshFile::~MeshFile() {
+    close();
+}
+
+bool MeshFile::open(const char* path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    fileHandle = file;
+    mappingHandle = mapping;
+    size = (size_t)fileSize.QuadPart;
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);    // The mapping keeps the file alive
+    if (mapped == MAP_FAILED)
+        return false;
+    data = static_cast<const unsigned char*>(mapped);
+    size = (size_t)info.st_size;
+#endif
+    if (data == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    // Validate header and make sure every blob lies inside the file
+    const MeshFileHeader* header = reinterpret_cast<const MeshFileHeader*>(data);
+    if (size < sizeof(MeshFileHeader) || header->magic != MESH_FILE_MAGIC || header->version != MESH_FILE_VERSION
+        || header->entryOffset + (uint64_t)header->meshCount * sizeof(MeshFileEntry) > size)
+    {
+        close();
+        return false;
+    }
+    for (uint32_t i = 0; i < header->meshCount; i++)
+    {
+        const MeshFileEntry& e = entry(i);
+        if (e.attributeCount > MESH_FILE_MAX_ATTRIBUTES || e.vertexStride == 0
+            || e.vertexOffset % MESH_FILE_ALIGNMENT != 0 || e.indexOffset % MESH_FILE_ALIGNMENT != 0
+            || e.vertexOffset + e.vertexBytes > size || e.indexOffset + e.indexBytes > size
+            || e.vertexBytes != (uint64_t)e.vertexCount * e.vertexStride || e.indexBytes != (uint64_t)e.indexCount * sizeof(uint32_t))
+        {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void MeshFile::close() {
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+#else
+    if (data)
+        munmap(const_cast<unsigned char*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+uint32_t MeshFile::meshCount() const {
+    return data ? reinterpret_cast<const MeshFileHeader*>(data)->meshCount : 0;
+}
+
+const MeshFileEntry& MeshFile::entry(uint32_t mesh) const {
+    const MeshFileHeader* header = reinterpret_cast<const MeshFileHeader*>(data);
+    return reinterpret_cast<const MeshFileEntry*>(data + header->entryOffset)[mesh];
+}
+
+const void* MeshFile::vertexData(uint32_t mesh) const {
+    return data + entry(mesh).vertexOffset;
+}
+
+const void* MeshFile::indexData(uint32_t mesh) const {
+    return entry(mesh).indexCount ? data + entry(mesh).indexOffset : nullptr;
+}
+
+int MeshFile::find(const char* name) const {
+    for (uint32_t i = 0; i < meshCount(); i++)
+    {
+        if (strncmp(entry(i).name, name, sizeof(entry(i).name)) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+bool MeshFile::write(const char* path, std::span<const MeshFileSource> meshes) {
+    std::vector<MeshFileEntry> entries(meshes.size());
+    std::vector<std::vector<float>> vertexBlobs(meshes.size());
+    std::vector<std::vector<uint32_t>> indexBlobs(meshes.size());
+
+    uint64_t offset = alignUp(sizeof(MeshFileHeader) + sizeof(MeshFileEntry) * meshes.size());
+    for (size_t m = 0; m < meshes.size(); m++)
+    {
+        const MeshFileSource& source = meshes[m];
+        MeshFileEntry& e = entries[m];
+        memset(&e, 0, sizeof(e));
+        if (source.floatsPerVertex < 3 || source.vertices.size() % source.floatsPerVertex != 0 || source.name.size() >= sizeof(e.name))
+            return false;
+        memcpy(e.name, source.name.c_str(), source.name.size());
+        describeLayout(source.floatsPerVertex, e);
+
+        // Collapse identical vertices and record the triangle list as indices
+        std::unordered_map<VertexKey, uint32_t, VertexKeyHash> unique;
+        size_t inputVertices = source.vertices.size() / source.floatsPerVertex;
+        for (size_t v = 0; v < inputVertices; v++)
+        {
+            VertexKey key{ source.vertices.data() + v * source.floatsPerVertex, source.floatsPerVertex };
+            auto found = unique.find(key);
+            if (found == unique.end())
+            {
+                found = unique.emplace(key, (uint32_t)unique.size()).first;
+                vertexBlobs[m].insert(vertexBlobs[m].end(), key.values, key.values + key.count);
+            }
+            indexBlobs[m].push_back(found->second);
+        }
+
+        // Object space bounds
+        for (int axis = 0; axis < 3; axis++)
+        {
+            e.aabbMin[axis] = inputVertices ? source.vertices[axis] : 0.0f;
+            e.aabbMax[axis] = e.aabbMin[axis];
+        }
+        for (size_t v = 0; v < inputVertices; v++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float value = source.vertices[v * source.floatsPerVertex + axis];
+                e.aabbMin[axis] = value < e.aabbMin[axis] ? value : e.aabbMin[axis];
+                e.aabbMax[axis] = value > e.aabbMax[axis] ? value : e.aabbMax[axis];
+            }
+        }
+
+        e.vertexCount = (uint32_t)unique.size();
+        e.indexCount = (uint32_t)indexBlobs[m].size();
+        e.vertexBytes = (uint64_t)e.vertexCount * e.vertexStride;
+        e.indexBytes = (uint64_t)e.indexCount * sizeof(uint32_t);
+        e.vertexOffset = offset;
+        offset = alignUp(offset + e.vertexBytes);
+        e.indexOffset = offset;
+        offset = alignUp(offset + e.indexBytes);
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    MeshFileHeader header{ MESH_FILE_MAGIC, MESH_FILE_VERSION, (uint32_t)meshes.size(), sizeof(MeshFileHeader) };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), sizeof(MeshFileEntry) * entries.size());
+
+    // Pad up to each blob's aligned offset before writing it
+    auto padTo = [&out](uint64_t target) {
+        static const char zeros[MESH_FILE_ALIGNMENT] = {};
+        uint64_t position = (uint64_t)out.tellp();
+        if (target > position)
+            out.write(zeros, (std::streamsize)(target - position));
+    };
+    for (size_t m = 0; m < meshes.size(); m++)
+    {
+        padTo(entries[m].vertexOffset);
+        out.write(reinterpret_cast<const char*>(vertexBlobs[m].data()), (std::streamsize)entries[m].vertexBytes);
+        padTo(entries[m].indexOffset);
+        out.write(reinterpret_cast<const char*>(indexBlobs[m].data()), (std::streamsize)entries[m].indexBytes);
+    }
+    padTo(offset);
+    return (bool)out;
+}
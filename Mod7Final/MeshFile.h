@@ -0,0 +1,90 @@
+#pragma once
+# include <cstdint>
+# include <cstddef>
+# include <span>
+# include <string>
+
+/* Versioned binary mesh container. Everything is little-endian and every blob starts on a
+MESH_FILE_ALIGNMENT boundary so a memory mapped file can be handed straight to glBufferStorage:
+
+	[MeshFileHeader][MeshFileEntry x meshCount][vertex blob][index blob][vertex blob]...
+*/
+const uint32_t MESH_FILE_MAGIC = 0x4853454D;	// "MESH"
+const uint32_t MESH_FILE_VERSION = 1;
+const uint32_t MESH_FILE_ALIGNMENT = 256;
+const uint32_t MESH_FILE_MAX_ATTRIBUTES = 4;
+
+struct MeshFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t meshCount;
+	uint32_t entryOffset;		// Byte offset of the first MeshFileEntry
+};
+
+// One vertex attribute (position, normal, texture) inside an interleaved vertex
+struct MeshAttribute
+{
+	uint32_t location;			// Shader attribute location
+	uint32_t components;		// Number of floats
+	uint32_t offset;			// Byte offset inside the vertex
+	uint32_t reserved;
+};
+
+struct MeshFileEntry
+{
+	char name[32];
+	uint32_t vertexStride;		// Bytes per vertex
+	uint32_t attributeCount;
+	MeshAttribute attributes[MESH_FILE_MAX_ATTRIBUTES];
+	float aabbMin[3];			// Object space bounding box
+	float aabbMax[3];
+	uint32_t vertexCount;
+	uint32_t indexCount;		// 32-bit indices, three per triangle
+	uint64_t vertexOffset;
+	uint64_t vertexBytes;
+	uint64_t indexOffset;
+	uint64_t indexBytes;
+};
+
+static_assert(sizeof(MeshFileHeader) == 16, "MeshFileHeader layout changed");
+static_assert(sizeof(MeshFileEntry) == 168, "MeshFileEntry layout changed");
+
+// Input for writing one mesh: non-indexed interleaved floats with the position first
+struct MeshFileSource
+{
+	std::string name;
+	std::span<const float> vertices;
+	uint32_t floatsPerVertex;
+};
+
+// Class to memory map a mesh file and hand out pointers to its blobs
+class MeshFile
+{
+public:
+	MeshFile();
+	~MeshFile();
+	MeshFile(const MeshFile&) = delete;
+	MeshFile& operator=(const MeshFile&) = delete;
+
+	// Maps the file and validates its header and entries. Returns false on any error
+	bool open(const char* path);
+	void close();
+
+	uint32_t meshCount() const;
+	const MeshFileEntry& entry(uint32_t mesh) const;
+	const void* vertexData(uint32_t mesh) const;
+	const void* indexData(uint32_t mesh) const;
+	int find(const char* name) const;	// Returns -1 if the mesh is not in the file
+
+	// Deduplicates vertices into an index buffer, computes bounds and writes all meshes to path
+	static bool write(const char* path, std::span<const MeshFileSource> meshes);
+
+private:
+	const unsigned char* data;
+	size_t size;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+};
@@ -0,0 +1,265 @@
+#include "MeshGenerator.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MESH_GENERATOR_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+    const int FLOATS_PER_VERTEX = 8;    // position x, y, z    normal x, y, z    texture x, y
+    const float TWO_PI = 6.28318530718f;
+
+    bool gUseSimd = true;
+
+    /* Every float of a vertex in a row is A + B * cos + C * sin + D * t, where cos, sin and t
+    vary per column and the coefficients are fixed for the row*/
+    struct RowCoefficients
+    {
+        float a[FLOATS_PER_VERTEX] = {};
+        float b[FLOATS_PER_VERTEX] = {};
+        float c[FLOATS_PER_VERTEX] = {};
+        float d[FLOATS_PER_VERTEX] = {};
+    };
+
+    void emitRowScalar(const RowCoefficients& k, const float* cosv, const float* sinv, const float* t, int begin, int count, GLfloat* out)
+    {
+        for (int i = begin; i < count; i++)
+        {
+            for (int f = 0; f < FLOATS_PER_VERTEX; f++)
+                out[i * FLOATS_PER_VERTEX + f] = k.a[f] + k.b[f] * cosv[i] + k.c[f] * sinv[i] + k.d[f] * t[i];
+        }
+    }
+
+#ifdef MESH_GENERATOR_SSE
+    // Four vertices per iteration: evaluate the eight planar components, then transpose them into interleaved vertices
+    void emitRowSse(const RowCoefficients& k, const float* cosv, const float* sinv, const float* t, int count, GLfloat* out)
+    {
+        int i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 c = _mm_loadu_ps(cosv + i);
+            __m128 s = _mm_loadu_ps(sinv + i);
+            __m128 p = _mm_loadu_ps(t + i);
+            __m128 component[FLOATS_PER_VERTEX];
+            for (int f = 0; f < FLOATS_PER_VERTEX; f++)
+            {
+                component[f] = _mm_add_ps(
+                    _mm_add_ps(_mm_set1_ps(k.a[f]), _mm_mul_ps(_mm_set1_ps(k.b[f]), c)),
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(k.c[f]), s), _mm_mul_ps(_mm_set1_ps(k.d[f]), p)));
+            }
+            _MM_TRANSPOSE4_PS(component[0], component[1], component[2], component[3]);
+            _MM_TRANSPOSE4_PS(component[4], component[5], component[6], component[7]);
+            for (int lane = 0; lane < 4; lane++)
+            {
+                _mm_storeu_ps(out + (i + lane) * FLOATS_PER_VERTEX, component[lane]);
+                _mm_storeu_ps(out + (i + lane) * FLOATS_PER_VERTEX + 4, component[4 + lane]);
+            }
+        }
+        emitRowScalar(k, cosv, sinv, t, i, count, out);
+    }
+#endif
+
+    void emitRow(const RowCoefficients& k, const float* cosv, const float* sinv, const float* t, int count, GLfloat* out)
+    {
+#ifdef MESH_GENERATOR_SSE
+        if (gUseSimd)
+        {
+            emitRowSse(k, cosv, sinv, t, count, out);
+            return;
+        }
+#endif
+        emitRowScalar(k, cosv, sinv, t, 0, count, out);
+    }
+
+    // Angle tables for segments + 1 columns; the last column repeats the first with t = 1 for the texture seam
+    void angleTable(int segments, std::vector<float>& cosv, std::vector<float>& sinv, std::vector<float>& t)
+    {
+        cosv.resize(segments + 1);
+        sinv.resize(segments + 1);
+        t.resize(segments + 1);
+        for (int i = 0; i <= segments; i++)
+        {
+            t[i] = (float)i / segments;
+            float angle = TWO_PI * (i == segments ? 0 : i) / segments;
+            cosv[i] = std::cos(angle);
+            sinv[i] = std::sin(angle);
+        }
+    }
+
+    // Expands a (rows + 1) x (columns + 1) vertex grid into a triangle list, optionally flipping the winding
+    void gridTriangles(const std::vector<GLfloat>& grid, int rows, int columns, bool flip, std::vector<GLfloat>& vertices)
+    {
+        size_t start = vertices.size();
+        vertices.resize(start + (size_t)rows * columns * 6 * FLOATS_PER_VERTEX);
+        GLfloat* out = vertices.data() + start;
+        auto copy = [&grid, columns, &out](int row, int column) {
+            memcpy(out, &grid[((size_t)row * (columns + 1) + column) * FLOATS_PER_VERTEX], sizeof(GLfloat) * FLOATS_PER_VERTEX);
+            out += FLOATS_PER_VERTEX;
+        };
+        for (int r = 0; r < rows; r++)
+        {
+            for (int c = 0; c < columns; c++)
+            {
+                // a = (r, c)  b = (r, c + 1)  d = (r + 1, c)  e = (r + 1, c + 1)
+                if (!flip)
+                {
+                    copy(r, c); copy(r, c + 1); copy(r + 1, c);
+                    copy(r, c + 1); copy(r + 1, c + 1); copy(r + 1, c);
+                }
+                else
+                {
+                    copy(r, c); copy(r + 1, c); copy(r, c + 1);
+                    copy(r, c + 1); copy(r + 1, c); copy(r + 1, c + 1);
+                }
+            }
+        }
+    }
+
+    void pushVertex(std::vector<GLfloat>& vertices, glm::vec3 position, glm::vec3 normal, glm::vec2 uv)
+    {
+        vertices.insert(vertices.end(), { position.x, position.y, position.z, normal.x, normal.y, normal.z, uv.x, uv.y });
+    }
+}
+
+void MeshGenerator::torus(float majorRadius, float minorRadius, float height, int rings, int sides, glm::vec3 center, glm::vec2 uvMin,
+    glm::vec2 uvMax, std::vector<GLfloat>& vertices) {
+    rings = rings < 3 ? 3 : rings;
+    sides = sides < 3 ? 3 : sides;
+    std::vector<float> cosSide, sinSide, tSide, cosRing, sinRing, tRing;
+    angleTable(sides, cosSide, sinSide, tSide);
+    angleTable(rings, cosRing, sinRing, tRing);
+
+    /* One grid row per ring angle; columns walk around the tube. The normal of the elliptic tube is (halfHeight * cos,
+    minorRadius * sin) across it, scaled to unit length once the rows are done; a round tube needs no scaling*/
+    float halfHeight = height * 0.5f;
+    float radial = halfHeight / minorRadius;
+    glm::vec2 uvHalf = (uvMax - uvMin) * 0.5f;
+    std::vector<GLfloat> grid((size_t)(rings + 1) * (sides + 1) * FLOATS_PER_VERTEX);
+    for (int r = 0; r <= rings; r++)
+    {
+        RowCoefficients k;
+        float ct = cosRing[r], st = sinRing[r];
+        k.a[0] = center.x + majorRadius * ct;  k.b[0] = minorRadius * ct;   // position
+        k.a[1] = center.y;                     k.c[1] = halfHeight;
+        k.a[2] = center.z + majorRadius * st;  k.b[2] = minorRadius * st;
+        k.b[3] = radial * ct;                                               // normal
+        k.c[4] = 1.0f;
+        k.b[5] = radial * st;
+        k.a[6] = uvMin.x + (uvMax.x - uvMin.x) * tRing[r];                  // texture
+        k.a[7] = uvMin.y + uvHalf.y;           k.b[7] = -uvHalf.y;
+        emitRow(k, cosSide.data(), sinSide.data(), tSide.data(), sides + 1, &grid[(size_t)r * (sides + 1) * FLOATS_PER_VERTEX]);
+    }
+    if (halfHeight != minorRadius)
+    {
+        for (size_t v = 0; v < grid.size(); v += FLOATS_PER_VERTEX)
+        {
+            glm::vec3 normal = glm::normalize(glm::vec3(grid[v + 3], grid[v + 4], grid[v + 5]));
+            grid[v + 3] = normal.x;
+            grid[v + 4] = normal.y;
+            grid[v + 5] = normal.z;
+        }
+    }
+    gridTriangles(grid, rings, sides, false, vertices);
+}
+
+void MeshGenerator::cylinder(float bottomRadius, float topRadius, float height, int segments, float uRepeat, glm::vec3 center, std::vector<GLfloat>& vertices) {
+    segments = segments < 3 ? 3 : segments;
+    std::vector<float> cosv, sinv, t;
+    angleTable(segments, cosv, sinv, t);
+
+    // The wall normal leans by the taper and is the same at every height
+    float slope = bottomRadius - topRadius;
+    float length = std::sqrt(height * height + slope * slope);
+    float radial = height / length, vertical = slope / length;
+
+    // Two rows are enough for a straight wall: bottom and top
+    std::vector<GLfloat> grid((size_t)2 * (segments + 1) * FLOATS_PER_VERTEX);
+    for (int row = 0; row < 2; row++)
+    {
+        RowCoefficients k;
+        float radius = row ? topRadius : bottomRadius;
+        k.a[0] = center.x;              k.b[0] = radius;
+        k.a[1] = center.y + row * height;
+        k.a[2] = center.z;              k.c[2] = radius;
+        k.b[3] = radial;
+        k.a[4] = vertical;
+        k.c[5] = radial;
+        k.d[6] = uRepeat;
+        k.a[7] = (float)row;
+        emitRow(k, cosv.data(), sinv.data(), t.data(), segments + 1, &grid[(size_t)row * (segments + 1) * FLOATS_PER_VERTEX]);
+    }
+    gridTriangles(grid, 1, segments, true, vertices);
+}
+
+void MeshGenerator::disk(float radius, int segments, bool facingUp, glm::vec3 center, glm::vec2 uvMin, glm::vec2 uvMax, std::vector<GLfloat>& vertices) {
+    segments = segments < 3 ? 3 : segments;
+    std::vector<float> cosv, sinv, t;
+    angleTable(segments, cosv, sinv, t);
+
+    // Rim vertices, texture mapped radially: around the rim along u, the rim itself at uvMax.y
+    RowCoefficients k;
+    k.a[0] = center.x;  k.b[0] = radius;
+    k.a[1] = center.y;
+    k.a[2] = center.z;  k.c[2] = radius;
+    k.a[4] = facingUp ? 1.0f : -1.0f;
+    k.a[6] = uvMin.x;   k.d[6] = uvMax.x - uvMin.x;
+    k.a[7] = uvMax.y;
+    std::vector<GLfloat> rim((size_t)(segments + 1) * FLOATS_PER_VERTEX);
+    emitRow(k, cosv.data(), sinv.data(), t.data(), segments + 1, rim.data());
+
+    // Triangle fan around the center, which takes the u halfway along the rim edge of each triangle
+    GLfloat middle[FLOATS_PER_VERTEX] = { center.x, center.y, center.z, 0.0f, k.a[4], 0.0f, 0.0f, uvMin.y };
+    for (int i = 0; i < segments; i++)
+    {
+        const GLfloat* first = &rim[(size_t)(facingUp ? i + 1 : i) * FLOATS_PER_VERTEX];
+        const GLfloat* second = &rim[(size_t)(facingUp ? i : i + 1) * FLOATS_PER_VERTEX];
+        middle[6] = (first[6] + second[6]) * 0.5f;
+        vertices.insert(vertices.end(), middle, middle + FLOATS_PER_VERTEX);
+        vertices.insert(vertices.end(), first, first + FLOATS_PER_VERTEX);
+        vertices.insert(vertices.end(), second, second + FLOATS_PER_VERTEX);
+    }
+}
+
+void MeshGenerator::cappedCylinder(float bottomRadius, float topRadius, float height, int segments, glm::vec3 center, std::vector<GLfloat>& vertices) {
+    cylinder(bottomRadius, topRadius, height, segments, 1.0f, center, vertices);
+    disk(topRadius, segments, true, center + glm::vec3(0.0f, height, 0.0f), glm::vec2(0.0f), glm::vec2(1.0f), vertices);
+    disk(bottomRadius, segments, false, center, glm::vec2(0.0f), glm::vec2(1.0f), vertices);
+}
+
+void MeshGenerator::box(glm::vec3 size, glm::vec3 center, std::vector<GLfloat>& vertices) {
+    // Each face: outward normal, then u and v axes chosen so that u x v = normal (counter-clockwise from outside)
+    static const glm::vec3 faces[6][3] = {
+        { glm::vec3(1, 0, 0),  glm::vec3(0, 0, -1), glm::vec3(0, 1, 0) },
+        { glm::vec3(-1, 0, 0), glm::vec3(0, 0, 1),  glm::vec3(0, 1, 0) },
+        { glm::vec3(0, 1, 0),  glm::vec3(1, 0, 0),  glm::vec3(0, 0, -1) },
+        { glm::vec3(0, -1, 0), glm::vec3(1, 0, 0),  glm::vec3(0, 0, 1) },
+        { glm::vec3(0, 0, 1),  glm::vec3(1, 0, 0),  glm::vec3(0, 1, 0) },
+        { glm::vec3(0, 0, -1), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0) },
+    };
+    static const glm::vec2 corners[6] = { glm::vec2(0, 0), glm::vec2(1, 0), glm::vec2(1, 1), glm::vec2(0, 0), glm::vec2(1, 1), glm::vec2(0, 1) };
+
+    glm::vec3 half = size * 0.5f;
+    for (const glm::vec3* face : faces)
+    {
+        for (const glm::vec2& corner : corners)
+        {
+            glm::vec3 offset = face[0] + face[1] * (corner.x * 2.0f - 1.0f) + face[2] * (corner.y * 2.0f - 1.0f);
+            pushVertex(vertices, center + offset * half, face[0], corner);
+        }
+    }
+}
+
+void MeshGenerator::setSimd(bool enabled) {
+    gUseSimd = enabled;
+}
+
+bool MeshGenerator::simdAvailable() {
+#ifdef MESH_GENERATOR_SSE
+    return true;
+#else
+    return false;
+#endif
+}
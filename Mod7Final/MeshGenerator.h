@@ -0,0 +1,33 @@
+#pragma once
+# include <vector>
+# include <GL/glew.h>
+# include <glm/glm.hpp>
+
+/* Class to build primitives procedurally at any tessellation. Output is a triangle list in the
+interleaved layout UCreateMesh uses (position, analytic normal, texture coordinate), wound
+counter-clockwise when seen from outside. Vertex rows are computed four at a time with SSE*/
+class MeshGenerator
+{
+public:
+	/* Ring torus around the y axis; rings go around the axis, sides go around the tube. The tube is minorRadius wide and
+	height tall (2 * minorRadius for a round one). u runs from uvMin.x to uvMax.x once around the ring; v runs from
+	uvMin.y on the outer equator over the top to uvMax.y on the inner one, and back the same way underneath*/
+	static void torus(float majorRadius, float minorRadius, float height, int rings, int sides, glm::vec3 center, glm::vec2 uvMin,
+		glm::vec2 uvMax, std::vector<GLfloat>& vertices);
+
+	// Open side wall of a (possibly tapered) cylinder standing on center; u repeats uRepeat times around
+	static void cylinder(float bottomRadius, float topRadius, float height, int segments, float uRepeat, glm::vec3 center, std::vector<GLfloat>& vertices);
+
+	// Flat disk facing +y (or -y); u runs from uvMin.x to uvMax.x around the rim, v from uvMin.y at the center to uvMax.y at the rim
+	static void disk(float radius, int segments, bool facingUp, glm::vec3 center, glm::vec2 uvMin, glm::vec2 uvMax, std::vector<GLfloat>& vertices);
+
+	// Cylinder wall plus top and bottom disks
+	static void cappedCylinder(float bottomRadius, float topRadius, float height, int segments, glm::vec3 center, std::vector<GLfloat>& vertices);
+
+	// Axis aligned box with one full texture per face
+	static void box(glm::vec3 size, glm::vec3 center, std::vector<GLfloat>& vertices);
+
+	// Switch between the SSE and scalar row kernels (used by the benchmark)
+	static void setSimd(bool enabled);
+	static bool simdAvailable();
+};
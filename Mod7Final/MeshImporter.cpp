@@ -0,0 +1,632 @@
+#include "MeshImporter.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+namespace
+{
+    const size_t FLOATS_PER_OUTPUT_VERTEX = 8;
+    const size_t MIN_OBJ_CHUNK_BYTES = 1 << 16;   // Don't split small files across threads
+
+    // ---------------------------------------------------------------- OBJ
+
+    // One face corner with 0-based indices, -1 when the attribute is missing
+    struct ObjCorner
+    {
+        int32_t position, uv, normal;
+    };
+
+    struct ObjChunk
+    {
+        const char* begin;
+        const char* end;
+        size_t positionCount = 0, uvCount = 0, normalCount = 0;     // Elements defined inside this chunk
+        size_t positionBase = 0, uvBase = 0, normalBase = 0;        // Elements defined before this chunk
+        std::vector<ObjCorner> corners;     // Triangulated corners, three per triangle
+        size_t outputBase = 0;              // First output triangle of this chunk
+        bool valid = true;
+    };
+
+    inline bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline const char* skipSpaces(const char* p, const char* end)
+    {
+        while (p < end && isSpace(*p))
+            p++;
+        return p;
+    }
+
+    inline const char* nextLine(const char* p, const char* end)
+    {
+        const void* newline = memchr(p, '\n', end - p);
+        return newline ? static_cast<const char*>(newline) + 1 : end;
+    }
+
+    // Parses a float in place without allocating; returns nullptr on failure
+    inline const char* parseFloat(const char* p, const char* end, float& value)
+    {
+        p = skipSpaces(p, end);
+        if (p < end && *p == '+')
+            p++;
+        std::from_chars_result result = std::from_chars(p, end, value);
+        return result.ec == std::errc() ? result.ptr : nullptr;
+    }
+
+    inline const char* parseInt(const char* p, const char* end, int32_t& value)
+    {
+        std::from_chars_result result = std::from_chars(p, end, value);
+        return result.ec == std::errc() ? result.ptr : nullptr;
+    }
+
+    // Converts a 1-based or negative (relative) OBJ index to 0-based; count is the number of elements defined so far
+    inline int32_t resolveIndex(int32_t raw, size_t count)
+    {
+        return raw > 0 ? raw - 1 : (int32_t)count + raw;
+    }
+
+    // Pass 1: count the attribute lines in a chunk so every chunk knows its global index base
+    void countObjChunk(ObjChunk& chunk)
+    {
+        for (const char* line = chunk.begin; line < chunk.end; line = nextLine(line, chunk.end))
+        {
+            const char* p = skipSpaces(line, chunk.end);
+            if (chunk.end - p < 2 || p[0] != 'v')
+                continue;
+            if (isSpace(p[1]))
+                chunk.positionCount++;
+            else if (p[1] == 't')
+                chunk.uvCount++;
+            else if (p[1] == 'n')
+                chunk.normalCount++;
+        }
+    }
+
+    // Pass 2: parse attributes straight into the shared arrays and triangulate faces into chunk corners
+    void parseObjChunk(ObjChunk& chunk, float* positions, float* uvs, float* normals)
+    {
+        size_t position = chunk.positionBase, uv = chunk.uvBase, normal = chunk.normalBase;
+        ObjCorner polygon[64];
+
+        for (const char* line = chunk.begin; line < chunk.end && chunk.valid; line = nextLine(line, chunk.end))
+        {
+            const char* p = skipSpaces(line, chunk.end);
+            const char* lineEnd = nextLine(p, chunk.end);
+            if (lineEnd - p < 2)
+                continue;
+
+            if (p[0] == 'v' && isSpace(p[1]))
+            {
+                p += 2;
+                for (int axis = 0; axis < 3 && p; axis++)
+                    p = parseFloat(p, lineEnd, positions[position * 3 + axis]);
+                chunk.valid = p != nullptr;
+                position++;
+            }
+            else if (p[0] == 'v' && p[1] == 't')
+            {
+                p += 2;
+                for (int axis = 0; axis < 2 && p; axis++)
+                    p = parseFloat(p, lineEnd, uvs[uv * 2 + axis]);
+                chunk.valid = p != nullptr;
+                uv++;
+            }
+            else if (p[0] == 'v' && p[1] == 'n')
+            {
+                p += 2;
+                for (int axis = 0; axis < 3 && p; axis++)
+                    p = parseFloat(p, lineEnd, normals[normal * 3 + axis]);
+                chunk.valid = p != nullptr;
+                normal++;
+            }
+            else if (p[0] == 'f' && isSpace(p[1]))
+            {
+                // Read every corner (v, v/vt, v//vn or v/vt/vn) of the polygon
+                int cornerCount = 0;
+                p = skipSpaces(p + 1, lineEnd);
+                while (p < lineEnd && *p != '\n' && *p != '#' && cornerCount < 64)
+                {
+                    int32_t raw = 0;
+                    ObjCorner corner{ -1, -1, -1 };
+                    if (!(p = parseInt(p, lineEnd, raw)))
+                        break;
+                    corner.position = resolveIndex(raw, position);
+                    if (p < lineEnd && *p == '/')
+                    {
+                        p++;
+                        if (p < lineEnd && *p != '/')
+                        {
+                            if (!(p = parseInt(p, lineEnd, raw)))
+                                break;
+                            corner.uv = resolveIndex(raw, uv);
+                        }
+                        if (p < lineEnd && *p == '/')
+                        {
+                            if (!(p = parseInt(p + 1, lineEnd, raw)))
+                                break;
+                            corner.normal = resolveIndex(raw, normal);
+                        }
+                    }
+                    polygon[cornerCount++] = corner;
+                    p = skipSpaces(p, lineEnd);
+                }
+                if (p == nullptr || cornerCount < 3)
+                {
+                    chunk.valid = false;
+                    break;
+                }
+
+                // Triangulate as a fan
+                for (int c = 1; c + 1 < cornerCount; c++)
+                {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[c]);
+                    chunk.corners.push_back(polygon[c + 1]);
+                }
+            }
+        }
+    }
+
+    // Writes one output vertex; a missing normal is replaced by the triangle's geometric normal
+    inline void writeVertex(GLfloat* out, const float* position, const float* normal, const float* faceNormal, const float* uv)
+    {
+        out[0] = position[0]; out[1] = position[1]; out[2] = position[2];
+        const float* n = normal ? normal : faceNormal;
+        out[3] = n[0]; out[4] = n[1]; out[5] = n[2];
+        out[6] = uv ? uv[0] : 0.0f;
+        out[7] = uv ? uv[1] : 0.0f;
+    }
+
+    inline void triangleNormal(const float* a, const float* b, const float* c, float* normal)
+    {
+        float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+        float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (int axis = 0; axis < 3; axis++)
+            normal[axis] = length > 0.0f ? normal[axis] / length : 0.0f;
+    }
+
+    // ---------------------------------------------------------------- glTF
+
+    // Just enough JSON to walk the glTF scene description
+    struct JsonValue
+    {
+        enum Type { Null, Bool, Number, String, Array, Object } type = Null;
+        double number = 0.0;
+        std::string_view text;
+        std::vector<JsonValue> items;
+        std::vector<std::string_view> keys;     // Parallel to items for objects
+
+        const JsonValue* get(std::string_view key) const
+        {
+            for (size_t i = 0; i < keys.size(); i++)
+                if (keys[i] == key)
+                    return &items[i];
+            return nullptr;
+        }
+
+        double numberOr(std::string_view key, double fallback) const
+        {
+            const JsonValue* value = get(key);
+            return value && value->type == Number ? value->number : fallback;
+        }
+    };
+
+    class JsonParser
+    {
+    public:
+        JsonParser(const char* begin, const char* end) : p(begin), end(end) {}
+
+        bool parse(JsonValue& value)
+        {
+            skip();
+            if (p >= end)
+                return false;
+            if (*p == '{')
+                return parseObject(value);
+            if (*p == '[')
+                return parseArray(value);
+            if (*p == '"')
+            {
+                value.type = JsonValue::String;
+                return parseString(value.text);
+            }
+            if (end - p >= 4 && (!strncmp(p, "true", 4) || !strncmp(p, "null", 4)))
+            {
+                value.type = *p == 't' ? JsonValue::Bool : JsonValue::Null;
+                value.number = *p == 't' ? 1.0 : 0.0;
+                p += 4;
+                return true;
+            }
+            if (end - p >= 5 && !strncmp(p, "false", 5))
+            {
+                value.type = JsonValue::Bool;
+                p += 5;
+                return true;
+            }
+            value.type = JsonValue::Number;
+            std::from_chars_result result = std::from_chars(p, end, value.number);
+            p = result.ptr;
+            return result.ec == std::errc();
+        }
+
+    private:
+        void skip()
+        {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+                p++;
+        }
+
+        bool parseString(std::string_view& text)
+        {
+            const char* start = ++p;
+            while (p < end && *p != '"')
+                p += *p == '\\' ? 2 : 1;
+            if (p >= end)
+                return false;
+            text = std::string_view(start, p - start);
+            p++;
+            return true;
+        }
+
+        bool parseArray(JsonValue& value)
+        {
+            value.type = JsonValue::Array;
+            p++;
+            skip();
+            if (p < end && *p == ']')
+                return ++p, true;
+            for (;;)
+            {
+                value.items.emplace_back();
+                if (!parse(value.items.back()))
+                    return false;
+                skip();
+                if (p < end && *p == ',')
+                    p++;
+                else if (p < end && *p == ']')
+                    return ++p, true;
+                else
+                    return false;
+            }
+        }
+
+        bool parseObject(JsonValue& value)
+        {
+            value.type = JsonValue::Object;
+            p++;
+            skip();
+            if (p < end && *p == '}')
+                return ++p, true;
+            for (;;)
+            {
+                skip();
+                std::string_view key;
+                if (p >= end || *p != '"' || !parseString(key))
+                    return false;
+                skip();
+                if (p >= end || *p++ != ':')
+                    return false;
+                value.keys.push_back(key);
+                value.items.emplace_back();
+                if (!parse(value.items.back()))
+                    return false;
+                skip();
+                if (p < end && *p == ',')
+                    p++;
+                else if (p < end && *p == '}')
+                    return ++p, true;
+                else
+                    return false;
+            }
+        }
+
+        const char* p;
+        const char* end;
+    };
+
+    // Resolved view of one glTF accessor inside the binary chunk
+    struct GltfAccessor
+    {
+        const unsigned char* data = nullptr;
+        size_t count = 0;
+        size_t stride = 0;
+        int componentType = 0;
+        int components = 0;
+    };
+
+    const int GLTF_UNSIGNED_BYTE = 5121;
+    const int GLTF_UNSIGNED_SHORT = 5123;
+    const int GLTF_UNSIGNED_INT = 5125;
+    const int GLTF_FLOAT = 5126;
+
+    int componentSize(int componentType)
+    {
+        switch (componentType)
+        {
+        case GLTF_UNSIGNED_BYTE: return 1;
+        case GLTF_UNSIGNED_SHORT: return 2;
+        case GLTF_UNSIGNED_INT: case GLTF_FLOAT: return 4;
+        default: return 0;
+        }
+    }
+
+    int typeComponents(std::string_view type)
+    {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        return 0;
+    }
+
+    bool resolveAccessor(const JsonValue& root, double index, std::span<const unsigned char> bin, GltfAccessor& accessor)
+    {
+        const JsonValue* accessors = root.get("accessors");
+        const JsonValue* views = root.get("bufferViews");
+        if (!accessors || !views || index < 0 || index >= accessors->items.size())
+            return false;
+        const JsonValue& a = accessors->items[(size_t)index];
+        const JsonValue* type = a.get("type");
+        double viewIndex = a.numberOr("bufferView", -1);
+        if (!type || viewIndex < 0 || viewIndex >= views->items.size())
+            return false;
+        const JsonValue& view = views->items[(size_t)viewIndex];
+        if (view.numberOr("buffer", 0) != 0)
+            return false;   // Only the embedded binary chunk is supported
+
+        accessor.componentType = (int)a.numberOr("componentType", 0);
+        accessor.components = typeComponents(type->text);
+        accessor.count = (size_t)a.numberOr("count", 0);
+        size_t elementSize = (size_t)componentSize(accessor.componentType) * accessor.components;
+        accessor.stride = (size_t)view.numberOr("byteStride", (double)elementSize);
+        size_t offset = (size_t)view.numberOr("byteOffset", 0) + (size_t)a.numberOr("byteOffset", 0);
+        size_t viewEnd = (size_t)view.numberOr("byteOffset", 0) + (size_t)view.numberOr("byteLength", 0);
+        if (elementSize == 0 || viewEnd > bin.size() || (accessor.count && offset + accessor.stride * (accessor.count - 1) + elementSize > viewEnd))
+            return false;
+        accessor.data = bin.data() + offset;
+        return true;
+    }
+
+    inline uint32_t readIndex(const GltfAccessor& accessor, size_t i)
+    {
+        const unsigned char* p = accessor.data + i * accessor.stride;
+        if (accessor.componentType == GLTF_UNSIGNED_BYTE)
+            return *p;
+        if (accessor.componentType == GLTF_UNSIGNED_SHORT)
+        {
+            uint16_t value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline void readFloats(const GltfAccessor& accessor, size_t i, float* out)
+    {
+        memcpy(out, accessor.data + i * accessor.stride, sizeof(float) * accessor.components);
+    }
+
+    struct GltfPrimitive
+    {
+        GltfAccessor positions, normals, uvs, indices;
+        bool hasNormals = false, hasUVs = false, indexed = false;
+        size_t triangles = 0;
+        size_t outputBase = 0;
+    };
+}
+
+bool MeshImporter::load(const char* path, std::vector<GLfloat>& vertices, ThreadPool& pool, ImportStats& stats) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+    std::vector<char> data((size_t)file.tellg());
+    file.seekg(0);
+    if (!file.read(data.data(), (std::streamsize)data.size()))
+        return false;
+
+    std::string_view name(path);
+    bool binary = name.size() >= 4 && (name.substr(name.size() - 4) == ".glb" || name.substr(name.size() - 4) == ".GLB");
+
+    auto start = std::chrono::steady_clock::now();
+    bool loaded = binary
+        ? parseGlb(std::span<const unsigned char>(reinterpret_cast<const unsigned char*>(data.data()), data.size()), vertices, pool)
+        : parseObj(data, vertices, pool);
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.bytes = data.size();
+    stats.triangles = vertices.size() / (FLOATS_PER_OUTPUT_VERTEX * 3);
+    return loaded;
+}
+
+bool MeshImporter::parseObj(std::span<const char> text, std::vector<GLfloat>& vertices, ThreadPool& pool) {
+    vertices.clear();
+    const char* begin = text.data();
+    const char* end = text.data() + text.size();
+
+    // Split at line boundaries, one chunk per worker
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(pool.size(), text.size() / MIN_OBJ_CHUNK_BYTES));
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char* cursor = begin;
+    for (size_t c = 0; c < chunkCount; c++)
+    {
+        const char* split = c + 1 == chunkCount ? end : nextLine(std::max(cursor, begin + text.size() * (c + 1) / chunkCount), end);
+        chunks[c].begin = cursor;
+        chunks[c].end = split;
+        cursor = split;
+    }
+
+    pool.parallelFor(chunkCount, [&](size_t c) { countObjChunk(chunks[c]); });
+
+    size_t positionCount = 0, uvCount = 0, normalCount = 0;
+    for (ObjChunk& chunk : chunks)
+    {
+        chunk.positionBase = positionCount;
+        chunk.uvBase = uvCount;
+        chunk.normalBase = normalCount;
+        positionCount += chunk.positionCount;
+        uvCount += chunk.uvCount;
+        normalCount += chunk.normalCount;
+    }
+
+    std::vector<float> positions(positionCount * 3), uvs(uvCount * 2), normals(normalCount * 3);
+    pool.parallelFor(chunkCount, [&](size_t c) { parseObjChunk(chunks[c], positions.data(), uvs.data(), normals.data()); });
+
+    size_t triangleCount = 0;
+    for (ObjChunk& chunk : chunks)
+    {
+        if (!chunk.valid)
+            return false;
+        chunk.outputBase = triangleCount;
+        triangleCount += chunk.corners.size() / 3;
+    }
+
+    // Pass 3: gather every corner into the interleaved output
+    vertices.resize(triangleCount * 3 * FLOATS_PER_OUTPUT_VERTEX);
+    std::atomic<bool> valid(true);
+    pool.parallelFor(chunkCount, [&](size_t c) {
+        const ObjChunk& chunk = chunks[c];
+        GLfloat* out = vertices.data() + chunk.outputBase * 3 * FLOATS_PER_OUTPUT_VERTEX;
+        for (size_t i = 0; i < chunk.corners.size(); i += 3)
+        {
+            const ObjCorner* corner = &chunk.corners[i];
+            for (int k = 0; k < 3; k++)
+            {
+                if (corner[k].position < 0 || (size_t)corner[k].position >= positionCount
+                    || corner[k].uv >= (int32_t)uvCount || corner[k].normal >= (int32_t)normalCount)
+                {
+                    valid = false;
+                    return;
+                }
+            }
+            float faceNormal[3];
+            triangleNormal(&positions[corner[0].position * 3], &positions[corner[1].position * 3], &positions[corner[2].position * 3], faceNormal);
+            for (int k = 0; k < 3; k++, out += FLOATS_PER_OUTPUT_VERTEX)
+            {
+                writeVertex(out, &positions[corner[k].position * 3],
+                    corner[k].normal >= 0 ? &normals[corner[k].normal * 3] : nullptr, faceNormal,
+                    corner[k].uv >= 0 ? &uvs[corner[k].uv * 2] : nullptr);
+            }
+        }
+    });
+    if (!valid)
+        vertices.clear();
+    return valid;
+}
+
+bool MeshImporter::parseGlb(std::span<const unsigned char> data, std::vector<GLfloat>& vertices, ThreadPool& pool) {
+    vertices.clear();
+
+    // 12 byte header followed by a JSON chunk and an optional BIN chunk
+    auto read32 = [&data](size_t offset) {
+        uint32_t value;
+        memcpy(&value, data.data() + offset, sizeof(value));
+        return value;
+    };
+    if (data.size() < 20 || read32(0) != 0x46546C67 || read32(4) != 2)   // "glTF", version 2
+        return false;
+    size_t jsonLength = read32(12);
+    if (read32(16) != 0x4E4F534A || 20 + jsonLength > data.size())         // "JSON"
+        return false;
+    std::span<const unsigned char> bin;
+    size_t binHeader = 20 + ((jsonLength + 3) & ~size_t(3));
+    if (binHeader + 8 <= data.size() && read32(binHeader + 4) == 0x004E4942)  // "BIN"
+        bin = data.subspan(binHeader + 8, std::min<size_t>(read32(binHeader), data.size() - binHeader - 8));
+
+    JsonValue root;
+    const char* json = reinterpret_cast<const char*>(data.data() + 20);
+    if (!JsonParser(json, json + jsonLength).parse(root) || root.type != JsonValue::Object)
+        return false;
+
+    // Collect every triangle primitive of every mesh
+    static const std::vector<JsonValue> none;
+    std::vector<GltfPrimitive> primitives;
+    const JsonValue* meshes = root.get("meshes");
+    for (const JsonValue& mesh : meshes ? meshes->items : none)
+    {
+        const JsonValue* list = mesh.get("primitives");
+        for (const JsonValue& primitive : list ? list->items : none)
+        {
+            const JsonValue* attributes = primitive.get("attributes");
+            if (!attributes || primitive.numberOr("mode", 4) != 4)
+                continue;   // Only triangle lists are imported
+            GltfPrimitive p;
+            if (!resolveAccessor(root, attributes->numberOr("POSITION", -1), bin, p.positions)
+                || p.positions.componentType != GLTF_FLOAT || p.positions.components != 3)
+                return false;
+            p.hasNormals = resolveAccessor(root, attributes->numberOr("NORMAL", -1), bin, p.normals)
+                && p.normals.componentType == GLTF_FLOAT && p.normals.components == 3 && p.normals.count == p.positions.count;
+            p.hasUVs = resolveAccessor(root, attributes->numberOr("TEXCOORD_0", -1), bin, p.uvs)
+                && p.uvs.componentType == GLTF_FLOAT && p.uvs.components == 2 && p.uvs.count == p.positions.count;
+            p.indexed = primitive.get("indices") != nullptr;
+            if (p.indexed && !resolveAccessor(root, primitive.numberOr("indices", -1), bin, p.indices))
+                return false;
+            p.triangles = (p.indexed ? p.indices.count : p.positions.count) / 3;
+            primitives.push_back(p);
+        }
+    }
+
+    size_t triangleCount = 0;
+    for (GltfPrimitive& p : primitives)
+    {
+        p.outputBase = triangleCount;
+        triangleCount += p.triangles;
+    }
+    vertices.resize(triangleCount * 3 * FLOATS_PER_OUTPUT_VERTEX);
+
+    // De-index triangles across the pool, each worker writing its own slice of the output
+    std::atomic<bool> valid(true);
+    pool.parallelFor(triangleCount, [&](size_t triangle) {
+        auto owner = std::upper_bound(primitives.begin(), primitives.end(), triangle,
+            [](size_t t, const GltfPrimitive& p) { return t < p.outputBase; });
+        const GltfPrimitive& p = *(owner - 1);
+        size_t local = triangle - p.outputBase;
+
+        uint32_t corner[3];
+        for (int k = 0; k < 3; k++)
+        {
+            corner[k] = p.indexed ? readIndex(p.indices, local * 3 + k) : (uint32_t)(local * 3 + k);
+            if (corner[k] >= p.positions.count)
+            {
+                valid = false;
+                return;
+            }
+        }
+
+        float position[3][3], faceNormal[3];
+        for (int k = 0; k < 3; k++)
+            readFloats(p.positions, corner[k], position[k]);
+        triangleNormal(position[0], position[1], position[2], faceNormal);
+
+        GLfloat* out = vertices.data() + triangle * 3 * FLOATS_PER_OUTPUT_VERTEX;
+        for (int k = 0; k < 3; k++, out += FLOATS_PER_OUTPUT_VERTEX)
+        {
+            float normal[3], uv[2];
+            if (p.hasNormals)
+                readFloats(p.normals, corner[k], normal);
+            if (p.hasUVs)
+            {
+                readFloats(p.uvs, corner[k], uv);
+                uv[1] = 1.0f - uv[1];   // glTF puts the texture origin at the top left
+            }
+            writeVertex(out, position[k], p.hasNormals ? normal : nullptr, faceNormal, p.hasUVs ? uv : nullptr);
+        }
+    });
+    if (!valid)
+        vertices.clear();
+    return valid;
+}
@@ -0,0 +1,29 @@
+#pragma once
+# include <cstddef>
+# include <span>
+# include <vector>
+# include <GL/glew.h>
+
+class ThreadPool;
+
+// Size and speed of one import
+struct ImportStats
+{
+	size_t bytes = 0;			// Size of the source file
+	size_t triangles = 0;		// Triangles produced
+	double seconds = 0.0;		// Parse time, excluding the file read
+};
+
+/* Class to import Wavefront OBJ and binary glTF 2.0 (.glb) models. Parsing is split across the
+worker pool and the result is a triangle list in the same interleaved layout UCreateMesh uses:
+position x, y, z    normal x, y, z    texture x, y*/
+class MeshImporter
+{
+public:
+	// Reads the file and picks the parser from the extension (.obj or .glb)
+	static bool load(const char* path, std::vector<GLfloat>& vertices, ThreadPool& pool, ImportStats& stats);
+
+	// Parsers working on data already in memory
+	static bool parseObj(std::span<const char> text, std::vector<GLfloat>& vertices, ThreadPool& pool);
+	static bool parseGlb(std::span<const unsigned char> data, std::vector<GLfloat>& vertices, ThreadPool& pool);
+};
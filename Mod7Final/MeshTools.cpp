@@ -0,0 +1,403 @@
+#include "MeshTools.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MESH_TOOLS_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+    // Squared area (times 4) below which a triangle is treated as degenerate
+    const float DEGENERATE_EPSILON = 1e-12f;
+
+    // Returns true if the three positions do not span any area
+    bool isDegenerate(const GLfloat* a, const GLfloat* b, const GLfloat* c)
+    {
+        float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+        return n[0] * n[0] + n[1] * n[1] + n[2] * n[2] <= DEGENERATE_EPSILON;
+    }
+
+    /*Computes the unit normal of every triangle and the cosine of each of its three corner angles.
+    Four triangles are processed per step with SSE; degenerate triangles get a zero normal*/
+    void faceNormals(const GLfloat* vertices, GLuint floatsPerVertex, GLuint nTriangles, std::vector<float>& normals, std::vector<float>& cosines)
+    {
+        normals.assign((size_t)nTriangles * 3, 0.0f);
+        cosines.assign((size_t)nTriangles * 3, 0.0f);
+        const size_t triangleStride = (size_t)floatsPerVertex * 3;
+        GLuint t = 0;
+
+#ifdef MESH_TOOLS_SSE
+        for (; t + 4 <= nTriangles; t += 4)
+        {
+            // Gather the corners of four triangles into one register per coordinate
+            alignas(16) float p[3][3][4];
+            for (int lane = 0; lane < 4; lane++)
+            {
+                const GLfloat* v = vertices + (t + lane) * triangleStride;
+                for (int corner = 0; corner < 3; corner++)
+                    for (int axis = 0; axis < 3; axis++)
+                        p[corner][axis][lane] = v[corner * floatsPerVertex + axis];
+            }
+            __m128 corner[3][3];
+            for (int c = 0; c < 3; c++)
+                for (int axis = 0; axis < 3; axis++)
+                    corner[c][axis] = _mm_load_ps(p[c][axis]);
+
+            // Edge vectors leaving each corner and their reciprocal lengths
+            __m128 edge[3][3], inverseLength[3];
+            for (int c = 0; c < 3; c++)
+            {
+                int next = (c + 1) % 3;
+                for (int axis = 0; axis < 3; axis++)
+                    edge[c][axis] = _mm_sub_ps(corner[next][axis], corner[c][axis]);
+                __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge[c][0], edge[c][0]), _mm_mul_ps(edge[c][1], edge[c][1])), _mm_mul_ps(edge[c][2], edge[c][2]));
+                __m128 valid = _mm_cmpgt_ps(lengthSq, _mm_set1_ps(DEGENERATE_EPSILON));
+                inverseLength[c] = _mm_and_ps(valid, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(lengthSq, _mm_set1_ps(DEGENERATE_EPSILON)))));
+            }
+
+            // Normal = edge0 x -edge2 (both leave corner 0)
+            __m128 nx = _mm_sub_ps(_mm_mul_ps(edge[2][1], edge[0][2]), _mm_mul_ps(edge[2][2], edge[0][1]));
+            __m128 ny = _mm_sub_ps(_mm_mul_ps(edge[2][2], edge[0][0]), _mm_mul_ps(edge[2][0], edge[0][2]));
+            __m128 nz = _mm_sub_ps(_mm_mul_ps(edge[2][0], edge[0][1]), _mm_mul_ps(edge[2][1], edge[0][0]));
+            __m128 areaSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+            __m128 valid = _mm_cmpgt_ps(areaSq, _mm_set1_ps(DEGENERATE_EPSILON));
+            __m128 inverseArea = _mm_and_ps(valid, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(areaSq, _mm_set1_ps(DEGENERATE_EPSILON)))));
+            nx = _mm_mul_ps(nx, inverseArea);
+            ny = _mm_mul_ps(ny, inverseArea);
+            nz = _mm_mul_ps(nz, inverseArea);
+
+            // Corner c sits between edge c (outgoing) and edge c-1 (incoming, reversed)
+            __m128 cosine[3];
+            for (int c = 0; c < 3; c++)
+            {
+                int previous = (c + 2) % 3;
+                __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge[c][0], edge[previous][0]), _mm_mul_ps(edge[c][1], edge[previous][1])), _mm_mul_ps(edge[c][2], edge[previous][2]));
+                cosine[c] = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(dot, _mm_mul_ps(inverseLength[c], inverseLength[previous])));
+            }
+
+            alignas(16) float out[6][4];
+            _mm_store_ps(out[0], nx);
+            _mm_store_ps(out[1], ny);
+            _mm_store_ps(out[2], nz);
+            for (int c = 0; c < 3; c++)
+                _mm_store_ps(out[3 + c], cosine[c]);
+            for (int lane = 0; lane < 4; lane++)
+                for (int i = 0; i < 3; i++)
+                {
+                    normals[(size_t)(t + lane) * 3 + i] = out[i][lane];
+                    cosines[(size_t)(t + lane) * 3 + i] = out[3 + i][lane];
+                }
+        }
+#endif
+
+        // Remaining triangles (or all of them without SSE)
+        for (; t < nTriangles; t++)
+        {
+            const GLfloat* v = vertices + t * triangleStride;
+            float edge[3][3], inverseLength[3];
+            for (int c = 0; c < 3; c++)
+            {
+                const GLfloat* from = v + c * floatsPerVertex;
+                const GLfloat* to = v + ((c + 1) % 3) * floatsPerVertex;
+                for (int axis = 0; axis < 3; axis++)
+                    edge[c][axis] = to[axis] - from[axis];
+                float lengthSq = edge[c][0] * edge[c][0] + edge[c][1] * edge[c][1] + edge[c][2] * edge[c][2];
+                inverseLength[c] = lengthSq > DEGENERATE_EPSILON ? 1.0f / std::sqrt(lengthSq) : 0.0f;
+            }
+            float n[3] = { edge[2][1] * edge[0][2] - edge[2][2] * edge[0][1],
+                           edge[2][2] * edge[0][0] - edge[2][0] * edge[0][2],
+                           edge[2][0] * edge[0][1] - edge[2][1] * edge[0][0] };
+            float areaSq = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+            float inverseArea = areaSq > DEGENERATE_EPSILON ? 1.0f / std::sqrt(areaSq) : 0.0f;
+            for (int c = 0; c < 3; c++)
+            {
+                int previous = (c + 2) % 3;
+                float dot = edge[c][0] * edge[previous][0] + edge[c][1] * edge[previous][1] + edge[c][2] * edge[previous][2];
+                normals[(size_t)t * 3 + c] = n[c] * inverseArea;
+                cosines[(size_t)t * 3 + c] = -dot * inverseLength[c] * inverseLength[previous];
+            }
+        }
+    }
+
+    // Marks the triangles whose winding faces away from their outward side (see MeshTools::countInverted)
+    GLuint findInverted(std::span<const GLfloat> vertices, GLuint floatsPerVertex, std::vector<char>& inverted)
+    {
+        const GLuint nTriangles = (GLuint)(vertices.size() / floatsPerVertex) / 3;
+        std::vector<float> normals, cosines;
+        faceNormals(vertices.data(), floatsPerVertex, nTriangles, normals, cosines);
+
+        // Mesh center, the fallback reference for triangles without a usable normal
+        double center[3] = {};
+        for (GLuint v = 0; v < nTriangles * 3; v++)
+            for (int axis = 0; axis < 3; axis++)
+                center[axis] += vertices[(size_t)v * floatsPerVertex + axis];
+        for (int axis = 0; axis < 3; axis++)
+            center[axis] /= std::max<GLuint>(1, nTriangles * 3);
+
+        inverted.assign(nTriangles, 0);
+        GLuint count = 0;
+        for (GLuint t = 0; t < nTriangles; t++)
+        {
+            const float* face = &normals[(size_t)t * 3];
+            const GLfloat* corner = vertices.data() + (size_t)t * 3 * floatsPerVertex;
+            float side = 0.0f;
+            if (floatsPerVertex >= 6)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    const GLfloat* stored = corner + c * floatsPerVertex + 3;
+                    float length = std::sqrt(stored[0] * stored[0] + stored[1] * stored[1] + stored[2] * stored[2]);
+                    if (length > 0.0f)
+                        side += (stored[0] * face[0] + stored[1] * face[1] + stored[2] * face[2]) / length;
+                }
+            }
+            if (std::fabs(side) < 0.3f)
+            {
+                side = 0.0f;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    float middle = (corner[axis] + corner[floatsPerVertex + axis] + corner[2 * floatsPerVertex + axis]) / 3.0f;
+                    side += (middle - (float)center[axis]) * face[axis];
+                }
+            }
+            if (side < 0.0f)
+            {
+                inverted[t] = 1;
+                count++;
+            }
+        }
+        return count;
+    }
+}
+
+bool MeshTools::validate(std::span<const GLfloat> vertices, GLuint floatsPerVertex, MeshReport& report) {
+    report = MeshReport();
+
+    // Position must be the first three floats of every vertex and the stride must divide the data exactly
+    if (floatsPerVertex < 3 || vertices.empty() || vertices.size() % floatsPerVertex != 0)
+        return false;
+
+    report.nVertices = vertices.size() / floatsPerVertex;
+    report.nTriangles = report.nVertices / 3;
+    report.leftoverVertices = report.nVertices % 3;
+
+    // Look for triangles that cover no area
+    for (GLuint t = 0; t < report.nTriangles; t++)
+    {
+        const GLfloat* v = vertices.data() + (size_t)t * 3 * floatsPerVertex;
+        if (isDegenerate(v, v + floatsPerVertex, v + 2 * floatsPerVertex))
+            report.degenerateTriangles++;
+    }
+    return true;
+}
+
+GLuint MeshTools::removeDegenerate(std::vector<GLfloat>& vertices, GLuint floatsPerVertex) {
+    if (floatsPerVertex < 3)
+        return 0;
+    const size_t triangleStride = (size_t)floatsPerVertex * 3;
+    const GLuint nTriangles = (GLuint)(vertices.size() / triangleStride);
+
+    // Slide every real triangle down over the degenerate ones before it
+    size_t kept = 0;
+    for (GLuint t = 0; t < nTriangles; t++)
+    {
+        const GLfloat* v = vertices.data() + t * triangleStride;
+        if (isDegenerate(v, v + floatsPerVertex, v + 2 * floatsPerVertex))
+            continue;
+        if (kept != t)
+            std::copy(v, v + triangleStride, vertices.begin() + kept * triangleStride);
+        kept++;
+    }
+    vertices.resize(kept * triangleStride);
+    return nTriangles - (GLuint)kept;
+}
+
+void MeshTools::generateNormals(std::span<GLfloat> vertices, GLuint floatsPerVertex, float creaseAngle) {
+    if (floatsPerVertex < 6)
+        return;
+    const GLuint nVertices = (GLuint)(vertices.size() / floatsPerVertex) / 3 * 3;
+    std::vector<float> normals, cosines;
+    faceNormals(vertices.data(), floatsPerVertex, nVertices / 3, normals, cosines);
+
+    // Faces keep the side their stored normals point to; the winding only decides when those give no side
+    for (GLuint t = 0; t < nVertices / 3; t++)
+    {
+        float* face = &normals[(size_t)t * 3];
+        float side = 0.0f;
+        for (GLuint v = t * 3; v < t * 3 + 3; v++)
+        {
+            const GLfloat* stored = vertices.data() + (size_t)v * floatsPerVertex + 3;
+            side += stored[0] * face[0] + stored[1] * face[1] + stored[2] * face[2];
+        }
+        if (side < -1e-3f)
+            for (int axis = 0; axis < 3; axis++)
+                face[axis] = -face[axis];
+    }
+
+    // Sort the corners by position so corners that share a position sit next to each other
+    std::vector<GLuint> order(nVertices);
+    std::iota(order.begin(), order.end(), 0u);
+    auto position = [&](GLuint v) { return vertices.data() + (size_t)v * floatsPerVertex; };
+    std::sort(order.begin(), order.end(), [&](GLuint a, GLuint b) {
+        return std::lexicographical_compare(position(a), position(a) + 3, position(b), position(b) + 3);
+    });
+
+    const float creaseCosine = std::cos(creaseAngle * 3.14159265f / 180.0f) - 1e-5f;
+    std::vector<float> smooth((size_t)nVertices * 3, 0.0f);
+    for (size_t first = 0; first < order.size();)
+    {
+        size_t last = first + 1;
+        while (last < order.size() && std::equal(position(order[first]), position(order[first]) + 3, position(order[last])))
+            last++;
+
+        // Each corner takes the angle weighted faces around the position that are within the crease angle of its own face
+        for (size_t i = first; i < last; i++)
+        {
+            const float* own = &normals[(size_t)(order[i] / 3) * 3];
+            float* sum = &smooth[(size_t)order[i] * 3];
+            for (size_t j = first; j < last; j++)
+            {
+                const float* other = &normals[(size_t)(order[j] / 3) * 3];
+                if (own[0] * other[0] + own[1] * other[1] + own[2] * other[2] < creaseCosine)
+                    continue;
+                float weight = std::acos(std::clamp(cosines[order[j]], -1.0f, 1.0f));
+                for (int axis = 0; axis < 3; axis++)
+                    sum[axis] += other[axis] * weight;
+            }
+        }
+        first = last;
+    }
+
+    // Write unit normals back; corners of degenerate triangles keep whatever they had
+    for (GLuint v = 0; v < nVertices; v++)
+    {
+        const float* n = &smooth[(size_t)v * 3];
+        float lengthSq = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+        if (lengthSq <= DEGENERATE_EPSILON)
+            continue;
+        float inverseLength = 1.0f / std::sqrt(lengthSq);
+        GLfloat* out = vertices.data() + (size_t)v * floatsPerVertex + 3;
+        for (int axis = 0; axis < 3; axis++)
+            out[axis] = n[axis] * inverseLength;
+    }
+}
+
+GLuint MeshTools::checkNormals(std::span<const GLfloat> vertices, GLuint floatsPerVertex, float tolerance) {
+    if (floatsPerVertex < 6)
+        return 0;
+    const GLuint nVertices = (GLuint)(vertices.size() / floatsPerVertex) / 3 * 3;
+    std::vector<float> normals, cosines;
+    faceNormals(vertices.data(), floatsPerVertex, nVertices / 3, normals, cosines);
+
+    const float toleranceCosine = std::cos(tolerance * 3.14159265f / 180.0f);
+    GLuint deviating = 0;
+    for (GLuint v = 0; v < nVertices; v++)
+    {
+        const float* face = &normals[(size_t)(v / 3) * 3];
+        if (face[0] == 0.0f && face[1] == 0.0f && face[2] == 0.0f)
+            continue;   // Degenerate triangles have no facing to compare against (validate reports them)
+        const GLfloat* stored = vertices.data() + (size_t)v * floatsPerVertex + 3;
+        float length = std::sqrt(stored[0] * stored[0] + stored[1] * stored[1] + stored[2] * stored[2]);
+        if (length <= 0.0f || stored[0] * face[0] + stored[1] * face[1] + stored[2] * face[2] < toleranceCosine * length)
+            deviating++;
+    }
+    return deviating;
+}
+
+GLuint MeshTools::countInverted(std::span<const GLfloat> vertices, GLuint floatsPerVertex) {
+    if (floatsPerVertex < 3)
+        return 0;
+    std::vector<char> inverted;
+    return findInverted(vertices, floatsPerVertex, inverted);
+}
+
+GLuint MeshTools::fixWinding(std::span<GLfloat> vertices, GLuint floatsPerVertex) {
+    if (floatsPerVertex < 3)
+        return 0;
+    std::vector<char> inverted;
+    GLuint count = findInverted(vertices, floatsPerVertex, inverted);
+
+    // Swapping the last two corners (with all their attributes) reverses the winding and keeps the surface
+    for (size_t t = 0; t < inverted.size(); t++)
+    {
+        if (!inverted[t])
+            continue;
+        GLfloat* second = vertices.data() + (t * 3 + 1) * floatsPerVertex;
+        std::swap_ranges(second, second + floatsPerVertex, second + floatsPerVertex);
+    }
+    return count;
+}
+
+void MeshTools::facePlanes(std::span<const GLfloat> vertices, GLuint floatsPerVertex, std::vector<GLfloat>& planes) {
+    if (floatsPerVertex < 3)
+        return;
+    const GLuint nTriangles = (GLuint)(vertices.size() / floatsPerVertex) / 3;
+    std::vector<float> normals, cosines;
+    faceNormals(vertices.data(), floatsPerVertex, nTriangles, normals, cosines);
+
+    planes.reserve(planes.size() + (size_t)nTriangles * 4);
+    for (GLuint t = 0; t < nTriangles; t++)
+    {
+        const float* n = &normals[(size_t)t * 3];
+        const GLfloat* p = vertices.data() + (size_t)t * 3 * floatsPerVertex;
+        planes.insert(planes.end(), { n[0], n[1], n[2], -(n[0] * p[0] + n[1] * p[1] + n[2] * p[2]) });
+    }
+}
+
+UVStretch MeshTools::uvStretch(std::span<const GLfloat> vertices, GLuint floatsPerVertex) {
+    UVStretch stretch;
+    if (floatsPerVertex < 8)
+        return stretch;
+    const GLuint nTriangles = (GLuint)(vertices.size() / floatsPerVertex) / 3;
+    for (GLuint t = 0; t < nTriangles; t++)
+    {
+        const GLfloat* a = vertices.data() + (size_t)t * 3 * floatsPerVertex;
+        const GLfloat* b = a + floatsPerVertex;
+        const GLfloat* c = b + floatsPerVertex;
+        glm::vec3 e1(b[0] - a[0], b[1] - a[1], b[2] - a[2]), e2(c[0] - a[0], c[1] - a[1], c[2] - a[2]);
+        float du1 = b[6] - a[6], dv1 = b[7] - a[7], du2 = c[6] - a[6], dv2 = c[7] - a[7];
+        float det = du1 * dv2 - du2 * dv1;
+        float area = 0.5f * glm::length(glm::cross(e1, e2));
+        if (std::fabs(det) < 1e-12f || area == 0.0f)
+            continue;   // Degenerate, or the texture is not stretched over this triangle
+
+        // Solve e1 = dPdu * du1 + dPdv * dv1 and e2 = dPdu * du2 + dPdv * dv2
+        glm::vec3 dPdu = (e1 * dv2 - e2 * dv1) / det;
+        glm::vec3 dPdv = (e2 * du1 - e1 * du2) / det;
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+            {
+                stretch.u[j][i] += area * dPdu[i] * dPdu[j];
+                stretch.v[j][i] += area * dPdv[i] * dPdv[j];
+            }
+        stretch.area += area;
+    }
+    return stretch;
+}
+
+glm::vec4 MeshTools::boundingSphere(std::span<const GLfloat> vertices, GLuint floatsPerVertex) {
+    const GLuint nVertices = (GLuint)(vertices.size() / floatsPerVertex);
+    if (nVertices == 0)
+        return glm::vec4(0.0f);
+    glm::vec3 low(vertices[0], vertices[1], vertices[2]), high = low;
+    for (GLuint i = 1; i < nVertices; i++)
+    {
+        const GLfloat* p = vertices.data() + (size_t)i * floatsPerVertex;
+        low = glm::min(low, glm::vec3(p[0], p[1], p[2]));
+        high = glm::max(high, glm::vec3(p[0], p[1], p[2]));
+    }
+    glm::vec3 center = (low + high) * 0.5f;
+    float radius = 0.0f;
+    for (GLuint i = 0; i < nVertices; i++)
+    {
+        const GLfloat* p = vertices.data() + (size_t)i * floatsPerVertex;
+        radius = std::max(radius, glm::distance(center, glm::vec3(p[0], p[1], p[2])));
+    }
+    return glm::vec4(center, radius);
+}
@@ -0,0 +1,61 @@
+#pragma once
+# include <span>
+# include <vector>
+# include <GL/glew.h> 
+# include <glm/glm.hpp>
+
+// Summary of the geometry found in a vertex array
+struct MeshReport
+{
+	GLuint nVertices = 0;			// Number of complete vertices in the data
+	GLuint nTriangles = 0;			// Number of complete triangles (what actually gets drawn)
+	GLuint degenerateTriangles = 0;	// Triangles with zero area (rasterized for nothing)
+	GLuint leftoverVertices = 0;	// Trailing vertices that do not form a full triangle
+};
+
+/* How far one unit of texture coordinate reaches across a surface, summed over its triangles. Kept as second
+moments so an object's transform A can be applied later: the RMS length of a unit step in u is
+sqrt(trace(A * u * transpose(A)) / area)*/
+struct UVStretch
+{
+	glm::mat3 u = glm::mat3(0.0f);	// Sum over triangles of area * outer(dPosition/du, dPosition/du)
+	glm::mat3 v = glm::mat3(0.0f);	// Same for v
+	GLfloat area = 0.0f;			// Area of the triangles that have a usable UV mapping
+};
+
+// Class to validate and inspect interleaved vertex data before it is sent to the GPU
+class MeshTools
+{
+public:
+	// Checks that the stride divides the data and counts real and wasted triangles. Returns false if the data is unusable
+	static bool validate(std::span<const GLfloat> vertices, GLuint floatsPerVertex, MeshReport& report);
+
+	/* Removes the triangles validate counts as degenerate, and any leftover vertices, keeping the order of the
+	rest. Returns the number of triangles removed*/
+	static GLuint removeDegenerate(std::vector<GLfloat>& vertices, GLuint floatsPerVertex);
+
+	/* Recomputes the normal (floats 3-5) of every vertex. Corners at the same position are averaged,
+	weighted by corner angle, when their faces meet at less than creaseAngle degrees; 0 gives flat shading.
+	Each face stays on the side its old normals point to, so data with mixed winding keeps its lighting*/
+	static void generateNormals(std::span<GLfloat> vertices, GLuint floatsPerVertex, float creaseAngle);
+
+	/* Counts vertices whose stored normal is missing or tilted more than tolerance degrees away from the front
+	face normal of its triangle as wound, so normals pointing out of the back count too. Run after fixWinding*/
+	static GLuint checkNormals(std::span<const GLfloat> vertices, GLuint floatsPerVertex, float tolerance);
+
+	/* Counts triangles that wind clockwise seen from outside. Outside is where the stored normals point,
+	or away from the mesh center for triangles whose normals give no side (or when there are no normals)*/
+	static GLuint countInverted(std::span<const GLfloat> vertices, GLuint floatsPerVertex);
+
+	// Swaps two corners of every inverted triangle so front faces are counter-clockwise. Returns the number fixed
+	static GLuint fixWinding(std::span<GLfloat> vertices, GLuint floatsPerVertex);
+
+	// Appends the plane (normal x, y, z, distance) of every triangle as wound, for facing tests on the CPU
+	static void facePlanes(std::span<const GLfloat> vertices, GLuint floatsPerVertex, std::vector<GLfloat>& planes);
+
+	// Measures the UV stretch of vertices with texture coordinates in floats 6-7 (all zero without them)
+	static UVStretch uvStretch(std::span<const GLfloat> vertices, GLuint floatsPerVertex);
+
+	// Sphere around every position, centered on their bounding box: center in xyz, radius in w
+	static glm::vec4 boundingSphere(std::span<const GLfloat> vertices, GLuint floatsPerVertex);
+};
@@ -0,0 +1,794 @@
+#include "PathTracer.h"
+#include "SoftwareRenderer.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PATH_TRACER_AVX2 1
+#include <immintrin.h>
+#endif
+
+// The packet kernels are compiled for AVX2 on their own and only run after the CPU has been checked
+#if defined(PATH_TRACER_AVX2) && defined(__GNUC__)
+#define AVX2_FUNCTION __attribute__((target("avx2,fma")))
+#else
+#define AVX2_FUNCTION
+#endif
+
+namespace
+{
+    const int TILE_SIZE = 16;
+    const int FLOATS_PER_VERTEX = 8;
+    const int BINS = 16;                    // Centroid bins per axis when looking for a split
+    const int MAX_LEAF = 8;                 // Triangles a leaf may hold
+    const int SAH_DEPTH = 48;               // Deeper nodes split at the median, so the tree stays under STACK_SIZE levels
+    const int STACK_SIZE = 96;
+    const float SPECULAR_INTENSITY = 0.2f;  // As in fragmentShaderSource
+    const float RAY_OFFSET = 1e-4f;         // Secondary rays start this far off the surface, relative to its distance from the origin
+
+    std::atomic<bool> gUsePackets{ true };
+
+    // 32 bytes. An interior node's first child follows it, offset is the second; a leaf's triangles are [offset, offset + count)
+    struct Node
+    {
+        float lower[3];
+        uint32_t offset;
+        float upper[3];
+        uint16_t count;     // 0 for an interior node
+        uint16_t axis;      // Of the split, to visit the nearer child first
+    };
+
+    // What ray tests need, in world space
+    struct Triangle
+    {
+        glm::vec3 v0, e1, e2;   // e1 = v1 - v0, e2 = v2 - v0
+    };
+
+    // What shading needs, fetched only for hits
+    struct Surface
+    {
+        glm::vec3 normal[3];
+        glm::vec2 uv[3];        // Times uvScale
+        int texture;
+    };
+
+    struct Hierarchy
+    {
+        std::vector<Node> nodes;
+        std::vector<Triangle> triangles;
+        std::vector<Surface> surfaces;
+        int depth = 0;
+    };
+
+    // Eight rays, one per lane. t is the farthest distance tested on the way in and the nearest hit on the way out
+    struct alignas(32) Packet
+    {
+        float ox[8], oy[8], oz[8];
+        float dx[8], dy[8], dz[8];
+        float t[8], u[8], v[8];
+        int32_t triangle[8];
+    };
+
+    struct Bounds
+    {
+        glm::vec3 lower = glm::vec3(FLT_MAX);
+        glm::vec3 upper = glm::vec3(-FLT_MAX);
+
+        void grow(const glm::vec3& point)
+        {
+            lower = glm::min(lower, point);
+            upper = glm::max(upper, point);
+        }
+
+        void grow(const Bounds& bounds)
+        {
+            lower = glm::min(lower, bounds.lower);
+            upper = glm::max(upper, bounds.upper);
+        }
+
+        float area() const
+        {
+            glm::vec3 size = glm::max(upper - lower, glm::vec3(0.0f));
+            return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+        }
+    };
+
+    // PCG hash as a random number generator: a path's numbers depend only on its pixel and sample, not on the thread
+    struct Random
+    {
+        uint32_t state;
+
+        explicit Random(uint32_t pixel = 0, uint32_t sample = 0)
+        {
+            state = pixel * 0x9E3779B9u ^ sample * 0x85EBCA6Bu;
+            state ^= state >> 16;
+            state *= 0x7FEB352Du;
+            state ^= state >> 15;
+            state *= 0x846CA68Bu;
+            state ^= state >> 16;
+        }
+
+        float next()    // [0, 1)
+        {
+            state = state * 747796405u + 2891336453u;
+            uint32_t word = ((state >> ((state >> 28) + 4)) ^ state) * 277803737u;
+            word = (word >> 22) ^ word;
+            return (word >> 8) * (1.0f / 16777216.0f);
+        }
+    };
+
+    // Splits [begin, end) of order and appends the nodes depth first
+    void buildNode(Hierarchy& bvh, const std::vector<Bounds>& primitives, const std::vector<glm::vec3>& centers,
+        std::vector<uint32_t>& order, uint32_t begin, uint32_t end, int depth)
+    {
+        uint32_t index = (uint32_t)bvh.nodes.size();
+        bvh.nodes.emplace_back();
+        Bounds bounds, centerBounds;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            bounds.grow(primitives[order[i]]);
+            centerBounds.grow(centers[order[i]]);
+        }
+        for (int c = 0; c < 3; c++)
+        {
+            bvh.nodes[index].lower[c] = bounds.lower[c];
+            bvh.nodes[index].upper[c] = bounds.upper[c];
+        }
+
+        // Surface area heuristic: cost of a split = 1 traversal + triangles tested on each side, weighted by the chance of entering it
+        uint32_t count = end - begin;
+        int axis = -1, split = 0;
+        float best = FLT_MAX;
+        for (int a = 0; a < 3 && count > 1 && depth < SAH_DEPTH; a++)
+        {
+            float extent = centerBounds.upper[a] - centerBounds.lower[a];
+            if (!(extent > 0.0f))
+                continue;
+            float scale = BINS / extent;
+            Bounds binBounds[BINS];
+            uint32_t binCount[BINS] = {};
+            for (uint32_t i = begin; i < end; i++)
+            {
+                int bin = std::min(BINS - 1, (int)((centers[order[i]][a] - centerBounds.lower[a]) * scale));
+                binBounds[bin].grow(primitives[order[i]]);
+                binCount[bin]++;
+            }
+            float rightCost[BINS];
+            Bounds right;
+            uint32_t rightCount = 0;
+            for (int bin = BINS - 1; bin > 0; bin--)
+            {
+                right.grow(binBounds[bin]);
+                rightCount += binCount[bin];
+                rightCost[bin] = right.area() * rightCount;
+            }
+            Bounds left;
+            uint32_t leftCount = 0;
+            for (int bin = 0; bin < BINS - 1; bin++)
+            {
+                left.grow(binBounds[bin]);
+                leftCount += binCount[bin];
+                float cost = left.area() * leftCount + rightCost[bin + 1];
+                if (leftCount > 0 && leftCount < count && cost < best)
+                {
+                    best = cost;
+                    axis = a;
+                    split = bin;
+                }
+            }
+        }
+        float area = bounds.area();
+        bool leaf = count <= (uint32_t)MAX_LEAF && (axis < 0 || area <= 0.0f || 1.0f + best / area >= (float)count);
+        if (leaf)
+        {
+            bvh.nodes[index].offset = begin;
+            bvh.nodes[index].count = (uint16_t)count;
+            bvh.depth = std::max(bvh.depth, depth);
+            return;
+        }
+
+        uint32_t middle;
+        if (axis >= 0)
+        {
+            float scale = BINS / (centerBounds.upper[axis] - centerBounds.lower[axis]);
+            float lower = centerBounds.lower[axis];
+            middle = (uint32_t)(std::partition(order.begin() + begin, order.begin() + end, [&](uint32_t p) {
+                return std::min(BINS - 1, (int)((centers[p][axis] - lower) * scale)) <= split;
+            }) - order.begin());
+        }
+        else
+        {
+            // Too deep or every centroid in one place: halve along the widest axis
+            glm::vec3 size = centerBounds.upper - centerBounds.lower;
+            axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+            middle = begin + count / 2;
+            std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+                [&](uint32_t a, uint32_t b) { return centers[a][axis] < centers[b][axis]; });
+        }
+        buildNode(bvh, primitives, centers, order, begin, middle, depth + 1);
+        bvh.nodes[index].offset = (uint32_t)bvh.nodes.size();
+        bvh.nodes[index].count = 0;
+        bvh.nodes[index].axis = (uint16_t)axis;
+        buildNode(bvh, primitives, centers, order, middle, end, depth + 1);
+    }
+
+    // Slab test against [0, t]
+    bool hitBox(const Node& node, const glm::vec3& origin, const glm::vec3& inverse, float t)
+    {
+        float near = 0.0f, far = t;
+        for (int c = 0; c < 3; c++)
+        {
+            float t0 = (node.lower[c] - origin[c]) * inverse[c];
+            float t1 = (node.upper[c] - origin[c]) * inverse[c];
+            near = std::max(near, std::min(t0, t1));
+            far = std::min(far, std::max(t0, t1));
+        }
+        return near <= far;
+    }
+
+    // Moller-Trumbore, both sides. Replaces t, u, v with a hit nearer than t
+    bool hitTriangle(const Triangle& triangle, const glm::vec3& origin, const glm::vec3& direction, float& t, float& u, float& v)
+    {
+        glm::vec3 p = glm::cross(direction, triangle.e2);
+        float det = glm::dot(triangle.e1, p);
+        if (std::fabs(det) < 1e-12f)
+            return false;
+        float inverse = 1.0f / det;
+        glm::vec3 s = origin - triangle.v0;
+        float hitU = glm::dot(s, p) * inverse;
+        if (hitU < 0.0f || hitU > 1.0f)
+            return false;
+        glm::vec3 q = glm::cross(s, triangle.e1);
+        float hitV = glm::dot(direction, q) * inverse;
+        if (hitV < 0.0f || hitU + hitV > 1.0f)
+            return false;
+        float hitT = glm::dot(triangle.e2, q) * inverse;
+        if (!(hitT > 0.0f && hitT < t))
+            return false;
+        t = hitT;
+        u = hitU;
+        v = hitV;
+        return true;
+    }
+
+    // One lane of the packet on its own. With any, stops at the first hit (shadow rays)
+    bool traceScalar(const Hierarchy& bvh, Packet& packet, int lane, bool any)
+    {
+        glm::vec3 origin(packet.ox[lane], packet.oy[lane], packet.oz[lane]);
+        glm::vec3 direction(packet.dx[lane], packet.dy[lane], packet.dz[lane]);
+        glm::vec3 inverse = 1.0f / direction;
+        bool found = false;
+        uint32_t stack[STACK_SIZE];
+        int top = 0;
+        uint32_t index = 0;
+        for (;;)
+        {
+            const Node& node = bvh.nodes[index];
+            if (hitBox(node, origin, inverse, packet.t[lane]))
+            {
+                if (node.count == 0)
+                {
+                    bool backwards = direction[node.axis] < 0.0f;
+                    stack[top++] = backwards ? index + 1 : node.offset;
+                    index = backwards ? node.offset : index + 1;
+                    continue;
+                }
+                for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+                {
+                    if (hitTriangle(bvh.triangles[i], origin, direction, packet.t[lane], packet.u[lane], packet.v[lane]))
+                    {
+                        packet.triangle[lane] = (int32_t)i;
+                        found = true;
+                        if (any)
+                            return true;
+                    }
+                }
+            }
+            if (top == 0)
+                return found;
+            index = stack[--top];
+        }
+    }
+
+#ifdef PATH_TRACER_AVX2
+    /* The lanes of the packet in lanes (a bit each) together: a node is entered when any of them hits its box, children
+    in the order of the first lane's direction, and each triangle is tested against all eight. Returns the lanes that hit*/
+    AVX2_FUNCTION uint32_t tracePacket(const Hierarchy& bvh, Packet& packet, uint32_t lanes, bool any)
+    {
+        const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+        const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        __m256 active = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int)lanes), bits), bits));
+        __m256 ox = _mm256_load_ps(packet.ox), oy = _mm256_load_ps(packet.oy), oz = _mm256_load_ps(packet.oz);
+        __m256 dx = _mm256_load_ps(packet.dx), dy = _mm256_load_ps(packet.dy), dz = _mm256_load_ps(packet.dz);
+        __m256 ix = _mm256_div_ps(one, dx), iy = _mm256_div_ps(one, dy), iz = _mm256_div_ps(one, dz);
+        __m256 oix = _mm256_mul_ps(ox, ix), oiy = _mm256_mul_ps(oy, iy), oiz = _mm256_mul_ps(oz, iz);
+        __m256 t = _mm256_load_ps(packet.t), u = _mm256_load_ps(packet.u), v = _mm256_load_ps(packet.v);
+        __m256i triangle = _mm256_load_si256((const __m256i*)packet.triangle);
+        __m256 hits = zero;
+
+        int first = std::countr_zero(lanes);
+        bool backwards[3] = { packet.dx[first] < 0.0f, packet.dy[first] < 0.0f, packet.dz[first] < 0.0f };
+        uint32_t stack[STACK_SIZE];
+        int top = 0;
+        uint32_t index = 0;
+        for (;;)
+        {
+            const Node& node = bvh.nodes[index];
+            __m256 x0 = _mm256_fmsub_ps(_mm256_set1_ps(node.lower[0]), ix, oix), x1 = _mm256_fmsub_ps(_mm256_set1_ps(node.upper[0]), ix, oix);
+            __m256 y0 = _mm256_fmsub_ps(_mm256_set1_ps(node.lower[1]), iy, oiy), y1 = _mm256_fmsub_ps(_mm256_set1_ps(node.upper[1]), iy, oiy);
+            __m256 z0 = _mm256_fmsub_ps(_mm256_set1_ps(node.lower[2]), iz, oiz), z1 = _mm256_fmsub_ps(_mm256_set1_ps(node.upper[2]), iz, oiz);
+            __m256 near = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(x0, x1), _mm256_min_ps(y0, y1)), _mm256_max_ps(_mm256_min_ps(z0, z1), zero));
+            __m256 far = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(x0, x1), _mm256_max_ps(y0, y1)), _mm256_min_ps(_mm256_max_ps(z0, z1), t));
+            __m256 entered = _mm256_and_ps(_mm256_cmp_ps(near, far, _CMP_LE_OQ), active);
+            if (_mm256_movemask_ps(entered) != 0)
+            {
+                if (node.count == 0)
+                {
+                    bool back = backwards[node.axis];
+                    stack[top++] = back ? index + 1 : node.offset;
+                    index = back ? node.offset : index + 1;
+                    continue;
+                }
+                for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+                {
+                    const Triangle& tri = bvh.triangles[i];
+                    __m256 e1x = _mm256_set1_ps(tri.e1.x), e1y = _mm256_set1_ps(tri.e1.y), e1z = _mm256_set1_ps(tri.e1.z);
+                    __m256 e2x = _mm256_set1_ps(tri.e2.x), e2y = _mm256_set1_ps(tri.e2.y), e2z = _mm256_set1_ps(tri.e2.z);
+                    __m256 px = _mm256_fmsub_ps(dy, e2z, _mm256_mul_ps(dz, e2y));
+                    __m256 py = _mm256_fmsub_ps(dz, e2x, _mm256_mul_ps(dx, e2z));
+                    __m256 pz = _mm256_fmsub_ps(dx, e2y, _mm256_mul_ps(dy, e2x));
+                    __m256 det = _mm256_fmadd_ps(e1x, px, _mm256_fmadd_ps(e1y, py, _mm256_mul_ps(e1z, pz)));
+                    __m256 inverse = _mm256_div_ps(one, det);
+                    __m256 sx = _mm256_sub_ps(ox, _mm256_set1_ps(tri.v0.x));
+                    __m256 sy = _mm256_sub_ps(oy, _mm256_set1_ps(tri.v0.y));
+                    __m256 sz = _mm256_sub_ps(oz, _mm256_set1_ps(tri.v0.z));
+                    __m256 hitU = _mm256_mul_ps(_mm256_fmadd_ps(sx, px, _mm256_fmadd_ps(sy, py, _mm256_mul_ps(sz, pz))), inverse);
+                    __m256 qx = _mm256_fmsub_ps(sy, e1z, _mm256_mul_ps(sz, e1y));
+                    __m256 qy = _mm256_fmsub_ps(sz, e1x, _mm256_mul_ps(sx, e1z));
+                    __m256 qz = _mm256_fmsub_ps(sx, e1y, _mm256_mul_ps(sy, e1x));
+                    __m256 hitV = _mm256_mul_ps(_mm256_fmadd_ps(dx, qx, _mm256_fmadd_ps(dy, qy, _mm256_mul_ps(dz, qz))), inverse);
+                    __m256 hitT = _mm256_mul_ps(_mm256_fmadd_ps(e2x, qx, _mm256_fmadd_ps(e2y, qy, _mm256_mul_ps(e2z, qz))), inverse);
+                    __m256 absDet = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), det);
+                    __m256 hit = _mm256_and_ps(entered, _mm256_cmp_ps(absDet, _mm256_set1_ps(1e-12f), _CMP_GE_OQ));
+                    hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(hitU, zero, _CMP_GE_OQ), _mm256_cmp_ps(hitV, zero, _CMP_GE_OQ)));
+                    hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_add_ps(hitU, hitV), one, _CMP_LE_OQ));
+                    hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(hitT, zero, _CMP_GT_OQ), _mm256_cmp_ps(hitT, t, _CMP_LT_OQ)));
+                    if (_mm256_movemask_ps(hit) == 0)
+                        continue;
+                    t = _mm256_blendv_ps(t, hitT, hit);
+                    u = _mm256_blendv_ps(u, hitU, hit);
+                    v = _mm256_blendv_ps(v, hitV, hit);
+                    triangle = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(triangle), _mm256_castsi256_ps(_mm256_set1_epi32((int)i)), hit));
+                    hits = _mm256_or_ps(hits, hit);
+                    if (any)
+                    {
+                        // Occluded lanes are done
+                        active = _mm256_andnot_ps(hit, active);
+                        entered = _mm256_andnot_ps(hit, entered);
+                    }
+                }
+                if (any && _mm256_movemask_ps(active) == 0)
+                    break;
+            }
+            if (top == 0)
+                break;
+            index = stack[--top];
+        }
+        _mm256_store_ps(packet.t, t);
+        _mm256_store_ps(packet.u, u);
+        _mm256_store_ps(packet.v, v);
+        _mm256_store_si256((__m256i*)packet.triangle, triangle);
+        return (uint32_t)_mm256_movemask_ps(hits);
+    }
+#endif
+
+    uint32_t trace(const Hierarchy& bvh, Packet& packet, uint32_t lanes, bool any, bool packets)
+    {
+        if (lanes == 0 || bvh.triangles.empty())
+            return 0;
+#ifdef PATH_TRACER_AVX2
+        if (packets)
+            return tracePacket(bvh, packet, lanes, any);
+#endif
+        uint32_t hits = 0;
+        for (int lane = 0; lane < 8; lane++)
+        {
+            if ((lanes >> lane & 1) && traceScalar(bvh, packet, lane, any))
+                hits |= 1u << lane;
+        }
+        return hits;
+    }
+
+    void setRay(Packet& packet, int lane, const glm::vec3& origin, glm::vec3 direction, float t)
+    {
+        // No zero components, so the slab tests never see 0 * infinity
+        for (int c = 0; c < 3; c++)
+        {
+            if (direction[c] == 0.0f)
+                direction[c] = 1e-20f;
+        }
+        packet.ox[lane] = origin.x;
+        packet.oy[lane] = origin.y;
+        packet.oz[lane] = origin.z;
+        packet.dx[lane] = direction.x;
+        packet.dy[lane] = direction.y;
+        packet.dz[lane] = direction.z;
+        packet.t[lane] = t;
+        packet.triangle[lane] = -1;
+    }
+
+    // Level 0 with GL_LINEAR and GL_REPEAT: the pixel filter of many samples does the minification. rgb in 0..1
+    glm::vec3 sampleTexture(const SoftwareTexture& texture, glm::vec2 uv)
+    {
+        int width = texture.levelWidth[0], height = texture.levelHeight[0];
+        float x = (uv.x - std::floor(uv.x)) * width - 0.5f;
+        float y = (uv.y - std::floor(uv.y)) * height - 0.5f;
+        if (!(x >= -0.5f && y >= -0.5f))
+            x = y = 0.0f;
+        float fx = std::floor(x), fy = std::floor(y);
+        float ax = x - fx, ay = y - fy;
+        int x0 = fx < 0.0f ? width - 1 : std::min((int)fx, width - 1), x1 = x0 + 1 >= width ? 0 : x0 + 1;
+        int y0 = fy < 0.0f ? height - 1 : std::min((int)fy, height - 1), y1 = y0 + 1 >= height ? 0 : y0 + 1;
+        const uint32_t* texels = texture.texels.data();
+        uint32_t t00 = texels[y0 * width + x0], t10 = texels[y0 * width + x1];
+        uint32_t t01 = texels[y1 * width + x0], t11 = texels[y1 * width + x1];
+        glm::vec3 rgb;
+        for (int c = 0; c < 3; c++)
+        {
+            int shift = 8 * c;
+            float top = ((t00 >> shift) & 0xFF) + (((t10 >> shift) & 0xFF) - (float)((t00 >> shift) & 0xFF)) * ax;
+            float bottom = ((t01 >> shift) & 0xFF) + (((t11 >> shift) & 0xFF) - (float)((t01 >> shift) & 0xFF)) * ax;
+            rgb[c] = (top + (bottom - top) * ay) / 255.0f;
+        }
+        return rgb;
+    }
+
+    // Cosine weighted direction about normal
+    glm::vec3 sampleHemisphere(const glm::vec3& normal, Random& random)
+    {
+        float sign = std::copysign(1.0f, normal.z);
+        float a = -1.0f / (sign + normal.z);
+        float b = normal.x * normal.y * a;
+        glm::vec3 tangent(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+        glm::vec3 bitangent(b, sign + normal.y * normal.y * a, -normal.y);
+        float radius = std::sqrt(random.next());
+        float angle = 6.28318531f * random.next();
+        float z = std::sqrt(std::max(0.0f, 1.0f - radius * radius));
+        return tangent * (radius * std::cos(angle)) + bitangent * (radius * std::sin(angle)) + normal * z;
+    }
+
+    // Uniform point in a ball
+    glm::vec3 sampleBall(float radius, Random& random)
+    {
+        float z = 2.0f * random.next() - 1.0f;
+        float angle = 6.28318531f * random.next();
+        float ring = std::sqrt(std::max(0.0f, 1.0f - z * z));
+        return glm::vec3(ring * std::cos(angle), ring * std::sin(angle), z) * (radius * std::cbrt(random.next()));
+    }
+
+    // Where a ray hit and how it looks there
+    struct Shading
+    {
+        glm::vec3 position;
+        glm::vec3 geometric;    // Face normal on the ray's side
+        glm::vec3 normal;       // Interpolated normal on the ray's side
+        glm::vec3 view;         // Back along the ray
+        glm::vec3 albedo;
+        float offset;
+    };
+
+    Shading shade(const Hierarchy& bvh, const SoftwareScene& scene, const Packet& packet, int lane)
+    {
+        Shading shading;
+        const Triangle& triangle = bvh.triangles[packet.triangle[lane]];
+        const Surface& surface = bvh.surfaces[packet.triangle[lane]];
+        glm::vec3 direction(packet.dx[lane], packet.dy[lane], packet.dz[lane]);
+        float u = packet.u[lane], v = packet.v[lane], w = 1.0f - u - v;
+        shading.position = glm::vec3(packet.ox[lane], packet.oy[lane], packet.oz[lane]) + direction * packet.t[lane];
+        shading.view = -glm::normalize(direction);
+        shading.geometric = glm::normalize(glm::cross(triangle.e1, triangle.e2));
+        if (glm::dot(shading.geometric, shading.view) < 0.0f)
+            shading.geometric = -shading.geometric;
+        glm::vec3 normal = surface.normal[0] * w + surface.normal[1] * u + surface.normal[2] * v;
+        float length = glm::length(normal);
+        shading.normal = length > 0.0f ? normal / length : shading.geometric;
+        if (glm::dot(shading.normal, shading.geometric) < 0.0f)
+            shading.normal = -shading.normal;
+        glm::vec2 uv = surface.uv[0] * w + surface.uv[1] * u + surface.uv[2] * v;
+        shading.albedo = surface.texture >= 0 ? sampleTexture(scene.textures[surface.texture], uv) : glm::vec3(1.0f);
+        glm::vec3 magnitude = glm::abs(shading.position);
+        shading.offset = RAY_OFFSET * (1.0f + std::max(magnitude.x, std::max(magnitude.y, magnitude.z)));
+        return shading;
+    }
+
+    /* Follows the paths of the lanes in lanes, whose camera rays are in packet, adding what reaches the camera to
+    radiance. Returns the rays traced*/
+    uint64_t tracePaths(const Hierarchy& bvh, const SoftwareScene& scene, int maxBounces, bool packets, Packet& packet,
+        uint32_t lanes, Random random[8], glm::vec3 radiance[8])
+    {
+        uint64_t rays = 0;
+        glm::vec3 throughput[8];
+        for (int lane = 0; lane < 8; lane++)
+            throughput[lane] = glm::vec3(1.0f);
+        uint32_t alive = lanes;
+        for (int bounce = 0; alive != 0; bounce++)
+        {
+            rays += std::popcount(alive);
+            alive &= trace(bvh, packet, alive, false, packets);
+            if (alive == 0)
+                break;      // Nothing to hit beyond the scene: black, like the cleared framebuffer
+            Shading shading[8];
+            for (int lane = 0; lane < 8; lane++)
+            {
+                if (alive >> lane & 1)
+                    shading[lane] = shade(bvh, scene, packet, lane);
+            }
+
+            // Direct light: a shadow ray to a random point of each lamp
+            for (const SoftwareLight& light : scene.lights)
+            {
+                Packet shadow = {};
+                glm::vec3 contribution[8];
+                uint32_t lit = 0;
+                for (int lane = 0; lane < 8; lane++)
+                {
+                    if (!(alive >> lane & 1))
+                        continue;
+                    const Shading& s = shading[lane];
+                    glm::vec3 toLight = light.position + sampleBall(light.radius, random[lane]) - s.position;
+                    float distance = glm::length(toLight);
+                    glm::vec3 direction = toLight / distance;
+                    float nDotL = glm::dot(s.normal, direction);
+                    if (!(nDotL > 0.0f) || glm::dot(s.geometric, direction) <= 0.0f)
+                        continue;
+                    float vDotR = glm::dot(s.view, 2.0f * nDotL * s.normal - direction);
+                    float specular = SPECULAR_INTENSITY * std::pow(std::max(vDotR, 0.0f), light.highlightSize);
+                    contribution[lane] = throughput[lane] * s.albedo * light.color * (nDotL + specular);
+                    setRay(shadow, lane, s.position + s.geometric * s.offset, direction, distance - 2.0f * s.offset);
+                    lit |= 1u << lane;
+                }
+                rays += std::popcount(lit);
+                lit &= ~trace(bvh, shadow, lit, true, packets);
+                for (int lane = 0; lane < 8; lane++)
+                {
+                    if (lit >> lane & 1)
+                        radiance[lane] += contribution[lane];
+                }
+            }
+            if (bounce == maxBounces)
+                break;
+
+            // Indirect light: continue each path in a cosine weighted direction, so the albedo is the whole weight
+            for (int lane = 0; lane < 8; lane++)
+            {
+                if (!(alive >> lane & 1))
+                    continue;
+                const Shading& s = shading[lane];
+                glm::vec3 direction = sampleHemisphere(s.normal, random[lane]);
+                throughput[lane] *= s.albedo;
+                float survive = std::min(0.95f, std::max(throughput[lane].x, std::max(throughput[lane].y, throughput[lane].z)));
+                if (glm::dot(direction, s.geometric) <= 0.0f || (bounce > 0 && random[lane].next() >= survive))
+                {
+                    alive &= ~(1u << lane);
+                    continue;
+                }
+                if (bounce > 0)
+                    throughput[lane] /= survive;    // Russian roulette keeps the estimate unbiased
+                setRay(packet, lane, s.position + s.geometric * s.offset, direction, FLT_MAX);
+            }
+        }
+        return rays;
+    }
+}
+
+struct PathTracer::Bvh : Hierarchy
+{
+};
+
+// One pass over the image: the camera and where each pixel's sums go
+struct PathTracer::Frame
+{
+    glm::mat4 inverseViewProjection;
+    int width, height, tilesX;
+    int firstSample, samples, maxBounces;
+    bool packets;
+    glm::vec3* radiance;            // Sum per pixel
+    float* brightness;              // Sums of the clamped luminance and its square per pixel, for the noise estimate
+    float* brightnessSquares;
+    std::atomic<uint64_t>* rays;
+};
+
+PathTracer::PathTracer(const SoftwareScene& scene, ThreadPool* pool)
+    : scene(scene), pool(pool), bvh(new Bvh) {
+    auto start = std::chrono::steady_clock::now();
+
+    // World space triangles of every object, as the vertex shader places them
+    std::vector<Triangle> triangles;
+    std::vector<Surface> surfaces;
+    for (const SoftwareObject& object : scene.objects)
+    {
+        const std::vector<float>& vertices = scene.meshes[object.mesh].vertices;
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(object.model)));
+        for (size_t first = 0; first + 3 * FLOATS_PER_VERTEX <= vertices.size(); first += 3 * FLOATS_PER_VERTEX)
+        {
+            glm::vec3 position[3];
+            Surface surface;
+            for (int k = 0; k < 3; k++)
+            {
+                const float* vertex = &vertices[first + k * FLOATS_PER_VERTEX];
+                position[k] = glm::vec3(object.model * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f));
+                surface.normal[k] = normalMatrix * glm::vec3(vertex[3], vertex[4], vertex[5]);
+                surface.uv[k] = glm::vec2(vertex[6], vertex[7]) * scene.uvScale;
+            }
+            surface.texture = object.texture;
+            triangles.push_back({ position[0], position[1] - position[0], position[2] - position[0] });
+            surfaces.push_back(surface);
+        }
+    }
+
+    std::vector<Bounds> primitives(triangles.size());
+    std::vector<glm::vec3> centers(triangles.size());
+    std::vector<uint32_t> order(triangles.size());
+    for (size_t i = 0; i < triangles.size(); i++)
+    {
+        primitives[i].grow(triangles[i].v0);
+        primitives[i].grow(triangles[i].v0 + triangles[i].e1);
+        primitives[i].grow(triangles[i].v0 + triangles[i].e2);
+        centers[i] = (primitives[i].lower + primitives[i].upper) * 0.5f;
+        order[i] = (uint32_t)i;
+    }
+    bvh->nodes.reserve(2 * triangles.size() / MAX_LEAF + 1);
+    buildNode(*bvh, primitives, centers, order, 0, (uint32_t)triangles.size(), 0);
+
+    // Leaves refer to runs of triangles, so store them in the tree's order
+    bvh->triangles.resize(triangles.size());
+    bvh->surfaces.resize(triangles.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        bvh->triangles[i] = triangles[order[i]];
+        bvh->surfaces[i] = surfaces[order[i]];
+    }
+
+    tracerStats.triangles = triangles.size();
+    tracerStats.nodes = bvh->nodes.size();
+    tracerStats.depth = bvh->depth;
+    tracerStats.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+PathTracer::~PathTracer() = default;
+
+void PathTracer::render(const glm::mat4& view, const glm::mat4& projection, int width, int height, const PathTracerSettings& settings,
+    std::vector<uint8_t>& rgba) {
+    auto start = std::chrono::steady_clock::now();
+    size_t pixels = (size_t)width * height;
+    std::vector<glm::vec3> radiance(pixels, glm::vec3(0.0f));
+    std::vector<float> brightness(pixels, 0.0f), brightnessSquares(pixels, 0.0f);
+    std::atomic<uint64_t> rays{ 0 };
+
+    Frame frame;
+    frame.inverseViewProjection = glm::inverse(projection * view);
+    frame.width = width;
+    frame.height = height;
+    frame.tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    frame.maxBounces = std::max(settings.maxBounces, 0);
+    frame.packets = gUsePackets && packetsAvailable();
+    frame.radiance = radiance.data();
+    frame.brightness = brightness.data();
+    frame.brightnessSquares = brightnessSquares.data();
+    frame.rays = &rays;
+    size_t tiles = (size_t)frame.tilesX * ((height + TILE_SIZE - 1) / TILE_SIZE);
+
+    tracerStats.steals = 0;
+    tracerStats.noise = 0.0f;
+    int samples = 0;
+    int samplesPerPixel = std::max(settings.samplesPerPixel, 1);
+    while (samples < samplesPerPixel && pixels > 0)
+    {
+        frame.firstSample = samples;
+        frame.samples = std::min(std::max(settings.samplesPerPass, 1), samplesPerPixel - samples);
+        if (pool && pool->size() > 1)
+            tracerStats.steals += pool->parallelForStealing(tiles, [&](size_t tile) { traceTile(frame, tile); });
+        else
+        {
+            for (size_t tile = 0; tile < tiles; tile++)
+                traceTile(frame, tile);
+        }
+        samples += frame.samples;
+
+        // Standard error of each pixel's mean brightness from its sample variance, averaged over the image
+        double error = 0.0;
+        if (samples > 1)
+        {
+            for (size_t i = 0; i < pixels; i++)
+            {
+                double mean = brightness[i] / samples;
+                double variance = std::max(0.0, (brightnessSquares[i] - mean * brightness[i]) / (samples - 1));
+                error += std::sqrt(variance / samples);
+            }
+        }
+        tracerStats.noise = (float)(error / pixels * 255.0);
+        if (samples > 1 && settings.noiseTarget > 0.0f && tracerStats.noise <= settings.noiseTarget)
+            break;
+    }
+
+    rgba.resize(pixels * 4);
+    for (size_t i = 0; i < pixels; i++)
+    {
+        glm::vec3 color = radiance[i] / (float)std::max(samples, 1);
+        for (int c = 0; c < 3; c++)
+            rgba[i * 4 + c] = (uint8_t)std::lrint(std::min(std::max(color[c], 0.0f), 1.0f) * 255.0f);
+        rgba[i * 4 + 3] = 255;
+    }
+    tracerStats.samplesPerPixel = samples;
+    tracerStats.rays = rays;
+    tracerStats.renderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PathTracer::traceTile(const Frame& frame, size_t tile) {
+    int x0 = (int)(tile % frame.tilesX) * TILE_SIZE, y0 = (int)(tile / frame.tilesX) * TILE_SIZE;
+    int x1 = std::min(x0 + TILE_SIZE, frame.width), y1 = std::min(y0 + TILE_SIZE, frame.height);
+    uint64_t rays = 0;
+    for (int by = y0; by < y1; by += 2)
+    {
+        for (int bx = x0; bx < x1; bx += 4)
+        {
+            // A 4x2 block per packet: neighbouring camera rays take nearly the same way through the tree
+            uint32_t lanes = 0;
+            for (int lane = 0; lane < 8; lane++)
+            {
+                if (bx + (lane & 3) < x1 && by + (lane >> 2) < y1)
+                    lanes |= 1u << lane;
+            }
+            for (int sample = frame.firstSample; sample < frame.firstSample + frame.samples; sample++)
+            {
+                Packet packet = {};
+                Random random[8];
+                glm::vec3 radiance[8];
+                for (int lane = 0; lane < 8; lane++)
+                {
+                    radiance[lane] = glm::vec3(0.0f);
+                    if (!(lanes >> lane & 1))
+                        continue;
+                    int x = bx + (lane & 3), y = by + (lane >> 2);
+                    random[lane] = Random((uint32_t)(y * frame.width + x), (uint32_t)sample);
+
+                    // Through a random point of the pixel, from the near plane to the far plane like the rasterizer
+                    float ndcX = 2.0f * (x + random[lane].next()) / frame.width - 1.0f;
+                    float ndcY = 2.0f * (y + random[lane].next()) / frame.height - 1.0f;
+                    glm::vec4 near = frame.inverseViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+                    glm::vec4 far = frame.inverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+                    glm::vec3 origin = glm::vec3(near) / near.w;
+                    glm::vec3 span = glm::vec3(far) / far.w - origin;
+                    float length = glm::length(span);
+                    setRay(packet, lane, origin, span / length, length);
+                }
+                rays += tracePaths(*bvh, scene, frame.maxBounces, frame.packets, packet, lanes, random, radiance);
+                for (int lane = 0; lane < 8; lane++)
+                {
+                    if (!(lanes >> lane & 1))
+                        continue;
+                    size_t index = (size_t)(by + (lane >> 2)) * frame.width + bx + (lane & 3);
+                    frame.radiance[index] += radiance[lane];
+                    glm::vec3 clamped = glm::min(glm::max(radiance[lane], glm::vec3(0.0f)), glm::vec3(1.0f));
+                    float luminance = 0.2126f * clamped.x + 0.7152f * clamped.y + 0.0722f * clamped.z;
+                    frame.brightness[index] += luminance;
+                    frame.brightnessSquares[index] += luminance * luminance;
+                }
+            }
+        }
+    }
+    *frame.rays += rays;
+}
+
+void PathTracer::setPackets(bool enabled) {
+    gUsePackets = enabled;
+}
+
+bool PathTracer::packetsAvailable() {
+    return SoftwareRenderer::simdAvailable();
+}
@@ -0,0 +1,71 @@
+#pragma once
+# include <cstddef>
+# include <cstdint>
+# include <memory>
+# include <vector>
+# include <glm/glm.hpp>
+
+class ThreadPool;
+struct SoftwareScene;
+
+// One reference image: passes of samplesPerPass paths per pixel until the noise estimate or samplesPerPixel is reached
+struct PathTracerSettings
+{
+	int samplesPerPixel = 256;
+	int samplesPerPass = 16;
+	int maxBounces = 4;			// Diffuse interreflections after the first hit
+	float noiseTarget = 1.0f;	// Mean standard error of a pixel's brightness, in 8-bit levels (0 = always trace every sample)
+};
+
+struct PathTracerStats
+{
+	double buildMs = 0.0;		// BVH construction
+	size_t triangles = 0;
+	size_t nodes = 0;
+	int depth = 0;				// Deepest leaf
+	double renderMs = 0.0;		// Last render()
+	uint64_t rays = 0;			// Camera, bounce and shadow rays of the last render()
+	int samplesPerPixel = 0;
+	float noise = 0.0f;			// Noise estimate reached, as noiseTarget
+	size_t steals = 0;			// Tiles taken from another thread's share
+};
+
+/* Class to render converged reference images of a SoftwareScene by path tracing, as ground truth for lighting changes.
+All triangles are moved to world space by their object's model matrix and put in one BVH built with the surface area
+heuristic over binned centroids. Rays travel in packets of eight, one pixel of a 4x2 block each, traversing the BVH and
+testing triangles together with AVX2; 16x16 pixel tiles are spread over the pool with work stealing.
+
+Surfaces are Lambertian with the texture as albedo plus the Phong highlight of fragmentShaderSource, lit by its lights
+without distance falloff, like the shader. Lights are spheres of the lamp's size, so shadows are soft. The shader's
+ambient term and diffuse floor stand in for light arriving indirectly, which is traced here instead*/
+class PathTracer
+{
+public:
+	// Builds the BVH. The scene's textures must outlive the tracer
+	PathTracer(const SoftwareScene& scene, ThreadPool* pool = nullptr);
+	~PathTracer();
+
+	PathTracer(const PathTracer&) = delete;
+	PathTracer& operator=(const PathTracer&) = delete;
+
+	// Traces width x height pixels into rgba (RGBA8, rows bottom to top like glReadPixels), clamped like a UNORM8 target
+	void render(const glm::mat4& view, const glm::mat4& projection, int width, int height, const PathTracerSettings& settings,
+		std::vector<uint8_t>& rgba);
+
+	const PathTracerStats& stats() const { return tracerStats; }
+
+	// Switch between AVX2 packets and single rays (used by the benchmark)
+	static void setPackets(bool enabled);
+	static bool packetsAvailable();		// This CPU has AVX2 and FMA
+
+private:
+	struct Bvh;
+	struct Frame;
+
+	void traceTile(const Frame& frame, size_t tile);
+
+	const SoftwareScene& scene;
+	ThreadPool* const pool;
+	std::unique_ptr<Bvh> bvh;
+	PathTracerStats tracerStats;
+};
@@ -0,0 +1,165 @@
+#include "PixelBufferPool.h"
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    const size_t BUFFER_GRANULARITY = 1 << 20;     // Buffers are created in whole MB so they fit later images too
+}
+
+PixelBufferPool::PixelBufferPool(size_t budgetBytes)
+    : budget(budgetBytes) {
+}
+
+PixelBufferPool::~PixelBufferPool() {
+    shutdown();
+    for (auto& buffer : buffers)
+    {
+        if (buffer->fence)
+            glDeleteSync(buffer->fence);
+        glDeleteBuffers(1, &buffer->buffer);    // Also unmaps it; the GL keeps it alive until pending uploads are done
+    }
+}
+
+PixelBuffer* PixelBufferPool::acquire(size_t bytes) {
+    std::unique_lock<std::mutex> lock(poolMutex);
+    if (stopping)
+        return nullptr;
+    if (PixelBuffer* buffer = takeFree(bytes))
+    {
+        hand(buffer, bytes);
+        return buffer;
+    }
+
+    // Only the GL thread can map a new buffer
+    auto start = std::chrono::steady_clock::now();
+    Request request{ bytes };
+    requests.push_back(&request);
+    requestServed.wait(lock, [&] { return request.granted || stopping; });
+    if (!request.granted)
+        requests.erase(std::find(requests.begin(), requests.end(), &request));
+    counters.stalls++;
+    counters.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return request.granted;
+}
+
+void PixelBufferPool::discard(PixelBuffer* buffer) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    counters.bytesInFlight -= buffer->used;
+    buffer->used = 0;
+    buffer->busy = false;
+}
+
+void PixelBufferPool::submit(PixelBuffer* buffer) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    fenced.push_back(buffer);
+}
+
+void PixelBufferPool::service() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    // Retire uploads the GPU has finished reading, without waiting for the others
+    for (auto it = fenced.begin(); it != fenced.end();)
+    {
+        GLenum state = glClientWaitSync((*it)->fence, 0, 0);
+        if (state == GL_ALREADY_SIGNALED || state == GL_CONDITION_SATISFIED)
+        {
+            PixelBuffer* buffer = *it;
+            glDeleteSync(buffer->fence);
+            buffer->fence = nullptr;
+            counters.bytesInFlight -= buffer->used;
+            counters.fencesRetired++;
+            buffer->used = 0;
+            buffer->busy = false;
+            it = fenced.erase(it);
+        }
+        else
+        {
+            counters.fencesPending++;
+            ++it;
+        }
+    }
+
+    // Serve waiting workers in order, reusing idle buffers first
+    bool served = false;
+    while (!requests.empty() && !stopping)
+    {
+        Request* request = requests.front();
+        PixelBuffer* buffer = takeFree(request->bytes);
+        if (!buffer)
+        {
+            // Drop idle buffers that are too small to make room, then map a new one if the budget allows.
+            // A request larger than the budget is still served once nothing else is in flight
+            size_t capacity = (request->bytes + BUFFER_GRANULARITY - 1) / BUFFER_GRANULARITY * BUFFER_GRANULARITY;
+            for (auto it = buffers.begin(); it != buffers.end() && counters.mappedBytes + capacity > budget;)
+            {
+                if ((*it)->busy)
+                {
+                    ++it;
+                    continue;
+                }
+                counters.mappedBytes -= (*it)->capacity;
+                glDeleteBuffers(1, &(*it)->buffer);
+                it = buffers.erase(it);
+            }
+            bool anyBusy = std::any_of(buffers.begin(), buffers.end(), [](const std::unique_ptr<PixelBuffer>& b) { return b->busy; });
+            if (counters.mappedBytes + capacity > budget && anyBusy)
+                break;      // Wait for uploads in flight to retire
+
+            auto created = std::make_unique<PixelBuffer>();
+            created->capacity = capacity;
+            glGenBuffers(1, &created->buffer);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, created->buffer);
+
+            // Readable client storage: the vertical flip and the mip filter read the decoded pixels back
+            const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)capacity, nullptr, flags | GL_CLIENT_STORAGE_BIT);
+            created->mapped = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)capacity, flags);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            if (!created->mapped)
+            {
+                glDeleteBuffers(1, &created->buffer);
+                break;      // Out of memory; try again next frame
+            }
+            counters.mappedBytes += capacity;
+            buffer = created.get();
+            buffers.push_back(std::move(created));
+        }
+        hand(buffer, request->bytes);
+        request->granted = buffer;
+        requests.pop_front();
+        served = true;
+    }
+    counters.buffers = buffers.size();
+    if (served)
+        requestServed.notify_all();
+}
+
+void PixelBufferPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        stopping = true;
+    }
+    requestServed.notify_all();
+}
+
+PixelBufferStats PixelBufferPool::stats() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return counters;
+}
+
+PixelBuffer* PixelBufferPool::takeFree(size_t bytes) {
+    PixelBuffer* best = nullptr;
+    for (auto& buffer : buffers)
+        if (!buffer->busy && buffer->capacity >= bytes && (!best || buffer->capacity < best->capacity))
+            best = buffer.get();
+    return best;
+}
+
+void PixelBufferPool::hand(PixelBuffer* buffer, size_t bytes) {
+    buffer->busy = true;
+    buffer->used = bytes;
+    counters.bytesInFlight += bytes;
+    counters.peakBytesInFlight = std::max(counters.peakBytesInFlight, counters.bytesInFlight);
+}
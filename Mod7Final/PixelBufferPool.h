@@ -0,0 +1,83 @@
+#pragma once
+# include <GL/glew.h>
+# include <condition_variable>
+# include <cstddef>
+# include <cstdint>
+# include <deque>
+# include <memory>
+# include <mutex>
+# include <vector>
+
+// One persistently mapped pixel unpack buffer
+struct PixelBuffer
+{
+	GLuint buffer = 0;
+	size_t capacity = 0;
+	uint8_t* mapped = nullptr;		// Coherent mapping, valid for the life of the buffer
+	size_t used = 0;				// Bytes asked for by the current owner
+	GLsync fence = nullptr;			// Signaled once the GPU has read every upload sourced from the buffer
+	bool busy = false;				// Handed out, or waiting on its fence
+};
+
+// Upload counters since the pool was created
+struct PixelBufferStats
+{
+	size_t buffers = 0;
+	size_t mappedBytes = 0;			// Capacity of every buffer currently created
+	size_t bytesInFlight = 0;		// Handed out and not yet retired
+	size_t peakBytesInFlight = 0;
+	size_t stalls = 0;				// acquire() calls that had to wait for the GL thread
+	double stallMs = 0.0;			// Worker time spent waiting in them
+	size_t fencesRetired = 0;
+	size_t fencesPending = 0;		// Polls that found a fence not signaled yet
+};
+
+/* Class to hand out persistently mapped pixel unpack buffers to the decode workers, so images are decoded straight into
+memory the GPU uploads from. A worker takes a free buffer that fits, or waits until the GL thread's service() maps one.
+The GL thread fences a buffer with submit() after issuing its uploads, and service() puts it back in the pool once the
+fence signals. New buffers are only created while the total stays within the budget, which limits bytes in flight*/
+class PixelBufferPool
+{
+public:
+	explicit PixelBufferPool(size_t budgetBytes);
+	~PixelBufferPool();
+
+	PixelBufferPool(const PixelBufferPool&) = delete;
+	PixelBufferPool& operator=(const PixelBufferPool&) = delete;
+
+	// Any thread but the GL thread: waits for a mapped buffer of at least bytes. nullptr once shutdown() was called
+	PixelBuffer* acquire(size_t bytes);
+
+	// Puts back a buffer that was acquired but will not be uploaded from
+	void discard(PixelBuffer* buffer);
+
+	// GL thread: fences the uploads just issued from the buffer; it returns to the pool when they are done
+	void submit(PixelBuffer* buffer);
+
+	// GL thread, once per frame: retires signaled fences and maps buffers for waiting workers
+	void service();
+
+	// Wakes every waiting worker with nullptr and fails later acquires
+	void shutdown();
+
+	PixelBufferStats stats();
+
+private:
+	struct Request
+	{
+		size_t bytes;
+		PixelBuffer* granted = nullptr;
+	};
+
+	PixelBuffer* takeFree(size_t bytes);	// Smallest idle buffer of at least bytes; caller holds poolMutex
+	void hand(PixelBuffer* buffer, size_t bytes);
+
+	const size_t budget;
+	std::mutex poolMutex;
+	std::condition_variable requestServed;
+	std::vector<std::unique_ptr<PixelBuffer>> buffers;
+	std::deque<Request*> requests;			// Workers waiting for the GL thread
+	std::vector<PixelBuffer*> fenced;		// Submitted, fence not signaled yet
+	PixelBufferStats counters;
+	bool stopping = false;
+};
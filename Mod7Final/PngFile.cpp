@@ -0,0 +1,461 @@
+#include "PngFile.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    const int WINDOW_SIZE = 32768;
+    const int HASH_BITS = 15;
+    const int MIN_MATCH = 3;
+    const int MAX_MATCH = 258;
+    const int MAX_CHAIN = 64;           // Earlier positions tried per match, as zlib's default level
+    const int GOOD_MATCH = 128;         // A match this long is taken without looking further
+    const size_t BLOCK_SYMBOLS = 16384; // Literals and matches per Huffman block
+    const int LITERAL_CODES = 286;
+    const int DISTANCE_CODES = 30;
+    const int MAX_CODE_LENGTH = 15;
+
+    const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+        4097, 6145, 8193, 12289, 16385, 24577 };
+    const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    const uint8_t CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    // A literal byte (distance 0) or a match of length bytes distance back
+    struct Symbol
+    {
+        uint16_t length;
+        uint16_t distance;
+    };
+
+    // Appends bits least significant first, as deflate packs them
+    struct BitWriter
+    {
+        std::vector<uint8_t>& out;
+        uint64_t buffer = 0;
+        int count = 0;
+
+        void put(uint32_t bits, int length)
+        {
+            buffer |= (uint64_t)bits << count;
+            count += length;
+            while (count >= 8)
+            {
+                out.push_back((uint8_t)buffer);
+                buffer >>= 8;
+                count -= 8;
+            }
+        }
+
+        void flush()
+        {
+            if (count > 0)
+                out.push_back((uint8_t)buffer);
+            buffer = 0;
+            count = 0;
+        }
+    };
+
+    // Canonical Huffman code of one alphabet, codes stored bit reversed for the LSB first stream
+    struct HuffmanCode
+    {
+        uint8_t lengths[LITERAL_CODES] = {};
+        uint16_t codes[LITERAL_CODES] = {};
+    };
+
+    /* Code lengths of at most maxLength bits from symbol frequencies. Lengths too long are pulled in and the Kraft sum
+    repaired by lengthening the deepest shorter codes, as miniz does; the most frequent symbols keep the shortest codes*/
+    void buildCode(const uint32_t* frequencies, int symbols, int maxLength, HuffmanCode& code)
+    {
+        std::fill(code.lengths, code.lengths + symbols, 0);
+        std::vector<int> used;
+        for (int s = 0; s < symbols; s++)
+            if (frequencies[s] > 0)
+                used.push_back(s);
+        if (used.empty())
+            return;
+        if (used.size() == 1)
+        {
+            code.lengths[used[0]] = 1;
+        }
+        else
+        {
+            // Huffman tree by two queues over the symbols sorted by frequency: leaves, then internal nodes in creation order
+            std::sort(used.begin(), used.end(), [&](int a, int b) { return frequencies[a] < frequencies[b] || (frequencies[a] == frequencies[b] && a < b); });
+            size_t n = used.size();
+            std::vector<uint64_t> weight(2 * n - 1);
+            std::vector<int> parent(2 * n - 1, -1);
+            for (size_t i = 0; i < n; i++)
+                weight[i] = frequencies[used[i]];
+            size_t leaf = 0, node = n, next = n;
+            auto smallest = [&]() {
+                if (leaf < n && (node >= next || weight[leaf] <= weight[node]))
+                    return leaf++;
+                return node++;
+            };
+            for (; next < 2 * n - 1; next++)
+            {
+                size_t a = smallest(), b = smallest();
+                weight[next] = weight[a] + weight[b];
+                parent[a] = parent[b] = (int)next;
+            }
+            int counts[64] = {};
+            std::vector<int> depth(2 * n - 1, 0);
+            for (size_t i = 2 * n - 2; i-- > 0;)
+                depth[i] = depth[parent[i]] + 1;
+            for (size_t i = 0; i < n; i++)
+                counts[std::min(depth[i], 63)]++;
+
+            // Pull in codes that are too long, then give back Kraft space by splitting the longest shorter code
+            for (int length = maxLength + 1; length < 64; length++)
+            {
+                counts[maxLength] += counts[length];
+                counts[length] = 0;
+            }
+            uint64_t total = 0;
+            for (int length = 1; length <= maxLength; length++)
+                total += (uint64_t)counts[length] << (maxLength - length);
+            while (total > (1ull << maxLength))
+            {
+                counts[maxLength]--;
+                for (int length = maxLength - 1; length > 0; length--)
+                {
+                    if (counts[length] > 0)
+                    {
+                        counts[length]--;
+                        counts[length + 1] += 2;
+                        break;
+                    }
+                }
+                total--;
+            }
+
+            // Longest codes to the rarest symbols
+            size_t i = 0;
+            for (int length = maxLength; length > 0; length--)
+                for (int k = 0; k < counts[length]; k++)
+                    code.lengths[used[i++]] = (uint8_t)length;
+        }
+
+        // Canonical codes, reversed
+        int lengthCount[MAX_CODE_LENGTH + 1] = {};
+        for (int s = 0; s < symbols; s++)
+            lengthCount[code.lengths[s]]++;
+        lengthCount[0] = 0;
+        uint32_t nextCode[MAX_CODE_LENGTH + 2] = {};
+        for (int length = 1; length <= MAX_CODE_LENGTH; length++)
+            nextCode[length + 1] = (nextCode[length] + lengthCount[length]) << 1;
+        for (int s = 0; s < symbols; s++)
+        {
+            int length = code.lengths[s];
+            if (length == 0)
+                continue;
+            uint32_t value = nextCode[length]++;
+            uint32_t reversed = 0;
+            for (int b = 0; b < length; b++)
+                reversed |= ((value >> b) & 1) << (length - 1 - b);
+            code.codes[s] = (uint16_t)reversed;
+        }
+    }
+
+    int lengthSymbol(int length)
+    {
+        return (int)(std::upper_bound(LENGTH_BASE, LENGTH_BASE + 29, (uint16_t)length) - LENGTH_BASE) - 1;
+    }
+
+    int distanceSymbol(int distance)
+    {
+        return (int)(std::upper_bound(DISTANCE_BASE, DISTANCE_BASE + 30, (uint16_t)distance) - DISTANCE_BASE) - 1;
+    }
+
+    // Writes one block with dynamic Huffman codes
+    void writeBlock(BitWriter& writer, const std::vector<Symbol>& symbols, bool last)
+    {
+        uint32_t literalFrequency[LITERAL_CODES] = {}, distanceFrequency[DISTANCE_CODES] = {};
+        for (const Symbol& symbol : symbols)
+        {
+            if (symbol.distance == 0)
+            {
+                literalFrequency[symbol.length]++;
+                continue;
+            }
+            literalFrequency[257 + lengthSymbol(symbol.length)]++;
+            distanceFrequency[distanceSymbol(symbol.distance)]++;
+        }
+        literalFrequency[256] = 1;      // End of block
+        if (std::count(distanceFrequency, distanceFrequency + DISTANCE_CODES, 0u) == DISTANCE_CODES)
+            distanceFrequency[0] = 1;   // The header needs one distance code even when nothing uses it
+        HuffmanCode literals, distances;
+        buildCode(literalFrequency, LITERAL_CODES, MAX_CODE_LENGTH, literals);
+        buildCode(distanceFrequency, DISTANCE_CODES, MAX_CODE_LENGTH, distances);
+
+        int literalCount = LITERAL_CODES, distanceCount = DISTANCE_CODES;
+        while (literalCount > 257 && literals.lengths[literalCount - 1] == 0)
+            literalCount--;
+        while (distanceCount > 1 && distances.lengths[distanceCount - 1] == 0)
+            distanceCount--;
+
+        // Both length lists run together, with runs of zeros and repeats shortened by codes 16, 17 and 18
+        std::vector<uint8_t> lengths(literals.lengths, literals.lengths + literalCount);
+        lengths.insert(lengths.end(), distances.lengths, distances.lengths + distanceCount);
+        std::vector<std::pair<uint8_t, uint8_t>> runs;  // Code length symbol and its extra bits
+        for (size_t i = 0; i < lengths.size();)
+        {
+            size_t run = 1;
+            while (i + run < lengths.size() && lengths[i + run] == lengths[i])
+                run++;
+            if (lengths[i] == 0 && run >= 3)
+            {
+                run = std::min<size_t>(run, 138);
+                runs.push_back(run <= 10 ? std::make_pair<uint8_t, uint8_t>(17, (uint8_t)(run - 3)) : std::make_pair<uint8_t, uint8_t>(18, (uint8_t)(run - 11)));
+            }
+            else if (run >= 4)
+            {
+                run = std::min<size_t>(run, 7);
+                runs.push_back({ lengths[i], 0 });
+                runs.push_back({ 16, (uint8_t)(run - 4) });
+            }
+            else
+            {
+                run = 1;
+                runs.push_back({ lengths[i], 0 });
+            }
+            i += run;
+        }
+        uint32_t lengthFrequency[19] = {};
+        for (const auto& run : runs)
+            lengthFrequency[run.first]++;
+        HuffmanCode lengthCode;
+        buildCode(lengthFrequency, 19, 7, lengthCode);
+        int lengthCodeCount = 19;
+        while (lengthCodeCount > 4 && lengthCode.lengths[CODE_LENGTH_ORDER[lengthCodeCount - 1]] == 0)
+            lengthCodeCount--;
+
+        writer.put(last ? 1 : 0, 1);
+        writer.put(2, 2);       // Dynamic Huffman codes
+        writer.put(literalCount - 257, 5);
+        writer.put(distanceCount - 1, 5);
+        writer.put(lengthCodeCount - 4, 4);
+        for (int i = 0; i < lengthCodeCount; i++)
+            writer.put(lengthCode.lengths[CODE_LENGTH_ORDER[i]], 3);
+        for (const auto& run : runs)
+        {
+            writer.put(lengthCode.codes[run.first], lengthCode.lengths[run.first]);
+            if (run.first >= 16)
+                writer.put(run.second, run.first == 16 ? 2 : run.first == 17 ? 3 : 7);
+        }
+
+        for (const Symbol& symbol : symbols)
+        {
+            if (symbol.distance == 0)
+            {
+                writer.put(literals.codes[symbol.length], literals.lengths[symbol.length]);
+                continue;
+            }
+            int length = lengthSymbol(symbol.length);
+            writer.put(literals.codes[257 + length], literals.lengths[257 + length]);
+            writer.put(symbol.length - LENGTH_BASE[length], LENGTH_EXTRA[length]);
+            int distance = distanceSymbol(symbol.distance);
+            writer.put(distances.codes[distance], distances.lengths[distance]);
+            writer.put(symbol.distance - DISTANCE_BASE[distance], DISTANCE_EXTRA[distance]);
+        }
+        writer.put(literals.codes[256], literals.lengths[256]);
+    }
+
+    // zlib stream of data: greedy matching along hash chains of 3-byte prefixes within the 32 KB window
+    void deflate(const std::vector<uint8_t>& data, std::vector<uint8_t>& out)
+    {
+        out.push_back(0x78);    // 32 KB window, deflate
+        out.push_back(0x9C);    // Default level, header checksum
+        BitWriter writer{ out };
+        std::vector<int32_t> head(1 << HASH_BITS, -1), previous(WINDOW_SIZE, -1);
+        auto hash = [&](size_t at) {
+            uint32_t value = data[at] | data[at + 1] << 8 | data[at + 2] << 16;
+            return (value * 2654435761u) >> (32 - HASH_BITS);
+        };
+        auto insert = [&](size_t at) {
+            if (at + MIN_MATCH > data.size())
+                return;
+            uint32_t h = hash(at);
+            previous[at & (WINDOW_SIZE - 1)] = head[h];
+            head[h] = (int32_t)at;
+        };
+
+        std::vector<Symbol> symbols;
+        symbols.reserve(BLOCK_SYMBOLS);
+        size_t at = 0;
+        while (at < data.size())
+        {
+            int bestLength = 0, bestDistance = 0;
+            if (at + MIN_MATCH <= data.size())
+            {
+                int limit = (int)std::min<size_t>(MAX_MATCH, data.size() - at);
+                int32_t candidate = head[hash(at)];
+                for (int chain = 0; candidate >= 0 && chain < MAX_CHAIN && at - candidate <= WINDOW_SIZE; chain++)
+                {
+                    const uint8_t* a = &data[at];
+                    const uint8_t* b = &data[candidate];
+                    if (b[bestLength] == a[bestLength])
+                    {
+                        int length = 0;
+                        while (length < limit && a[length] == b[length])
+                            length++;
+                        if (length > bestLength)
+                        {
+                            bestLength = length;
+                            bestDistance = (int)(at - candidate);
+                            if (length >= GOOD_MATCH || length == limit)
+                                break;
+                        }
+                    }
+                    int32_t next = previous[candidate & (WINDOW_SIZE - 1)];
+                    if (next >= candidate)
+                        break;  // The slot was reused by a newer position
+                    candidate = next;
+                }
+            }
+            if (bestLength >= MIN_MATCH)
+            {
+                symbols.push_back({ (uint16_t)bestLength, (uint16_t)bestDistance });
+                for (int i = 0; i < bestLength; i++)
+                    insert(at + i);
+                at += bestLength;
+            }
+            else
+            {
+                symbols.push_back({ data[at], 0 });
+                insert(at);
+                at++;
+            }
+            if (symbols.size() == BLOCK_SYMBOLS)
+            {
+                writeBlock(writer, symbols, at == data.size());
+                symbols.clear();
+            }
+        }
+        if (!symbols.empty() || data.empty())
+            writeBlock(writer, symbols, true);
+        writer.flush();
+
+        uint32_t a = 1, b = 0;      // Adler-32
+        for (size_t i = 0; i < data.size();)
+        {
+            size_t end = std::min(data.size(), i + 5552);   // Longest run before the sums can overflow
+            for (; i < end; i++)
+            {
+                a += data[i];
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        uint32_t adler = b << 16 | a;
+        for (int shift = 24; shift >= 0; shift -= 8)
+            out.push_back((uint8_t)(adler >> shift));
+    }
+
+    uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc)
+    {
+        static const auto table = [] {
+            std::vector<uint32_t> entries(256);
+            for (uint32_t n = 0; n < 256; n++)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++)
+                    c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                entries[n] = c;
+            }
+            return entries;
+        }();
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    void put32(std::vector<uint8_t>& out, uint32_t value)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            out.push_back((uint8_t)(value >> shift));
+    }
+
+    void chunk(std::vector<uint8_t>& png, const char type[4], const uint8_t* data, size_t size)
+    {
+        put32(png, (uint32_t)size);
+        size_t start = png.size();
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), data, data + size);
+        put32(png, crc32(&png[start], size + 4, 0));
+    }
+
+    int paeth(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+    }
+}
+
+void PngFile::encode(const uint8_t* pixels, uint32_t width, uint32_t height, int channels, bool flip, std::vector<uint8_t>& png) {
+    // Filter each row every way and keep the one whose bytes, read as signed, sum smallest
+    size_t rowBytes = (size_t)width * channels;
+    std::vector<uint8_t> filtered((rowBytes + 1) * height);
+    std::vector<uint8_t> candidate(rowBytes);
+    std::vector<uint8_t> zeros(rowBytes, 0);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint8_t* row = pixels + (size_t)(flip ? height - 1 - y : y) * rowBytes;
+        const uint8_t* above = y == 0 ? zeros.data() : pixels + (size_t)(flip ? height - y : y - 1) * rowBytes;
+        uint8_t* out = &filtered[y * (rowBytes + 1)];
+        uint64_t bestSum = UINT64_MAX;
+        for (int filter = 0; filter < 5; filter++)
+        {
+            uint64_t sum = 0;
+            for (size_t i = 0; i < rowBytes; i++)
+            {
+                int left = i >= (size_t)channels ? row[i - channels] : 0;
+                int upLeft = i >= (size_t)channels ? above[i - channels] : 0;
+                int predicted = filter == 0 ? 0 : filter == 1 ? left : filter == 2 ? above[i] : filter == 3 ? (left + above[i]) / 2
+                    : paeth(left, above[i], upLeft);
+                uint8_t value = (uint8_t)(row[i] - predicted);
+                candidate[i] = value;
+                sum += value < 128 ? value : 256 - value;
+            }
+            if (sum < bestSum)
+            {
+                bestSum = sum;
+                out[0] = (uint8_t)filter;
+                std::memcpy(out + 1, candidate.data(), rowBytes);
+            }
+        }
+    }
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    static const uint8_t colorTypes[5] = { 0, 0, 4, 2, 6 };     // By channel count: gray, gray and alpha, RGB, RGBA
+    png.assign(signature, signature + 8);
+    std::vector<uint8_t> header;
+    put32(header, width);
+    put32(header, height);
+    header.insert(header.end(), { 8, colorTypes[channels], 0, 0, 0 });     // 8 bits, deflate, adaptive filters, no interlace
+    chunk(png, "IHDR", header.data(), header.size());
+    std::vector<uint8_t> compressed;
+    deflate(filtered, compressed);
+    chunk(png, "IDAT", compressed.data(), compressed.size());
+    chunk(png, "IEND", nullptr, 0);
+}
+
+bool PngFile::write(const char* path, const uint8_t* pixels, uint32_t width, uint32_t height, int channels, bool flip) {
+    std::vector<uint8_t> png;
+    encode(pixels, width, height, channels, flip, png);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.write((const char*)png.data(), (std::streamsize)png.size()))
+    {
+        std::cout << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
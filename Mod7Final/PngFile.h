@@ -0,0 +1,18 @@
+#pragma once
+# include <cstddef>
+# include <cstdint>
+# include <vector>
+
+/* Class to write PNG images (8-bit gray, gray and alpha, RGB or RGBA, not interlaced). Each row gets the filter with the
+smallest sum of absolute differences, then the rows are deflated with hash chain matching and dynamic Huffman codes, as
+zlib does at its default level. Images are read back through stb_image*/
+class PngFile
+{
+public:
+	/* Encodes width x height pixels of channels (1 to 4) bytes each into png. Rows go top to bottom, or bottom to top
+	(OpenGL and glReadPixels order) with flip*/
+	static void encode(const uint8_t* pixels, uint32_t width, uint32_t height, int channels, bool flip, std::vector<uint8_t>& png);
+
+	// Encodes the image and writes it to path. False (with a message) if the file cannot be written
+	static bool write(const char* path, const uint8_t* pixels, uint32_t width, uint32_t height, int channels, bool flip);
+};
@@ -0,0 +1,157 @@
+#include "ProcessedCache.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace
+{
+    const uint32_t MAX_BLOBS = 64;
+
+    uint64_t fnv1a(uint64_t hash, const uint8_t* bytes, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return hash;
+    }
+}
+
+ProcessedCache::ProcessedCache(std::string directory)
+    : directory(std::move(directory)) {
+}
+
+uint64_t ProcessedCache::key(std::span<const uint8_t> source, const std::string& parameters) {
+    uint64_t hash = 1469598103934665603ull;    // FNV-1a over the source, then the parameters
+    hash = fnv1a(hash, source.data(), source.size());
+    hash = fnv1a(hash, (const uint8_t*)parameters.data(), parameters.size());
+    return hash ? hash : 1;    // 0 is left to mean "no key"
+}
+
+bool ProcessedCache::load(const char* name, uint64_t key, CachedArtifact& artifact) {
+    auto start = std::chrono::steady_clock::now();
+    std::string file = path(name, key);
+    std::ifstream in(file, std::ios::binary | std::ios::ate);
+    uint64_t fileBytes = in ? (uint64_t)in.tellg() : 0;
+    in.seekg(0);
+
+    // Validate the header and make sure the blobs add up to the file
+    ProcessedCacheHeader header;
+    bool valid = in.read((char*)&header, sizeof(header)) && header.magic == PROCESSED_CACHE_MAGIC && header.version == PROCESSED_CACHE_VERSION
+        && header.key == key && header.blobCount <= MAX_BLOBS;
+    std::vector<uint64_t> sizes(valid ? header.blobCount : 0);
+    valid = valid && in.read((char*)sizes.data(), (std::streamsize)(sizes.size() * sizeof(uint64_t)));
+    uint64_t total = sizeof(header) + sizes.size() * sizeof(uint64_t);
+    for (uint64_t size : sizes)
+        total += size;
+    valid = valid && total == fileBytes;
+    if (valid)
+    {
+        artifact.blobs.resize(sizes.size());
+        for (size_t b = 0; b < sizes.size() && valid; b++)
+        {
+            artifact.blobs[b].resize((size_t)sizes[b]);
+            valid = (bool)in.read((char*)artifact.blobs[b].data(), (std::streamsize)sizes[b]);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    if (!valid)
+    {
+        counters.misses++;
+        if (in)
+        {
+            in.close();
+            std::error_code error;
+            std::filesystem::remove(file, error);   // Damaged: rewritten after processing
+        }
+        return false;
+    }
+    std::memcpy(artifact.values, header.values, sizeof(artifact.values));
+    artifact.processMs = header.processMs;
+    counters.hits++;
+    counters.bytesRead += (size_t)fileBytes;
+    counters.savedMs += header.processMs - std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+bool ProcessedCache::store(const char* name, uint64_t key, const uint32_t values[8], double processMs, std::span<const std::span<const uint8_t>> blobs) {
+    if (blobs.size() > MAX_BLOBS)
+        return false;
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    ProcessedCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = PROCESSED_CACHE_MAGIC;
+    header.version = PROCESSED_CACHE_VERSION;
+    header.key = key;
+    std::memcpy(header.values, values, sizeof(header.values));
+    header.processMs = processMs;
+    header.blobCount = (uint32_t)blobs.size();
+    std::vector<uint64_t> sizes;
+    size_t bytes = sizeof(header) + blobs.size() * sizeof(uint64_t);
+    for (std::span<const uint8_t> blob : blobs)
+    {
+        sizes.push_back(blob.size());
+        bytes += blob.size();
+    }
+
+    // Written under a name of this thread's own first, so a reader never sees half a file
+    std::string file = path(name, key);
+    std::string temporary = file + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)sizes.data(), (std::streamsize)(sizes.size() * sizeof(uint64_t)));
+        for (std::span<const uint8_t> blob : blobs)
+            out.write((const char*)blob.data(), (std::streamsize)blob.size());
+        if (!out)
+        {
+            out.close();
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, file, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+
+    // Artifacts of the same source under other keys can no longer be hit
+    std::string stale = std::filesystem::path(prefix(name)).filename().string();
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+    {
+        std::string other = entry.path().filename().string();
+        if (other.size() == stale.size() + 23 && other.compare(0, stale.size(), stale) == 0 && other.ends_with(".pcache") && entry.path() != file)
+            std::filesystem::remove(entry.path(), error);
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    counters.stores++;
+    counters.bytesWritten += bytes;
+    return true;
+}
+
+ProcessedCacheStats ProcessedCache::stats() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return counters;
+}
+
+std::string ProcessedCache::prefix(const char* name) const {
+    // Sources in subdirectories get flat names
+    std::string flat = name;
+    for (char& c : flat)
+        if (c == '/' || c == '\\' || c == ':')
+            c = '_';
+    return (std::filesystem::path(directory) / (flat + "-")).string();
+}
+
+std::string ProcessedCache::path(const char* name, uint64_t key) const {
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)key);
+    return prefix(name) + hex + ".pcache";
+}
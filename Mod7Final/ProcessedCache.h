@@ -0,0 +1,74 @@
+#pragma once
+# include <cstddef>
+# include <cstdint>
+# include <mutex>
+# include <span>
+# include <string>
+# include <vector>
+
+/* On-disk cache of processed assets (decoded, flipped, mipmapped or compressed textures). Each artifact is one file
+named after its source and key, where the key hashes the source bytes, the processing parameters and the version of
+the code that processed it, so an edited source or changed setting simply misses:
+
+	[ProcessedCacheHeader][uint64 blob size x blobCount][blob][blob]...
+*/
+const uint32_t PROCESSED_CACHE_MAGIC = 0x43414350;	// "PCAC"
+const uint32_t PROCESSED_CACHE_VERSION = 1;
+
+struct ProcessedCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t values[8];			// Small results of the processing (sizes, formats), meaning up to the caller
+	double processMs;			// What producing the artifact cost, to report the time a hit saves
+	uint32_t blobCount;
+	uint32_t reserved;
+};
+
+static_assert(sizeof(ProcessedCacheHeader) == 64, "ProcessedCacheHeader layout changed");
+
+// One artifact read back from the cache
+struct CachedArtifact
+{
+	uint32_t values[8] = {};
+	double processMs = 0.0;
+	std::vector<std::vector<uint8_t>> blobs;
+};
+
+// Cache counters since it was created
+struct ProcessedCacheStats
+{
+	size_t hits = 0;
+	size_t misses = 0;
+	size_t stores = 0;
+	double savedMs = 0.0;			// Processing the hits skipped, less the time spent reading them
+	size_t bytesRead = 0;
+	size_t bytesWritten = 0;
+};
+
+// Class to look up and store processed artifacts; safe to use from several threads
+class ProcessedCache
+{
+public:
+	explicit ProcessedCache(std::string directory);
+
+	// Key of an artifact: its source bytes and a description of how it is processed, including a version
+	static uint64_t key(std::span<const uint8_t> source, const std::string& parameters);
+
+	// Reads the artifact of name stored under key. False (a miss) if there is none or it is damaged
+	bool load(const char* name, uint64_t key, CachedArtifact& artifact);
+
+	// Writes an artifact and removes any other of the same name, which was made from an older source or other settings
+	bool store(const char* name, uint64_t key, const uint32_t values[8], double processMs, std::span<const std::span<const uint8_t>> blobs);
+
+	ProcessedCacheStats stats();
+
+private:
+	std::string prefix(const char* name) const;		// Path of name's artifacts up to the key
+	std::string path(const char* name, uint64_t key) const;
+
+	const std::string directory;
+	std::mutex statsMutex;
+	ProcessedCacheStats counters;
+};
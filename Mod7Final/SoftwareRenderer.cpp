@@ -0,0 +1,772 @@
+#include "SoftwareRenderer.h"
+#include "ImageTools.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <future>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SOFTWARE_RENDERER_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// The AVX2 kernels are compiled for that target on their own and only run after the CPU has been checked
+#if defined(SOFTWARE_RENDERER_AVX2) && defined(__GNUC__)
+#define AVX2_FUNCTION __attribute__((target("avx2,fma")))
+#else
+#define AVX2_FUNCTION
+#endif
+
+namespace
+{
+    const int TILE_SIZE = 64;
+    const size_t CHUNK_TRIANGLES = 512;     // Triangles set up by one geometry job
+    const int FLOATS_PER_VERTEX = 8;
+    const int PLANES = 10;                  // z, 1/w, then world position, normal and texture coordinate over w
+    const int MAX_LIGHTS = 8;
+    const float SPECULAR_INTENSITY = 0.2f;  // As in fragmentShaderSource
+    const float MIN_DIFFUSE = 0.2f;
+
+    std::atomic<bool> gUseSimd{ true };
+
+    // Clip space vertex and the attributes interpolated across its triangles
+    struct ClipVertex
+    {
+        glm::vec4 position;
+        float attributes[8];    // World position, normal, texture coordinate (times uvScale)
+    };
+
+    // One triangle ready to rasterize, in window coordinates (pixel centers at +0.5, y up)
+    struct Triangle
+    {
+        float edge[3][3];       // A, B, C with A x + B y + C positive inside
+        bool owns[3];           // Pixel centers exactly on the edge belong to this triangle
+        float plane[PLANES][3]; // a, b, c with value = a x + b y + c
+        int minX, minY, maxX, maxY;
+        int texture;
+    };
+
+    // The lights and camera of a frame, as the shader's uniforms
+    struct Lighting
+    {
+        int count;
+        float position[MAX_LIGHTS][3];
+        float color[MAX_LIGHTS][3];
+        float intensity[MAX_LIGHTS];
+        float highlightSize[MAX_LIGHTS];
+        float viewPosition[3];
+    };
+
+    // Keeps the part of the triangle in front of the near plane (z >= -w): none, a triangle or a quad
+    int clipNear(const ClipVertex in[3], ClipVertex out[4])
+    {
+        int count = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            const ClipVertex& a = in[k];
+            const ClipVertex& b = in[(k + 1) % 3];
+            float da = a.position.z + a.position.w;
+            float db = b.position.z + b.position.w;
+            if (da >= 0.0f)
+                out[count++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f))
+            {
+                float t = da / (da - db);
+                ClipVertex& v = out[count++];
+                v.position = a.position + (b.position - a.position) * t;
+                for (int i = 0; i < 8; i++)
+                    v.attributes[i] = a.attributes[i] + (b.attributes[i] - a.attributes[i]) * t;
+            }
+        }
+        return count;
+    }
+
+    // Projects, culls and sets up one triangle. False if nothing of it can cover a pixel center
+    bool setupTriangle(const ClipVertex* v[3], bool cullBackFaces, int width, int height, Triangle& triangle)
+    {
+        float x[3], y[3], values[3][PLANES];
+        for (int k = 0; k < 3; k++)
+        {
+            float invW = 1.0f / v[k]->position.w;
+            x[k] = (v[k]->position.x * invW * 0.5f + 0.5f) * width;
+            y[k] = (v[k]->position.y * invW * 0.5f + 0.5f) * height;
+            values[k][0] = v[k]->position.z * invW;
+            values[k][1] = invW;
+            for (int i = 0; i < 8; i++)
+                values[k][2 + i] = v[k]->attributes[i] * invW;
+        }
+        float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (area == 0.0f || (cullBackFaces && area < 0.0f))
+            return false;
+        int order[3] = { 0, 1, 2 };
+        if (area < 0.0f)
+        {
+            std::swap(order[1], order[2]);  // Seen from behind: wind it counterclockwise
+            area = -area;
+        }
+
+        // Pixel centers i + 0.5 inside the bounds, clamped before converting so huge triangles do not overflow
+        float minX = std::min({ x[0], x[1], x[2] }), maxX = std::max({ x[0], x[1], x[2] });
+        float minY = std::min({ y[0], y[1], y[2] }), maxY = std::max({ y[0], y[1], y[2] });
+        triangle.minX = std::max(0, (int)std::ceil(std::max(minX, -1.0f) - 0.5f));
+        triangle.maxX = std::min(width - 1, (int)std::floor(std::min(maxX, width + 1.0f) - 0.5f));
+        triangle.minY = std::max(0, (int)std::ceil(std::max(minY, -1.0f) - 0.5f));
+        triangle.maxY = std::min(height - 1, (int)std::floor(std::min(maxY, height + 1.0f) - 0.5f));
+        if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+            return false;
+
+        for (int k = 0; k < 3; k++)
+        {
+            int i = order[k], j = order[(k + 1) % 3];
+            float a = y[i] - y[j], b = x[j] - x[i];
+            triangle.edge[k][0] = a;
+            triangle.edge[k][1] = b;
+            triangle.edge[k][2] = -(a * x[i] + b * y[i]);
+            triangle.owns[k] = a > 0.0f || (a == 0.0f && b < 0.0f);    // The opposite edge of a neighbor never does
+        }
+        int i0 = order[0], i1 = order[1], i2 = order[2];
+        float dx1 = x[i1] - x[i0], dy1 = y[i1] - y[i0], dx2 = x[i2] - x[i0], dy2 = y[i2] - y[i0];
+        for (int p = 0; p < PLANES; p++)
+        {
+            float f0 = values[i0][p], f1 = values[i1][p] - f0, f2 = values[i2][p] - f0;
+            float a = (f1 * dy2 - f2 * dy1) / area;
+            float b = (f2 * dx1 - f1 * dx2) / area;
+            triangle.plane[p][0] = a;
+            triangle.plane[p][1] = b;
+            triangle.plane[p][2] = f0 - a * x[i0] - b * y[i0];
+        }
+        return true;
+    }
+
+    // Texel coordinate along one axis of a level, wrapped like GL_REPEAT: the texel at or left of s and the next one
+    void wrapTexel(float s, int size, int& i0, int& i1, float& weight)
+    {
+        s -= std::floor(s);
+        if (!(s >= 0.0f && s <= 1.0f))
+            s = 0.0f;   // Not a number, from a helper pixel far off the triangle
+        float x = s * size - 0.5f;
+        float fx = std::floor(x);
+        weight = x - fx;
+        i0 = fx < 0.0f ? size - 1 : (int)fx;
+        i1 = (int)fx + 1 >= size ? 0 : (int)fx + 1;
+    }
+
+    void bilinearScalar(const SoftwareTexture& texture, int level, float s, float t, float rgb[3])
+    {
+        int x0, x1, y0, y1;
+        float ax, ay;
+        int width = texture.levelWidth[level];
+        wrapTexel(s, width, x0, x1, ax);
+        wrapTexel(t, texture.levelHeight[level], y0, y1, ay);
+        const uint32_t* texels = texture.texels.data() + texture.levelOffset[level];
+        uint32_t t00 = texels[y0 * width + x0], t10 = texels[y0 * width + x1];
+        uint32_t t01 = texels[y1 * width + x0], t11 = texels[y1 * width + x1];
+        for (int c = 0; c < 3; c++)
+        {
+            int shift = 8 * c;
+            float top = ((t00 >> shift) & 0xFF) + (((t10 >> shift) & 0xFF) - (float)((t00 >> shift) & 0xFF)) * ax;
+            float bottom = ((t01 >> shift) & 0xFF) + (((t11 >> shift) & 0xFF) - (float)((t01 >> shift) & 0xFF)) * ax;
+            rgb[c] = top + (bottom - top) * ay;
+        }
+    }
+
+    // GL_LINEAR_MIPMAP_LINEAR with GL_LINEAR magnification; rgb in 0..255
+    void sampleScalar(const SoftwareTexture& texture, float s, float t, float dsdx, float dtdx, float dsdy, float dtdy, float rgb[3])
+    {
+        float width = (float)texture.levelWidth[0], height = (float)texture.levelHeight[0];
+        float rho = std::max(std::sqrt(dsdx * dsdx * width * width + dtdx * dtdx * height * height),
+            std::sqrt(dsdy * dsdy * width * width + dtdy * dtdy * height * height));
+        float lambda = std::log2(rho);
+        float d = std::min(lambda > 0.0f ? lambda : 0.0f, (float)(texture.levels - 1));
+        int level = (int)d;
+        float fraction = d - level;
+        bilinearScalar(texture, level, s, t, rgb);
+        if (fraction > 0.0f)
+        {
+            float next[3];
+            bilinearScalar(texture, std::min(level + 1, texture.levels - 1), s, t, next);
+            for (int c = 0; c < 3; c++)
+                rgb[c] += (next[c] - rgb[c]) * fraction;
+        }
+    }
+
+    // Covers, depth tests and shades the triangle's pixels in [x0, x1) x [y0, y1), 4x2 at a time. Returns pixels written
+    size_t rasterScalar(const Triangle& triangle, const SoftwareTexture& texture, const Lighting& lighting,
+        int x0, int y0, int x1, int y1, uint32_t* color, float* depth, int stride)
+    {
+        size_t written = 0;
+        int startX = std::max(triangle.minX, x0) & ~3, endX = std::min(triangle.maxX, x1 - 1);
+        int startY = std::max(triangle.minY, y0) & ~1, endY = std::min(triangle.maxY, y1 - 1);
+        for (int by = startY; by <= endY; by += 2)
+        {
+            for (int bx = startX; bx <= endX; bx += 4)
+            {
+                float px[8], py[8], z[8];
+                bool covered[8];
+                bool any = false;
+                for (int lane = 0; lane < 8; lane++)
+                {
+                    px[lane] = bx + (lane & 3) + 0.5f;
+                    py[lane] = by + (lane >> 2) + 0.5f;
+                    covered[lane] = true;
+                    for (int k = 0; k < 3; k++)
+                    {
+                        float e = std::fma(triangle.edge[k][0], px[lane], std::fma(triangle.edge[k][1], py[lane], triangle.edge[k][2]));
+                        covered[lane] = covered[lane] && (e > 0.0f || (e == 0.0f && triangle.owns[k]));
+                    }
+                    z[lane] = std::fma(triangle.plane[0][0], px[lane], std::fma(triangle.plane[0][1], py[lane], triangle.plane[0][2]));
+                    float& stored = depth[(by + (lane >> 2)) * stride + bx + (lane & 3)];
+                    covered[lane] = covered[lane] && z[lane] < stored && z[lane] <= 1.0f;
+                    any = any || covered[lane];
+                }
+                if (!any)
+                    continue;
+
+                // Attributes of every lane, as the quad derivatives need the uncovered ones too
+                float attribute[8][8];
+                for (int lane = 0; lane < 8; lane++)
+                {
+                    float w = 1.0f / std::fma(triangle.plane[1][0], px[lane], std::fma(triangle.plane[1][1], py[lane], triangle.plane[1][2]));
+                    for (int i = 0; i < 8; i++)
+                    {
+                        const float* plane = triangle.plane[2 + i];
+                        attribute[i][lane] = std::fma(plane[0], px[lane], std::fma(plane[1], py[lane], plane[2])) * w;
+                    }
+                }
+                for (int lane = 0; lane < 8; lane++)
+                {
+                    if (!covered[lane])
+                        continue;
+                    int quad = lane & 2;    // Top left lane of the 2x2 quad
+                    const float* s = attribute[6];
+                    const float* t = attribute[7];
+                    float rgb[3];
+                    sampleScalar(texture, s[lane], t[lane], s[quad + 1] - s[quad], t[quad + 1] - t[quad], s[quad + 4] - s[quad], t[quad + 4] - t[quad], rgb);
+
+                    float world[3] = { attribute[0][lane], attribute[1][lane], attribute[2][lane] };
+                    float normal[3] = { attribute[3][lane], attribute[4][lane], attribute[5][lane] };
+                    float view[3];
+                    float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                    for (int c = 0; c < 3; c++)
+                    {
+                        normal[c] /= normalLength;
+                        view[c] = lighting.viewPosition[c] - world[c];
+                    }
+                    float viewLength = std::sqrt(view[0] * view[0] + view[1] * view[1] + view[2] * view[2]);
+                    for (int c = 0; c < 3; c++)
+                        view[c] /= viewLength;
+
+                    float sum[3] = {};
+                    for (int l = 0; l < lighting.count; l++)
+                    {
+                        float light[3];
+                        for (int c = 0; c < 3; c++)
+                            light[c] = lighting.position[l][c] - world[c];
+                        float lightLength = std::sqrt(light[0] * light[0] + light[1] * light[1] + light[2] * light[2]);
+                        for (int c = 0; c < 3; c++)
+                            light[c] /= lightLength;
+                        float nDotL = normal[0] * light[0] + normal[1] * light[1] + normal[2] * light[2];
+                        float vDotR = 0.0f;     // R = reflect(-light, normal)
+                        for (int c = 0; c < 3; c++)
+                            vDotR += view[c] * (2.0f * nDotL * normal[c] - light[c]);
+                        float specular = SPECULAR_INTENSITY * std::pow(std::max(vDotR, 0.0f), lighting.highlightSize[l]);
+                        float phong = lighting.intensity[l] + std::max(nDotL, MIN_DIFFUSE) + specular;
+                        for (int c = 0; c < 3; c++)
+                            sum[c] += phong * lighting.color[l][c];
+                    }
+                    uint32_t pixel = 0xFF000000u;
+                    for (int c = 0; c < 3; c++)
+                    {
+                        float value = std::min(std::max(sum[c] * rgb[c] / 255.0f, 0.0f), 1.0f);
+                        pixel |= (uint32_t)std::lrint(value * 255.0f) << (8 * c);
+                    }
+                    int index = (by + (lane >> 2)) * stride + bx + (lane & 3);
+                    color[index] = pixel;
+                    depth[index] = z[lane];
+                    written++;
+                }
+            }
+        }
+        return written;
+    }
+
+#ifdef SOFTWARE_RENDERER_AVX2
+    // log2 of 8 positive floats: exponent plus a polynomial in the mantissa (cephes logf), accurate to about 1e-7
+    AVX2_FUNCTION inline __m256 log2Avx2(__m256 x)
+    {
+        __m256i bits = _mm256_castps_si256(x);
+        __m256 exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+        __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000)));
+        __m256 high = _mm256_cmp_ps(m, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+        m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), high);     // Mantissa in [0.71, 1.41]
+        exponent = _mm256_add_ps(exponent, _mm256_and_ps(high, _mm256_set1_ps(1.0f)));
+        __m256 f = _mm256_sub_ps(m, _mm256_set1_ps(1.0f));
+        __m256 z = _mm256_mul_ps(f, f);
+        __m256 y = _mm256_set1_ps(7.0376836292e-2f);
+        y = _mm256_fmadd_ps(y, f, _mm256_set1_ps(-1.1514610310e-1f));
+        y = _mm256_fmadd_ps(y, f, _mm256_set1_ps(1.1676998740e-1f));
+        y = _mm256_fmadd_ps(y, f, _mm256_set1_ps(-1.2420140846e-1f));
+        y = _mm256_fmadd_ps(y, f, _mm256_set1_ps(1.4249322787e-1f));
+        y = _mm256_fmadd_ps(y, f, _mm256_set1_ps(-1.6668057665e-1f));
+        y = _mm256_fmadd_ps(y, f, _mm256_set1_ps(2.0000714765e-1f));
+        y = _mm256_fmadd_ps(y, f, _mm256_set1_ps(-2.4999993993e-1f));
+        y = _mm256_fmadd_ps(y, f, _mm256_set1_ps(3.3333331174e-1f));
+        y = _mm256_mul_ps(_mm256_mul_ps(y, f), z);
+        y = _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, y);
+        __m256 ln = _mm256_add_ps(f, y);
+        return _mm256_fmadd_ps(ln, _mm256_set1_ps(1.44269504f), exponent);
+    }
+
+    // 2^x of 8 floats (cephes exp2f), flushed to the smallest normal below -126
+    AVX2_FUNCTION inline __m256 exp2Avx2(__m256 x)
+    {
+        x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-126.0f)), _mm256_set1_ps(127.0f));
+        __m256 whole = _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256 f = _mm256_sub_ps(x, whole);
+        __m256 p = _mm256_set1_ps(1.535336188319500e-4f);
+        p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.339887440266574e-3f));
+        p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(9.618437357674640e-3f));
+        p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(5.550332471162809e-2f));
+        p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(2.402264791363012e-1f));
+        p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(6.931472028550421e-1f));
+        p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.0f));
+        __m256i scale = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(whole), _mm256_set1_epi32(127)), 23);
+        return _mm256_mul_ps(p, _mm256_castsi256_ps(scale));
+    }
+
+    // Difference across each 2x2 quad of a 4x2 block (lanes 0-3 the lower row), given to all four of its lanes
+    AVX2_FUNCTION inline __m256 quadDx(__m256 v)
+    {
+        return _mm256_sub_ps(_mm256_permutevar8x32_ps(v, _mm256_setr_epi32(1, 1, 3, 3, 1, 1, 3, 3)),
+            _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(0, 0, 2, 2, 0, 0, 2, 2)));
+    }
+
+    AVX2_FUNCTION inline __m256 quadDy(__m256 v)
+    {
+        return _mm256_sub_ps(_mm256_permutevar8x32_ps(v, _mm256_setr_epi32(4, 4, 6, 6, 4, 4, 6, 6)),
+            _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(0, 0, 2, 2, 0, 0, 2, 2)));
+    }
+
+    // wrapTexel for 8 lanes
+    AVX2_FUNCTION inline void wrapTexelAvx2(__m256 s, __m256i size, __m256i& i0, __m256i& i1, __m256& weight)
+    {
+        s = _mm256_sub_ps(s, _mm256_floor_ps(s));
+        s = _mm256_and_ps(s, _mm256_cmp_ps(s, s, _CMP_ORD_Q));     // Not a number -> 0
+        __m256 x = _mm256_fmsub_ps(s, _mm256_cvtepi32_ps(size), _mm256_set1_ps(0.5f));
+        __m256 fx = _mm256_floor_ps(x);
+        weight = _mm256_sub_ps(x, fx);
+        __m256i left = _mm256_cvttps_epi32(fx);
+        __m256i right = _mm256_add_epi32(left, _mm256_set1_epi32(1));
+        i0 = _mm256_blendv_epi8(left, _mm256_sub_epi32(size, _mm256_set1_epi32(1)), _mm256_cmpgt_epi32(_mm256_setzero_si256(), left));
+        i1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(right, size), right);
+    }
+
+    AVX2_FUNCTION inline void unpackAvx2(__m256i texel, __m256& r, __m256& g, __m256& b)
+    {
+        __m256i byte = _mm256_set1_epi32(0xFF);
+        r = _mm256_cvtepi32_ps(_mm256_and_si256(texel, byte));
+        g = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texel, 8), byte));
+        b = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texel, 16), byte));
+    }
+
+    AVX2_FUNCTION inline __m256 lerpAvx2(__m256 a, __m256 b, __m256 t)
+    {
+        return _mm256_fmadd_ps(_mm256_sub_ps(b, a), t, a);
+    }
+
+    // bilinearScalar for 8 lanes, each from its own level
+    AVX2_FUNCTION void bilinearAvx2(const SoftwareTexture& texture, __m256i level, __m256 s, __m256 t, __m256& r, __m256& g, __m256& b)
+    {
+        __m256i width = _mm256_i32gather_epi32(texture.levelWidth, level, 4);
+        __m256i height = _mm256_i32gather_epi32(texture.levelHeight, level, 4);
+        __m256i offset = _mm256_i32gather_epi32(texture.levelOffset, level, 4);
+        __m256i x0, x1, y0, y1;
+        __m256 ax, ay;
+        wrapTexelAvx2(s, width, x0, x1, ax);
+        wrapTexelAvx2(t, height, y0, y1, ay);
+        __m256i row0 = _mm256_add_epi32(offset, _mm256_mullo_epi32(y0, width));
+        __m256i row1 = _mm256_add_epi32(offset, _mm256_mullo_epi32(y1, width));
+        const int* texels = (const int*)texture.texels.data();
+        __m256 r00, g00, b00, r10, g10, b10, r01, g01, b01, r11, g11, b11;
+        unpackAvx2(_mm256_i32gather_epi32(texels, _mm256_add_epi32(row0, x0), 4), r00, g00, b00);
+        unpackAvx2(_mm256_i32gather_epi32(texels, _mm256_add_epi32(row0, x1), 4), r10, g10, b10);
+        unpackAvx2(_mm256_i32gather_epi32(texels, _mm256_add_epi32(row1, x0), 4), r01, g01, b01);
+        unpackAvx2(_mm256_i32gather_epi32(texels, _mm256_add_epi32(row1, x1), 4), r11, g11, b11);
+        r = lerpAvx2(lerpAvx2(r00, r10, ax), lerpAvx2(r01, r11, ax), ay);
+        g = lerpAvx2(lerpAvx2(g00, g10, ax), lerpAvx2(g01, g11, ax), ay);
+        b = lerpAvx2(lerpAvx2(b00, b10, ax), lerpAvx2(b01, b11, ax), ay);
+    }
+
+    AVX2_FUNCTION inline __m256 planeAvx2(const float plane[3], __m256 x, __m256 y)
+    {
+        return _mm256_fmadd_ps(_mm256_set1_ps(plane[0]), x, _mm256_fmadd_ps(_mm256_set1_ps(plane[1]), y, _mm256_set1_ps(plane[2])));
+    }
+
+    AVX2_FUNCTION inline __m256 rsqrtAvx2(__m256 x)
+    {
+        return _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(x));
+    }
+
+    // rasterScalar with one pixel of the 4x2 block per lane
+    AVX2_FUNCTION size_t rasterAvx2(const Triangle& triangle, const SoftwareTexture& texture, const Lighting& lighting,
+        int x0, int y0, int x1, int y1, uint32_t* color, float* depth, int stride)
+    {
+        size_t written = 0;
+        int startX = std::max(triangle.minX, x0) & ~3, endX = std::min(triangle.maxX, x1 - 1);
+        int startY = std::max(triangle.minY, y0) & ~1, endY = std::min(triangle.maxY, y1 - 1);
+        const __m256 laneX = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 0.5f, 1.5f, 2.5f, 3.5f);
+        const __m256 laneY = _mm256_setr_ps(0.5f, 0.5f, 0.5f, 0.5f, 1.5f, 1.5f, 1.5f, 1.5f);
+        const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+        __m256 owns[3];
+        for (int k = 0; k < 3; k++)
+            owns[k] = _mm256_castsi256_ps(_mm256_set1_epi32(triangle.owns[k] ? -1 : 0));
+        const __m256 levelLimit = _mm256_set1_ps((float)(texture.levels - 1));
+        const __m256i lastLevel = _mm256_set1_epi32(texture.levels - 1);
+        const float textureWidth = (float)texture.levelWidth[0], textureHeight = (float)texture.levelHeight[0];
+
+        for (int by = startY; by <= endY; by += 2)
+        {
+            __m256 py = _mm256_add_ps(_mm256_set1_ps((float)by), laneY);
+            for (int bx = startX; bx <= endX; bx += 4)
+            {
+                __m256 px = _mm256_add_ps(_mm256_set1_ps((float)bx), laneX);
+                __m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (int k = 0; k < 3; k++)
+                {
+                    __m256 e = planeAvx2(triangle.edge[k], px, py);
+                    __m256 inside = _mm256_or_ps(_mm256_cmp_ps(e, zero, _CMP_GT_OQ), _mm256_and_ps(_mm256_cmp_ps(e, zero, _CMP_EQ_OQ), owns[k]));
+                    mask = _mm256_and_ps(mask, inside);
+                }
+                float* depthRow0 = depth + by * stride + bx;
+                float* depthRow1 = depthRow0 + stride;
+                __m256 stored = _mm256_set_m128(_mm_loadu_ps(depthRow1), _mm_loadu_ps(depthRow0));
+                __m256 z = planeAvx2(triangle.plane[0], px, py);
+                mask = _mm256_and_ps(mask, _mm256_and_ps(_mm256_cmp_ps(z, stored, _CMP_LT_OQ), _mm256_cmp_ps(z, one, _CMP_LE_OQ)));
+                int bits = _mm256_movemask_ps(mask);
+                if (bits == 0)
+                    continue;
+
+                // Perspective correct attributes of every lane; uncovered ones feed the quad derivatives
+                __m256 w = _mm256_div_ps(one, planeAvx2(triangle.plane[1], px, py));
+                __m256 wx = _mm256_mul_ps(planeAvx2(triangle.plane[2], px, py), w);
+                __m256 wy = _mm256_mul_ps(planeAvx2(triangle.plane[3], px, py), w);
+                __m256 wz = _mm256_mul_ps(planeAvx2(triangle.plane[4], px, py), w);
+                __m256 nx = _mm256_mul_ps(planeAvx2(triangle.plane[5], px, py), w);
+                __m256 ny = _mm256_mul_ps(planeAvx2(triangle.plane[6], px, py), w);
+                __m256 nz = _mm256_mul_ps(planeAvx2(triangle.plane[7], px, py), w);
+                __m256 s = _mm256_mul_ps(planeAvx2(triangle.plane[8], px, py), w);
+                __m256 t = _mm256_mul_ps(planeAvx2(triangle.plane[9], px, py), w);
+
+                // Level of detail from the quad's texture coordinate derivatives, then two bilinear levels
+                __m256 dsdx = _mm256_mul_ps(quadDx(s), _mm256_set1_ps(textureWidth)), dtdx = _mm256_mul_ps(quadDx(t), _mm256_set1_ps(textureHeight));
+                __m256 dsdy = _mm256_mul_ps(quadDy(s), _mm256_set1_ps(textureWidth)), dtdy = _mm256_mul_ps(quadDy(t), _mm256_set1_ps(textureHeight));
+                __m256 rho = _mm256_max_ps(_mm256_sqrt_ps(_mm256_fmadd_ps(dsdx, dsdx, _mm256_mul_ps(dtdx, dtdx))),
+                    _mm256_sqrt_ps(_mm256_fmadd_ps(dsdy, dsdy, _mm256_mul_ps(dtdy, dtdy))));
+                __m256 d = _mm256_min_ps(_mm256_max_ps(log2Avx2(rho), zero), levelLimit);    // max() turns a NaN into 0
+                __m256 level = _mm256_floor_ps(d);
+                __m256 fraction = _mm256_sub_ps(d, level);
+                __m256i level0 = _mm256_cvttps_epi32(level);
+                __m256 tr, tg, tb;
+                bilinearAvx2(texture, level0, s, t, tr, tg, tb);
+                if (_mm256_movemask_ps(_mm256_and_ps(mask, _mm256_cmp_ps(fraction, zero, _CMP_GT_OQ))) != 0)
+                {
+                    __m256 r1, g1, b1;
+                    bilinearAvx2(texture, _mm256_min_epi32(_mm256_add_epi32(level0, _mm256_set1_epi32(1)), lastLevel), s, t, r1, g1, b1);
+                    tr = lerpAvx2(tr, r1, fraction);
+                    tg = lerpAvx2(tg, g1, fraction);
+                    tb = lerpAvx2(tb, b1, fraction);
+                }
+
+                // Phong: every light adds (ambient + diffuse + specular) x light color
+                __m256 inverse = rsqrtAvx2(_mm256_fmadd_ps(nx, nx, _mm256_fmadd_ps(ny, ny, _mm256_mul_ps(nz, nz))));
+                nx = _mm256_mul_ps(nx, inverse);
+                ny = _mm256_mul_ps(ny, inverse);
+                nz = _mm256_mul_ps(nz, inverse);
+                __m256 vx = _mm256_sub_ps(_mm256_set1_ps(lighting.viewPosition[0]), wx);
+                __m256 vy = _mm256_sub_ps(_mm256_set1_ps(lighting.viewPosition[1]), wy);
+                __m256 vz = _mm256_sub_ps(_mm256_set1_ps(lighting.viewPosition[2]), wz);
+                inverse = rsqrtAvx2(_mm256_fmadd_ps(vx, vx, _mm256_fmadd_ps(vy, vy, _mm256_mul_ps(vz, vz))));
+                vx = _mm256_mul_ps(vx, inverse);
+                vy = _mm256_mul_ps(vy, inverse);
+                vz = _mm256_mul_ps(vz, inverse);
+                __m256 sumR = zero, sumG = zero, sumB = zero;
+                for (int l = 0; l < lighting.count; l++)
+                {
+                    __m256 lx = _mm256_sub_ps(_mm256_set1_ps(lighting.position[l][0]), wx);
+                    __m256 ly = _mm256_sub_ps(_mm256_set1_ps(lighting.position[l][1]), wy);
+                    __m256 lz = _mm256_sub_ps(_mm256_set1_ps(lighting.position[l][2]), wz);
+                    inverse = rsqrtAvx2(_mm256_fmadd_ps(lx, lx, _mm256_fmadd_ps(ly, ly, _mm256_mul_ps(lz, lz))));
+                    lx = _mm256_mul_ps(lx, inverse);
+                    ly = _mm256_mul_ps(ly, inverse);
+                    lz = _mm256_mul_ps(lz, inverse);
+                    __m256 nDotL = _mm256_fmadd_ps(nx, lx, _mm256_fmadd_ps(ny, ly, _mm256_mul_ps(nz, lz)));
+                    __m256 twice = _mm256_add_ps(nDotL, nDotL);
+                    __m256 vDotR = _mm256_fmadd_ps(vx, _mm256_fmsub_ps(twice, nx, lx),
+                        _mm256_fmadd_ps(vy, _mm256_fmsub_ps(twice, ny, ly), _mm256_mul_ps(vz, _mm256_fmsub_ps(twice, nz, lz))));
+                    __m256 specular = exp2Avx2(_mm256_mul_ps(log2Avx2(_mm256_max_ps(vDotR, zero)), _mm256_set1_ps(lighting.highlightSize[l])));
+                    __m256 phong = _mm256_add_ps(_mm256_add_ps(_mm256_set1_ps(lighting.intensity[l]), _mm256_max_ps(nDotL, _mm256_set1_ps(MIN_DIFFUSE))),
+                        _mm256_mul_ps(specular, _mm256_set1_ps(SPECULAR_INTENSITY)));
+                    sumR = _mm256_fmadd_ps(phong, _mm256_set1_ps(lighting.color[l][0]), sumR);
+                    sumG = _mm256_fmadd_ps(phong, _mm256_set1_ps(lighting.color[l][1]), sumG);
+                    sumB = _mm256_fmadd_ps(phong, _mm256_set1_ps(lighting.color[l][2]), sumB);
+                }
+
+                // Texture 0..255 times light, clamped like a UNORM8 target
+                __m256 limit = _mm256_set1_ps(255.0f);
+                __m256i r = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(sumR, tr), zero), limit));
+                __m256i g = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(sumG, tg), zero), limit));
+                __m256i b = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(sumB, tb), zero), limit));
+                __m256i pixel = _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)),
+                    _mm256_or_si256(_mm256_slli_epi32(b, 16), _mm256_set1_epi32((int)0xFF000000u)));
+
+                uint32_t* colorRow0 = color + by * stride + bx;
+                uint32_t* colorRow1 = colorRow0 + stride;
+                __m256i old = _mm256_set_m128i(_mm_loadu_si128((const __m128i*)colorRow1), _mm_loadu_si128((const __m128i*)colorRow0));
+                pixel = _mm256_blendv_epi8(old, pixel, _mm256_castps_si256(mask));
+                z = _mm256_blendv_ps(stored, z, mask);
+                _mm_storeu_si128((__m128i*)colorRow0, _mm256_castsi256_si128(pixel));
+                _mm_storeu_si128((__m128i*)colorRow1, _mm256_extracti128_si256(pixel, 1));
+                _mm_storeu_ps(depthRow0, _mm256_castps256_ps128(z));
+                _mm_storeu_ps(depthRow1, _mm256_extractf128_ps(z, 1));
+                written += (size_t)_mm_popcnt_u32((unsigned)bits);
+            }
+        }
+        return written;
+    }
+#endif
+}
+
+// The work of one frame, shared by its jobs
+struct SoftwareRenderer::Frame
+{
+    const SoftwareScene* scene;
+    glm::mat4 viewProjection;
+    Lighting lighting;
+    bool simd;
+    std::vector<std::pair<size_t, size_t>> work;    // Object and first triangle of each geometry job
+};
+
+struct SoftwareRenderer::Chunk
+{
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<uint32_t>> bins;        // Triangles overlapping each tile, in draw order
+    size_t submitted = 0;
+};
+
+SoftwareRenderer::SoftwareRenderer(int width, int height, ThreadPool* pool)
+    : frameWidth(width), frameHeight(height), stride((width + 3) & ~3),
+    tilesX((width + TILE_SIZE - 1) / TILE_SIZE), tilesY((height + TILE_SIZE - 1) / TILE_SIZE), pool(pool) {
+    size_t rows = (size_t)((height + 1) & ~1);
+    color.assign(rows * stride, 0xFF000000u);
+    depth.assign(rows * stride, 1.0f);
+    tileFragments.assign((size_t)tilesX * tilesY, 0);
+}
+
+SoftwareRenderer::~SoftwareRenderer() = default;
+
+void SoftwareRenderer::render(const SoftwareScene& scene, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPosition) {
+    auto start = std::chrono::steady_clock::now();
+    Frame frame;
+    frame.scene = &scene;
+    frame.viewProjection = projection * view;
+    frame.simd = gUseSimd && simdAvailable();
+    frame.lighting.count = std::min((int)scene.lights.size(), MAX_LIGHTS);
+    for (int l = 0; l < frame.lighting.count; l++)
+    {
+        const SoftwareLight& light = scene.lights[l];
+        for (int c = 0; c < 3; c++)
+        {
+            frame.lighting.position[l][c] = light.position[c];
+            frame.lighting.color[l][c] = light.color[c];
+        }
+        frame.lighting.intensity[l] = light.intensity;
+        frame.lighting.highlightSize[l] = light.highlightSize;
+    }
+    for (int c = 0; c < 3; c++)
+        frame.lighting.viewPosition[c] = viewPosition[c];
+
+    // Geometry: every object's triangles in jobs of CHUNK_TRIANGLES, each binning into its own lists
+    for (size_t o = 0; o < scene.objects.size(); o++)
+    {
+        size_t triangles = scene.meshes[scene.objects[o].mesh].vertices.size() / (3 * FLOATS_PER_VERTEX);
+        for (size_t first = 0; first < triangles; first += CHUNK_TRIANGLES)
+            frame.work.push_back({ o, first });
+    }
+    if (chunks.size() < frame.work.size())
+        chunks.resize(frame.work.size());
+    run(frame.work.size(), [&](size_t index) { setupChunk(frame, index); });
+    auto binned = std::chrono::steady_clock::now();
+
+    // Raster: tiles go to whichever thread is free, as their cost varies with what covers them
+    run(tileFragments.size(), [&](size_t tile) { rasterTile(frame, tile); });
+
+    frameStats = SoftwareFrameStats();
+    for (size_t c = 0; c < frame.work.size(); c++)
+    {
+        frameStats.triangles += chunks[c].submitted;
+        frameStats.binned += chunks[c].triangles.size();
+    }
+    for (size_t fragments : tileFragments)
+        frameStats.fragments += fragments;
+    auto end = std::chrono::steady_clock::now();
+    frameStats.geometryMs = std::chrono::duration<double, std::milli>(binned - start).count();
+    frameStats.rasterMs = std::chrono::duration<double, std::milli>(end - binned).count();
+}
+
+void SoftwareRenderer::readPixels(std::vector<uint8_t>& rgba) const {
+    rgba.resize((size_t)frameWidth * frameHeight * 4);
+    for (int y = 0; y < frameHeight; y++)
+        std::memcpy(&rgba[(size_t)y * frameWidth * 4], &color[(size_t)y * stride], (size_t)frameWidth * 4);
+}
+
+void SoftwareRenderer::makeTexture(const uint8_t* rgba, uint32_t width, uint32_t height, SoftwareTexture& texture) {
+    size_t levelTexels = (size_t)width * height;
+    texture.texels.resize(levelTexels + ImageTools::mipChainBytes(width, height, 4) / 4);
+    std::memcpy(texture.texels.data(), rgba, levelTexels * 4);
+    ImageTools::buildMipChain(rgba, width, height, 4, MipFilter::Box, true, nullptr, (uint8_t*)(texture.texels.data() + levelTexels));
+    texture.levels = std::min(ImageTools::mipLevelCount(width, height), SOFTWARE_MAX_LEVELS);
+    int32_t offset = 0;
+    for (int level = 0; level < texture.levels; level++)
+    {
+        texture.levelWidth[level] = (int32_t)width;
+        texture.levelHeight[level] = (int32_t)height;
+        texture.levelOffset[level] = offset;
+        offset += (int32_t)(width * height);
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+    }
+}
+
+void SoftwareRenderer::setSimd(bool enabled) {
+    gUseSimd = enabled;
+}
+
+bool SoftwareRenderer::simdAvailable() {
+#if defined(SOFTWARE_RENDERER_AVX2) && defined(__GNUC__)
+    static const bool available = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return available;
+#elif defined(SOFTWARE_RENDERER_AVX2)
+    static const bool available = [] {
+        int info[4];
+        __cpuid(info, 1);
+        bool fma = (info[2] & (1 << 12)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        __cpuidex(info, 7, 0);
+        bool avx2 = (info[1] & (1 << 5)) != 0;
+        return fma && avx2 && osxsave && (_xgetbv(0) & 6) == 6;   // The OS saves the YMM registers too
+    }();
+    return available;
+#else
+    return false;
+#endif
+}
+
+void SoftwareRenderer::run(size_t count, const std::function<void(size_t)>& body) {
+    if (!pool || pool->size() < 2 || count < 2)
+    {
+        for (size_t i = 0; i < count; i++)
+            body(i);
+        return;
+    }
+    std::atomic<size_t> next{ 0 };
+    std::vector<std::future<void>> pending;
+    for (unsigned worker = 0; worker < pool->size(); worker++)
+    {
+        pending.push_back(pool->submit([&] {
+            for (size_t i = next++; i < count; i = next++)
+                body(i);
+        }));
+    }
+    for (std::future<void>& job : pending)
+        job.get();
+}
+
+void SoftwareRenderer::setupChunk(const Frame& frame, size_t index) {
+    Chunk& chunk = chunks[index];
+    chunk.triangles.clear();
+    chunk.bins.resize(tileFragments.size());
+    for (std::vector<uint32_t>& bin : chunk.bins)
+        bin.clear();
+
+    const SoftwareScene& scene = *frame.scene;
+    const SoftwareObject& object = scene.objects[frame.work[index].first];
+    const std::vector<float>& vertices = scene.meshes[object.mesh].vertices;
+    size_t first = frame.work[index].second;
+    chunk.submitted = std::min(CHUNK_TRIANGLES, vertices.size() / (3 * FLOATS_PER_VERTEX) - first);
+    glm::mat4 clip = frame.viewProjection * object.model;
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(object.model)));    // As the vertex shader
+
+    for (size_t t = first; t < first + chunk.submitted; t++)
+    {
+        ClipVertex corners[3];
+        for (int k = 0; k < 3; k++)
+        {
+            const float* v = &vertices[(t * 3 + k) * FLOATS_PER_VERTEX];
+            glm::vec4 position(v[0], v[1], v[2], 1.0f);
+            glm::vec4 world = object.model * position;
+            glm::vec3 normal = normalMatrix * glm::vec3(v[3], v[4], v[5]);
+            corners[k].position = clip * position;
+            float* attributes = corners[k].attributes;
+            attributes[0] = world.x;
+            attributes[1] = world.y;
+            attributes[2] = world.z;
+            attributes[3] = normal.x;
+            attributes[4] = normal.y;
+            attributes[5] = normal.z;
+            attributes[6] = v[6] * scene.uvScale.x;
+            attributes[7] = v[7] * scene.uvScale.y;
+        }
+        ClipVertex polygon[4];
+        int count = clipNear(corners, polygon);
+        for (int k = 1; k + 1 < count; k++)
+        {
+            const ClipVertex* fan[3] = { &polygon[0], &polygon[k], &polygon[k + 1] };
+            Triangle triangle;
+            if (!setupTriangle(fan, object.cullBackFaces, frameWidth, frameHeight, triangle))
+                continue;
+            triangle.texture = object.texture;
+            uint32_t number = (uint32_t)chunk.triangles.size();
+            chunk.triangles.push_back(triangle);
+            for (int ty = triangle.minY / TILE_SIZE; ty <= triangle.maxY / TILE_SIZE; ty++)
+                for (int tx = triangle.minX / TILE_SIZE; tx <= triangle.maxX / TILE_SIZE; tx++)
+                    chunk.bins[(size_t)ty * tilesX + tx].push_back(number);
+        }
+    }
+}
+
+void SoftwareRenderer::rasterTile(const Frame& frame, size_t tile) {
+    // The tile's pixels, padded out to whole 4x2 blocks
+    int x0 = (int)(tile % tilesX) * TILE_SIZE, y0 = (int)(tile / tilesX) * TILE_SIZE;
+    int x1 = std::min(x0 + TILE_SIZE, stride), y1 = std::min(y0 + TILE_SIZE, (frameHeight + 1) & ~1);
+    for (int y = y0; y < y1; y++)
+    {
+        std::fill(&color[(size_t)y * stride + x0], &color[(size_t)y * stride + x1], 0xFF000000u);
+        std::fill(&depth[(size_t)y * stride + x0], &depth[(size_t)y * stride + x1], 1.0f);
+    }
+
+    size_t fragments = 0;
+    for (size_t c = 0; c < frame.work.size(); c++)
+    {
+        const Chunk& chunk = chunks[c];
+        for (uint32_t number : chunk.bins[tile])
+        {
+            const Triangle& triangle = chunk.triangles[number];
+            const SoftwareTexture& texture = frame.scene->textures[triangle.texture];
+#ifdef SOFTWARE_RENDERER_AVX2
+            if (frame.simd)
+            {
+                fragments += rasterAvx2(triangle, texture, frame.lighting, x0, y0, x1, y1, color.data(), depth.data(), stride);
+                continue;
+            }
+#endif
+            fragments += rasterScalar(triangle, texture, frame.lighting, x0, y0, x1, y1, color.data(), depth.data(), stride);
+        }
+    }
+    tileFragments[tile] = fragments;
+}
@@ -0,0 +1,113 @@
+#pragma once
+# include <cstddef>
+# include <cstdint>
+# include <functional>
+# include <vector>
+# include <glm/glm.hpp>
+
+class ThreadPool;
+
+const int SOFTWARE_MAX_LEVELS = 16;		// Mip levels a SoftwareTexture can hold (32768 texels across)
+
+// Texture of the software renderer: RGBA8 texels of every mip level back to back, sampled like GL_REPEAT with GL_LINEAR_MIPMAP_LINEAR
+struct SoftwareTexture
+{
+	int levels = 0;
+	int32_t levelWidth[SOFTWARE_MAX_LEVELS] = {};
+	int32_t levelHeight[SOFTWARE_MAX_LEVELS] = {};
+	int32_t levelOffset[SOFTWARE_MAX_LEVELS] = {};	// First texel of each level
+	std::vector<uint32_t> texels;		// R in the low byte
+};
+
+// Triangles as the GL path draws them: 8 floats per vertex (position, normal, texture coordinate), 3 vertices each
+struct SoftwareMesh
+{
+	std::vector<float> vertices;
+};
+
+struct SoftwareObject
+{
+	int mesh;
+	int texture;
+	glm::mat4 model;
+	bool cullBackFaces;		// Counterclockwise triangles face the viewer, like glCullFace(GL_BACK)
+};
+
+// Point light of the Phong model in fragmentShaderSource
+struct SoftwareLight
+{
+	glm::vec3 position;
+	glm::vec3 color;
+	float intensity;
+	float highlightSize;
+	float radius = 0.0f;	// Size of the lamp, for the soft shadows of the path tracer
+};
+
+struct SoftwareScene
+{
+	std::vector<SoftwareMesh> meshes;
+	std::vector<SoftwareTexture> textures;
+	std::vector<SoftwareObject> objects;		// In draw order
+	std::vector<SoftwareLight> lights;
+	glm::vec2 uvScale = glm::vec2(1.0f);
+};
+
+// Work and time of the last frame
+struct SoftwareFrameStats
+{
+	double geometryMs = 0.0;	// Transforming, clipping, culling and binning
+	double rasterMs = 0.0;		// Rasterizing and shading the tiles
+	size_t triangles = 0;		// Submitted
+	size_t binned = 0;			// Left after clipping and culling
+	size_t fragments = 0;		// Shaded pixels that passed the depth test
+};
+
+/* Class to draw the Phong scene on the CPU, for machines without a GPU. Triangles are transformed, clipped against the
+near plane, culled and binned into 64x64 pixel tiles in chunks on the pool; then each tile is rasterized and shaded
+by whichever thread takes it, its triangles in draw order. Pixels are covered, depth tested and shaded 4x2 at a time,
+one AVX2 lane each when the CPU has it: edge functions, perspective correct attributes, trilinear texture sampling
+with derivatives from each 2x2 quad like a GPU, and the five-light Phong model of fragmentShaderSource*/
+class SoftwareRenderer
+{
+public:
+	SoftwareRenderer(int width, int height, ThreadPool* pool = nullptr);
+	~SoftwareRenderer();
+
+	SoftwareRenderer(const SoftwareRenderer&) = delete;
+	SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+
+	// Clears to black and draws the scene. viewPosition is the camera's, for specular highlights
+	void render(const SoftwareScene& scene, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPosition);
+
+	// Copies the last frame out as RGBA8, rows bottom to top like glReadPixels
+	void readPixels(std::vector<uint8_t>& rgba) const;
+
+	int width() const { return frameWidth; }
+	int height() const { return frameHeight; }
+	const SoftwareFrameStats& stats() const { return frameStats; }
+
+	// Builds a texture and its mip chain (box filtered in linear light, like the GL path's) from RGBA8 pixels
+	static void makeTexture(const uint8_t* rgba, uint32_t width, uint32_t height, SoftwareTexture& texture);
+
+	// Switch between the AVX2 and scalar kernels (used by the benchmark)
+	static void setSimd(bool enabled);
+	static bool simdAvailable();	// This CPU has AVX2 and FMA
+
+private:
+	struct Chunk;
+	struct Frame;
+
+	void run(size_t count, const std::function<void(size_t)>& body);	// body(0 .. count-1) spread over the pool
+	void setupChunk(const Frame& frame, size_t index);
+	void rasterTile(const Frame& frame, size_t tile);
+
+	const int frameWidth, frameHeight;
+	const int stride;				// Pixels per row of the buffers, a multiple of 4 (rows come in pairs too)
+	const int tilesX, tilesY;
+	ThreadPool* const pool;
+	std::vector<uint32_t> color;
+	std::vector<float> depth;		// Normalized device z
+	std::vector<Chunk> chunks;		// Triangles set up by one geometry job, binned per tile
+	std::vector<size_t> tileFragments;
+	SoftwareFrameStats frameStats;
+};
@@ -3,17 +3,54 @@
 #include <GL/glew.h>        // GLEW library
 #include <GLFW/glfw3.h>     // GLFW library
 #include <string>
+#include <span>
+#include <chrono>         // Startup timing
+#include <memory>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <cctype>
+#include <cstdio>           // sscanf
+#include <charconv>         // from_chars
+#include <cstring>
 
 // GLM Libraries
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-// STB Library to load an image
+// STB Library to load an image. Allocations go through TextureLoader so images can be decoded into mapped pixel buffers
+#include "TextureLoader.h" // Concurrent image decoding
+#define STBI_MALLOC(size) TextureLoader::decodeMalloc(size)
+#define STBI_REALLOC(pointer, size) TextureLoader::decodeRealloc(pointer, size)
+#define STBI_FREE(pointer) TextureLoader::decodeFree(pointer)
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 #include "Coordinates.h"  // Class to hold/retrieve object coordinates
+#include "MeshTools.h"    // Class to validate vertex data before upload
+#include "MeshFile.h"     // Binary, memory mappable mesh container
+#include "MeshImporter.h" // OBJ/glTF model importer
+#include "ThreadPool.h"   // Worker threads for loading
+#include "TextureCompressor.h" // BC1/BC3/BC7 block compression
+#include "ImageTools.h"   // CPU mip chains
+#include "PixelBufferPool.h" // Mapped upload buffers
+#include "TextureResidency.h" // Mip levels kept in video memory
+#include "KtxFile.h"      // Baked texture container
+#include "JpegDecoder.h"  // Restart markers for parallel decoding
+#include "AssetPack.h"    // Single-file mapped assets
+#include "AssetReader.h"  // Batched file reads
+#include "ProcessedCache.h" // Decoded textures kept between runs
+#include "Benchmarks.h"   // Command-line benchmarks
+#include "AssetTools.h"   // Command-line asset tools
+#include "HeadlessContext.h" // Offscreen EGL rendering
+#include "SoftwareRenderer.h" // CPU rasterizer for machines without a GPU
+#include "PathTracer.h"   // Reference images for lighting changes
+#include "PngFile.h"      // PNG output
+#include "GoldenImages.h" // Golden image checks
+#include "FrameSequence.h" // Offline frame sequences
+#include "HeapCounter.h"  // Startup memory use
 #include "camera.h" // Camera class file originated from website LearnOpenGL.com
 
 /*
@@ -27,6 +64,60 @@ This program uses the following keys to navigate the camera in a 3D scene:
 
             **Scrolling the mouse change camera speed**
 
+Command-line options:
+
+    --export-meshes <file>  : Write the built-in meshes to a binary mesh file and exit
+    --meshes <file>         : Load geometry from a binary mesh file instead of Coordinates
+    --pack <file>           : Load textures from an asset pack (mapped and prefetched) instead of the loose image files
+    --pack-assets <file>    : Write every texture into an asset pack and exit. Fails without writing it if any texture is
+                              missing, so it can run as a build step
+    --import <file> <slot>  : Replace a mesh slot (e.g. "donut") with an OBJ or .glb model
+    --bench-import [tris]   : Report OBJ/glTF import throughput on generated files and exit
+    --tessellation <n>      : Segments for the procedural donut, glass and cap (default 32, 0 = the hand-typed octagons)
+    --bench-generate [n]    : Report procedural mesh generation speed up to n segments and exit
+    --bench-textures        : Report scene texture decoding time per thread count and exit
+    --bench-mips [size]     : Report CPU mip chain generation speed (SSE vs scalar, threads) on a size x size image and exit
+    --bench-jpeg [file]     : Report JPEG decode time and memory at 1/1 to 1/8 scale against a full decode plus downsampling and exit
+    --bench-io              : Report texture read and load times per I/O backend with the files evicted from the page cache and
+                              cached, and exit
+    --bench-strips [KB]     : Stream the texture JPEGs in strips under a memory cap (default 8192), check them and the cap, and exit
+    --bake-textures [bc1|bc3|bc7] : Write a block compressed .ktx2 with mipmaps next to each texture image (default bc7) and exit.
+                              Detail the scene cannot show is left out unless --full-textures is given
+    --add-restarts          : Rewrite each texture JPEG in place with a restart marker after every row of blocks, so one image
+                              can be decoded on several threads (lossless; tables are re-optimized) and exit
+    --compress-textures     : Block compress textures that have no baked .ktx2 while loading (BC1, BC3 with alpha)
+    --upload-budget <ms>    : Texture upload time per frame while textures stream in (default 2, 0 = no limit)
+    --io <uring|pread|decoder> : How texture files are read: one io_uring batch for all of them (default, pread where the
+                              kernel has no io_uring), blocking reads on I/O threads, or each decoder reading its own file
+    --no-pbo                : Decode textures to the heap and upload from there instead of through mapped pixel buffers
+    --decode-memory <KB>    : Decode JPEG textures a strip of rows at a time and upload each strip as it comes, holding at most
+                              this much memory for them (0 = decode whole images, the default)
+    --texture-budget <MB>   : Video memory for all textures (default 64, 0 = no limit). The largest are halved to fit at load;
+                              while running, textures drawn least recently give up detail first (T prints what is resident).
+                              Every level is kept in system memory to bring detail back, except with no limit
+    --full-textures         : Load and bake textures at full size instead of the detail that can reach the screen
+    --normals <degrees>     : Regenerate normals at load, smoothing across edges sharper than the crease angle (0 = flat)
+    --no-cull               : Start with back-face culling of closed objects off (C toggles it while running)
+    --software              : Render the headless frames (--headless, --camera-script) on the CPU without OpenGL and report
+                              megapixels per second
+    --compare-software      : Render headless through OpenGL with every texture in full, draw each frame on the CPU too and
+                              fail if they differ beyond tolerance
+    --bench-software        : Report CPU renderer frame times per thread count, AVX2 and scalar, from the start view and exit
+    --reference <file> [spp] : Path trace a converged PNG of the start view, or of each --camera-script pose (numbered before
+                              the extension), with soft shadows and indirect light, tracing up to spp samples per pixel
+                              (default 256) and stopping early once the noise is under one level, then exit
+    --bench-reference       : Report path tracer rays per second per thread count, packets and single rays, and exit
+    --golden [dir]          : Render fixed camera poses (or the --camera-script ones) headless with every texture in full,
+                              compare each frame with <dir>/frame-NNN.png by SSIM and fail if any is beyond tolerance,
+                              writing frame-NNN-diff.png heatmaps of where. With --software the CPU renderer draws them.
+                              The default dir, goldens, holds the committed baseline (see goldens/README.md)
+    --update-goldens        : With --golden, write the frames as the new golden images instead
+    --sequence <dir> [n]    : Render n frames (default 120) headless into numbered PNGs in dir, along the --camera-script
+                              poses spread evenly over the sequence or on a turntable orbit around the table, and report
+                              frames per second for the whole pipeline and per stage, then exit
+    --size <w>x<h>          : Size of headless frames (default 800x600, the window's)
+    --raw                   : Write sequence frames as raw RGBA8 files instead of PNGs
+
 */
 
 using namespace std;
@@ -44,13 +135,29 @@ namespace
     // window variables
     const int WINDOW_WIDTH = 800;
     const int WINDOW_HEIGHT = 600;
+    int gFrameWidth = WINDOW_WIDTH;         // Size of the frames drawn: the window's, or any size headless (--size)
+    int gFrameHeight = WINDOW_HEIGHT;
 
     // Store mesh data
     struct GLMesh
     {
         GLuint vao[11];         // Handle for vertex array object
         GLuint vbo[11];         // Handle for  vertex buffer object
+        GLuint ebo[11];         // Handle for element buffer object (0 when drawn without indices)
         GLuint nVertices[11];   // Number of indices of the mesh
+        GLsizeiptr nBytes[11];  // Size of vertex data uploaded for the mesh
+        vector<GLfloat> facePlanes[11]; // Plane of every triangle, kept on the CPU to count back faces
+        UVStretch uvStretch[11];        // How far the texture coordinates stretch over the surface, for sizing textures
+        glm::vec4 bounds[11];           // Sphere around each slot (center, radius), to skip textures of objects off screen
+    };
+
+    // One object in the scene: the mesh and texture unit it draws with and where it is placed
+    struct SceneObject
+    {
+        int mesh;               // Slot in GLMesh
+        GLint textureUnit;      // Texture unit sampled as uTexture
+        glm::mat4 model;        // Object to world transform
+        bool closed;            // Only ever seen from outside, so back faces can be culled
     };
 
     // Store light data
@@ -65,13 +172,163 @@ namespace
         float highlightSize;
     };
 
+    // Where each mesh slot gets its coordinates from, and how many floats make up one vertex
+    struct MeshSource
+    {
+        const char* name;
+        std::span<const GLfloat>(*coords)();
+        GLuint floatsPerVertex;
+    };
+
+    // Lets a getter of a fixed-size array stand in the table next to the ones sized at run time
+    template <auto Getter>
+    std::span<const GLfloat> anyExtent()
+    {
+        return Getter();
+    }
+
+    const MeshSource gMeshSources[11] = {
+        { "lights", anyExtent<Coordinates::getLightCoords>, 3 },
+        { "plane", anyExtent<Coordinates::getPlaneCoords>, 8 },
+        { "milk bottom", anyExtent<Coordinates::getMilkBotCoords>, 8 },
+        { "milk top", anyExtent<Coordinates::getMilkTopCoords>, 8 },
+        { "donut box", anyExtent<Coordinates::getBoxCoords>, 8 },
+        { "glass top", Coordinates::getGlassTopcoords, 8 },
+        { "glass side", Coordinates::getGlassSideCoords, 8 },
+        { "cap top", Coordinates::getCapTopCoords, 8 },
+        { "cap side", Coordinates::getCapSideCoords, 8 },
+        { "donut", Coordinates::getDonutCoords, 8 },
+        { "milk plane", anyExtent<Coordinates::getMilkPlaneCoords>, 8 },
+    };
+
     GLFWwindow* gWindow = nullptr;  // Declare new window object
+    unique_ptr<HeadlessContext> gHeadless;  // Offscreen context used instead of the window (--headless)
+    const int HEADLESS_FRAMES = 60;         // Frames rendered headless when neither a count nor a camera script says
+    int gHeadlessFrames = 0;                // Frames to render headless before exiting (0 = open a window)
+
+    // Where the camera is for one headless frame
+    struct CameraPose
+    {
+        glm::vec3 position;
+        glm::vec3 target;       // Point looked at
+    };
+    vector<CameraPose> gCameraScript;       // One pose per frame (--camera-script); the last one holds after it ends
+    bool gSoftwareRender = false;           // Render the headless frames on the CPU instead of through OpenGL (--software)
+    bool gCompareSoftware = false;          // Check every headless frame against the CPU renderer (--compare-software)
+
+    // How far a CPU frame may stray from the GL one: mean difference per channel, and the share of pixels off by more than
+    // SOFTWARE_PIXEL_TOLERANCE in any channel (triangle edges and texture filtering round differently)
+    const double SOFTWARE_MEAN_TOLERANCE = 1.0;
+    const int SOFTWARE_PIXEL_TOLERANCE = 16;
+    const double SOFTWARE_OUTLIER_TOLERANCE = 0.01;
+
+    const char* gGoldenDir = nullptr;       // Check the headless frames against the images in this directory (--golden)
+    const char* const GOLDEN_DIR = "goldens";   // The committed baseline, when --golden names no directory
+    bool gUpdateGoldens = false;            // Write the headless frames as the goldens instead (--update-goldens)
+
+    // Poses of the golden images when no camera script is given: the start view, close ups, from behind and grazing
+    const CameraPose GOLDEN_POSES[] = {
+        { glm::vec3(0.0f, 30.0f, 40.0f), glm::vec3(0.0f, 0.0f, 0.0f) },
+        { glm::vec3(0.0f, 5.0f, 20.0f), glm::vec3(0.0f, 0.0f, 0.0f) },
+        { glm::vec3(6.0f, 3.0f, 6.0f), glm::vec3(5.0f, 1.0f, 2.0f) },
+        { glm::vec3(-5.0f, 2.0f, 7.0f), glm::vec3(-5.0f, 0.5f, 4.0f) },
+        { glm::vec3(20.0f, 8.0f, -20.0f), glm::vec3(0.0f, 0.0f, 0.0f) },
+        { glm::vec3(0.5f, 0.2f, 0.5f), glm::vec3(10.0f, 0.2f, 10.0f) },
+    };
+
+    const char* gSequenceDir = nullptr;     // Render an offline frame sequence into this directory (--sequence)
+    const int SEQUENCE_FRAMES = 120;        // Frames of a sequence when no count is given
+    FrameFormat gSequenceFormat = FrameFormat::Png;
+    const glm::vec3 TURNTABLE_START(0.0f, 15.0f, 25.0f);    // Where the turntable orbit starts, looking at the origin
     GLMesh gMesh;   // Triangle mesh data
+    const char* gMeshFilePath = nullptr;    // Binary mesh file to load instead of Coordinates (--meshes)
+    const char* gImportPath = nullptr;      // OBJ/glTF model that replaces one mesh slot (--import)
+    const char* gImportSlot = nullptr;
+    int gTessellation = 32;                 // Segments for the procedural donut, glass and cap (0 = hand-typed)
+    float gCreaseAngle = -1.0f;             // Rebuild normals with this crease angle at load (negative = keep stored normals)
 
     // Texture and scale
     GLuint texture1, texture2, texture3, texture4, texture5, texture6, texture7, texture8, texture9, texture10;
+
+    // Image for each texture. plane1.jpg is the only one loaded without flipping rows
+    const TextureRequest gTextureRequests[10] = {
+        { "plane1.jpg", false }, { "milkCarton.jpg", true }, { "milkTop.jpg", true }, { "DonutBox1.jpg", true }, { "glassTop8.jpg", true },
+        { "milkSide.jpg", true }, { "capTop.jpg", true }, { "capSide.jpg", true }, { "test5.jpg", true }, { "donut1.png", true },
+    };
+    GLuint* const gTextureTargets[10] = { &texture1, &texture2, &texture3, &texture4, &texture5, &texture6, &texture7, &texture8, &texture10, &texture9 };
+    GLuint* const gUnitTextures[11] = { nullptr, &texture1, &texture2, &texture3, &texture4, &texture5, &texture6, &texture7, &texture8,
+        &texture9, &texture10 };  // Texture bound to each unit; SceneObject::textureUnit picks one
     glm::vec2 gUVScale(1.0f, 1.0f);
 
+    // Objects in draw order. The cap is tilted onto the carton, the glass and donut box stand on the plane
+    const glm::mat4 capModel = glm::translate(glm::vec3(-3.35f, 11.0f, -2.8f)) * glm::rotate(glm::degrees(6.1f), glm::vec3(1.0f, 0.0f, 0.0f))
+        * glm::scale(glm::vec3(0.85f, 1.0f, 0.85f));
+    const glm::mat4 glassModel = glm::translate(glm::vec3(-5.0f, 0.0f, 4.0f)) * glm::scale(glm::vec3(0.4f));
+    const vector<SceneObject> gSceneObjects{
+        { 2, 2, glm::scale(glm::vec3(0.5f)), true },                                                    // Milk bottom
+        { 3, 3, glm::scale(glm::vec3(0.5f)), true },                                                    // Milk top
+        { 7, 7, capModel, true },                                                                       // Cap top
+        { 8, 8, capModel, true },                                                                       // Cap sides
+        { 4, 4, glm::translate(glm::vec3(5.0f, 0.0f, 2.0f)) * glm::scale(glm::vec3(0.7f, 0.6f, 0.7f)), true },  // Donut box
+        { 9, 9, glm::translate(glm::vec3(0.0f, 0.0f, 6.0f)) * glm::scale(glm::vec3(0.6f, 0.7f, 0.6f)), true },  // Donut
+        { 5, 5, glassModel, true },                                                                     // Glass top
+        { 6, 6, glassModel, true },                                                                     // Glass sides
+        { 10, 10, glm::scale(glm::vec3(0.5f)), false },                                                 // Milk plane
+        { 1, 1, glm::mat4(1.0f), false },                                                               // Plane
+    };
+    bool gCompressTextures = false;         // Block compress images that have no baked .ktx2 at load (--compress-textures)
+    double gUploadBudgetMs = 2.0;           // Texture upload time per frame while streaming (--upload-budget, 0 = no limit)
+    const size_t UPLOAD_STRIP_BYTES = 256 * 1024;   // Largest single upload, so the budget is checked often
+
+    // A decoded image being uploaded into its texture, smallest mip level first
+    struct StreamedTexture
+    {
+        DecodedImage image;
+        GLuint texture;
+        int level;              // Level being uploaded, counts down to 0
+        GLsizei row;            // Rows of that level already uploaded
+        double uploadMs;        // Time spent uploading it so far
+    };
+    unique_ptr<ThreadPool> gTexturePool;        // Decodes images while the scene is already being drawn
+    unique_ptr<ThreadPool> gJpegBandPool;       // Splits one JPEG with restart markers across cores
+    unique_ptr<TextureLoader> gTextureLoader;   // nullptr once every texture is at full quality
+    unique_ptr<PixelBufferPool> gPixelBufferPool;   // Mapped buffers the images are decoded into (nullptr with --no-pbo)
+    bool gUsePixelBuffers = true;
+    size_t gDecodeMemoryKB = 0;             // Memory cap of the strip path for JPEGs (--decode-memory, 0 = whole images)
+    const char* gAssetPackPath = nullptr;   // Asset pack to load textures from (--pack)
+    unique_ptr<AssetPack> gAssetPack;       // Mapped while textures stream in
+    string gAssetIO = "uring";              // Texture file reads (--io)
+    unique_ptr<AssetReader> gAssetReader;   // Reads the texture files all at once (nullptr: each decoder reads its own)
+    vector<uint8_t> gUnpackedAssets[10];    // Textures stored compressed in the pack, decompressed for the loader
+    string gProcessedCacheDir = "ProcessedCache";   // Where processed textures are kept between runs (--cache, empty = off)
+    unique_ptr<ProcessedCache> gProcessedCache;
+
+    // A texture filled from strips as the decoder produces them, which replaces the placeholder once every row is in
+    struct StripTexture
+    {
+        size_t index;
+        GLuint texture;         // 0 until the first strip arrives
+        size_t rowsLeft;        // Rows of all its levels not uploaded yet
+        bool decoded;           // The loader has handed over image, so no more strips are coming
+        DecodedImage image;
+        double uploadMs;
+    };
+    vector<StripTexture> gStripTextures;
+    const size_t PIXEL_BUFFER_BUDGET = 256u << 20;  // Mapped upload memory, which also caps bytes in flight
+    bool gDownscaleTextures = true;         // Drop texture detail that cannot reach the screen (off with --full-textures)
+    size_t gTextureBudgetMB = 64;           // Video memory for all textures together (--texture-budget, 0 = no limit)
+    const float VIEW_MARGIN = 2.0f;         // Detail is kept for the camera coming this many times closer than the start view
+    size_t gTextureFullBytes[10] = {};      // Video memory each texture would take at full size, for the savings report
+    unique_ptr<TextureResidency> gTextureResidency;     // Keeps the levels the view needs within gTextureBudgetMB
+    uint64_t gFrameNumber = 0;              // Frames started, for least recently used eviction
+    vector<StreamedTexture> gStreamedTextures;
+    const chrono::steady_clock::time_point gStartTime = chrono::steady_clock::now();  // Process start, for time to first frame / full quality
+    double gFirstFrameMs = 0.0;
+    double gUploadMs = 0.0;                 // Texture upload time summed over all frames
+    size_t gTextureBytes = 0;               // Video memory of the textures at full quality
+    size_t gStreamFrames = 0;               // Frames drawn while textures were streaming
+    bool gCullBackFaces = true;             // Skip back faces of closed objects (toggle with C, --no-cull)
+
     // Vector to hold light data that is passed to CalcPointLight
     vector<GLLight> gSceneLights{
         { 0, glm::vec3(16.0f, 20.0f, -5.0f), glm::vec3(0.1f), glm::vec3(0.33f, 0.24f, 0.3f), 0.3f, 256.0f},
@@ -96,6 +353,9 @@ namespace
     GLfloat scroll = 10.0f;     // Camera speed
     bool gFirstMouse = true;    // Detect initial mouse movement    
     bool perspective = true;    // boolean to change between perspective and orthographic
+    bool gCullKeyDown = false;  // C key state, so holding it toggles culling once
+    bool gResidencyKeyDown = false; // T key state, so holding it prints the residency stats once
+    const float ORTHO_SCALE = 50.0f;    // Pixels per two world units in the orthographic view
 }
 
 // Input fucntions 
@@ -105,12 +365,48 @@ void UProcessInput(GLFWwindow* window);
 void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos);
 void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 
+template <typename Number>
+bool UNumber(const char* text, Number& value, const char* usage);
+template <typename Number>
+bool UOptionalNumber(int argc, char* argv[], int& i, Number& value, const char* usage);
+
 // Functions to create, compile, destroy the shader program, create and render primitives
 void UCreateMesh(GLMesh& mesh);
+bool UCreateMeshBuffer(GLMesh& mesh, int index, std::span<const GLfloat> vertices, GLuint floatsPerVertex, const char* name);
+std::span<const GLfloat> UPrepareVertices(std::span<const GLfloat> vertices, GLuint floatsPerVertex, const char* name, vector<GLfloat>& edited);
+bool UCreateMeshFromFile(GLMesh& mesh, const char* path);
+bool UExportMeshes(const char* path);
+bool UImportMesh(GLMesh& mesh, const char* path, const char* slot);
+void UDrawMesh(const GLMesh& mesh, int index);
 void UDestroyMesh(GLMesh& mesh);
-bool UCreateTexture(const char* filename, GLuint& textureId);
+void UCreateTextures();
+void UStreamTextures();
+int UTextureLevelCount(const DecodedImage& image);
+const uint8_t* UTextureLevel(const DecodedImage& image, int level, GLsizei& width, GLsizei& height, size_t& bytes);
+bool UUploadTextureStrip(StreamedTexture& streamed);
+void UUploadDecodedStrip(TextureStrip& strip);
+void UFinishStripTextures();
+void UStopTextureStream();
+void UPlanTextures(const UVStretch stretch[11], std::span<TextureRequest> requests);
+void UUpdateResidency();
+void UReportResidency();
+float UStretchLength(const glm::mat3& transform, const glm::mat3& moment, float area);
+bool UBakeTextures(BlockFormat format);
+void UUseAssetPack(std::span<TextureRequest> requests);
 void UDestroyTexture(GLuint textureId);
+bool ULoadCameraScript(const char* path);
+void UHeadlessCamera(int frame);
+void UAimCamera(const CameraPose& pose);
+glm::mat4 UProjection();
+void UBindTextures();
 void URender();
+bool USoftwareScene(SoftwareScene& scene);
+int URenderSoftware();
+int URenderReference(const char* path, int samplesPerPixel);
+void USequenceCamera(int frame);
+void UReportSequence(const FrameSequenceStats& stats, double ms, size_t threads);
+bool UCompareSoftware(SoftwareRenderer& renderer, const SoftwareScene& scene, int frame);
+void UReportCulling();
 bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programId);
 void UDestroyShaderProgram(GLuint programId);
 
@@ -247,10 +543,235 @@ void main()
 // MAIN FUNCTION
 int main(int argc, char* argv[])
 {
+    // Command-line options
+    const char* exportPath = nullptr;
+    const char* bakeFormat = nullptr;
+    const char* cameraScriptPath = nullptr;
+    bool benchSoftware = false;
+    const char* referencePath = nullptr;
+    int referenceSamples = 256;
+    bool benchReference = false;
+    bool addRestarts = false;
+    const char* packAssetsPath = nullptr;
+    bool benchIO = false;
+    bool benchTextures = false;
+    bool benchImport = false;
+    size_t benchImportTriangles = 1000000;
+    bool benchMips = false;
+    size_t benchMipsSize = 4096;
+    const char* benchJpegPath = nullptr;
+    bool benchStrips = false;
+    size_t benchStripsKB = 8192;
+    bool benchGenerate = false;
+    int benchGenerateSegments = 2048;
+    for (int i = 1; i < argc; i++)
+    {
+        string option = argv[i];
+        if (option == "--export-meshes" && i + 1 < argc)        // Convert Coordinates to a binary mesh file and exit
+            exportPath = argv[++i];
+        else if (option == "--meshes" && i + 1 < argc)          // Load geometry from a binary mesh file
+            gMeshFilePath = argv[++i];
+        else if (option == "--import" && i + 2 < argc)          // Replace a mesh slot with an OBJ/glTF model
+        {
+            gImportPath = argv[++i];
+            gImportSlot = argv[++i];
+        }
+        else if (option == "--bench-import")                    // Measure importer throughput and exit
+        {
+            benchImport = true;
+            if (!UOptionalNumber(argc, argv, i, benchImportTriangles, "--bench-import [tris]"))
+                return EXIT_FAILURE;
+        }
+        else if (option == "--bake-textures")                   // Write block compressed .ktx2 copies of the textures and exit
+            bakeFormat = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : "bc7";
+        else if (option == "--add-restarts")                    // Rewrite the JPEGs for parallel decoding and exit
+            addRestarts = true;
+        else if (option == "--pack" && i + 1 < argc)            // Load textures from an asset pack
+            gAssetPackPath = argv[++i];
+        else if (option == "--pack-assets" && i + 1 < argc)     // Write the textures into an asset pack and exit
+            packAssetsPath = argv[++i];
+        else if (option == "--full-textures")                   // Keep every texel of every texture
+            gDownscaleTextures = false;
+        else if (option == "--texture-budget" && i + 1 < argc)  // Video memory for all textures
+        {
+            if (!UNumber(argv[++i], gTextureBudgetMB, "--texture-budget <MB>"))
+                return EXIT_FAILURE;
+        }
+        else if (option == "--compress-textures")               // Block compress textures without a baked copy at load
+            gCompressTextures = true;
+        else if (option == "--upload-budget" && i + 1 < argc)   // Texture upload time per frame while streaming
+        {
+            if (!UNumber(argv[++i], gUploadBudgetMs, "--upload-budget <ms>"))
+                return EXIT_FAILURE;
+        }
+        else if (option == "--io" && i + 1 < argc)              // I/O backend for texture files
+            gAssetIO = argv[++i];
+        else if (option == "--cache" && i + 1 < argc)           // Directory of the processed-asset cache
+            gProcessedCacheDir = argv[++i];
+        else if (option == "--no-cache")                        // Process every texture from its source
+            gProcessedCacheDir.clear();
+        else if (option == "--bench-io")                        // Measure cold and warm texture loading per I/O backend and exit
+            benchIO = true;
+        else if (option == "--no-pbo")                          // Decode to the heap and upload from client memory
+            gUsePixelBuffers = false;
+        else if (option == "--decode-memory" && i + 1 < argc)   // Stream JPEGs in strips within a memory cap
+        {
+            if (!UNumber(argv[++i], gDecodeMemoryKB, "--decode-memory <KB>"))
+                return EXIT_FAILURE;
+        }
+        else if (option == "--bench-textures")                  // Measure texture decoding per thread count and exit
+            benchTextures = true;
+        else if (option == "--bench-mips")                      // Measure CPU mipmap generation and exit
+        {
+            benchMips = true;
+            if (!UOptionalNumber(argc, argv, i, benchMipsSize, "--bench-mips [size]"))
+                return EXIT_FAILURE;
+        }
+        else if (option == "--bench-jpeg")                      // Measure scaled JPEG decoding and exit
+            benchJpegPath = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : "milkCarton.jpg";
+        else if (option == "--bench-strips")                    // Check strip decoding and its memory cap and exit
+        {
+            benchStrips = true;
+            if (!UOptionalNumber(argc, argv, i, benchStripsKB, "--bench-strips [KB]"))
+                return EXIT_FAILURE;
+        }
+        else if (option == "--bench-generate")                  // Measure procedural mesh generation and exit
+        {
+            benchGenerate = true;
+            if (!UOptionalNumber(argc, argv, i, benchGenerateSegments, "--bench-generate [n]"))
+                return EXIT_FAILURE;
+        }
+        else if (option == "--tessellation" && i + 1 < argc)    // Quality / vertex count of procedural meshes
+        {
+            if (!UNumber(argv[++i], gTessellation, "--tessellation <n>"))
+                return EXIT_FAILURE;
+        }
+        else if (option == "--normals" && i + 1 < argc)         // Regenerate normals at load
+        {
+            if (!UNumber(argv[++i], gCreaseAngle, "--normals <degrees>"))
+                return EXIT_FAILURE;
+        }
+        else if (option == "--no-cull")                         // Draw back faces of closed objects too
+            gCullBackFaces = false;
+        else if (option == "--headless")                        // Render frames offscreen through EGL, then exit
+        {
+            gHeadlessFrames = HEADLESS_FRAMES;
+            if (!UOptionalNumber(argc, argv, i, gHeadlessFrames, "--headless [frames]"))
+                return EXIT_FAILURE;
+        }
+        else if (option == "--camera-script" && i + 1 < argc)   // Camera poses for headless frames, one per line
+            cameraScriptPath = argv[++i];
+        else if (option == "--software")                        // Render on the CPU, no OpenGL needed
+            gSoftwareRender = true;
+        else if (option == "--compare-software")                // Check the CPU renderer against the GL frames
+            gCompareSoftware = true;
+        else if (option == "--bench-software")                  // Measure the CPU renderer and exit
+            benchSoftware = true;
+        else if (option == "--reference" && i + 1 < argc)       // Path trace reference images and exit
+        {
+            referencePath = argv[++i];
+            if (!UOptionalNumber(argc, argv, i, referenceSamples, "--reference <file> [spp]"))
+                return EXIT_FAILURE;
+        }
+        else if (option == "--bench-reference")                 // Measure the path tracer and exit
+            benchReference = true;
+        else if (option == "--golden")                          // Check headless frames against golden images
+            gGoldenDir = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : GOLDEN_DIR;
+        else if (option == "--update-goldens")                  // Write the golden images instead of checking them
+            gUpdateGoldens = true;
+        else if (option == "--sequence" && i + 1 < argc)        // Render a frame sequence to files and exit
+        {
+            gSequenceDir = argv[++i];
+            gHeadlessFrames = SEQUENCE_FRAMES;
+            if (!UOptionalNumber(argc, argv, i, gHeadlessFrames, "--sequence <dir> [n]"))
+                return EXIT_FAILURE;
+        }
+        else if (option == "--size" && i + 1 < argc)            // Size of headless frames
+        {
+            if (sscanf(argv[++i], "%dx%d", &gFrameWidth, &gFrameHeight) != 2 || gFrameWidth <= 0 || gFrameHeight <= 0)
+            {
+                cout << "Expected --size <width>x<height>, not " << argv[i] << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (option == "--raw")                             // Sequence frames as raw RGBA8
+            gSequenceFormat = FrameFormat::Raw;
+    }
+    if (cameraScriptPath != nullptr)
+    {
+        if (!ULoadCameraScript(cameraScriptPath))
+            return EXIT_FAILURE;
+        if (gHeadlessFrames == 0)
+            gHeadlessFrames = (int)gCameraScript.size();    // A script alone renders each of its poses once
+    }
+    if (gGoldenDir != nullptr)
+    {
+        if (gCameraScript.empty())
+            gCameraScript.assign(begin(GOLDEN_POSES), end(GOLDEN_POSES));
+        gHeadlessFrames = (int)gCameraScript.size();    // One frame per pose
+        gDownscaleTextures = false;     // Frames must not depend on the view the textures were sized for
+        gTextureBudgetMB = 0;
+    }
+    if (gSequenceDir != nullptr)
+    {
+        gDownscaleTextures = false;     // Every frame at full detail, whatever its size and view
+        gTextureBudgetMB = 0;
+    }
+    Coordinates::setTessellation(gTessellation);
+    if (exportPath != nullptr)
+        return UExportMeshes(exportPath) ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (bakeFormat != nullptr)
+    {
+        string format = bakeFormat;
+        return UBakeTextures(format == "bc1" ? BlockFormat::BC1 : format == "bc3" ? BlockFormat::BC3 : BlockFormat::BC7) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (addRestarts)
+        return AssetTools::addRestartMarkers(gTextureRequests) ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (packAssetsPath != nullptr)
+        return AssetTools::packAssets(gTextureRequests, packAssetsPath) ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (benchImport)
+        return Benchmarks::importer(benchImportTriangles);
+    if (benchIO)
+        return Benchmarks::io(gTextureRequests);
+    if (benchTextures)
+        return Benchmarks::textures(gTextureRequests);
+    if (benchMips)
+        return Benchmarks::mipmaps(benchMipsSize);
+    if (benchJpegPath != nullptr)
+        return Benchmarks::jpeg(benchJpegPath);
+    if (benchStrips)
+        return Benchmarks::strips(gTextureRequests, benchStripsKB << 10);
+    if (benchGenerate)
+        return Benchmarks::generator(benchGenerateSegments);
+    if (benchSoftware)
+    {
+        SoftwareScene scene;
+        USoftwareScene(scene);
+        return Benchmarks::software(scene, gCamera.GetViewMatrix(), UProjection(), gCamera.Position, WINDOW_WIDTH, WINDOW_HEIGHT);
+    }
+    if (benchReference)
+    {
+        SoftwareScene scene;
+        USoftwareScene(scene);
+        return Benchmarks::reference(scene, gCamera.GetViewMatrix(), UProjection(), WINDOW_WIDTH / 2, WINDOW_HEIGHT / 2);
+    }
+    if (referencePath != nullptr)
+        return URenderReference(referencePath, referenceSamples);
+    if (gSoftwareRender)
+        return URenderSoftware();
+    if (gCompareSoftware)
+    {
+        if (gHeadlessFrames == 0)
+            gHeadlessFrames = HEADLESS_FRAMES;
+        gDownscaleTextures = false;     // Both sides sample every texel of every level
+        gTextureBudgetMB = 0;
+    }
+
     if (!UInitialize(argc, argv, &gWindow)) // Call function to initialize GLFW, GLEW, and create a window
         return EXIT_FAILURE;
 
     UCreateMesh(gMesh); // Call function to create VBO/VAOs
+    UReportCulling();   // Show how many triangles culling saves from the starting view
 
     // Create fucntion to create shader programs
     if (!UCreateShaderProgram(vertexShaderSource, fragmentShaderSource, shaderProgramId))
@@ -263,43 +784,99 @@ int main(int argc, char* argv[])
 
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);   // Set background color to black
 
-    // Render loop (infinite loop until user closes window)
-    while (!glfwWindowShouldClose(gWindow))
+    // Comparing against the CPU renderer or goldens: frames must not depend on how far the textures have streamed, so
+    // stream them all in first
+    SoftwareScene softwareScene;
+    unique_ptr<ThreadPool> softwarePool;
+    unique_ptr<SoftwareRenderer> softwareRenderer;
+    int mismatchedFrames = 0;
+    vector<vector<uint8_t>> goldenFrames;
+    bool fixedTextures = (gCompareSoftware || gGoldenDir != nullptr || gSequenceDir != nullptr) && gHeadless;
+    if (fixedTextures)
+    {
+        while (gTextureLoader)
+        {
+            UStreamTextures();
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+    if (gCompareSoftware && gHeadless)
+    {
+        USoftwareScene(softwareScene);
+        softwarePool = make_unique<ThreadPool>();
+        softwareRenderer = make_unique<SoftwareRenderer>(gHeadless->width(), gHeadless->height(), softwarePool.get());
+    }
+
+    // Offline sequence: frames leave through a ring of pixel pack buffers to encoders on the pool
+    unique_ptr<ThreadPool> sequencePool;
+    unique_ptr<FrameSequence> sequence;
+    if (gSequenceDir != nullptr && gHeadless)
+    {
+        sequencePool = make_unique<ThreadPool>();
+        sequence = make_unique<FrameSequence>(gSequenceDir, gHeadless->width(), gHeadless->height(), gSequenceFormat, *sequencePool);
+    }
+
+    // Render loop (infinite loop until user closes window, or a set number of frames headless)
+    int headlessFrame = 0;
+    chrono::steady_clock::time_point headlessStart = chrono::steady_clock::now();
+    while (gHeadless ? headlessFrame < gHeadlessFrames : !glfwWindowShouldClose(gWindow))
     {
         // Set delta time and ensure we are transforming at consistent rate
-        float currentFrame = glfwGetTime();
+        float currentFrame = gHeadless ? chrono::duration<float>(chrono::steady_clock::now() - gStartTime).count() : (float)glfwGetTime();
         gDeltaTime = currentFrame - gLastFrame;
         gLastFrame = currentFrame;
 
-        // Activate/Bind texture unitS
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, texture2);
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, texture3);
-        glActiveTexture(GL_TEXTURE4);
-        glBindTexture(GL_TEXTURE_2D, texture4);
-        glActiveTexture(GL_TEXTURE5);
-        glBindTexture(GL_TEXTURE_2D, texture5);
-        glActiveTexture(GL_TEXTURE6);
-        glBindTexture(GL_TEXTURE_2D, texture6);
-        glActiveTexture(GL_TEXTURE7);
-        glBindTexture(GL_TEXTURE_2D, texture7);
-        glActiveTexture(GL_TEXTURE8);
-        glBindTexture(GL_TEXTURE_2D, texture8);
-        glActiveTexture(GL_TEXTURE9);
-        glBindTexture(GL_TEXTURE_2D, texture9);
-        glActiveTexture(GL_TEXTURE10);
-        glBindTexture(GL_TEXTURE_2D, texture10);
-
-        UProcessInput(gWindow); // Call fucntion to get input from user
+        UStreamTextures();      // Upload more of the textures still streaming in, within the frame's budget
+        if (!fixedTextures)
+            UUpdateResidency(); // Bring in or drop mip levels for what the last view drew; may replace texture names
+
+        UBindTextures();
+
+        if (sequence)
+            USequenceCamera(headlessFrame++);   // Camera along the sequence's path
+        else if (gHeadless)
+            UHeadlessCamera(headlessFrame++);   // Camera from the script instead of the user
+        else
+            UProcessInput(gWindow); // Call fucntion to get input from user
 
         URender();              // Call function to render frame
+        if (softwareRenderer && !UCompareSoftware(*softwareRenderer, softwareScene, headlessFrame - 1))
+            mismatchedFrames++;
+        if (gGoldenDir != nullptr && gHeadless)
+            gHeadless->readPixels(goldenFrames.emplace_back());
+        if (sequence)
+            sequence->capture();
+        if (gFirstFrameMs == 0.0)
+        {
+            gFirstFrameMs = chrono::duration<double, milli>(chrono::steady_clock::now() - gStartTime).count();
+            cout << "Time to first frame: " << gFirstFrameMs << " ms" << endl;
+        }
 
-        glfwPollEvents();       // Process events
+        if (!gHeadless)
+            glfwPollEvents();   // Process events
+    }
+    if (gHeadless)
+    {
+        double headlessMs = chrono::duration<double, milli>(chrono::steady_clock::now() - headlessStart).count();
+        cout << "Rendered " << headlessFrame << " frames of " << gHeadless->width() << "x" << gHeadless->height() << " headless in "
+            << headlessMs << " ms (" << headlessMs / max(headlessFrame, 1) << " ms per frame)" << endl;
+    }
+    if (softwareRenderer)
+    {
+        cout << "CPU renderer " << (mismatchedFrames == 0 ? "matches" : "does not match") << " OpenGL: " << mismatchedFrames << " of "
+            << headlessFrame << " frames beyond tolerance" << endl;
+    }
+    bool goldensMatch = gGoldenDir == nullptr || !gHeadless || GoldenImages::check(gGoldenDir, gUpdateGoldens, goldenFrames, gHeadless->width(), gHeadless->height());
+    bool sequenceWritten = true;
+    if (sequence)
+    {
+        sequenceWritten = sequence->finish();
+        UReportSequence(sequence->stats(), chrono::duration<double, milli>(chrono::steady_clock::now() - headlessStart).count(), sequencePool->size());
+        sequence.reset();
     }
 
+    UStopTextureStream();         // Stop decodes still in flight
+    UReportResidency();
     UDestroyMesh(gMesh);          // Release mesh data 
     UDestroyTexture(texture1);    // Release texture data
     UDestroyTexture(texture2);
@@ -316,13 +893,47 @@ int main(int argc, char* argv[])
     {
         UDestroyShaderProgram(light.shaderProgram);  // Loop through vector to release shader program for lights
     }
+    gHeadless.reset();
 
-    exit(EXIT_SUCCESS); // Terminate the program successfully
+    exit(mismatchedFrames == 0 && goldensMatch && sequenceWritten ? EXIT_SUCCESS : EXIT_FAILURE); // Terminate the program, failing if the CPU renderer or a golden frame strayed or frames were lost
+}
+
+/*Function reads the argument of an option into value. False (with the usage line) if the argument is not a number of
+that type, or does not fit in it*/
+template <typename Number>
+bool UNumber(const char* text, Number& value, const char* usage)
+{
+    const char* end = text + strlen(text);
+    auto [parsed, error] = from_chars(text, end, value);
+    if (error == errc() && parsed == end)
+        return true;
+    cout << "Expected a number, not " << text << ". Usage: " << usage << endl;
+    return false;
+}
+
+/*Function reads the number that may follow option argv[i] into value, moving i past it; value keeps its default when the
+next argument is another option or there is none. False (with the usage line) if the argument is not a whole number*/
+template <typename Number>
+bool UOptionalNumber(int argc, char* argv[], int& i, Number& value, const char* usage)
+{
+    if (i + 1 >= argc || argv[i + 1][0] == '-')
+        return true;
+    return UNumber(argv[++i], value, usage);
 }
 
 // Initialize GLFW, GLEW, and create a window
 bool UInitialize(int argc, char* argv[], GLFWwindow** window)
 {
+    // Without a display: an EGL context drawing into a framebuffer of the window's size, or --size
+    if (gHeadlessFrames > 0)
+    {
+        gHeadless = make_unique<HeadlessContext>();
+        return gHeadless->create(gFrameWidth, gFrameHeight);
+    }
+
+    gFrameWidth = WINDOW_WIDTH;     // --size is for headless frames only
+    gFrameHeight = WINDOW_HEIGHT;
+
     // Initialize glfw library 
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -382,6 +993,19 @@ void UProcessInput(GLFWwindow* window)
         gCamera.ProcessKeyboard(DOWN, gDeltaTime);
     if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS)       // If 'P' pressed, change projection matrix between perspective/ortho
         perspective = !perspective;
+
+    bool cullKey = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;   // If 'C' pressed, toggle back-face culling of closed objects
+    if (cullKey && !gCullKeyDown)
+    {
+        gCullBackFaces = !gCullBackFaces;
+        UReportCulling();
+    }
+    gCullKeyDown = cullKey;
+
+    bool residencyKey = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;  // If 'T' pressed, print which texture levels are in video memory
+    if (residencyKey && !gResidencyKeyDown)
+        UReportResidency();
+    gResidencyKeyDown = residencyKey;
 }
 
 // Resize window and graphics simultaneously
@@ -415,6 +1039,118 @@ void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
     gCamera.ProcessMouseScroll(yoffset);
 }
 
+/*Function reads a camera script for headless runs: one frame per line, "x y z targetX targetY targetZ" placing the
+camera and the point it looks at. Blank lines and lines starting with # are skipped*/
+bool ULoadCameraScript(const char* path)
+{
+    ifstream file(path);
+    if (!file)
+    {
+        cout << "Failed to open camera script " << path << endl;
+        return false;
+    }
+    string line;
+    for (int number = 1; getline(file, line); number++)
+    {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == string::npos || line[start] == '#')
+            continue;
+        istringstream fields(line);
+        CameraPose pose;
+        if (!(fields >> pose.position.x >> pose.position.y >> pose.position.z >> pose.target.x >> pose.target.y >> pose.target.z)
+            || glm::length(pose.target - pose.position) == 0.0f)
+        {
+            cout << path << ":" << number << ": expected \"x y z targetX targetY targetZ\"" << endl;
+            return false;
+        }
+        gCameraScript.push_back(pose);
+    }
+    if (gCameraScript.empty())
+    {
+        cout << "Camera script " << path << " has no poses" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Function places the camera for a headless frame; without a script it stays at the start view
+void UHeadlessCamera(int frame)
+{
+    if (gCameraScript.empty())
+        return;
+    UAimCamera(gCameraScript[min((size_t)frame, gCameraScript.size() - 1)]);
+}
+
+// Function puts the camera at a pose, level with the world's up so no previous pose leaves it rolled
+void UAimCamera(const CameraPose& pose)
+{
+    gCamera.Position = pose.position;
+    gCamera.Front = glm::normalize(pose.target - pose.position);
+    gCamera.Right = glm::normalize(glm::cross(gCamera.Front, gCamera.WorldUp));
+    gCamera.Up = glm::cross(gCamera.Right, gCamera.Front);
+}
+
+/*Function places the camera for a frame of an offline sequence: along the camera script, its poses spread evenly over
+the sequence with straight moves between them, or without a script once around a turntable orbit of the origin*/
+void USequenceCamera(int frame)
+{
+    CameraPose pose;
+    if (gCameraScript.size() > 1)
+    {
+        float along = gHeadlessFrames > 1 ? (float)frame / (gHeadlessFrames - 1) * (gCameraScript.size() - 1) : 0.0f;
+        size_t from = min((size_t)along, gCameraScript.size() - 2);
+        float blend = along - from;
+        const CameraPose& a = gCameraScript[from];
+        const CameraPose& b = gCameraScript[from + 1];
+        pose.position = a.position + (b.position - a.position) * blend;
+        pose.target = a.target + (b.target - a.target) * blend;
+    }
+    else if (gCameraScript.size() == 1)
+        pose = gCameraScript[0];
+    else
+    {
+        float angle = glm::radians(360.0f) * frame / max(gHeadlessFrames, 1);   // The last frame leads back into the first
+        pose.position = glm::vec3(TURNTABLE_START.x * cos(angle) + TURNTABLE_START.z * sin(angle), TURNTABLE_START.y,
+            TURNTABLE_START.z * cos(angle) - TURNTABLE_START.x * sin(angle));
+        pose.target = glm::vec3(0.0f);
+    }
+    UAimCamera(pose);
+}
+
+// Function reports how fast an offline sequence went through, as a whole and per stage
+void UReportSequence(const FrameSequenceStats& stats, double ms, size_t threads)
+{
+    double frames = max(stats.frames, 1);
+    auto fps = [frames](double stageMs) { return stageMs > 0.0 ? 1000.0 * frames / stageMs : 0.0; };
+    cout << "Sequence: " << stats.frames << " frames of " << gFrameWidth << "x" << gFrameHeight << " in " << ms << " ms, "
+        << fps(ms) << " fps sustained, " << stats.bytes / 1048576.0 << " MB written to " << gSequenceDir << endl;
+    cout << "  Drawing: " << stats.renderMs / frames << " ms per frame (" << fps(stats.renderMs) << " fps)" << endl;
+    cout << "  Readback: " << (stats.readMs + stats.mapMs) / frames << " ms per frame (" << fps(stats.readMs + stats.mapMs)
+        << " fps), " << stats.stalls << " of " << stats.frames << " frames not copied yet when their buffer came around" << endl;
+    cout << "  Encoding: " << stats.encodeMs / frames << " ms per frame on one thread (" << fps(stats.encodeMs) * threads
+        << " fps on " << threads << " threads); drawing waited " << stats.queueMs / frames << " ms per frame for encoders" << endl;
+}
+
+// Function returns the projection of the current view, which the user can change between orthographic (2D) and perspective (3D)
+glm::mat4 UProjection()
+{
+    float aspect = (GLfloat)gFrameWidth / (GLfloat)gFrameHeight;
+    if (perspective)
+        return glm::perspective(glm::radians(gCamera.Zoom), aspect, 0.1f, 100.0f);
+    float halfHeight = (float)WINDOW_HEIGHT / ORTHO_SCALE;     // Frames of other sizes show what the window would
+    return glm::ortho(-halfHeight * aspect, halfHeight * aspect, -halfHeight, halfHeight, 0.1f, 100.0f);
+}
+
+// Function activates/binds texture units 1 to 10, which may have been replaced since the last frame
+void UBindTextures()
+{
+    for (int unit = 1; unit <= 10; unit++)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, *gUnitTextures[unit]);
+    }
+}
+
 // Functioned called to render a frame
 void URender()
 {
@@ -427,23 +1163,10 @@ void URender()
 
     // Initialize transformations
     glm::mat4 model = glm::mat4(1.0f);
-    glm::mat4 translation = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
-    glm::mat4 scale = glm::scale(glm::vec3(1.0f));
-    glm::mat4 rotation = glm::rotate(0.0f, glm::vec3(0.0, 0.0f, 0.0f));
 
     // Create view matrix that transforms all world coordinates to view space
     glm::mat4 view = gCamera.GetViewMatrix();
-    glm::mat4 projection = glm::mat4(1.0f);
-
-    // Conditional loop allows user to change view of scene between orthographic (2D) and perspective (3D) views
-    if (perspective)
-    {
-        projection = glm::perspective(glm::radians(gCamera.Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
-    }
-    else {
-        float scale = 50;
-        projection = glm::ortho(-((float)WINDOW_WIDTH / scale), (float)WINDOW_WIDTH / scale, -(float)WINDOW_HEIGHT / scale, ((float)WINDOW_HEIGHT / scale), 0.1f, 100.0f);
-    }
+    glm::mat4 projection = UProjection();
 
     // Retrieve and pass transform matrices to the Shader program
     GLint modelLoc = glGetUniformLocation(shaderProgramId, "model");
@@ -475,151 +1198,19 @@ void URender()
     GLint UVScaleLoc = glGetUniformLocation(shaderProgramId, "uvScale");
     glUniform2fv(UVScaleLoc, 1, glm::value_ptr(gUVScale));
 
-    // Draw Milk Bottom
-    model = glm::mat4(1.0f);
-    scale = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));         // Scale 
-    model = scale;
-    modelLoc = glGetUniformLocation(shaderProgramId, "model");
-    viewLoc = glGetUniformLocation(shaderProgramId, "view");
-    projLoc = glGetUniformLocation(shaderProgramId, "projection");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform1i(glGetUniformLocation(shaderProgramId, "uTexture"), 2);  // Set texture as texture unit
-    glBindVertexArray(gMesh.vao[2]);
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[2]);
-
-    // Draw Milk Top
-    model = glm::mat4(1.0f);
-    scale = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));         // Scale  
-    model = scale;
-    modelLoc = glGetUniformLocation(shaderProgramId, "model");
-    viewLoc = glGetUniformLocation(shaderProgramId, "view");
-    projLoc = glGetUniformLocation(shaderProgramId, "projection");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform1i(glGetUniformLocation(shaderProgramId, "uTexture"), 3);
-    glBindVertexArray(gMesh.vao[3]);
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[3]);
-
-    // Draw cap top
-    model = glm::mat4(1.0f);
-    translation = glm::translate(model, glm::vec3(-3.35f, 11.0f, -2.8f)); // Translate, rotate, and scale cap
-    rotation = glm::rotate(model, glm::degrees(6.1f), glm::vec3(1.0f, 0.0f, 0.0f));
-    scale = glm::scale(model, glm::vec3(0.85f, 1.0f, 0.85f));
-    model = translation * rotation * scale;
-    modelLoc = glGetUniformLocation(shaderProgramId, "model");
-    viewLoc = glGetUniformLocation(shaderProgramId, "view");
-    projLoc = glGetUniformLocation(shaderProgramId, "projection");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform1i(glGetUniformLocation(shaderProgramId, "uTexture"), 7);
-    glBindVertexArray(gMesh.vao[7]);
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[7]);
-
-    // Draw cap sides
-    model = glm::mat4(1.0f);
-    translation = glm::translate(model, glm::vec3(-3.35f, 11.0f, -2.8f));  // Translate, rotate, and scale
-    rotation = glm::rotate(model, glm::degrees(6.1f), glm::vec3(1.0f, 0.0f, 0.0f));
-    scale = glm::scale(model, glm::vec3(0.85f, 1.0f, 0.85f));
-    model = translation * rotation * scale;
-    modelLoc = glGetUniformLocation(shaderProgramId, "model");
-    viewLoc = glGetUniformLocation(shaderProgramId, "view");
-    projLoc = glGetUniformLocation(shaderProgramId, "projection");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform1i(glGetUniformLocation(shaderProgramId, "uTexture"), 8);
-    glBindVertexArray(gMesh.vao[8]);
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[8]);
-
-    // Draw donut box
-    model = glm::mat4(1.0f);
-    translation = glm::translate(model, glm::vec3(5.0f, 0.0f, 2.0f));  // Translate and scale 
-    scale = glm::scale(model, glm::vec3(0.7f, 0.6f, 0.7f));
-    model = translation * scale;
-    modelLoc = glGetUniformLocation(shaderProgramId, "model");
-    viewLoc = glGetUniformLocation(shaderProgramId, "view");
-    projLoc = glGetUniformLocation(shaderProgramId, "projection");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform1i(glGetUniformLocation(shaderProgramId, "uTexture"), 4);
-    glBindVertexArray(gMesh.vao[4]);
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[4]);
-
-    // Draw donut 
-    model = glm::mat4(1.0f);
-    translation = glm::translate(model, glm::vec3(0.0f, 0.0f, 6.0f)); // Translate and scale 
-    scale = glm::scale(model, glm::vec3(0.6f, 0.7f, 0.6f));
-    model = translation * scale;
-    modelLoc = glGetUniformLocation(shaderProgramId, "model");
-    viewLoc = glGetUniformLocation(shaderProgramId, "view");
-    projLoc = glGetUniformLocation(shaderProgramId, "projection");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform1i(glGetUniformLocation(shaderProgramId, "uTexture"), 9);
-    glBindVertexArray(gMesh.vao[9]);
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[9]);
-
-    // Draw glass top
-    model = glm::mat4(1.0f);
-    translation = glm::translate(model, glm::vec3(-5.0f, 0.0f, 4.0f)); // Translate and scale 
-    scale = glm::scale(model, glm::vec3(0.4f, 0.4f, 0.4f));
-    model = translation * scale;
-    modelLoc = glGetUniformLocation(shaderProgramId, "model");
-    viewLoc = glGetUniformLocation(shaderProgramId, "view");
-    projLoc = glGetUniformLocation(shaderProgramId, "projection");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform1i(glGetUniformLocation(shaderProgramId, "uTexture"), 5);
-    glBindVertexArray(gMesh.vao[5]);
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[5]);
-
-    // Draw glass sides
-    model = glm::mat4(1.0f);
-    translation = glm::translate(model, glm::vec3(-5.0f, 0.0f, 4.0f)); // Translate and scale 
-    scale = glm::scale(model, glm::vec3(0.4f, 0.4f, 0.4f));
-    model = translation * scale;
-    modelLoc = glGetUniformLocation(shaderProgramId, "model");
-    viewLoc = glGetUniformLocation(shaderProgramId, "view");
-    projLoc = glGetUniformLocation(shaderProgramId, "projection");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform1i(glGetUniformLocation(shaderProgramId, "uTexture"), 6);
-    glBindVertexArray(gMesh.vao[6]);
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[6]);
-
-    // Draw Milk Plane
-    model = glm::mat4(1.0f);
-    scale = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));         // Scale 
-    model = scale;
-    modelLoc = glGetUniformLocation(shaderProgramId, "model");
-    viewLoc = glGetUniformLocation(shaderProgramId, "view");
-    projLoc = glGetUniformLocation(shaderProgramId, "projection");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform1i(glGetUniformLocation(shaderProgramId, "uTexture"), 10);
-    glBindVertexArray(gMesh.vao[10]);
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[10]);
-
-    // Draw Plane
-    model = glm::mat4(1.0f);
-    modelLoc = glGetUniformLocation(shaderProgramId, "model");
-    viewLoc = glGetUniformLocation(shaderProgramId, "view");
-    projLoc = glGetUniformLocation(shaderProgramId, "projection");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform1i(glGetUniformLocation(shaderProgramId, "uTexture"), 1);
-    glBindVertexArray(gMesh.vao[1]);
-    glDrawArrays(GL_TRIANGLES, 0, gMesh.nVertices[1]);
+    // Draw every object; closed ones skip their back faces while culling is on
+    GLint textureLoc = glGetUniformLocation(shaderProgramId, "uTexture");
+    for (const SceneObject& object : gSceneObjects)
+    {
+        if (gCullBackFaces && object.closed)
+            glEnable(GL_CULL_FACE);
+        else
+            glDisable(GL_CULL_FACE);
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(object.model));
+        glUniform1i(textureLoc, object.textureUnit);
+        UDrawMesh(gMesh, object.mesh);
+    }
+    glDisable(GL_CULL_FACE);
 
     // Draw Lamps
     for (int i = 0; i < gSceneLights.size(); i++)
@@ -645,322 +1236,1059 @@ void URender()
     // Deactivate VAO and shader program
     glBindVertexArray(0);
     glUseProgram(0);
-    glfwSwapBuffers(gWindow);    // Swap front and back buffers of window
+    if (gHeadless)
+        glFinish();     // Nothing to present; finishing the frame keeps headless frame times honest
+    else
+        glfwSwapBuffers(gWindow);    // Swap front and back buffers of window
+}
+
+/*Function counts the triangles sent to the rasterizer from the current camera with and without back-face culling.
+A triangle faces the camera when the eye is in front of its plane (in object space, so the model matrix does not matter)*/
+void UReportCulling()
+{
+    // Eye as a point for perspective, as a direction toward the viewer for orthographic
+    glm::vec4 eye = perspective ? glm::vec4(gCamera.Position, 1.0f) : glm::vec4(-gCamera.Front, 0.0f);
+
+    size_t allTriangles = 0, drawnTriangles = 0;
+    for (const SceneObject& object : gSceneObjects)
+    {
+        const vector<GLfloat>& planes = gMesh.facePlanes[object.mesh];
+        size_t triangles = planes.size() / 4;
+        allTriangles += triangles;
+        if (!gCullBackFaces || !object.closed)
+        {
+            drawnTriangles += triangles;
+            continue;
+        }
+        glm::vec4 objectEye = glm::inverse(object.model) * eye;
+        for (size_t t = 0; t < triangles; t++)
+        {
+            const GLfloat* plane = &planes[t * 4];
+            if (plane[0] * objectEye.x + plane[1] * objectEye.y + plane[2] * objectEye.z + plane[3] * objectEye.w > 0.0f)
+                drawnTriangles++;
+        }
+    }
+    cout << "Back-face culling " << (gCullBackFaces ? "on" : "off") << ": " << drawnTriangles << " of " << allTriangles
+        << " triangles rasterized from this view" << endl;
+}
+
+/*Function gathers the scene for the CPU renderer from the sources the GL path draws: the Coordinates meshes after the
+same audit as their upload, every texture image at full size with its mip chain, the objects, lights and texture scale.
+Images that cannot be loaded stay gray, like the GL placeholders. False if any could not be*/
+bool USoftwareScene(SoftwareScene& scene)
+{
+    auto start = chrono::steady_clock::now();
+    scene.meshes.assign(11, SoftwareMesh());
+    size_t triangles = 0;
+    for (int i = 0; i < 11; i++)
+    {
+        const MeshSource& source = gMeshSources[i];
+        MeshReport report;
+        if (source.floatsPerVertex != 8 || !MeshTools::validate(source.coords(), source.floatsPerVertex, report))
+            continue;   // The lamps are never drawn
+        vector<GLfloat> edited;
+        std::span<const GLfloat> vertices = UPrepareVertices(source.coords(), source.floatsPerVertex, source.name, edited);
+        scene.meshes[i].vertices.assign(vertices.begin(), vertices.end());
+        triangles += vertices.size() / source.floatsPerVertex / 3;
+    }
+
+    // Decode the images on every core, each building its own mip chain
+    scene.textures.assign(size(gTextureRequests), SoftwareTexture());
+    vector<future<bool>> loads;
+    ThreadPool pool;
+    for (size_t r = 0; r < scene.textures.size(); r++)
+    {
+        loads.push_back(pool.submit([&scene, r] {
+            const TextureRequest& request = gTextureRequests[r];
+            int width, height, channels;
+            stbi_set_flip_vertically_on_load_thread(request.flip);
+            unsigned char* pixels = stbi_load(request.filename, &width, &height, &channels, 4);
+            if (!pixels)
+            {
+                const unsigned char gray[4] = { 128, 128, 128, 255 };
+                SoftwareRenderer::makeTexture(gray, 1, 1, scene.textures[r]);
+                return false;
+            }
+            SoftwareRenderer::makeTexture(pixels, width, height, scene.textures[r]);
+            stbi_image_free(pixels);
+            return true;
+        }));
+    }
+    bool loaded = true;
+    size_t textureBytes = 0;
+    for (size_t r = 0; r < loads.size(); r++)
+    {
+        if (!loads[r].get())
+        {
+            cout << "Failed to load texture " << gTextureRequests[r].filename << endl;
+            loaded = false;
+        }
+        textureBytes += scene.textures[r].texels.size() * 4;
+    }
+
+    // Objects sample the image whose texture is bound to their unit
+    scene.objects.clear();
+    for (const SceneObject& object : gSceneObjects)
+    {
+        int request = (int)(find(begin(gTextureTargets), end(gTextureTargets), gUnitTextures[object.textureUnit]) - begin(gTextureTargets));
+        scene.objects.push_back({ object.mesh, request, object.model, gCullBackFaces && object.closed });
+    }
+    scene.lights.clear();
+    for (const GLLight& light : gSceneLights)
+        scene.lights.push_back({ light.lightPosition, light.lightColor, light.lightIntensity, light.highlightSize, light.lightScale.x });
+    scene.uvScale = gUVScale;
+
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "Software scene: " << triangles << " triangles, " << scene.textures.size() << " textures (" << textureBytes / 1048576.0
+        << " MB with mipmaps) built in " << ms << " ms" << endl;
+    return loaded;
+}
+
+// Function renders the headless frames on the CPU, with no OpenGL context at all, and reports where the time went
+int URenderSoftware()
+{
+    SoftwareScene scene;
+    USoftwareScene(scene);
+    ThreadPool pool;
+    SoftwareRenderer renderer(gFrameWidth, gFrameHeight, &pool);
+    int frames = gHeadlessFrames > 0 ? gHeadlessFrames : HEADLESS_FRAMES;
+    double geometryMs = 0.0, rasterMs = 0.0;
+    size_t fragments = 0;
+    vector<vector<uint8_t>> goldenFrames;
+    auto start = chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        UHeadlessCamera(frame);
+        renderer.render(scene, gCamera.GetViewMatrix(), UProjection(), gCamera.Position);
+        geometryMs += renderer.stats().geometryMs;
+        rasterMs += renderer.stats().rasterMs;
+        fragments += renderer.stats().fragments;
+        if (gGoldenDir != nullptr)
+            renderer.readPixels(goldenFrames.emplace_back());
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "Rendered " << frames << " frames of " << gFrameWidth << "x" << gFrameHeight << " on the CPU in " << ms << " ms ("
+        << ms / frames << " ms per frame, " << (double)gFrameWidth * gFrameHeight * frames / ms / 1000.0 << " Mpixels/s) with "
+        << (SoftwareRenderer::simdAvailable() ? "AVX2" : "scalar") << " kernels on " << pool.size() << " threads" << endl;
+    cout << "  Per frame: geometry and binning " << geometryMs / frames << " ms, tiles " << rasterMs / frames << " ms, "
+        << fragments / frames << " fragments shaded" << endl;
+    if (gGoldenDir != nullptr && !GoldenImages::check(gGoldenDir, gUpdateGoldens, goldenFrames, gFrameWidth, gFrameHeight))
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+/*Function path traces converged reference images of the start view, or of each camera script pose with its number
+before the extension (reference-000.png), for judging lighting changes against. False if any file cannot be written*/
+int URenderReference(const char* path, int samplesPerPixel)
+{
+    SoftwareScene scene;
+    USoftwareScene(scene);
+    ThreadPool pool;
+    PathTracer tracer(scene, &pool);
+    cout << "Reference BVH: " << tracer.stats().triangles << " triangles, " << tracer.stats().nodes << " nodes, depth "
+        << tracer.stats().depth << ", built in " << tracer.stats().buildMs << " ms" << endl;
+
+    PathTracerSettings settings;
+    settings.samplesPerPixel = samplesPerPixel;
+    int poses = gCameraScript.empty() ? 1 : (int)gCameraScript.size();
+    string name = path;
+    size_t dot = name.find_last_of('.');
+    size_t slash = name.find_last_of("/\\");
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        dot = name.size();
+    bool written = true;
+    vector<uint8_t> image;
+    for (int pose = 0; pose < poses; pose++)
+    {
+        UHeadlessCamera(pose);
+        tracer.render(gCamera.GetViewMatrix(), UProjection(), gFrameWidth, gFrameHeight, settings, image);
+        string file = name;
+        if (poses > 1)
+        {
+            char number[16];
+            snprintf(number, sizeof(number), "-%03d", pose);
+            file.insert(dot, number);
+        }
+        const PathTracerStats& stats = tracer.stats();
+        cout << file << ": " << stats.samplesPerPixel << " samples per pixel, noise " << stats.noise << " levels, "
+            << stats.rays / 1e6 << " M rays in " << stats.renderMs << " ms (" << stats.rays / stats.renderMs / 1000.0
+            << " Mrays/s on " << pool.size() << " threads, " << stats.steals << " steals)" << endl;
+        written = PngFile::write(file.c_str(), image.data(), gFrameWidth, gFrameHeight, 4, true) && written;
+    }
+    return written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*Function draws the headless frame OpenGL just rendered again on the CPU and compares the two images.
+False if they differ beyond tolerance*/
+bool UCompareSoftware(SoftwareRenderer& renderer, const SoftwareScene& scene, int frame)
+{
+    vector<uint8_t> expected, actual;
+    gHeadless->readPixels(expected);
+    renderer.render(scene, gCamera.GetViewMatrix(), UProjection(), gCamera.Position);
+    renderer.readPixels(actual);
+
+    uint64_t total = 0;
+    size_t outliers = 0;
+    for (size_t p = 0; p < expected.size(); p += 4)
+    {
+        int worst = 0;
+        for (int c = 0; c < 3; c++)
+        {
+            int difference = abs(expected[p + c] - actual[p + c]);
+            total += difference;
+            worst = max(worst, difference);
+        }
+        outliers += worst > SOFTWARE_PIXEL_TOLERANCE;
+    }
+    size_t pixels = max<size_t>(expected.size() / 4, 1);
+    double mean = (double)total / (pixels * 3);
+    double outlierShare = (double)outliers / pixels;
+    bool matches = mean <= SOFTWARE_MEAN_TOLERANCE && outlierShare <= SOFTWARE_OUTLIER_TOLERANCE;
+    cout << "Frame " << frame << ": CPU " << renderer.stats().geometryMs + renderer.stats().rasterMs << " ms, mean difference "
+        << mean << ", " << outlierShare * 100.0 << "% of pixels off by more than " << SOFTWARE_PIXEL_TOLERANCE
+        << (matches ? "" : " - beyond tolerance") << endl;
+    return matches;
 }
 
 /*Function holds object coordinates, generates/activates VAO/VBO,
 create/enable Vertex Attribute Pointers, and loads texture to texture variable*/
 void UCreateMesh(GLMesh& mesh)
 {
-    // Identify how many floats for Position, Normal, and Texture coordinates
-    const GLuint floatsPerVertex = 3;
+    auto meshStart = chrono::steady_clock::now();   // Time geometry upload and count its heap traffic
+    HeapCounter::start();
+
+    // Load geometry from the binary mesh file if one was given, otherwise validate and send each object's coordinates to the GPU
+    if (gMeshFilePath == nullptr || !UCreateMeshFromFile(mesh, gMeshFilePath))
+    {
+        for (int i = 0; i < 11; i++)
+            UCreateMeshBuffer(mesh, i, gMeshSources[i].coords(), gMeshSources[i].floatsPerVertex, gMeshSources[i].name);
+    }
+    if (gImportPath != nullptr)
+        UImportMesh(mesh, gImportPath, gImportSlot);
+
+    // Report geometry upload cost; hand-typed vertex data is sent straight from static storage unless the audit changed it
+    GLsizeiptr meshBytes = 0;
+    for (GLsizeiptr bytes : mesh.nBytes)
+        meshBytes += bytes;
+    double meshMs = chrono::duration<double, milli>(chrono::steady_clock::now() - meshStart).count();
+    HeapUsage heap = HeapCounter::stop();
+    cout << "Uploaded " << meshBytes << " bytes of vertex data in " << meshMs << " ms (" << heap.allocations
+        << " heap allocations, " << heap.bytes << " bytes)" << endl;
+
+    UCreateTextures();   // Placeholders now; the images are decoded on worker threads and stream in over the first frames
+}
+
+/*Function validates one object's vertex data, creates its VAO/VBO and vertex attribute pointers.
+Only complete triangles with area are uploaded and drawn; rejected data leaves the mesh slot empty*/
+bool UCreateMeshBuffer(GLMesh& mesh, int index, std::span<const GLfloat> vertices, GLuint floatsPerVertex, const char* name)
+{
+    const GLuint floatsPerPosition = 3;
     const GLuint floatsPerNormal = 3;
-    const GLuint floatsPerUV = 2;
-
-    // lights
-    std::vector<GLfloat>* lightCoords = Coordinates::getLightCoords();
-    GLfloat lightVertices[108]{};
-    for (int i = 0; i < lightCoords->size(); i++) {
-        lightVertices[i] = lightCoords->at(i);
-    }
-    mesh.nVertices[0] = sizeof(lightVertices) / (sizeof(lightVertices[0]) * (floatsPerVertex));
-    glGenVertexArrays(1, &mesh.vao[0]); // Create and bind Vertex Array Object (repeated for each obj)
-    glBindVertexArray(mesh.vao[0]);
-    glGenBuffers(1, &mesh.vbo[0]); // Create and activate Vertex Buffer Object (repeated for each obj)
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(lightVertices), lightVertices, GL_STATIC_DRAW); // Send vertex data to the GPU (repeated for each obj)
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, sizeof(float) * floatsPerVertex, 0);
-    glEnableVertexAttribArray(0);
 
-    //Plane
-    std::vector<GLfloat>* planeCoords = Coordinates::getPlaneCoords();
-    GLfloat planeVertices[48]{};
-    for (int i = 0; i < planeCoords->size(); i++) {
-        planeVertices[i] = planeCoords->at(i);
-    }
-    mesh.nVertices[1] = sizeof(planeVertices) / (sizeof(planeVertices[1]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
-    glGenVertexArrays(1, &mesh.vao[1]);
-    glBindVertexArray(mesh.vao[1]);
-    glGenBuffers(1, &mesh.vbo[1]);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[1]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), planeVertices, GL_STATIC_DRAW);
-    // Create Vertex Attribute Pointers - position, normal, texture (repeated for each obj except plane)
-    GLint stride = sizeof(float) * (floatsPerVertex + floatsPerNormal + floatsPerUV);
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-
-    //milk Bottom
-    std::vector<GLfloat>* milkBottomCoords = Coordinates::getMilkBotCoords();
-    GLfloat milkBottomVertices[192]{};
-    for (int i = 0; i < milkBottomCoords->size(); i++) {
-        milkBottomVertices[i] = milkBottomCoords->at(i);
-    }
-    mesh.nVertices[2] = sizeof(milkBottomVertices) / (sizeof(milkBottomVertices[1]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
-    glGenVertexArrays(1, &mesh.vao[2]);
-    glBindVertexArray(mesh.vao[2]);
-    glGenBuffers(1, &mesh.vbo[2]);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[2]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(milkBottomVertices), milkBottomVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-
-    // milk top
-    std::vector<GLfloat>* milkTopCoords = Coordinates::getMilkTopCoords();
-    GLfloat milkTopVertices[144]{};
-    for (int i = 0; i < milkTopCoords->size(); i++) {
-        milkTopVertices[i] = milkTopCoords->at(i);
-    }
-    mesh.nVertices[3] = sizeof(milkTopVertices) / (sizeof(milkTopVertices[1]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
-    glGenVertexArrays(1, &mesh.vao[3]);
-    glBindVertexArray(mesh.vao[3]);
-    glGenBuffers(1, &mesh.vbo[3]);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[3]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(milkTopVertices), milkTopVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-
-    // dontut box
-    std::vector<GLfloat>* donutBoxCoords = Coordinates::getBoxCoords();
-    GLfloat donutBoxVertices[240]{};
-    for (int i = 0; i < donutBoxCoords->size(); i++) {
-        donutBoxVertices[i] = donutBoxCoords->at(i);
-    }
-    mesh.nVertices[4] = sizeof(donutBoxVertices) / (sizeof(donutBoxVertices[1]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
-    glGenVertexArrays(1, &mesh.vao[4]);
-    glBindVertexArray(mesh.vao[4]);
-    glGenBuffers(1, &mesh.vbo[4]);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[4]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(donutBoxVertices), donutBoxVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-
-    // Glass top
-    std::vector<GLfloat>* glassTopCoords = Coordinates::getGlassTopcoords();
-    GLfloat glassTopVertices[192]{};
-    for (int i = 0; i < glassTopCoords->size(); i++) {
-        glassTopVertices[i] = glassTopCoords->at(i);
-    }
-    mesh.nVertices[5] = sizeof(glassTopVertices) / (sizeof(glassTopVertices[1]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
-    glGenVertexArrays(1, &mesh.vao[5]);
-    glBindVertexArray(mesh.vao[5]);
-    glGenBuffers(1, &mesh.vbo[5]);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[5]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glassTopVertices), glassTopVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-
-    // glass side getGlassSideCoords
-    std::vector<GLfloat>* glassSideCoords = Coordinates::getGlassSideCoords();
-    GLfloat glassSideVertices[384]{};
-    for (int i = 0; i < glassSideCoords->size(); i++) {
-        glassSideVertices[i] = glassSideCoords->at(i);
-    }
-    mesh.nVertices[6] = sizeof(glassSideVertices) / (sizeof(glassSideVertices[1]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
-    glGenVertexArrays(1, &mesh.vao[6]);
-    glBindVertexArray(mesh.vao[6]);
-    glGenBuffers(1, &mesh.vbo[6]);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[6]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glassSideVertices), glassSideVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-
-    // cap Top
-    std::vector<GLfloat>* capTopCoords = Coordinates::getCapTopCoords();
-    GLfloat capTopVertices[192]{};
-    for (int i = 0; i < capTopCoords->size(); i++) {
-        capTopVertices[i] = capTopCoords->at(i);
-    }
-    mesh.nVertices[7] = sizeof(capTopVertices) / (sizeof(capTopVertices[1]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
-    glGenVertexArrays(1, &mesh.vao[7]);
-    glBindVertexArray(mesh.vao[7]);
-    glGenBuffers(1, &mesh.vbo[7]);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[7]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(capTopVertices), capTopVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-
-    // cap side  
-    std::vector<GLfloat>* capSideCoords = Coordinates::getCapSideCoords();
-    GLfloat capSideVertices[384]{};
-    for (int i = 0; i < capSideCoords->size(); i++) {
-        capSideVertices[i] = capSideCoords->at(i);
-    }
-    mesh.nVertices[8] = sizeof(capSideVertices) / (sizeof(capSideVertices[1]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
-    glGenVertexArrays(1, &mesh.vao[8]);
-    glBindVertexArray(mesh.vao[8]);
-    glGenBuffers(1, &mesh.vbo[8]);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[8]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(capSideVertices), capSideVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-
-    // donut  
-    std::vector<GLfloat>* donutCoords = Coordinates::getDonutCoords();
-    GLfloat donutVertices[3072]{};
-    for (int i = 0; i < donutCoords->size(); i++) {
-        donutVertices[i] = donutCoords->at(i);
-    }
-    mesh.nVertices[9] = sizeof(donutVertices) / (sizeof(donutVertices[1]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
-    glGenVertexArrays(1, &mesh.vao[9]);
-    glBindVertexArray(mesh.vao[9]);
-    glGenBuffers(1, &mesh.vbo[9]);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[9]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(donutVertices), donutVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-
-    // milk plane  
-    std::vector<GLfloat>* milkPlaneCoords = Coordinates::getMilkPlaneCoords();
-    GLfloat milkPlaneVertices[48]{};
-    for (int i = 0; i < milkPlaneCoords->size(); i++) {
-        milkPlaneVertices[i] = milkPlaneCoords->at(i);
-    }
-    mesh.nVertices[10] = sizeof(milkPlaneVertices) / (sizeof(milkPlaneVertices[1]) * (floatsPerVertex + floatsPerNormal + floatsPerUV));
-    glGenVertexArrays(1, &mesh.vao[10]);
-    glBindVertexArray(mesh.vao[10]);
-    glGenBuffers(1, &mesh.vbo[10]);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[10]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(milkPlaneVertices), milkPlaneVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
+    mesh.vao[index] = 0;
+    mesh.vbo[index] = 0;
+    mesh.ebo[index] = 0;
+    mesh.nVertices[index] = 0;
+    mesh.nBytes[index] = 0;
 
-    // Call function to generate textures passing texture image files
-    const char* texFilename = "plane1.jpg";
-    if (!UCreateTexture(texFilename, texture1))
+    MeshReport report;
+    if (!MeshTools::validate(vertices, floatsPerVertex, report))
     {
-        cout << "Failed to load texture " << texFilename << endl;
+        cout << "Rejected mesh " << name << ": " << vertices.size() << " floats is not a whole number of "
+            << floatsPerVertex << "-float vertices" << endl;
+        return false;
     }
-    texFilename = "milkCarton.jpg";
-    if (!UCreateTexture(texFilename, texture2))
+    if (report.leftoverVertices > 0 || report.degenerateTriangles > 0)
     {
-        cout << "Failed to load texture " << texFilename << endl;
+        cout << "Mesh " << name << ": " << report.leftoverVertices << " leftover vertices skipped, "
+            << report.degenerateTriangles << " of " << report.nTriangles << " triangles are degenerate, removed" << endl;
     }
-    texFilename = "milkTop.jpg";
-    if (!UCreateTexture(texFilename, texture3))
+
+    vector<GLfloat> edited;
+    vertices = UPrepareVertices(vertices, floatsPerVertex, name, edited);
+    mesh.facePlanes[index].clear();
+    MeshTools::facePlanes(vertices, floatsPerVertex, mesh.facePlanes[index]);
+    mesh.uvStretch[index] = MeshTools::uvStretch(vertices, floatsPerVertex);
+    mesh.bounds[index] = MeshTools::boundingSphere(vertices, floatsPerVertex);
+
+    mesh.nVertices[index] = (GLuint)(vertices.size() / floatsPerVertex);
+    mesh.nBytes[index] = sizeof(GLfloat) * floatsPerVertex * mesh.nVertices[index];
+
+    glGenVertexArrays(1, &mesh.vao[index]); // Create and bind Vertex Array Object
+    glBindVertexArray(mesh.vao[index]);
+    glGenBuffers(1, &mesh.vbo[index]);      // Create and activate Vertex Buffer Object
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[index]);
+    glBufferData(GL_ARRAY_BUFFER, mesh.nBytes[index], vertices.data(), GL_STATIC_DRAW); // Send vertex data to the GPU
+
+    // Create Vertex Attribute Pointers - position, then normal and texture when the layout carries them
+    GLint stride = sizeof(float) * floatsPerVertex;
+    glVertexAttribPointer(0, floatsPerPosition, GL_FLOAT, GL_FALSE, stride, 0);
+    glEnableVertexAttribArray(0);
+    if (floatsPerVertex >= floatsPerPosition + floatsPerNormal)
     {
-        cout << "Failed to load texture " << texFilename << endl;
+        glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerPosition));
+        glEnableVertexAttribArray(1);
     }
-    texFilename = "DonutBox1.jpg";
-    if (!UCreateTexture(texFilename, texture4))
+    if (floatsPerVertex > floatsPerPosition + floatsPerNormal)
     {
-        cout << "Failed to load texture " << texFilename << endl;
+        glVertexAttribPointer(2, floatsPerVertex - floatsPerPosition - floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerPosition + floatsPerNormal)));
+        glEnableVertexAttribArray(2);
     }
-    texFilename = "glassTop8.jpg";
-    if (!UCreateTexture(texFilename, texture5))
+    return true;
+}
+
+/*Function audits vertex data before upload or export: drops triangles without area and leftover vertices, turns
+inverted triangles to wind counter-clockwise seen from outside (needed for back-face culling) and checks or rebuilds
+normals. Returns the data to use, whole triangles only*/
+std::span<const GLfloat> UPrepareVertices(std::span<const GLfloat> vertices, GLuint floatsPerVertex, const char* name, vector<GLfloat>& edited)
+{
+    const GLuint floatsWithNormal = 6;      // Position and normal: the fewest floats a vertex with a normal has
+    const float normalTolerance = 60.0f;    // Degrees a stored normal may lean before it is reported
+
+    // Zero-area triangles cost vertex shading and setup and draw nothing, so only whole triangles with area go on
+    MeshReport report;
+    MeshTools::validate(vertices, floatsPerVertex, report);
+    bool trim = report.degenerateTriangles > 0 || report.leftoverVertices > 0;
+    GLuint inverted = MeshTools::countInverted(vertices, floatsPerVertex);
+    if (trim || inverted > 0 || (gCreaseAngle >= 0.0f && floatsPerVertex >= floatsWithNormal))
     {
-        cout << "Failed to load texture " << texFilename << endl;
+        edited.assign(vertices.begin(), vertices.end());
+        if (trim)
+            MeshTools::removeDegenerate(edited, floatsPerVertex);
+        vertices = edited;
+    }
+    if (inverted > 0)
+    {
+        MeshTools::fixWinding(edited, floatsPerVertex);
+        cout << "Mesh " << name << ": " << inverted << " of " << vertices.size() / floatsPerVertex / 3 << " triangles wound clockwise, fixed" << endl;
+    }
+
+    // Report stored normals that do not stand off their triangle and rebuild all normals when asked (--normals)
+    if (floatsPerVertex >= floatsWithNormal)
+    {
+        GLuint deviating = MeshTools::checkNormals(vertices, floatsPerVertex, normalTolerance);
+        if (gCreaseAngle >= 0.0f)
+            MeshTools::generateNormals(edited, floatsPerVertex, gCreaseAngle);
+        if (deviating > 0)
+        {
+            cout << "Mesh " << name << ": " << deviating << " of " << vertices.size() / floatsPerVertex << " normals lean more than "
+                << normalTolerance << " degrees off their triangle" << (gCreaseAngle >= 0.0f ? ", regenerated" : "") << endl;
+        }
     }
-    texFilename = "milkSide.jpg";
-    if (!UCreateTexture(texFilename, texture6))
+    return vertices;
+}
+
+/*Function maps a binary mesh file (see MeshFile.h) and hands its blobs straight to immutable GPU buffers.
+Slots missing from the file fall back to Coordinates*/
+bool UCreateMeshFromFile(GLMesh& mesh, const char* path)
+{
+    MeshFile file;
+    if (!file.open(path))
     {
-        cout << "Failed to load texture " << texFilename << endl;
+        cout << "Failed to open mesh file " << path << endl;
+        return false;
     }
-    texFilename = "capTop.jpg";
-    if (!UCreateTexture(texFilename, texture7))
+
+    for (int i = 0; i < 11; i++)
     {
-        cout << "Failed to load texture " << texFilename << endl;
+        int found = file.find(gMeshSources[i].name);
+        if (found < 0 || file.entry(found).vertexStride != sizeof(GLfloat) * gMeshSources[i].floatsPerVertex)
+        {
+            cout << "Mesh " << gMeshSources[i].name << " not usable in " << path << ", using built-in coordinates" << endl;
+            UCreateMeshBuffer(mesh, i, gMeshSources[i].coords(), gMeshSources[i].floatsPerVertex, gMeshSources[i].name);
+            continue;
+        }
+
+        const MeshFileEntry& entry = file.entry(found);
+        mesh.nVertices[i] = entry.indexCount;
+        mesh.nBytes[i] = entry.vertexBytes + entry.indexBytes;
+
+        glGenVertexArrays(1, &mesh.vao[i]);
+        glBindVertexArray(mesh.vao[i]);
+        glGenBuffers(1, &mesh.vbo[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo[i]);
+        glBufferStorage(GL_ARRAY_BUFFER, entry.vertexBytes, file.vertexData(found), 0);    // Copy straight from the mapping
+        glGenBuffers(1, &mesh.ebo[i]);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo[i]);
+        glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, entry.indexBytes, file.indexData(found), 0);
+
+        for (GLuint a = 0; a < entry.attributeCount; a++)
+        {
+            const MeshAttribute& attribute = entry.attributes[a];
+            glVertexAttribPointer(attribute.location, attribute.components, GL_FLOAT, GL_FALSE, entry.vertexStride, (void*)(uintptr_t)attribute.offset);
+            glEnableVertexAttribArray(attribute.location);
+        }
+
+        // Expand the vertices through the index list to keep triangle planes for the culling report and the UV stretch
+        const GLfloat* vertexFloats = static_cast<const GLfloat*>(file.vertexData(found));
+        const uint32_t* indices = static_cast<const uint32_t*>(file.indexData(found));
+        const GLuint floatsPerVertex = entry.vertexStride / sizeof(GLfloat);
+        vector<GLfloat> expanded;
+        expanded.reserve((size_t)entry.indexCount * floatsPerVertex);
+        for (uint32_t k = 0; k < entry.indexCount; k++)
+            expanded.insert(expanded.end(), vertexFloats + (size_t)indices[k] * floatsPerVertex, vertexFloats + ((size_t)indices[k] + 1) * floatsPerVertex);
+        mesh.facePlanes[i].clear();
+        MeshTools::facePlanes(expanded, floatsPerVertex, mesh.facePlanes[i]);
+        mesh.uvStretch[i] = MeshTools::uvStretch(expanded, floatsPerVertex);
+        mesh.bounds[i] = MeshTools::boundingSphere(expanded, floatsPerVertex);
     }
-    texFilename = "capSide.jpg";
-    if (!UCreateTexture(texFilename, texture8))
+    glBindVertexArray(0);
+    return true;
+}
+
+// Function to write every Coordinates mesh into a binary mesh file
+bool UExportMeshes(const char* path)
+{
+    vector<MeshFileSource> sources;
+    vector<GLfloat> edited[11];     // Audited copies, when the audit changed anything
+    for (int i = 0; i < 11; i++)
     {
-        cout << "Failed to load texture " << texFilename << endl;
+        const MeshSource& source = gMeshSources[i];
+        sources.push_back({ source.name, UPrepareVertices(source.coords(), source.floatsPerVertex, source.name, edited[i]), source.floatsPerVertex });
     }
-    texFilename = "test5.jpg";
-    if (!UCreateTexture(texFilename, texture10))
+
+    if (!MeshFile::write(path, sources))
     {
-        cout << "Failed to load texture " << texFilename << endl;
+        cout << "Failed to write mesh file " << path << endl;
+        return false;
     }
-    texFilename = "donut1.png";
-    if (!UCreateTexture(texFilename, texture9))
+    cout << "Wrote " << sources.size() << " meshes to " << path << endl;
+    return true;
+}
+
+// Function to replace one mesh slot with a model imported from an OBJ or glTF (.glb) file
+bool UImportMesh(GLMesh& mesh, const char* path, const char* slot)
+{
+    for (int i = 0; i < 11; i++)
     {
-        cout << "Failed to load texture " << texFilename << endl;
+        if (string(gMeshSources[i].name) != slot)
+            continue;
+
+        ThreadPool pool;
+        vector<GLfloat> vertices;
+        ImportStats stats;
+        if (!MeshImporter::load(path, vertices, pool, stats))
+        {
+            cout << "Failed to import " << path << endl;
+            return false;
+        }
+        cout << "Imported " << stats.triangles << " triangles from " << path << " in " << stats.seconds * 1000.0 << " ms ("
+            << stats.bytes / 1e6 / stats.seconds << " MB/s on " << pool.size() << " threads)" << endl;
+
+        glDeleteVertexArrays(1, &mesh.vao[i]);
+        glDeleteBuffers(1, &mesh.vbo[i]);
+        glDeleteBuffers(1, &mesh.ebo[i]);
+        return UCreateMeshBuffer(mesh, i, vertices, 8, slot);
     }
+    cout << "No mesh slot named " << slot << endl;
+    return false;
+}
+
+// Function to draw one mesh slot, indexed when it was loaded with an element buffer
+void UDrawMesh(const GLMesh& mesh, int index)
+{
+    glBindVertexArray(mesh.vao[index]);
+    if (mesh.ebo[index])
+        glDrawElements(GL_TRIANGLES, mesh.nVertices[index], GL_UNSIGNED_INT, 0);
+    else
+        glDrawArrays(GL_TRIANGLES, 0, mesh.nVertices[index]);
 }
 
 // Function to destroy VAO and VBO
 void UDestroyMesh(GLMesh& mesh)
 {
-    glDeleteVertexArrays(1, mesh.vao);
-    glDeleteBuffers(1, mesh.vbo);
+    glDeleteVertexArrays(11, mesh.vao);
+    glDeleteBuffers(11, mesh.vbo);
+    glDeleteBuffers(11, mesh.ebo);
 }
 
-// Function to load and bind texture
-bool UCreateTexture(const char* filename, GLuint& textureId)
+/*Function gives every material a 1x1 gray placeholder so the first frame can be drawn right away, and starts
+decoding the real images on the worker pool. UStreamTextures replaces the placeholders as images finish*/
+void UCreateTextures()
 {
-    int width, height, channels;
-    unsigned char* image = stbi_load(filename, &width, &height, &channels, 0);
-    if (image)
+    const unsigned char gray[4] = { 128, 128, 128, 255 };
+    for (GLuint* target : gTextureTargets)
     {
-        stbi_set_flip_vertically_on_load(true); // Flip y-axis during image loading so that image is not upside down
-
-        glGenTextures(1, &textureId);               // Create texture ID
-        glBindTexture(GL_TEXTURE_2D, textureId);    // Bind texure 
+        glGenTextures(1, target);               // Create texture ID
+        glBindTexture(GL_TEXTURE_2D, *target);  // Bind texure 
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);       // Specify how to wrap texture
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);   // Specify how to filter texture
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);   // Specify how to filter texture (trilinear across the mipmaps)
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-        if (channels == 3)
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-        else if (channels == 4)
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, gray);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);    // Unbind the texture
+
+    if (gTextureBudgetMB > 0)   // Without a budget every level stays resident, so no copies are kept to bring one back
+        gTextureResidency = make_unique<TextureResidency>(gTextureBudgetMB << 20);
+    if (gUsePixelBuffers && !gCompressTextures)     // Block compressed images are encoded on the heap
+        gPixelBufferPool = make_unique<PixelBufferPool>(PIXEL_BUFFER_BUDGET);
+    vector<TextureRequest> requests(begin(gTextureRequests), end(gTextureRequests));
+    if (gAssetPackPath != nullptr)
+        UUseAssetPack(requests);
+    if (gDownscaleTextures)
+        UPlanTextures(gMesh.uvStretch, requests);
+    gTexturePool = make_unique<ThreadPool>();
+    gJpegBandPool = make_unique<ThreadPool>();
+    if (gAssetIO != "decoder" && gDecodeMemoryKB == 0)     // Files read ahead would sit outside the strip path's memory cap
+        gAssetReader = AssetReader::create(gAssetIO == "pread" ? AssetBackend::Pread : AssetBackend::Uring);
+    if (!gProcessedCacheDir.empty())
+        gProcessedCache = make_unique<ProcessedCache>(gProcessedCacheDir);
+    gTextureLoader = make_unique<TextureLoader>(requests, *gTexturePool, gCompressTextures, gPixelBufferPool.get(), gJpegBandPool.get(),
+        gDecodeMemoryKB << 10, gAssetReader.get(), gProcessedCache.get());
+}
+
+/*Function is called once per frame. It picks up decoded images and uploads their mip levels smallest first, in strips,
+until the frame's upload budget is spent. The level with the fewest bytes left across all textures goes next, so every
+material sharpens together and the full size levels come last. Images decoded into a pixel buffer upload from it
+asynchronously; the buffer is fenced after the last strip and reused once the GPU has read it*/
+void UStreamTextures()
+{
+    if (!gTextureLoader)
+        return;     // Every texture is at full quality
+    auto frameStart = chrono::steady_clock::now();
+    if (gPixelBufferPool)
+        gPixelBufferPool->service();
+
+    DecodedImage image;
+    while (gTextureLoader->tryNext(image))
+    {
+        auto stripped = find_if(gStripTextures.begin(), gStripTextures.end(), [&](const StripTexture& s) { return s.index == image.index; });
+        if (image.stripped)
+        {
+            if (stripped == gStripTextures.end())
+                stripped = gStripTextures.insert(gStripTextures.end(), { image.index, 0, 0, false, DecodedImage(), 0.0 });
+            stripped->decoded = true;
+            stripped->image = std::move(image);
+            image = DecodedImage();
+            continue;   // Its rows come as strips
+        }
+        if (stripped != gStripTextures.end())
+        {
+            // The strip path gave up part way; the strips already uploaded are thrown away with their texture
+            glDeleteTextures(1, &stripped->texture);
+            gStripTextures.erase(stripped);
+        }
+        if (!image.pixels && image.compressed.levels.empty())
+        {
+            cout << "Failed to load texture " << gTextureRequests[image.index].filename;
+            if (image.overCapBytes > 0)
+                cout << ": decoding it in strips needs at least " << image.overCapBytes / 1024 << " KB more than --decode-memory allows";
+            cout << endl;
+            TextureLoader::release(image);
+            continue;   // Keeps its placeholder
+        }
+        if (image.compressed.levels.empty() && image.channels != 3 && image.channels != 4)
+        {
+            cout << "Not implemented to handle image with " << image.channels << " channels" << endl;
+            TextureLoader::release(image);
+            continue;
+        }
+        GLuint texture = *gTextureTargets[image.index];
+        int levels = UTextureLevelCount(image);
+        gStreamedTextures.push_back({ std::move(image), texture, levels - 1, 0, 0.0 });
+        image = DecodedImage();
+    }
+
+    // Strips go first: the decoder producing them waits while they hold its memory
+    TextureStrip strip;
+    while ((gUploadBudgetMs <= 0.0 || chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count() < gUploadBudgetMs)
+        && gTextureLoader->tryNextStrip(strip))
+        UUploadDecodedStrip(strip);
+    UFinishStripTextures();
+
+    auto levelBytes = [](const StreamedTexture& streamed) {
+        GLsizei width, height;
+        size_t bytes;
+        UTextureLevel(streamed.image, streamed.level, width, height, bytes);
+        return bytes;
+    };
+    while (!gStreamedTextures.empty()
+        && (gUploadBudgetMs <= 0.0 || chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count() < gUploadBudgetMs))
+    {
+        auto streamed = min_element(gStreamedTextures.begin(), gStreamedTextures.end(),
+            [&](const StreamedTexture& a, const StreamedTexture& b) { return levelBytes(a) < levelBytes(b); });
+
+        auto uploadStart = chrono::steady_clock::now();
+        bool finished = UUploadTextureStrip(*streamed);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - uploadStart).count();
+        streamed->uploadMs += ms;
+        gUploadMs += ms;
+        if (!finished)
+            continue;
+
+        // Video memory used: every level uploaded
+        const DecodedImage& done = streamed->image;
+        size_t bytes = 0;
+        for (int level = done.firstLevel; level < UTextureLevelCount(done); level++)
+        {
+            GLsizei width, height;
+            size_t levelSize;
+            UTextureLevel(done, level, width, height, levelSize);
+            bytes += levelSize;
+        }
+        gTextureBytes += bytes;
+        string source = done.compressed.levels.empty() ? "decoded" : done.baked ? "baked" : "encoded";
+        if (done.decodeScale > 1)
+            source += " at 1/" + to_string(done.decodeScale);
+        cout << "Texture " << gTextureRequests[done.index].filename << " (" << max(1, done.width >> done.firstLevel) << "x" << max(1, done.height >> done.firstLevel)
+            << ", " << source << ", " << bytes / 1024 << " KB): ready in " << done.decodeMs << " ms, full quality "
+            << chrono::duration<double, milli>(chrono::steady_clock::now() - gStartTime).count() << " ms after start (" << streamed->uploadMs << " ms of uploads)";
+        if (gTextureFullBytes[done.index] > bytes && bytes > 0)
+        {
+            // Uploads of the dropped detail would have run at the same rate
+            size_t saved = gTextureFullBytes[done.index] - bytes;
+            cout << ", saved " << saved / 1024 << " KB of video memory and ~" << streamed->uploadMs * saved / bytes << " ms of uploads";
+        }
+        cout << endl;
+
+        // The residency manager keeps every level in system memory to bring detail back after dropping it
+        if (gTextureResidency)
+        {
+            ResidentImage resident;
+            resident.width = max(1, done.width >> done.firstLevel);
+            resident.height = max(1, done.height >> done.firstLevel);
+            if (done.compressed.levels.empty())
+            {
+                resident.internalFormat = done.channels == 3 ? GL_RGB8 : GL_RGBA8;
+                resident.format = done.channels == 3 ? GL_RGB : GL_RGBA;
+            }
+            else
+                resident.internalFormat = done.compressed.format == BlockFormat::BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                    : done.compressed.format == BlockFormat::BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_BPTC_UNORM;
+            for (int level = done.firstLevel; level < UTextureLevelCount(done); level++)
+            {
+                GLsizei width, height;
+                size_t levelSize;
+                const uint8_t* data = UTextureLevel(done, level, width, height, levelSize);
+                resident.levels.emplace_back(data, data + levelSize);
+            }
+            gTextureResidency->adopt(gTextureTargets[done.index], std::move(resident));
+        }
+
+        if (done.staging)
+            gPixelBufferPool->submit(done.staging);
+        TextureLoader::release(streamed->image);
+        gStreamedTextures.erase(streamed);
+    }
+    gStreamFrames++;
+
+    // Done once every image is uploaded and the GPU has finished reading the pixel buffers
+    PixelBufferStats staging = gPixelBufferPool ? gPixelBufferPool->stats() : PixelBufferStats();
+    if (gStreamedTextures.empty() && gStripTextures.empty() && gTextureLoader->done() && staging.bytesInFlight == 0)
+    {
+        double totalMs = chrono::duration<double, milli>(chrono::steady_clock::now() - gStartTime).count();
+        cout << "Time to full quality: " << totalMs << " ms (first frame at " << gFirstFrameMs << " ms; " << gUploadMs << " ms of uploads over "
+            << gStreamFrames << " frames on " << gTexturePool->size() << " decode threads, files read by " << (gAssetReader ? gAssetReader->name() : "the decoders")
+            << ", " << gTextureBytes / (1024 * 1024) << " MB of video memory)" << endl;
+        if (gPixelBufferPool)
+            cout << "Pixel buffers: " << staging.buffers << " mapped (" << staging.mappedBytes / (1024 * 1024) << " MB), peak " << staging.peakBytesInFlight / (1024 * 1024)
+                << " MB in flight, " << staging.stalls << " decodes waited " << staging.stallMs << " ms for a buffer, " << staging.fencesRetired
+                << " fences retired after " << staging.fencesPending << " polls found them pending" << endl;
+        if (gProcessedCache)
+        {
+            ProcessedCacheStats cache = gProcessedCache->stats();
+            size_t lookups = cache.hits + cache.misses;
+            cout << "Processed-asset cache: " << cache.hits << " of " << lookups << " textures hit (" << (lookups ? 100 * cache.hits / lookups : 0)
+                << "%), about " << cache.savedMs << " ms of processing saved; " << cache.stores << " stored (" << cache.bytesWritten / (1024 * 1024) << " MB)" << endl;
+        }
+        if (gDecodeMemoryKB > 0)
+        {
+            StripStats strips = gTextureLoader->stripStats();
+            cout << "Strip decoding: peak " << strips.peakBytes / 1024 << " KB of the " << strips.capBytes / 1024 << " KB cap, " << strips.strips
+                << " strips, " << strips.stalls << " decodes waited " << strips.stallMs << " ms for uploads" << endl;
+        }
+        UStopTextureStream();
+    }
+}
+
+// Function returns the number of mip levels of a decoded image: the stored blocks, or the pixels and their mipmaps
+int UTextureLevelCount(const DecodedImage& image)
+{
+    if (image.staging)
+        return ImageTools::mipLevelCount(image.width, image.height);
+    return image.compressed.levels.empty() ? (int)image.mipLevels.size() + 1 : (int)image.compressed.levels.size();
+}
+
+// Function returns the pixels or blocks of one mip level of a decoded image, with its size
+const uint8_t* UTextureLevel(const DecodedImage& image, int level, GLsizei& width, GLsizei& height, size_t& bytes)
+{
+    width = max(1, image.width >> level);
+    height = max(1, image.height >> level);
+    if (!image.compressed.levels.empty())
+    {
+        bytes = image.compressed.levels[level].size();
+        return image.compressed.levels[level].data();
+    }
+    bytes = (size_t)width * height * image.channels;
+    if (image.staging)
+    {
+        // Levels follow each other in the pixel buffer
+        const uint8_t* data = image.pixels;
+        for (int above = 0; above < level; above++)
+            data += (size_t)max(1, image.width >> above) * max(1, image.height >> above) * image.channels;
+        return data;
+    }
+    return level == 0 ? image.pixels : image.mipLevels[level - 1].data();
+}
+
+/*Function uploads the next strip of rows of the level being streamed. A level is allocated on its first strip and
+becomes the texture's base level once its last strip is in. Strips of an image in a pixel buffer are copied by the GPU
+from the buffer instead of by the driver from memory. Returns true when the top level worth uploading is done*/
+bool UUploadTextureStrip(StreamedTexture& streamed)
+{
+    const DecodedImage& image = streamed.image;
+    const CompressedTexture& compressed = image.compressed;
+    GLsizei width, height;
+    size_t bytes;
+    const uint8_t* data = UTextureLevel(image, streamed.level, width, height, bytes);
+
+    bool blocks = !compressed.levels.empty();
+    GLenum format = blocks ? (compressed.format == BlockFormat::BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+        : compressed.format == BlockFormat::BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_BPTC_UNORM)
+        : image.channels == 3 ? GL_RGB : GL_RGBA;
+    GLsizei rowHeight = blocks ? 4 : 1;     // Blocks cover 4 rows
+    size_t rowBytes = bytes / ((height + rowHeight - 1) / rowHeight);
+
+    glBindTexture(GL_TEXTURE_2D, streamed.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);  // Rows of RGB levels are not 4-byte aligned once the width gets odd
+    GLint textureLevel = streamed.level - image.firstLevel;    // Dropped top levels shift the rest up
+    if (streamed.row == 0)
+    {
+        if (blocks)
+            glCompressedTexImage2D(GL_TEXTURE_2D, textureLevel, format, width, height, 0, (GLsizei)bytes, nullptr);
         else
+            glTexImage2D(GL_TEXTURE_2D, textureLevel, image.channels == 3 ? GL_RGB8 : GL_RGBA8, width, height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    GLsizei rows = min(height - streamed.row, max<GLsizei>(1, (GLsizei)(UPLOAD_STRIP_BYTES / rowBytes)) * rowHeight);
+    const uint8_t* strip = data + (size_t)(streamed.row / rowHeight) * rowBytes;
+    if (image.staging)
+    {
+        // With a bound unpack buffer the pointer is an offset into it
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, image.staging->buffer);
+        strip = (const uint8_t*)(uintptr_t)(strip - image.staging->mapped);
+    }
+    if (blocks)
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, textureLevel, 0, streamed.row, width, rows, format, (GLsizei)((rows + 3) / 4 * rowBytes), strip);
+    else
+        glTexSubImage2D(GL_TEXTURE_2D, textureLevel, 0, streamed.row, width, rows, format, GL_UNSIGNED_BYTE, strip);
+    if (image.staging)
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    streamed.row += rows;
+    if (streamed.row == height)
+    {
+        // Sample this level and the smaller ones already in; the placeholder and unfinished levels are left out
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, textureLevel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, UTextureLevelCount(image) - 1 - image.firstLevel);
+        streamed.level--;
+        streamed.row = 0;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);    // Unbind the texture
+    return streamed.level < image.firstLevel;
+}
+
+/*Function uploads one strip of rows from the strip path into its level of the texture being filled. The texture is
+created with every level allocated on the first strip of its image, since the rows of all levels arrive interleaved*/
+void UUploadDecodedStrip(TextureStrip& strip)
+{
+    auto uploadStart = chrono::steady_clock::now();
+    auto filled = find_if(gStripTextures.begin(), gStripTextures.end(), [&](const StripTexture& s) { return s.index == strip.index; });
+    if (filled == gStripTextures.end())
+        filled = gStripTextures.insert(gStripTextures.end(), { strip.index, 0, 0, false, DecodedImage(), 0.0 });
+
+    GLenum format = strip.channels == 3 ? GL_RGB : GL_RGBA;
+    if (filled->texture == 0)
+    {
+        glGenTextures(1, &filled->texture);
+        glBindTexture(GL_TEXTURE_2D, filled->texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, strip.levels - 1);
+        for (int level = 0; level < strip.levels; level++)
         {
-            cout << "Not implemented to handle image with " << channels << " channels" << endl;
-            return false;
+            GLsizei height = max(1, strip.height >> level);
+            glTexImage2D(GL_TEXTURE_2D, level, strip.channels == 3 ? GL_RGB8 : GL_RGBA8, max(1, strip.width >> level), height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+            filled->rowsLeft += height;
+        }
+    }
+    else
+        glBindTexture(GL_TEXTURE_2D, filled->texture);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, strip.level, 0, strip.row, max(1, strip.width >> strip.level), strip.rows, format, GL_UNSIGNED_BYTE, strip.pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    filled->rowsLeft -= strip.rows;
+    gTextureLoader->returnStrip(strip);     // The driver has its own copy now
+
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - uploadStart).count();
+    filled->uploadMs += ms;
+    gUploadMs += ms;
+}
+
+/*Function puts the textures whose every strip is in in place of their placeholders. They are not handed to the
+residency manager: it re-creates textures from levels kept in system memory, which the strip path never holds*/
+void UFinishStripTextures()
+{
+    for (auto filled = gStripTextures.begin(); filled != gStripTextures.end();)
+    {
+        if (!filled->decoded || filled->texture == 0 || filled->rowsLeft > 0)
+        {
+            filled++;
+            continue;
+        }
+        const DecodedImage& done = filled->image;
+        GLuint* target = gTextureTargets[done.index];
+        glDeleteTextures(1, target);
+        *target = filled->texture;
+
+        size_t bytes = 0;
+        for (int level = done.firstLevel; level < ImageTools::mipLevelCount(done.width, done.height); level++)
+            bytes += (size_t)max(1, done.width >> level) * max(1, done.height >> level) * done.channels;
+        gTextureBytes += bytes;
+        cout << "Texture " << gTextureRequests[done.index].filename << " (" << max(1, done.width >> done.firstLevel) << "x" << max(1, done.height >> done.firstLevel)
+            << ", streamed in strips at 1/" << done.decodeScale << ", " << bytes / 1024 << " KB): ready in " << done.decodeMs << " ms, full quality "
+            << chrono::duration<double, milli>(chrono::steady_clock::now() - gStartTime).count() << " ms after start (" << filled->uploadMs << " ms of uploads)" << endl;
+        filled = gStripTextures.erase(filled);
+    }
+}
+
+// Function stops streaming: waits for decodes still running and frees every image not yet uploaded
+void UStopTextureStream()
+{
+    if (gPixelBufferPool)
+        gPixelBufferPool->shutdown();   // Decodes waiting for a buffer give up
+    for (StreamedTexture& streamed : gStreamedTextures)
+        TextureLoader::release(streamed.image);
+    gStreamedTextures.clear();
+    for (StripTexture& filled : gStripTextures)
+        glDeleteTextures(1, &filled.texture);   // Unfinished; the placeholder stays
+    gStripTextures.clear();
+    gTextureLoader.reset();
+    gAssetReader.reset();
+    gProcessedCache.reset();
+    gTexturePool.reset();
+    gJpegBandPool.reset();
+    gPixelBufferPool.reset();
+    gAssetPack.reset();     // Nothing reads the packed images once they are uploaded
+    for (vector<uint8_t>& unpacked : gUnpackedAssets)
+        unpacked = vector<uint8_t>();
+}
+
+// Function returns the RMS length in world units of a unit step along one texture axis, after the object transform
+float UStretchLength(const glm::mat3& transform, const glm::mat3& moment, float area)
+{
+    glm::mat3 moved = transform * moment * glm::transpose(transform);
+    return sqrt((moved[0][0] + moved[1][1] + moved[2][2]) / area);
+}
+
+/*Function sizes each texture to the detail that can reach the screen and fits them all in the video memory budget.
+An object seen from the start view, or VIEW_MARGIN times closer, covers at most (pixels per world unit at that
+distance) x (world units per texture repeat) pixels along each texture axis; texels beyond that only feed the minifying
+filter. If the planned chains still exceed gTextureBudgetMB the largest one is halved until they fit. The detail is
+written into the requests and the plan is printed per texture*/
+void UPlanTextures(const UVStretch stretch[11], std::span<TextureRequest> requests)
+{
+    const float pixelsPerUnit = gFrameHeight / (2.0f * tan(glm::radians(gCamera.Zoom) / 2.0f));    // At distance 1
+
+    // Texels each texture needs across u and v: the most any object sampling it can show
+    vector<glm::vec2> needed(requests.size(), glm::vec2(0.0f));
+    for (const SceneObject& object : gSceneObjects)
+    {
+        const UVStretch& mesh = stretch[object.mesh];
+        if (mesh.area <= 0.0f)
+            continue;
+        float distance = max(glm::distance(glm::vec3(object.model[3]), gCamera.Position) / VIEW_MARGIN, 1.0f);
+        glm::mat3 transform(object.model);
+        glm::vec2 texels(UStretchLength(transform, mesh.u, mesh.area) / gUVScale.x, UStretchLength(transform, mesh.v, mesh.area) / gUVScale.y);
+        texels *= pixelsPerUnit / distance;
+        for (size_t j = 0; j < requests.size(); j++)
+            if (gTextureTargets[j] == gUnitTextures[object.textureUnit])
+                needed[j] = glm::max(needed[j], texels);
+    }
+
+    // Video memory of a chain from a given level down, as it will be uploaded
+    auto chainBytes = [](int width, int height, int channels, int firstLevel) {
+        size_t bytes = 0;
+        for (int level = firstLevel; level < ImageTools::mipLevelCount(width, height); level++)
+        {
+            size_t w = max(1, width >> level), h = max(1, height >> level);
+            if (gCompressTextures)
+                bytes += (w + 3) / 4 * ((h + 3) / 4) * (channels == 4 ? 16 : 8);   // BC3 or BC1 blocks
+            else
+                bytes += w * h * channels;
         }
+        return bytes;
+    };
+
+    struct Plan
+    {
+        int width = 0, height = 0, channels = 0, dropped = 0;
+    };
+    vector<Plan> plans(requests.size());
+    size_t total = 0;
+    for (size_t j = 0; j < requests.size(); j++)
+    {
+        Plan& plan = plans[j];
+        bool known = requests[j].data.empty() ? stbi_info(requests[j].filename, &plan.width, &plan.height, &plan.channels)
+            : stbi_info_from_memory(requests[j].data.data(), (int)requests[j].data.size(), &plan.width, &plan.height, &plan.channels);
+        if (!known)
+            continue;   // The loader reports the failure
+        if (needed[j].x > 0.0f && needed[j].y > 0.0f)
+            plan.dropped = ImageTools::levelsAbove(plan.width, plan.height, (uint32_t)ceil(needed[j].x), (uint32_t)ceil(needed[j].y));
+        gTextureFullBytes[j] = chainBytes(plan.width, plan.height, plan.channels, 0);
+        total += chainBytes(plan.width, plan.height, plan.channels, plan.dropped);
+    }
+
+    // Over budget: halve whichever texture is largest now
+    const size_t budget = gTextureBudgetMB << 20;
+    while (budget > 0 && total > budget)
+    {
+        size_t largest = requests.size(), largestBytes = 0;
+        for (size_t j = 0; j < plans.size(); j++)
+        {
+            const Plan& plan = plans[j];
+            size_t bytes = plan.width > 0 ? chainBytes(plan.width, plan.height, plan.channels, plan.dropped) : 0;
+            if (plan.dropped + 1 < ImageTools::mipLevelCount(plan.width, plan.height) && bytes > largestBytes)
+            {
+                largest = j;
+                largestBytes = bytes;
+            }
+        }
+        if (largest == requests.size())
+            break;      // Everything is down to 1x1
+        Plan& plan = plans[largest];
+        plan.dropped++;
+        total -= largestBytes - chainBytes(plan.width, plan.height, plan.channels, plan.dropped);
+    }
+
+    size_t fullTotal = 0;
+    for (size_t j = 0; j < requests.size(); j++)
+    {
+        const Plan& plan = plans[j];
+        if (plan.width == 0)
+            continue;
+        requests[j].detailWidth = max(1, plan.width >> plan.dropped);
+        requests[j].detailHeight = max(1, plan.height >> plan.dropped);
+        fullTotal += gTextureFullBytes[j];
+        cout << "Texture plan " << requests[j].filename << ": " << plan.width << "x" << plan.height << " -> " << requests[j].detailWidth << "x"
+            << requests[j].detailHeight << " (needs " << (int)ceil(needed[j].x) << "x" << (int)ceil(needed[j].y) << "), "
+            << gTextureFullBytes[j] / 1024 << " -> " << chainBytes(plan.width, plan.height, plan.channels, plan.dropped) / 1024 << " KB" << endl;
+    }
+    cout << "Texture plan total: " << fullTotal / 1024 << " -> " << total / 1024 << " KB of video memory (budget " << gTextureBudgetMB << " MB)" << endl;
+}
 
-        glGenerateMipmap(GL_TEXTURE_2D);    // Generate all  required mipmaps for currently bound texture
+/*Function tells the residency manager which textures the current view draws and at how many texels, then lets it
+drop, evict and bring back mip levels. An object counts when its bounding sphere is inside the view frustum; its texels
+are the pixels one texture repeat covers at the sphere's nearest point, as in UPlanTextures*/
+void UUpdateResidency()
+{
+    if (!gTextureResidency)
+        return;
+    gFrameNumber++;
 
-        stbi_image_free(image);             // Free image memory
-        glBindTexture(GL_TEXTURE_2D, 0);    // Unbind the texture
+    glm::mat4 viewProjection = UProjection() * gCamera.GetViewMatrix();
+
+    // Frustum planes from the rows of the view-projection matrix, pointing inward
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    const glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+
+    const float pixelsPerUnit = perspective ? gFrameHeight / (2.0f * tan(glm::radians(gCamera.Zoom) / 2.0f))
+        : ORTHO_SCALE / 2.0f * gFrameHeight / WINDOW_HEIGHT;
+    for (const SceneObject& object : gSceneObjects)
+    {
+        const glm::vec4& bounds = gMesh.bounds[object.mesh];
+        const UVStretch& stretch = gMesh.uvStretch[object.mesh];
+        if (stretch.area <= 0.0f)
+            continue;
+        glm::mat3 transform(object.model);
+        glm::vec3 center = glm::vec3(object.model * glm::vec4(glm::vec3(bounds), 1.0f));
+        float radius = bounds.w * max(glm::length(transform[0]), max(glm::length(transform[1]), glm::length(transform[2])));
+
+        bool visible = true;
+        for (const glm::vec4& plane : planes)
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius * glm::length(glm::vec3(plane)))
+                visible = false;
+        if (!visible)
+            continue;
+
+        float distance = perspective ? max(glm::distance(center, gCamera.Position) - radius, 0.1f) : 1.0f;
+        float texelsU = UStretchLength(transform, stretch.u, stretch.area) / gUVScale.x * pixelsPerUnit / distance;
+        float texelsV = UStretchLength(transform, stretch.v, stretch.area) / gUVScale.y * pixelsPerUnit / distance;
+        gTextureResidency->request(gUnitTextures[object.textureUnit], texelsU, texelsV, gFrameNumber);
+    }
+    gTextureResidency->update(gFrameNumber);
+}
+
+// Function prints the finest level of each texture in video memory and the residency counters
+void UReportResidency()
+{
+    if (!gTextureResidency)
+    {
+        cout << "Texture residency: every level resident (no --texture-budget)" << endl;
+        return;
+    }
+    ResidencyStats stats = gTextureResidency->stats();
+    cout << "Texture residency: " << stats.residentBytes / 1024 << " of " << stats.fullBytes / 1024 << " KB resident (peak " << stats.peakBytes / 1024
+        << " KB, budget " << gTextureBudgetMB << " MB), " << stats.promotions << " promotions, " << stats.demotions << " demotions, " << stats.evictions
+        << " evictions, " << stats.deferred << " deferred, " << stats.uploadedBytes / 1024 << " KB uploaded, " << stats.copiedBytes / 1024 << " KB copied on the GPU" << endl;
+    for (size_t j = 0; j < size(gTextureTargets); j++)
+    {
+        int level = gTextureResidency->residentLevel(gTextureTargets[j]);
+        if (level >= 0)
+            cout << "  " << gTextureRequests[j].filename << ": from level " << level << endl;
+    }
+}
 
-        return true;                        // Image loaded and texture bound successfully
+/*Function bakes every scene texture into a block compressed .ktx2 file next to the image (see AssetTools). Detail
+that cannot reach the screen is left out, as planned from the Coordinates meshes*/
+bool UBakeTextures(BlockFormat format)
+{
+    vector<TextureRequest> requests(begin(gTextureRequests), end(gTextureRequests));
+    if (gDownscaleTextures)
+    {
+        UVStretch stretch[11];
+        for (int i = 0; i < 11; i++)
+            stretch[i] = MeshTools::uvStretch(gMeshSources[i].coords(), gMeshSources[i].floatsPerVertex);
+        UPlanTextures(stretch, requests);
     }
+    return AssetTools::bakeTextures(requests, format);
+}
 
-    return false;   // Error loading the image
+/*Function maps the asset pack and points each texture request at its bytes there, prefetching them in the order the
+loader decodes them. Textures missing from the pack are read from their files*/
+void UUseAssetPack(std::span<TextureRequest> requests)
+{
+    gAssetPack = make_unique<AssetPack>();
+    if (!gAssetPack->open(gAssetPackPath))
+    {
+        cout << "Failed to open asset pack " << gAssetPackPath << ", loading the image files" << endl;
+        gAssetPack.reset();
+        return;
+    }
+    for (size_t j = 0; j < requests.size(); j++)
+    {
+        int asset = gAssetPack->find(requests[j].filename);
+        if (asset < 0)
+        {
+            cout << requests[j].filename << " is not in " << gAssetPackPath << ", loading the file" << endl;
+            continue;
+        }
+        gAssetPack->prefetch(asset);
+        requests[j].data = gAssetPack->contents(asset, gUnpackedAssets[j]);
+    }
 }
 
 // Function to destroy texture
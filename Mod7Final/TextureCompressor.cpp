@@ -0,0 +1,610 @@
+#include "TextureCompressor.h"
+#include "ImageTools.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define TEXTURE_COMPRESSOR_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+    // BC7 interpolation weights (out of 64) for 4-bit indices
+    const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // The 16 pixels of one block as floats, one row per channel (R, G, B, A)
+    struct Block
+    {
+        alignas(16) float channel[4][16];
+    };
+
+    // Reads the 4x4 block at (bx, by); pixels past the edge repeat the last row/column
+    void loadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, Block& block)
+    {
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            const uint8_t* row = rgba + (size_t)std::min(by * 4 + y, height - 1) * width * 4;
+            for (uint32_t x = 0; x < 4; x++)
+            {
+                const uint8_t* pixel = row + (size_t)std::min(bx * 4 + x, width - 1) * 4;
+                for (int c = 0; c < 4; c++)
+                    block.channel[c][y * 4 + x] = pixel[c];
+            }
+        }
+    }
+
+    /*Picks the closest palette entry for every pixel (weighted squared distance) and returns the total error.
+    Four pixels are compared against each entry at once with SSE*/
+    float fitIndices(const Block& block, const float (*palette)[4], int entries, const float weights[4], int indices[16])
+    {
+        float error = 0.0f;
+#ifdef TEXTURE_COMPRESSOR_SSE
+        for (int p = 0; p < 16; p += 4)
+        {
+            __m128 pixel[4];
+            for (int c = 0; c < 4; c++)
+                pixel[c] = _mm_load_ps(&block.channel[c][p]);
+            __m128 best = _mm_set1_ps(FLT_MAX);
+            __m128 bestIndex = _mm_setzero_ps();
+            for (int k = 0; k < entries; k++)
+            {
+                __m128 distance = _mm_setzero_ps();
+                for (int c = 0; c < 4; c++)
+                {
+                    __m128 d = _mm_sub_ps(pixel[c], _mm_set1_ps(palette[k][c]));
+                    distance = _mm_add_ps(distance, _mm_mul_ps(_mm_mul_ps(d, d), _mm_set1_ps(weights[c])));
+                }
+                __m128 closer = _mm_cmplt_ps(distance, best);
+                best = _mm_min_ps(best, distance);
+                bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps((float)k)), _mm_andnot_ps(closer, bestIndex));
+            }
+            alignas(16) float bestOut[4], indexOut[4];
+            _mm_store_ps(bestOut, best);
+            _mm_store_ps(indexOut, bestIndex);
+            for (int i = 0; i < 4; i++)
+            {
+                indices[p + i] = (int)indexOut[i];
+                error += bestOut[i];
+            }
+        }
+#else
+        for (int p = 0; p < 16; p++)
+        {
+            float best = FLT_MAX;
+            for (int k = 0; k < entries; k++)
+            {
+                float distance = 0.0f;
+                for (int c = 0; c < 4; c++)
+                {
+                    float d = block.channel[c][p] - palette[k][c];
+                    distance += d * d * weights[c];
+                }
+                if (distance < best)
+                {
+                    best = distance;
+                    indices[p] = k;
+                }
+            }
+            error += best;
+        }
+#endif
+        return error;
+    }
+
+    // Endpoints along the principal axis of the block (weighted channels only), low end first
+    void principalEndpoints(const Block& block, const float weights[4], float low[4], float high[4])
+    {
+        float mean[4] = {};
+        for (int c = 0; c < 4; c++)
+        {
+            for (int p = 0; p < 16; p++)
+                mean[c] += block.channel[c][p];
+            mean[c] /= 16.0f;
+        }
+
+        float covariance[4][4] = {};
+        for (int p = 0; p < 16; p++)
+            for (int i = 0; i < 4; i++)
+                for (int j = 0; j < 4; j++)
+                    covariance[i][j] += (block.channel[i][p] - mean[i]) * (block.channel[j][p] - mean[j]) * weights[i] * weights[j];
+
+        // Power iteration, started from the channel with the widest spread
+        float axis[4] = {};
+        int widest = 0;
+        for (int c = 1; c < 4; c++)
+            if (covariance[c][c] > covariance[widest][widest])
+                widest = c;
+        axis[widest] = 1.0f;
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = {};
+            for (int i = 0; i < 4; i++)
+                for (int j = 0; j < 4; j++)
+                    next[i] += covariance[i][j] * axis[j];
+            float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+            if (length < 1e-6f)
+                break;
+            for (int c = 0; c < 4; c++)
+                axis[c] = next[c] / length;
+        }
+
+        float minT = FLT_MAX, maxT = -FLT_MAX;
+        for (int p = 0; p < 16; p++)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < 4; c++)
+                t += (block.channel[c][p] - mean[c]) * axis[c] * weights[c];
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+        for (int c = 0; c < 4; c++)
+        {
+            low[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+            high[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+        }
+    }
+
+    /*Least squares endpoints for fixed indices, where palette entry k sits at fraction t[k] from e0 to e1.
+    Returns false when every pixel uses the same fraction*/
+    bool refitEndpoints(const Block& block, const int indices[16], const float* t, float e0[4], float e1[4])
+    {
+        float a = 0.0f, b = 0.0f, c = 0.0f, x0[4] = {}, x1[4] = {};
+        for (int p = 0; p < 16; p++)
+        {
+            float w1 = t[indices[p]], w0 = 1.0f - w1;
+            a += w0 * w0;
+            b += w0 * w1;
+            c += w1 * w1;
+            for (int ch = 0; ch < 4; ch++)
+            {
+                x0[ch] += w0 * block.channel[ch][p];
+                x1[ch] += w1 * block.channel[ch][p];
+            }
+        }
+        float determinant = a * c - b * b;
+        if (std::fabs(determinant) < 1e-6f)
+            return false;
+        for (int ch = 0; ch < 4; ch++)
+        {
+            e0[ch] = std::clamp((c * x0[ch] - b * x1[ch]) / determinant, 0.0f, 255.0f);
+            e1[ch] = std::clamp((a * x1[ch] - b * x0[ch]) / determinant, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    // 5:6:5 packing and the 8-bit values a decoder expands it to
+    uint16_t pack565(const float color[4])
+    {
+        int r = (int)std::lround(color[0] * 31.0f / 255.0f);
+        int g = (int)std::lround(color[1] * 63.0f / 255.0f);
+        int b = (int)std::lround(color[2] * 31.0f / 255.0f);
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    void unpack565(uint16_t packed, int color[3])
+    {
+        int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    // The four BC1 shades of two packed endpoints in 4-shade mode (index order 0, 1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1)
+    void bc1Palette(uint16_t c0, uint16_t c1, int palette[4][3])
+    {
+        unpack565(c0, palette[0]);
+        unpack565(c1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+    }
+
+    // Tries one pair of endpoints: packs them, finds indices and returns the error
+    float tryBC1(const Block& block, const float e0[4], const float e1[4], uint16_t& c0, uint16_t& c1, int indices[16])
+    {
+        static const float rgbWeights[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+        c0 = pack565(e0);
+        c1 = pack565(e1);
+        int shades[4][3];
+        bc1Palette(c0, c1, shades);
+        float palette[4][4];
+        for (int k = 0; k < 4; k++)
+            for (int c = 0; c < 4; c++)
+                palette[k][c] = c < 3 ? (float)shades[k][c] : 0.0f;
+        return fitIndices(block, palette, 4, rgbWeights, indices);
+    }
+
+    // Color half of BC1/BC3, always in 4-shade mode (BC3 ignores the endpoint order, BC1 needs c0 > c1 for it)
+    void encodeColorBlock(const Block& block, uint8_t* out)
+    {
+        static const float rgbWeights[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+        static const float fractions[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+        float low[4], high[4];
+        principalEndpoints(block, rgbWeights, low, high);
+        uint16_t c0, c1;
+        int indices[16];
+        float error = tryBC1(block, high, low, c0, c1, indices);
+
+        // One least squares pass on the chosen indices, kept only if it helps
+        float e0[4], e1[4];
+        if (refitEndpoints(block, indices, fractions, e0, e1))
+        {
+            uint16_t r0, r1;
+            int refitIndices[16];
+            if (tryBC1(block, e0, e1, r0, r1, refitIndices) < error)
+            {
+                c0 = r0;
+                c1 = r1;
+                std::copy(refitIndices, refitIndices + 16, indices);
+            }
+        }
+
+        // 4-shade mode needs c0 > c1: swap the endpoints and remap 0<->1, 2<->3. Equal endpoints all use index 0
+        if (c0 < c1)
+        {
+            std::swap(c0, c1);
+            for (int& index : indices)
+                index ^= 1;
+        }
+        else if (c0 == c1)
+            std::fill(indices, indices + 16, 0);
+
+        uint32_t bits = 0;
+        for (int p = 0; p < 16; p++)
+            bits |= (uint32_t)indices[p] << (p * 2);
+        out[0] = (uint8_t)c0;
+        out[1] = (uint8_t)(c0 >> 8);
+        out[2] = (uint8_t)c1;
+        out[3] = (uint8_t)(c1 >> 8);
+        for (int i = 0; i < 4; i++)
+            out[4 + i] = (uint8_t)(bits >> (i * 8));
+    }
+
+    // The eight BC3 alpha levels of a0 > a1 (index order a0, a1, then 6/7 a0 + 1/7 a1 ... 1/7 a0 + 6/7 a1)
+    void alphaPalette(int a0, int a1, int levels[8])
+    {
+        levels[0] = a0;
+        levels[1] = a1;
+        for (int i = 2; i < 8; i++)
+            levels[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+    }
+
+    void encodeAlphaBlock(const Block& block, uint8_t* out)
+    {
+        static const float alphaWeights[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        float minA = 255.0f, maxA = 0.0f;
+        for (int p = 0; p < 16; p++)
+        {
+            minA = std::min(minA, block.channel[3][p]);
+            maxA = std::max(maxA, block.channel[3][p]);
+        }
+        int a0 = (int)std::lround(maxA), a1 = (int)std::lround(minA);
+        int indices[16] = {};
+        if (a0 > a1)
+        {
+            int levels[8];
+            alphaPalette(a0, a1, levels);
+            float palette[8][4] = {};
+            for (int k = 0; k < 8; k++)
+                palette[k][3] = (float)levels[k];
+            fitIndices(block, palette, 8, alphaWeights, indices);
+        }
+
+        uint64_t bits = 0;
+        for (int p = 0; p < 16; p++)
+            bits |= (uint64_t)indices[p] << (p * 3);
+        out[0] = (uint8_t)a0;
+        out[1] = (uint8_t)a1;
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = (uint8_t)(bits >> (i * 8));
+    }
+
+    // Rounds an RGBA endpoint to 7 bits per channel plus the shared low bit that fits it best
+    void quantizeBC7(const float endpoint[4], int quantized[4], int& pbit)
+    {
+        float bestError = FLT_MAX;
+        for (int p = 0; p < 2; p++)
+        {
+            int candidate[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++)
+            {
+                candidate[c] = std::clamp((int)std::lround((endpoint[c] - p) / 2.0f), 0, 127);
+                float d = (float)(candidate[c] * 2 + p) - endpoint[c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                pbit = p;
+                std::copy(candidate, candidate + 4, quantized);
+            }
+        }
+    }
+
+    void bc7Palette(const int q0[4], int p0, const int q1[4], int p1, int palette[16][4])
+    {
+        for (int k = 0; k < 16; k++)
+            for (int c = 0; c < 4; c++)
+            {
+                int v0 = q0[c] * 2 + p0, v1 = q1[c] * 2 + p1;
+                palette[k][c] = ((64 - BC7_WEIGHTS[k]) * v0 + BC7_WEIGHTS[k] * v1 + 32) >> 6;
+            }
+    }
+
+    float tryBC7(const Block& block, const float e0[4], const float e1[4], int q0[4], int& p0, int q1[4], int& p1, int indices[16])
+    {
+        static const float rgbaWeights[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        quantizeBC7(e0, q0, p0);
+        quantizeBC7(e1, q1, p1);
+        int shades[16][4];
+        bc7Palette(q0, p0, q1, p1, shades);
+        float palette[16][4];
+        for (int k = 0; k < 16; k++)
+            for (int c = 0; c < 4; c++)
+                palette[k][c] = (float)shades[k][c];
+        return fitIndices(block, palette, 16, rgbaWeights, indices);
+    }
+
+    // Writes bit fields into a 128-bit block, lowest bit first
+    struct BitWriter
+    {
+        uint8_t* out;
+        int position = 0;
+
+        void write(uint32_t value, int count)
+        {
+            for (int i = 0; i < count; i++, position++)
+                if (value & (1u << i))
+                    out[position >> 3] |= (uint8_t)(1u << (position & 7));
+        }
+    };
+
+    // BC7 mode 6: one subset, RGBA endpoints of 7 bits plus a low bit each, 4-bit indices
+    void encodeBC7Block(const Block& block, uint8_t* out)
+    {
+        static const float rgbaWeights[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        float fractions[16];
+        for (int k = 0; k < 16; k++)
+            fractions[k] = BC7_WEIGHTS[k] / 64.0f;
+
+        float low[4], high[4];
+        principalEndpoints(block, rgbaWeights, low, high);
+        int q0[4], q1[4], p0, p1, indices[16];
+        float error = tryBC7(block, low, high, q0, p0, q1, p1, indices);
+
+        float e0[4], e1[4];
+        if (refitEndpoints(block, indices, fractions, e0, e1))
+        {
+            int r0[4], r1[4], rp0, rp1, refitIndices[16];
+            if (tryBC7(block, e0, e1, r0, rp0, r1, rp1, refitIndices) < error)
+            {
+                std::copy(r0, r0 + 4, q0);
+                std::copy(r1, r1 + 4, q1);
+                p0 = rp0;
+                p1 = rp1;
+                std::copy(refitIndices, refitIndices + 16, indices);
+            }
+        }
+
+        // The first index is stored with 3 bits, so its top bit must be 0: swap the endpoints if needed
+        if (indices[0] >= 8)
+        {
+            for (int c = 0; c < 4; c++)
+                std::swap(q0[c], q1[c]);
+            std::swap(p0, p1);
+            for (int& index : indices)
+                index = 15 - index;
+        }
+
+        std::fill(out, out + 16, (uint8_t)0);
+        BitWriter writer{ out };
+        writer.write(1u << 6, 7);       // Mode 6
+        for (int c = 0; c < 4; c++)
+        {
+            writer.write(q0[c], 7);
+            writer.write(q1[c], 7);
+        }
+        writer.write(p0, 1);
+        writer.write(p1, 1);
+        writer.write(indices[0], 3);
+        for (int p = 1; p < 16; p++)
+            writer.write(indices[p], 4);
+    }
+
+    void encodeBlock(const Block& block, BlockFormat format, uint8_t* out)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1:
+            encodeColorBlock(block, out);
+            break;
+        case BlockFormat::BC3:
+            encodeAlphaBlock(block, out);
+            encodeColorBlock(block, out + 8);
+            break;
+        case BlockFormat::BC7:
+            encodeBC7Block(block, out);
+            break;
+        }
+    }
+
+    // Decodes one block into a 4x4 RGBA8 tile
+    void decodeBlock(const uint8_t* in, BlockFormat format, uint8_t tile[16][4])
+    {
+        if (format == BlockFormat::BC7)
+        {
+            auto bits = [in](int first, int count) {
+                uint32_t value = 0;
+                for (int i = 0; i < count; i++)
+                    value |= (uint32_t)((in[(first + i) >> 3] >> ((first + i) & 7)) & 1) << i;
+                return value;
+            };
+            if (bits(0, 7) != (1u << 6))
+            {
+                std::fill(&tile[0][0], &tile[0][0] + 64, (uint8_t)0);   // Only mode 6 (what encode writes) is decoded
+                return;
+            }
+            int q0[4], q1[4];
+            for (int c = 0; c < 4; c++)
+            {
+                q0[c] = (int)bits(7 + c * 14, 7);
+                q1[c] = (int)bits(14 + c * 14, 7);
+            }
+            int palette[16][4];
+            bc7Palette(q0, (int)bits(63, 1), q1, (int)bits(64, 1), palette);
+            for (int p = 0; p < 16; p++)
+            {
+                int index = p == 0 ? (int)bits(65, 3) : (int)bits(68 + (p - 1) * 4, 4);
+                for (int c = 0; c < 4; c++)
+                    tile[p][c] = (uint8_t)palette[index][c];
+            }
+            return;
+        }
+
+        const uint8_t* color = format == BlockFormat::BC3 ? in + 8 : in;
+        uint16_t c0 = (uint16_t)(color[0] | (color[1] << 8)), c1 = (uint16_t)(color[2] | (color[3] << 8));
+        uint32_t indices = color[4] | (color[5] << 8) | (color[6] << 16) | ((uint32_t)color[7] << 24);
+        int shades[4][3];
+        int alphas[4] = { 255, 255, 255, 255 };
+        bc1Palette(c0, c1, shades);
+        if (format == BlockFormat::BC1 && c0 <= c1)
+        {
+            // 3-shade mode: midpoint and transparent black
+            for (int c = 0; c < 3; c++)
+            {
+                shades[2][c] = (shades[0][c] + shades[1][c]) / 2;
+                shades[3][c] = 0;
+            }
+            alphas[3] = 0;
+        }
+        for (int p = 0; p < 16; p++)
+        {
+            int index = (indices >> (p * 2)) & 3;
+            for (int c = 0; c < 3; c++)
+                tile[p][c] = (uint8_t)shades[index][c];
+            tile[p][3] = (uint8_t)alphas[index];
+        }
+
+        if (format == BlockFormat::BC3)
+        {
+            int levels[8];
+            if (in[0] > in[1])
+                alphaPalette(in[0], in[1], levels);
+            else
+            {
+                // 6-level mode: four steps between the endpoints, then 0 and 255
+                levels[0] = in[0];
+                levels[1] = in[1];
+                for (int i = 2; i < 6; i++)
+                    levels[i] = ((6 - i) * in[0] + (i - 1) * in[1]) / 5;
+                levels[6] = 0;
+                levels[7] = 255;
+            }
+            uint64_t bits = 0;
+            for (int i = 0; i < 6; i++)
+                bits |= (uint64_t)in[2 + i] << (i * 8);
+            for (int p = 0; p < 16; p++)
+                tile[p][3] = (uint8_t)levels[(bits >> (p * 3)) & 7];
+        }
+    }
+}
+
+size_t TextureCompressor::blockBytes(BlockFormat format) {
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t TextureCompressor::imageBytes(BlockFormat format, uint32_t width, uint32_t height) {
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+void TextureCompressor::encode(const uint8_t* rgba, uint32_t width, uint32_t height, BlockFormat format, ThreadPool* pool, std::vector<uint8_t>& blocks) {
+    const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    const size_t bytes = blockBytes(format);
+    blocks.assign(imageBytes(format, width, height), 0);
+
+    auto encodeRow = [&](size_t by) {
+        Block block;
+        for (uint32_t bx = 0; bx < blocksX; bx++)
+        {
+            loadBlock(rgba, width, height, bx, (uint32_t)by, block);
+            encodeBlock(block, format, blocks.data() + (by * blocksX + bx) * bytes);
+        }
+    };
+    if (pool)
+        pool->parallelFor(blocksY, encodeRow);
+    else
+        for (size_t by = 0; by < blocksY; by++)
+            encodeRow(by);
+}
+
+void TextureCompressor::decode(const uint8_t* blocks, uint32_t width, uint32_t height, BlockFormat format, std::vector<uint8_t>& rgba) {
+    const uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    rgba.resize((size_t)width * height * 4);
+    for (uint32_t by = 0; by < blocksY; by++)
+    {
+        for (uint32_t bx = 0; bx < blocksX; bx++)
+        {
+            uint8_t tile[16][4];
+            decodeBlock(blocks + ((size_t)by * blocksX + bx) * blockBytes(format), format, tile);
+            for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++)
+                for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++)
+                    std::copy(tile[y * 4 + x], tile[y * 4 + x] + 4, &rgba[(((size_t)by * 4 + y) * width + bx * 4 + x) * 4]);
+        }
+    }
+}
+
+bool TextureCompressor::compress(const unsigned char* pixels, int width, int height, int channels, BlockFormat format, ThreadPool* pool, CompressedTexture& texture,
+    int firstLevel) {
+    if (!pixels || width <= 0 || height <= 0 || (channels != 3 && channels != 4))
+        return false;
+
+    // Expand to RGBA
+    std::vector<uint8_t> level((size_t)width * height * 4);
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        for (int c = 0; c < 3; c++)
+            level[i * 4 + c] = pixels[i * channels + c];
+        level[i * 4 + 3] = channels == 4 ? pixels[i * 4 + 3] : 255;
+    }
+
+    // Filter the mip chain in linear light (sRGB content), then encode every level down to 1x1
+    std::vector<std::vector<uint8_t>> mips;
+    ImageTools::buildMipChain(level.data(), (uint32_t)width, (uint32_t)height, 4, MipFilter::Lanczos, true, pool, mips);
+
+    firstLevel = std::clamp(firstLevel, 0, (int)mips.size());
+    texture.format = format;
+    texture.width = std::max(1u, (uint32_t)width >> firstLevel);
+    texture.height = std::max(1u, (uint32_t)height >> firstLevel);
+    texture.levels.assign(mips.size() + 1 - firstLevel, {});
+    uint32_t levelWidth = texture.width, levelHeight = texture.height;
+    for (size_t i = 0; i < texture.levels.size(); i++)
+    {
+        size_t source = firstLevel + i;
+        encode(source == 0 ? level.data() : mips[source - 1].data(), levelWidth, levelHeight, format, pool, texture.levels[i]);
+        levelWidth = std::max(1u, levelWidth / 2);
+        levelHeight = std::max(1u, levelHeight / 2);
+    }
+    return true;
+}
+
+double TextureCompressor::psnr(const uint8_t* a, const uint8_t* b, size_t pixelCount, int channels) {
+    double squaredError = 0.0;
+    for (size_t i = 0; i < pixelCount; i++)
+        for (int c = 0; c < channels; c++)
+        {
+            double d = (double)a[i * 4 + c] - b[i * 4 + c];
+            squaredError += d * d;
+        }
+    if (squaredError == 0.0)
+        return std::numeric_limits<double>::infinity();
+    double mse = squaredError / ((double)pixelCount * channels);
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
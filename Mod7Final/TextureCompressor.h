@@ -0,0 +1,49 @@
+#pragma once
+# include <cstddef>
+# include <cstdint>
+# include <vector>
+
+class ThreadPool;
+
+// GPU block compression formats. Every format stores 4x4 pixel blocks
+enum class BlockFormat : uint32_t
+{
+	BC1,		// 8 bytes per block, RGB with 4 shades per block
+	BC3,		// 16 bytes per block, BC1 color plus separate 8 level alpha
+	BC7,		// 16 bytes per block, RGBA with 16 shades per block (mode 6)
+};
+
+// A block compressed image with its mip chain, level 0 first
+struct CompressedTexture
+{
+	BlockFormat format = BlockFormat::BC1;
+	uint32_t width = 0, height = 0;
+	std::vector<std::vector<uint8_t>> levels;
+};
+
+/* Class to encode images to BC1/BC3/BC7 on the CPU and decode them back for quality checks. The
+index search of every block is done four pixels at a time with SSE; rows of blocks are split across the
+pool when one is given*/
+class TextureCompressor
+{
+public:
+	// Bytes of one 4x4 block
+	static size_t blockBytes(BlockFormat format);
+
+	// Bytes of a whole image of the given size, partial blocks included
+	static size_t imageBytes(BlockFormat format, uint32_t width, uint32_t height);
+
+	// Encodes RGBA8 pixels; edge blocks repeat the last row/column. pool may be nullptr to stay on this thread
+	static void encode(const uint8_t* rgba, uint32_t width, uint32_t height, BlockFormat format, ThreadPool* pool, std::vector<uint8_t>& blocks);
+
+	// Decodes blocks back to RGBA8 pixels
+	static void decode(const uint8_t* blocks, uint32_t width, uint32_t height, BlockFormat format, std::vector<uint8_t>& rgba);
+
+	/* Builds the full mip chain of an 8-bit image with 3 or 4 channels and encodes every level from firstLevel down.
+	Levels above it only feed the filter; texture.width/height are those of firstLevel*/
+	static bool compress(const unsigned char* pixels, int width, int height, int channels, BlockFormat format, ThreadPool* pool, CompressedTexture& texture,
+		int firstLevel = 0);
+
+	// Peak signal to noise ratio in dB between two RGBA8 images, over the first channels channels
+	static double psnr(const uint8_t* a, const uint8_t* b, size_t pixelCount, int channels);
+};
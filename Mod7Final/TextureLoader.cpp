@@ -0,0 +1,581 @@
+#include "TextureLoader.h"
+#include "AssetReader.h"
+#include "ImageTools.h"
+#include "JpegDecoder.h"
+#include "KtxFile.h"
+#include "PixelBufferPool.h"
+#include "ProcessedCache.h"
+#include "ThreadPool.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace
+{
+    const int STRIP_ROWS = 16;      // Rows per strip of each level (fewer at the end of a level)
+
+    // Part of every cache key: change it whenever decoding, mip filtering or block encoding changes its output
+    const char* TEXTURE_PROCESSING_VERSION = "texture-1";
+
+    // Staging memory for the image this thread is decoding, and the exact size stb_image will ask for
+    thread_local uint8_t* tDecodeTarget = nullptr;
+    thread_local size_t tDecodeTargetSize = 0;
+    thread_local bool tDecodeTargetUsed = false;
+
+    // stb_image on the request's bytes when it has them, on its file otherwise
+    stbi_uc* loadImage(const TextureRequest& request, int& width, int& height, int& channels)
+    {
+        if (!request.data.empty())
+            return stbi_load_from_memory(request.data.data(), (int)request.data.size(), &width, &height, &channels, 0);
+        return stbi_load(request.filename, &width, &height, &channels, 0);
+    }
+
+    bool imageInfo(const TextureRequest& request, int& width, int& height, int& channels)
+    {
+        if (!request.data.empty())
+            return stbi_info_from_memory(request.data.data(), (int)request.data.size(), &width, &height, &channels);
+        return stbi_info(request.filename, &width, &height, &channels);
+    }
+
+    // The request's file: a view of the bytes it came with, or the file read into storage (empty if it cannot be)
+    std::span<const uint8_t> fileContents(const TextureRequest& request, std::vector<uint8_t>& storage)
+    {
+        if (!request.data.empty())
+            return request.data;
+        std::ifstream file(request.filename, std::ios::binary | std::ios::ate);
+        storage.resize(file ? (size_t)file.tellg() : 0);
+        file.seekg(0);
+        if (!file.read((char*)storage.data(), (std::streamsize)storage.size()))
+            storage.clear();
+        return storage;
+    }
+
+    // Decodes into the start of a staging buffer and builds the mipmaps after it. False if the buffer was not used
+    bool decodeInto(PixelBuffer* buffer, const TextureRequest& request, DecodedImage& image, int width, int height, int channels)
+    {
+        size_t levelBytes = (size_t)width * height * channels;
+        tDecodeTarget = buffer->mapped;
+        tDecodeTargetSize = levelBytes;
+        tDecodeTargetUsed = false;
+        image.pixels = loadImage(request, image.width, image.height, image.channels);
+        tDecodeTarget = nullptr;
+
+        if (!image.pixels || image.width != width || image.height != height || image.channels != channels)
+        {
+            if (image.pixels != buffer->mapped)
+                stbi_image_free(image.pixels);
+            image.pixels = nullptr;
+            return false;
+        }
+        if (image.pixels != buffer->mapped)
+        {
+            // Decoded on the heap after all (e.g. converted from 16 bits): copy it over
+            std::memcpy(buffer->mapped, image.pixels, levelBytes);
+            stbi_image_free(image.pixels);
+            image.pixels = buffer->mapped;
+        }
+        ImageTools::buildMipChain(image.pixels, width, height, channels, MipFilter::Box, true, nullptr, buffer->mapped + levelBytes);
+        image.staging = buffer;
+        return true;
+    }
+
+    /* Decodes a baseline JPEG straight at 1/2, 1/4 or 1/8 of its size when the request needs no more detail than that,
+    or at full size in bands on bandPool when it has restart markers, into a staging buffer when there is a pool.
+    False leaves the image to stb_image*/
+    bool decodeJpeg(const TextureRequest& request, PixelBufferPool* staging, ThreadPool* bandPool, DecodedImage& image)
+    {
+        int width, height, channels;
+        if (!imageInfo(request, width, height, channels))
+            return false;
+        int scale = 1 << std::min(ImageTools::levelsAbove(width, height, request.detailWidth, request.detailHeight), 3);
+        if (scale == 1 && (!bandPool || bandPool->size() < 2))
+            return false;
+
+        std::vector<uint8_t> storage;
+        std::span<const uint8_t> data = fileContents(request, storage);
+        JpegDecoder jpeg;
+        if (!jpeg.open(data.data(), data.size()))
+            return false;   // Not a JPEG, or one only stb_image handles
+        if (scale == 1 && jpeg.info().restartInterval == 0)
+            return false;   // Decoded on one thread either way, and stb_image is faster at that
+
+        width = JpegDecoder::scaledSize(jpeg.info().width, scale);
+        height = JpegDecoder::scaledSize(jpeg.info().height, scale);
+        channels = jpeg.info().components;
+        size_t levelBytes = (size_t)width * height * channels;
+        PixelBuffer* buffer = staging ? staging->acquire(levelBytes + ImageTools::mipChainBytes(width, height, channels)) : nullptr;
+        uint8_t* pixels = buffer ? buffer->mapped : (uint8_t*)std::malloc(levelBytes);     // stbi_image_free releases it like stb's own
+        if (!pixels || !jpeg.decode(scale, request.flip, pixels, bandPool))
+        {
+            if (buffer)
+                staging->discard(buffer);
+            else
+                std::free(pixels);
+            return false;
+        }
+        image.pixels = pixels;
+        image.width = width;
+        image.height = height;
+        image.channels = channels;
+        image.decodeScale = scale;
+        if (buffer)
+        {
+            ImageTools::buildMipChain(pixels, width, height, channels, MipFilter::Box, true, nullptr, buffer->mapped + levelBytes);
+            image.staging = buffer;
+        }
+        return true;
+    }
+
+    // Level 0 and the mipmaps of an image's pixels, on the heap or back to back in its staging buffer
+    std::vector<std::span<const uint8_t>> pixelLevels(const DecodedImage& image)
+    {
+        std::vector<std::span<const uint8_t>> levels;
+        uint32_t width = (uint32_t)image.width, height = (uint32_t)image.height;
+        size_t bytes = (size_t)width * height * image.channels;
+        levels.emplace_back(image.pixels, bytes);
+        if (!image.staging)
+        {
+            for (const std::vector<uint8_t>& level : image.mipLevels)
+                levels.emplace_back(level);
+            return levels;
+        }
+        const uint8_t* level = image.pixels;
+        while (width > 1 || height > 1)
+        {
+            level += bytes;
+            width = std::max(1u, width / 2);
+            height = std::max(1u, height / 2);
+            bytes = (size_t)width * height * image.channels;
+            levels.emplace_back(level, bytes);
+        }
+        return levels;
+    }
+
+    /* Looks the request up in the cache by its file's bytes and everything else that decides the result. The bytes
+    are kept in source and the request pointed at them, so a miss does not read the file again*/
+    bool loadCached(ProcessedCache& cache, TextureRequest& request, bool compress, ThreadPool* bandPool, PixelBufferPool* staging,
+        std::vector<uint8_t>& source, uint64_t& key, DecodedImage& image)
+    {
+        std::span<const uint8_t> data = fileContents(request, source);
+        if (data.empty())
+            return false;
+        request.data = data;
+        std::string parameters = std::string(TEXTURE_PROCESSING_VERSION) + (request.flip ? " flip" : "") + " detail "
+            + std::to_string(request.detailWidth) + "x" + std::to_string(request.detailHeight) + (compress ? " compress" : "")
+            + (bandPool && bandPool->size() >= 2 ? " bands" : "");     // Banded JPEGs come from JpegDecoder, not stb_image
+        key = ProcessedCache::key(data, parameters);
+
+        CachedArtifact artifact;
+        if (!cache.load(request.filename, key, artifact) || artifact.blobs.empty())
+            return false;
+        size_t levelBytes = (size_t)artifact.values[0] * artifact.values[1] * artifact.values[2];
+        if (artifact.values[5] == 0 && (artifact.blobs[0].size() != levelBytes
+            || (int)artifact.blobs.size() != ImageTools::mipLevelCount(artifact.values[0], artifact.values[1])))
+            return false;
+        image.width = (int)artifact.values[0];
+        image.height = (int)artifact.values[1];
+        image.channels = (int)artifact.values[2];
+        image.firstLevel = (int)artifact.values[3];
+        image.decodeScale = (int)artifact.values[4];
+        if (artifact.values[5] != 0)
+        {
+            image.compressed.format = (BlockFormat)(artifact.values[5] - 1);
+            image.compressed.width = artifact.values[0];
+            image.compressed.height = artifact.values[1];
+            image.compressed.levels = std::move(artifact.blobs);
+            return true;
+        }
+
+        PixelBuffer* buffer = staging ? staging->acquire(levelBytes + ImageTools::mipChainBytes(image.width, image.height, image.channels)) : nullptr;
+        if (buffer)
+        {
+            uint8_t* level = buffer->mapped;
+            for (const std::vector<uint8_t>& blob : artifact.blobs)
+            {
+                std::memcpy(level, blob.data(), blob.size());
+                level += blob.size();
+            }
+            image.pixels = buffer->mapped;
+            image.staging = buffer;
+            return true;
+        }
+        image.pixels = (uint8_t*)std::malloc(levelBytes);   // stbi_image_free releases it like stb's own
+        std::memcpy(image.pixels, artifact.blobs[0].data(), levelBytes);
+        image.mipLevels.assign(std::make_move_iterator(artifact.blobs.begin() + 1), std::make_move_iterator(artifact.blobs.end()));
+        return true;
+    }
+
+    // Stores what decode() made of a request under the key loadCached() gave it
+    void storeCached(ProcessedCache& cache, const char* name, uint64_t key, const DecodedImage& image)
+    {
+        uint32_t values[8] = { (uint32_t)image.width, (uint32_t)image.height, (uint32_t)image.channels, (uint32_t)image.firstLevel,
+            (uint32_t)image.decodeScale, 0, 0, 0 };
+        std::vector<std::span<const uint8_t>> blobs;
+        if (!image.compressed.levels.empty())
+        {
+            values[5] = 1 + (uint32_t)image.compressed.format;
+            for (const std::vector<uint8_t>& level : image.compressed.levels)
+                blobs.emplace_back(level);
+        }
+        else if (image.pixels)
+            blobs = pixelLevels(image);
+        else
+            return;     // Nothing was made, so the next run tries again
+        cache.store(name, key, values, image.decodeMs, blobs);
+    }
+}
+
+TextureLoader::TextureLoader(std::span<const TextureRequest> requests, ThreadPool& pool, bool compress, PixelBufferPool* staging,
+    ThreadPool* bandPool, size_t stripMemory, AssetReader* reader, ProcessedCache* cache)
+    : remaining(requests.size()), running(requests.size()), stripCap(stripMemory), cache(cache) {
+    counters.capBytes = stripMemory;
+    if (reader)
+        files.resize(requests.size());  // Before any decode runs, as they all check it
+    std::vector<TextureRequest> unread;
+    std::vector<size_t> unreadIndices;
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        TextureRequest request = requests[i];
+        if (reader && request.data.empty())
+        {
+            unread.push_back(request);
+            unreadIndices.push_back(i);
+            continue;
+        }
+        pool.submit([this, request, i, compress, staging, bandPool] { decode(request, i, compress, staging, bandPool); });
+    }
+    if (unread.empty())
+        return;
+
+    // The reader gets every file at once; each image is decoded from memory as soon as its file is in
+    reading = std::thread([this, reader, unread, unreadIndices, &pool, compress, staging, bandPool] {
+        std::vector<const char*> paths;
+        for (const TextureRequest& request : unread)
+            paths.push_back(request.filename);
+        reader->readAll(paths, [&](size_t k, std::vector<uint8_t>& bytes) {
+            size_t i = unreadIndices[k];
+            TextureRequest request = unread[k];
+            files[i] = std::move(bytes);
+            request.data = files[i];    // Left empty if the read failed, so the decode tries the file itself
+            pool.submit([this, request, i, compress, staging, bandPool] { decode(request, i, compress, staging, bandPool); });
+        });
+    });
+}
+
+void TextureLoader::decode(TextureRequest request, size_t index, bool compress, PixelBufferPool* staging, ThreadPool* bandPool) {
+    auto start = std::chrono::steady_clock::now();
+    DecodedImage image;
+    image.index = index;
+    std::vector<uint8_t> source;    // The file, read for the cache key
+    uint64_t key = 0;
+    if (KtxFile::read(KtxFile::bakedPath(request.filename).c_str(), image.compressed))
+    {
+        image.baked = true;
+        image.width = (int)image.compressed.width;
+        image.height = (int)image.compressed.height;
+        image.channels = image.compressed.format == BlockFormat::BC1 ? 3 : 4;
+        image.firstLevel = std::min(ImageTools::levelsAbove(image.width, image.height, request.detailWidth, request.detailHeight),
+            (int)image.compressed.levels.size() - 1);
+    }
+    else if (cache && stripCap == 0 && loadCached(*cache, request, compress, bandPool, compress ? nullptr : staging, source, key, image))
+        image.cached = true;
+    else if (stripCap == 0 || compress || !streamStrips(request, image))
+    {
+        stbi_set_flip_vertically_on_load_thread(request.flip);     // Per thread, so workers do not race on it
+
+        // JPEGs with more detail than needed are decoded scaled down, and ones with restart markers on several
+        // threads. Otherwise the header gives the size of the staging buffer to wait for
+        int width, height, channels;
+        bool decoded = decodeJpeg(request, compress ? nullptr : staging, bandPool, image);
+        if (!decoded && staging && !compress && imageInfo(request, width, height, channels) && channels >= 1 && channels <= 4)
+        {
+            size_t bytes = (size_t)width * height * channels + ImageTools::mipChainBytes(width, height, channels);
+            if (PixelBuffer* buffer = staging->acquire(bytes))
+            {
+                if (!decodeInto(buffer, request, image, width, height, channels))
+                    staging->discard(buffer);
+            }
+        }
+        if (!image.staging && !image.pixels)
+            image.pixels = loadImage(request, image.width, image.height, image.channels);
+        BlockFormat format = image.channels == 4 ? BlockFormat::BC3 : BlockFormat::BC1;
+        int dropped = ImageTools::levelsAbove(image.width, image.height, request.detailWidth, request.detailHeight);
+        if (compress && TextureCompressor::compress(image.pixels, image.width, image.height, image.channels, format, nullptr, image.compressed, dropped))
+        {
+            stbi_image_free(image.pixels);  // Only the blocks are uploaded, and only the levels worth it were encoded
+            image.pixels = nullptr;
+            image.width = (int)image.compressed.width;
+            image.height = (int)image.compressed.height;
+        }
+        else
+        {
+            image.firstLevel = dropped;
+            if (image.pixels && !image.staging)
+                ImageTools::buildMipChain(image.pixels, image.width, image.height, image.channels, MipFilter::Box, true, nullptr, image.mipLevels);
+        }
+    }
+    image.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (key != 0 && !image.cached)
+        storeCached(*cache, request.filename, key, image);
+
+    if (!files.empty())
+        files[index] = std::vector<uint8_t>();  // Decoded: the file's bytes are not needed any more
+
+    std::lock_guard<std::mutex> lock(finishedMutex);
+    finished.push_back(image);
+    running--;
+    imageFinished.notify_all();
+}
+
+TextureLoader::~TextureLoader() {
+    if (reading.joinable())
+        reading.join();     // Every file is in and its decode queued
+    {
+        std::lock_guard<std::mutex> lock(stripMutex);
+        closing = true;     // A decode waiting for strip memory gives up
+    }
+    stripFreed.notify_all();
+
+    // Decodes hold a pointer to this loader, so wait for them and free anything that was never picked up
+    std::unique_lock<std::mutex> lock(finishedMutex);
+    imageFinished.wait(lock, [this] { return running == 0; });
+    for (DecodedImage& image : finished)
+        release(image);
+}
+
+bool TextureLoader::next(DecodedImage& image) {
+    std::unique_lock<std::mutex> lock(finishedMutex);
+    if (remaining == 0)
+        return false;
+    imageFinished.wait(lock, [this] { return !finished.empty(); });
+    image = finished.front();
+    finished.pop_front();
+    remaining--;
+    return true;
+}
+
+bool TextureLoader::tryNext(DecodedImage& image) {
+    std::lock_guard<std::mutex> lock(finishedMutex);
+    if (finished.empty())
+        return false;
+    image = finished.front();
+    finished.pop_front();
+    remaining--;
+    return true;
+}
+
+bool TextureLoader::done() {
+    std::lock_guard<std::mutex> lock(finishedMutex);
+    return remaining == 0;
+}
+
+bool TextureLoader::tryNextStrip(TextureStrip& strip) {
+    std::lock_guard<std::mutex> lock(stripMutex);
+    if (strips.empty())
+        return false;
+    strip = std::move(strips.front());
+    strips.pop_front();
+    return true;
+}
+
+void TextureLoader::returnStrip(TextureStrip& strip) {
+    size_t bytes = strip.pixels.size();
+    strip.pixels = std::vector<uint8_t>();
+    {
+        std::lock_guard<std::mutex> lock(stripMutex);
+        stripBytesHeld -= bytes;
+        stripBytesQueued -= bytes;
+    }
+    stripFreed.notify_all();
+}
+
+StripStats TextureLoader::stripStats() {
+    std::lock_guard<std::mutex> lock(stripMutex);
+    return counters;
+}
+
+bool TextureLoader::reserve(size_t bytes, size_t& shortBy) {
+    std::unique_lock<std::mutex> lock(stripMutex);
+    auto start = std::chrono::steady_clock::now();
+    bool waited = false;
+    while (!closing && stripBytesHeld + bytes > stripCap)
+    {
+        if (stripBytesQueued == 0)
+        {
+            shortBy = stripBytesHeld + bytes - stripCap;
+            return false;   // Nothing is on its way to being freed
+        }
+        waited = true;
+        stripFreed.wait(lock);
+    }
+    if (closing)
+        return false;
+    stripBytesHeld += bytes;
+    counters.peakBytes = std::max(counters.peakBytes, stripBytesHeld);
+    if (waited)
+    {
+        counters.stalls++;
+        counters.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    return true;
+}
+
+void TextureLoader::unreserve(size_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(stripMutex);
+        stripBytesHeld -= bytes;
+    }
+    stripFreed.notify_all();
+}
+
+bool TextureLoader::streamStrips(const TextureRequest& request, DecodedImage& image) {
+    // A loose file is read into memory counted against the cap; packed bytes are a view of the mapping
+    std::span<const uint8_t> data = request.data;
+    std::ifstream file;
+    size_t fileBytes = 0;
+    uint8_t soi[2] = {};
+    if (data.empty())
+    {
+        file.open(request.filename, std::ios::binary | std::ios::ate);
+        fileBytes = file ? (size_t)file.tellg() : 0;
+        file.seekg(0);
+        file.read((char*)soi, 2);
+    }
+    else if (data.size() >= 2)
+        std::memcpy(soi, data.data(), 2);
+    if (soi[0] != 0xFF || soi[1] != 0xD8)
+        return false;   // Not a JPEG: loaded whole
+
+    std::lock_guard<std::mutex> streaming(stripDecode);
+    if (!reserve(fileBytes, image.overCapBytes))
+        return true;
+    std::vector<uint8_t> storage(fileBytes);
+    file.seekg(0);
+    if (data.empty() && file.read((char*)storage.data(), (std::streamsize)storage.size()))
+        data = storage;
+    JpegDecoder jpeg;
+    if (!jpeg.open(data.data(), data.size()))
+    {
+        unreserve(fileBytes);
+        return false;   // Progressive or otherwise beyond the strip decoder: loaded whole
+    }
+
+    const JpegInfo& info = jpeg.info();
+    int scale = 1 << std::min(ImageTools::levelsAbove(info.width, info.height, request.detailWidth, request.detailHeight), 3);
+    image.width = JpegDecoder::scaledSize(info.width, scale);
+    image.height = JpegDecoder::scaledSize(info.height, scale);
+    image.channels = info.components;
+    image.decodeScale = scale;
+    image.firstLevel = ImageTools::levelsAbove(image.width, image.height, request.detailWidth, request.detailHeight);
+    const int levels = ImageTools::mipLevelCount(image.width, image.height);
+
+    // One strip per texture level being filled; rows arrive top down and are stored in OpenGL order
+    std::vector<TextureStrip> filling(levels - image.firstLevel);
+    std::vector<int> top(filling.size()), filled(filling.size());
+    auto handOver = [&](size_t level) {
+        std::lock_guard<std::mutex> lock(stripMutex);
+        stripBytesQueued += filling[level].pixels.size();
+        strips.push_back(std::move(filling[level]));
+        counters.strips++;
+        filling[level] = TextureStrip();
+    };
+    MipRowStream mips(image.width, image.height, image.channels, MipFilter::Box, true, [&](int level, uint32_t row, const uint8_t* pixels) {
+        if (level < image.firstLevel)
+            return true;    // Only feeds the smaller levels
+        size_t t = level - image.firstLevel;
+        int width = std::max(1, image.width >> level), height = std::max(1, image.height >> level);
+        size_t rowBytes = (size_t)width * image.channels;
+        TextureStrip& strip = filling[t];
+        if (strip.pixels.empty())
+        {
+            strip.rows = std::min(STRIP_ROWS, height - (int)row);
+            if (!reserve(strip.rows * rowBytes, image.overCapBytes))
+                return false;
+            strip.pixels.resize(strip.rows * rowBytes);
+            strip.index = image.index;
+            strip.width = std::max(1, image.width >> image.firstLevel);
+            strip.height = std::max(1, image.height >> image.firstLevel);
+            strip.channels = image.channels;
+            strip.levels = (int)filling.size();
+            strip.level = (int)t;
+            strip.row = request.flip ? height - (int)row - strip.rows : (int)row;
+            top[t] = (int)row;
+            filled[t] = 0;
+        }
+
+        // Flipping is only a matter of where each row goes in its strip and where the strip goes in the level
+        int slot = request.flip ? strip.rows - 1 - ((int)row - top[t]) : (int)row - top[t];
+        std::memcpy(strip.pixels.data() + slot * rowBytes, pixels, rowBytes);
+        if (++filled[t] == strip.rows)
+            handOver(t);
+        return true;
+    });
+
+    size_t working = jpeg.stripWorkingBytes(scale) + mips.workingBytes();
+    bool reserved = reserve(working, image.overCapBytes);
+    bool streamed = reserved && jpeg.decodeStrips(scale, [&](const uint8_t* rows, int, int count) {
+        for (int r = 0; r < count; r++)
+            if (!mips.push(rows + (size_t)r * image.width * image.channels))
+                return false;
+        return true;
+    });
+    if (!streamed)
+    {
+        // Strips still queued are dropped, so none of them reach the GL thread after the failure
+        std::lock_guard<std::mutex> lock(stripMutex);
+        for (auto strip = strips.begin(); strip != strips.end();)
+        {
+            if (strip->index == image.index)
+            {
+                stripBytesHeld -= strip->pixels.size();
+                stripBytesQueued -= strip->pixels.size();
+                strip = strips.erase(strip);
+            }
+            else
+                strip++;
+        }
+        for (TextureStrip& strip : filling)
+            stripBytesHeld -= strip.pixels.size();
+    }
+    image.stripped = streamed;
+    unreserve(fileBytes + (reserved ? working : 0));
+    return true;
+}
+
+void TextureLoader::release(DecodedImage& image) {
+    if (!image.staging)
+        stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+    image.staging = nullptr;
+    image.mipLevels.clear();
+    image.compressed.levels.clear();
+}
+
+void* TextureLoader::decodeMalloc(size_t size) {
+    // stb_image asks for the finished image with up to one byte of slack (JPEG)
+    if (tDecodeTarget && !tDecodeTargetUsed && size >= tDecodeTargetSize && size <= tDecodeTargetSize + 1)
+    {
+        tDecodeTargetUsed = true;
+        return tDecodeTarget;
+    }
+    return std::malloc(size);
+}
+
+void* TextureLoader::decodeRealloc(void* pointer, size_t size) {
+    if (pointer && pointer == tDecodeTarget)
+        return nullptr;     // Staging memory cannot grow; stb_image reports the failure
+    return std::realloc(pointer, size);
+}
+
+void TextureLoader::decodeFree(void* pointer) {
+    if (pointer && pointer == tDecodeTarget)
+    {
+        tDecodeTargetUsed = false;  // Decoding failed after placing the image; nothing to free
+        return;
+    }
+    std::free(pointer);
+}
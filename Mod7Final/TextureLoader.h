@@ -0,0 +1,147 @@
+#pragma once
+# include <condition_variable>
+# include <cstddef>
+# include <deque>
+# include <mutex>
+# include <span>
+# include <cstdint>
+# include <thread>
+# include <vector>
+# include "TextureCompressor.h"
+
+class ThreadPool;
+class PixelBufferPool;
+class AssetReader;
+class ProcessedCache;
+struct PixelBuffer;
+
+// One image to decode
+struct TextureRequest
+{
+	const char* filename;
+	bool flip;					// Flip rows so the first row is the bottom of the image (OpenGL order)
+	uint32_t detailWidth = 0;	// Texels that can reach the screen across u and v; larger top levels are dropped (0 = keep all)
+	uint32_t detailHeight = 0;
+	std::span<const uint8_t> data = {};	// The file's bytes when they are already in memory (an asset pack); empty = read filename
+};
+
+// One decoded image, handed to the GL thread for upload
+struct DecodedImage
+{
+	size_t index = 0;				// Position of the request it came from
+	int width = 0, height = 0, channels = 0;
+	unsigned char* pixels = nullptr;	// stb_image buffer (nullptr if decoding failed), freed by release()
+	std::vector<std::vector<uint8_t>> mipLevels;	// Levels 1, 2, ... of pixels, filtered on the worker
+	PixelBuffer* staging = nullptr;	// Mapped buffer holding pixels and levels 1, 2, ... back to back (mipLevels stays empty)
+	int firstLevel = 0;				// Top levels held but not worth uploading (the request's detail size)
+	CompressedTexture compressed;	// Block compressed mip chain, used instead of pixels when it has levels
+	bool baked = false;				// compressed came from a baked .ktx2 file rather than the encoder
+	bool cached = false;			// Read from the processed-asset cache instead of decoded
+	double decodeMs = 0.0;			// Time spent reading/decoding (and encoding) on the worker
+	int decodeScale = 1;			// Decoded at 1/decodeScale of the file's size (JPEG DCT scaling)
+	bool stripped = false;			// Went to the GL thread as TextureStrips, which all came before this
+	size_t overCapBytes = 0;		// Not loaded: the strip path needs this much more than the memory cap
+};
+
+// Rows of one mip level from the strip path, in OpenGL row order, ready for glTexSubImage2D
+struct TextureStrip
+{
+	size_t index = 0;				// Position of the request it came from
+	int width = 0, height = 0, channels = 0;	// Of the texture's level 0 (the request's first level worth uploading)
+	int levels = 0;					// Of the texture
+	int level = 0;					// Texture level the rows belong to
+	int row = 0, rows = 0;			// First row, counted from the bottom when the request flips
+	std::vector<uint8_t> pixels;
+};
+
+// Memory of the strip path since the loader was created
+struct StripStats
+{
+	size_t capBytes = 0;
+	size_t peakBytes = 0;			// Most held at once: file data, decoder and mip working sets, strips not yet uploaded
+	size_t strips = 0;
+	size_t stalls = 0;				// Times a decode waited for the GL thread to upload strips
+	double stallMs = 0.0;
+};
+
+/* Class to decode a set of images concurrently on the worker pool. The thread that owns the GL context
+calls next() to pick up images in the order they finish, so uploads overlap with the remaining decodes.
+A baked .ktx2 next to an image is used instead of it; with compress set, images without one are
+block compressed on the worker (BC1, or BC3 when they have alpha). Otherwise the worker also builds the
+mip chain of the pixels, box filtered in linear light. Given a staging pool, the image and its mipmaps are
+decoded straight into a mapped pixel buffer instead of the heap. Given a band pool (not pool itself, whose workers
+would wait on each other), one JPEG with restart markers is decoded on several threads.
+
+Given a strip memory cap, baseline JPEGs are decoded instead one row of blocks at a time, their mip levels built from
+the rows as they come, and handed over as strips of rows for the GL thread to upload; no level is ever held whole.
+Everything the path holds is counted against the cap before it is allocated, and a decode waits for uploads to free
+memory. One image streams at a time, so the cap covers one working set plus the strips in flight.
+
+Given an asset reader, the files of requests without data are read all at once on a thread of the loader, and each
+image is queued for decoding from memory when its file is in.
+
+Given a processed-asset cache, images that are not streamed in strips are looked up in it by their file's bytes and
+processing settings first; a hit skips decoding, filtering and encoding, and a miss stores what was made*/
+class TextureLoader
+{
+public:
+	TextureLoader(std::span<const TextureRequest> requests, ThreadPool& pool, bool compress = false, PixelBufferPool* staging = nullptr,
+		ThreadPool* bandPool = nullptr, size_t stripMemory = 0, AssetReader* reader = nullptr, ProcessedCache* cache = nullptr);
+	~TextureLoader();
+
+	TextureLoader(const TextureLoader&) = delete;
+	TextureLoader& operator=(const TextureLoader&) = delete;
+
+	// Waits for the next finished image. Returns false once every request has been handed out
+	bool next(DecodedImage& image);
+
+	// Takes the next finished image without waiting. Returns false if none is ready yet
+	bool tryNext(DecodedImage& image);
+
+	// True once every request has been handed out
+	bool done();
+
+	// Takes the next strip without waiting. The caller uploads it and gives its memory back with returnStrip()
+	bool tryNextStrip(TextureStrip& strip);
+	void returnStrip(TextureStrip& strip);
+
+	StripStats stripStats();
+
+	// Frees the pixels, mipmaps and blocks of an image returned by next(). A staging buffer is left to its pool
+	static void release(DecodedImage& image);
+
+	/* stb_image allocates through these (STBI_MALLOC/REALLOC/FREE). While a worker decodes into a staging
+	buffer, the allocation of the finished image is placed in it; everything else goes to the heap*/
+	static void* decodeMalloc(size_t size);
+	static void* decodeRealloc(void* pointer, size_t size);
+	static void decodeFree(void* pointer);
+
+private:
+	void decode(TextureRequest request, size_t index, bool compress, PixelBufferPool* staging, ThreadPool* bandPool);
+	// Streams one JPEG as strips. False if it is not a JPEG this path handles; true with image.stripped unset if it failed
+	bool streamStrips(const TextureRequest& request, DecodedImage& image);
+	// Waits until bytes fit under the cap. False if the loader is closing, or if they never will (shortBy set)
+	bool reserve(size_t bytes, size_t& shortBy);
+	void unreserve(size_t bytes);
+
+	std::mutex finishedMutex;
+	std::condition_variable imageFinished;
+	std::deque<DecodedImage> finished;
+	size_t remaining;				// Requests not yet handed out by next()
+	size_t running;					// Decodes still in progress on the pool
+
+	const size_t stripCap;			// 0 = no strip path
+	std::mutex stripDecode;			// Held by the one image streaming
+	std::mutex stripMutex;
+	std::condition_variable stripFreed;
+	std::deque<TextureStrip> strips;
+	size_t stripBytesHeld = 0;		// Counted against the cap
+	size_t stripBytesQueued = 0;	// Part of that in strips handed over and not returned yet
+	bool closing = false;
+	StripStats counters;
+
+	std::thread reading;			// Runs the reader
+	std::vector<std::vector<uint8_t>> files;	// Bytes the reader read, per request, until the image is decoded
+
+	ProcessedCache* const cache;
+};
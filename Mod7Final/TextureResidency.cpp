@@ -0,0 +1,194 @@
+#include "TextureResidency.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace
+{
+    const size_t UPLOAD_BYTES_PER_FRAME = 16 << 20;    // Promotions past this wait for the next frame, so a fast turn does not stall one
+    const int TAIL_SIZE = 64;                           // Eviction keeps levels of at most this many texels across
+}
+
+TextureResidency::TextureResidency(size_t budgetBytes)
+    : budget(budgetBytes) {
+}
+
+void TextureResidency::adopt(GLuint* target, ResidentImage image) {
+    Entry entry;
+    entry.target = target;
+    entry.image = std::move(image);
+    entry.requested = entry.wanted = (int)entry.image.levels.size() - 1;
+    entries.push_back(std::move(entry));
+    residentBytes += chainBytes(entries.back(), 0);
+    counters.peakBytes = std::max(counters.peakBytes, residentBytes);
+}
+
+void TextureResidency::request(GLuint* target, float texelsU, float texelsV, uint64_t frame) {
+    auto found = std::find_if(entries.begin(), entries.end(), [&](const Entry& e) { return e.target == target; });
+    if (found == entries.end())
+        return;     // Still streaming in, or failed to load
+    Entry& entry = *found;
+    int last = (int)entry.image.levels.size() - 1;
+    if (entry.lastUsed != frame)
+    {
+        entry.lastUsed = frame;
+        entry.requested = last;
+    }
+
+    // Each level halves the texels, so the finest useful one is log2 of how far the texture outresolves the draw
+    float ratio = std::min(texelsU > 0.0f ? entry.image.width / texelsU : (float)INT_MAX, texelsV > 0.0f ? entry.image.height / texelsV : (float)INT_MAX);
+    int level = ratio > 1.0f ? (int)std::floor(std::log2(ratio)) : 0;
+    entry.requested = std::min(entry.requested, std::clamp(level, 0, last));
+}
+
+void TextureResidency::update(uint64_t frame) {
+    for (Entry& entry : entries)
+        if (entry.lastUsed == frame)
+            entry.wanted = entry.requested;     // Textures not drawn keep what they last needed
+
+    // Detail the view no longer needs goes right away. One level finer than needed is kept, so small camera moves
+    // do not re-create textures back and forth
+    for (Entry& entry : entries)
+        if (entry.lastUsed == frame && entry.resident < entry.wanted - 1)
+        {
+            recreate(entry, entry.wanted - 1);
+            counters.demotions++;
+        }
+
+    // Over the budget (textures were adopted at full detail): least recently drawn first, then the largest drawn ones
+    if (budget > 0 && !evictFor(budget, frame, nullptr))
+    {
+        while (residentBytes > budget)
+        {
+            Entry* largest = nullptr;
+            for (Entry& entry : entries)
+                if (entry.resident < tailLevel(entry) && (!largest || chainBytes(entry, entry.resident) > chainBytes(*largest, largest->resident)))
+                    largest = &entry;
+            if (!largest)
+                break;  // Everything is down to its tail
+            recreate(*largest, largest->resident + 1);
+            counters.evictions++;
+        }
+    }
+
+    // More detail for what was drawn, cheapest first, within the frame's upload limit and the budget
+    std::vector<Entry*> needy;
+    for (Entry& entry : entries)
+        if (entry.lastUsed == frame && entry.resident > entry.wanted)
+            needy.push_back(&entry);
+    std::sort(needy.begin(), needy.end(), [this](const Entry* a, const Entry* b) {
+        return chainBytes(*a, a->wanted) - chainBytes(*a, a->resident) < chainBytes(*b, b->wanted) - chainBytes(*b, b->resident);
+    });
+    size_t uploaded = 0;
+    for (Entry* entry : needy)
+    {
+        size_t extra = chainBytes(*entry, entry->wanted) - chainBytes(*entry, entry->resident);
+        if (uploaded > 0 && uploaded + extra > UPLOAD_BYTES_PER_FRAME)
+        {
+            counters.deferred++;
+            continue;
+        }
+        if (budget > 0 && residentBytes + extra > budget)
+            evictFor(budget > extra ? budget - extra : 0, frame, entry);
+
+        // What does not fit is brought in as far as it does
+        int level = entry->wanted;
+        while (level < entry->resident && budget > 0 && residentBytes + chainBytes(*entry, level) - chainBytes(*entry, entry->resident) > budget)
+            level++;
+        if (level > entry->wanted)
+            counters.deferred++;
+        if (level == entry->resident)
+            continue;
+        uploaded += chainBytes(*entry, level) - chainBytes(*entry, entry->resident);
+        recreate(*entry, level);
+        counters.promotions++;
+    }
+}
+
+int TextureResidency::residentLevel(const GLuint* target) const {
+    for (const Entry& entry : entries)
+        if (entry.target == target)
+            return entry.resident;
+    return -1;
+}
+
+ResidencyStats TextureResidency::stats() const {
+    ResidencyStats stats = counters;
+    stats.textures = entries.size();
+    stats.residentBytes = residentBytes;
+    for (const Entry& entry : entries)
+        stats.fullBytes += chainBytes(entry, 0);
+    return stats;
+}
+
+size_t TextureResidency::chainBytes(const Entry& entry, int firstLevel) const {
+    size_t bytes = 0;
+    for (size_t level = firstLevel; level < entry.image.levels.size(); level++)
+        bytes += entry.image.levels[level].size();
+    return bytes;
+}
+
+int TextureResidency::tailLevel(const Entry& entry) const {
+    int level = 0;
+    while (level + 1 < (int)entry.image.levels.size() && std::max(entry.image.width >> level, entry.image.height >> level) > TAIL_SIZE)
+        level++;
+    return level;
+}
+
+bool TextureResidency::evictFor(size_t limit, uint64_t frame, const Entry* keep) {
+    while (residentBytes > limit)
+    {
+        Entry* oldest = nullptr;
+        for (Entry& entry : entries)
+            if (&entry != keep && entry.lastUsed < frame && entry.resident < tailLevel(entry) && (!oldest || entry.lastUsed < oldest->lastUsed))
+                oldest = &entry;
+        if (!oldest)
+            return false;   // Only textures drawn this frame have detail left
+        recreate(*oldest, tailLevel(*oldest));
+        counters.evictions++;
+    }
+    return true;
+}
+
+void TextureResidency::recreate(Entry& entry, int firstLevel) {
+    const ResidentImage& image = entry.image;
+    const int last = (int)image.levels.size() - 1;
+    GLuint old = *entry.target;
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, last - firstLevel);
+
+    // Levels already resident are copied on the GPU; the others come from system memory
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int level = firstLevel; level <= last; level++)
+    {
+        GLsizei width = std::max(1, image.width >> level), height = std::max(1, image.height >> level);
+        bool kept = level >= entry.resident;
+        const void* data = kept ? nullptr : image.levels[level].data();
+        if (image.format == 0)
+            glCompressedTexImage2D(GL_TEXTURE_2D, level - firstLevel, image.internalFormat, width, height, 0, (GLsizei)image.levels[level].size(), data);
+        else
+            glTexImage2D(GL_TEXTURE_2D, level - firstLevel, image.internalFormat, width, height, 0, image.format, GL_UNSIGNED_BYTE, data);
+        if (kept)
+        {
+            glCopyImageSubData(old, GL_TEXTURE_2D, level - entry.resident, 0, 0, 0, texture, GL_TEXTURE_2D, level - firstLevel, 0, 0, 0, width, height, 1);
+            counters.copiedBytes += image.levels[level].size();
+        }
+        else
+            counters.uploadedBytes += image.levels[level].size();
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDeleteTextures(1, &old);
+
+    residentBytes = residentBytes - chainBytes(entry, entry.resident) + chainBytes(entry, firstLevel);
+    counters.peakBytes = std::max(counters.peakBytes, residentBytes);
+    *entry.target = texture;
+    entry.resident = firstLevel;
+}
@@ -0,0 +1,78 @@
+#pragma once
+# include <GL/glew.h>
+# include <cstddef>
+# include <cstdint>
+# include <vector>
+
+// Every mip level of one texture, kept in system memory so detail can be brought back after it was dropped
+struct ResidentImage
+{
+	GLenum internalFormat = 0;		// GL_RGB8, GL_RGBA8 or a compressed format
+	GLenum format = 0;				// Pixel format of uncompressed levels, 0 when the levels are blocks
+	int width = 0, height = 0;		// Of levels[0]
+	std::vector<std::vector<uint8_t>> levels;
+};
+
+// Residency counters since the manager was created
+struct ResidencyStats
+{
+	size_t textures = 0;
+	size_t residentBytes = 0;		// Video memory of the levels now in textures
+	size_t fullBytes = 0;			// Video memory if every level of every texture were resident
+	size_t peakBytes = 0;
+	size_t promotions = 0;			// Textures re-created with more detail
+	size_t demotions = 0;			// Re-created with less because the view no longer needs it
+	size_t evictions = 0;			// Re-created with less to stay within the budget
+	size_t deferred = 0;			// Promotions put off to a later frame (budget or upload limit)
+	size_t uploadedBytes = 0;		// Sent from system memory by promotions
+	size_t copiedBytes = 0;			// Kept levels copied on the GPU into re-created textures
+};
+
+/* Class to keep only the mip levels each texture needs in video memory. Every frame the draws report the finest level
+they sample; textures that need more are re-created with the extra levels uploaded from system memory and the rest
+copied on the GPU, and textures whose detail is no longer needed are re-created without it. Under the budget, the least
+recently drawn textures give up detail first, down to a small tail that always stays resident. Dropping levels through
+GL_TEXTURE_BASE_LEVEL alone would not free them, so textures are re-created and the owner's texture name is replaced*/
+class TextureResidency
+{
+public:
+	explicit TextureResidency(size_t budgetBytes);	// 0 = no limit
+
+	TextureResidency(const TextureResidency&) = delete;
+	TextureResidency& operator=(const TextureResidency&) = delete;
+
+	// Takes over *target, which holds every level of image. *target is replaced whenever the texture is re-created
+	void adopt(GLuint* target, ResidentImage image);
+
+	// One draw this frame samples *target at about texelsU x texelsV texels across the whole texture
+	void request(GLuint* target, float texelsU, float texelsV, uint64_t frame);
+
+	// GL thread, once per frame after the requests: drops, evicts and promotes levels
+	void update(uint64_t frame);
+
+	// Finest level resident in *target, -1 if it is not managed
+	int residentLevel(const GLuint* target) const;
+
+	ResidencyStats stats() const;
+
+private:
+	struct Entry
+	{
+		GLuint* target = nullptr;
+		ResidentImage image;
+		int resident = 0;			// Finest level in the texture
+		int wanted = 0;				// Finest level the last frame that drew it needed
+		int requested = 0;			// Finest level asked for so far this frame
+		uint64_t lastUsed = 0;
+	};
+
+	size_t chainBytes(const Entry& entry, int firstLevel) const;	// Levels firstLevel .. last
+	int tailLevel(const Entry& entry) const;						// Coarsest level eviction goes down to
+	bool evictFor(size_t bytes, uint64_t frame, const Entry* keep);	// Frees bytes from textures not drawn this frame
+	void recreate(Entry& entry, int firstLevel);
+
+	const size_t budget;
+	std::vector<Entry> entries;
+	size_t residentBytes = 0;
+	ResidencyStats counters;
+};
@@ -0,0 +1,177 @@
+#pragma once
+# include <algorithm>
+# include <atomic>
+# include <cassert>
+# include <condition_variable>
+# include <cstdint>
+# include <functional>
+# include <future>
+# include <mutex>
+# include <queue>
+# include <thread>
+# include <vector>
+
+// A fixed set of worker threads that run queued jobs. Used for decoding, importing and CPU rendering work
+class ThreadPool
+{
+public:
+	// Pass 0 to use one worker per hardware thread
+	explicit ThreadPool(unsigned threadCount = 0)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		for (unsigned i = 0; i < threadCount; i++)
+			workers.emplace_back([this] { workerLoop(); });
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			stopping = true;
+		}
+		wakeWorkers.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	unsigned size() const
+	{
+		return (unsigned)workers.size();
+	}
+
+	// Queues a job and returns a future for its result
+	template <typename Job>
+	auto submit(Job job) -> std::future<decltype(job())>
+	{
+		using Result = decltype(job());
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::move(job));
+		std::future<Result> result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			jobs.emplace([task] { (*task)(); });
+		}
+		wakeWorkers.notify_one();
+		return result;
+	}
+
+	/* Splits [0, count) into one contiguous range per worker and blocks until every range is done. Never call it from a
+	job running on this same pool: the caller holds a worker while it waits, so with every worker waiting the ranges
+	never run (a deadlock). Nested work needs a pool of its own (TextureLoader's band pool)*/
+	template <typename Body>
+	void parallelFor(size_t count, Body body)
+	{
+		assert(currentPool != this && "parallelFor from a job on the same pool deadlocks");
+		size_t chunks = std::min<size_t>(count, workers.size());
+		std::vector<std::future<void>> pending;
+		for (size_t c = 0; c < chunks; c++)
+		{
+			size_t begin = count * c / chunks;
+			size_t end = count * (c + 1) / chunks;
+			pending.push_back(submit([begin, end, &body] {
+				for (size_t i = begin; i < end; i++)
+					body(i);
+			}));
+		}
+		for (std::future<void>& job : pending)
+			job.get();
+	}
+
+	/* Like parallelFor, but a worker that runs out of work takes the back half of the largest range still left, so items
+	of very uneven cost (tiles of a ray traced image) still finish together. Returns how many times work was stolen.
+	The same rule holds: never from a job on this pool*/
+	template <typename Body>
+	size_t parallelForStealing(size_t count, Body body)
+	{
+		assert(currentPool != this && "parallelForStealing from a job on the same pool deadlocks");
+		// Each range is [begin, end) packed into one word: the owner takes from the front, thieves split off the back
+		size_t chunks = std::min<size_t>(count, workers.size());
+		std::vector<std::atomic<uint64_t>> ranges(chunks);
+		for (size_t c = 0; c < chunks; c++)
+			ranges[c] = (uint64_t)(count * (c + 1) / chunks) << 32 | (uint64_t)(count * c / chunks);
+		std::atomic<size_t> steals{ 0 };
+		std::vector<std::future<void>> pending;
+		for (size_t c = 0; c < chunks; c++)
+		{
+			pending.push_back(submit([c, &ranges, &steals, &body] {
+				std::atomic<uint64_t>& own = ranges[c];
+				for (;;)
+				{
+					uint64_t range = own.load();
+					if ((uint32_t)range < (uint32_t)(range >> 32))
+					{
+						if (own.compare_exchange_weak(range, range + 1))
+							body((size_t)(uint32_t)range);
+						continue;
+					}
+					if (!steal(ranges, own))
+						return;
+					steals++;
+				}
+			}));
+		}
+		for (std::future<void>& job : pending)
+			job.get();
+		return steals;
+	}
+
+private:
+	// Moves the back half of the fullest range into own, which is empty. False once no range has work left
+	static bool steal(std::vector<std::atomic<uint64_t>>& ranges, std::atomic<uint64_t>& own)
+	{
+		for (;;)
+		{
+			std::atomic<uint64_t>* victim = nullptr;
+			uint64_t victimRange = 0;
+			uint32_t most = 0;
+			for (std::atomic<uint64_t>& range : ranges)
+			{
+				uint64_t value = range.load();
+				uint32_t left = (uint32_t)(value >> 32) - std::min((uint32_t)(value >> 32), (uint32_t)value);
+				if (left > most)
+				{
+					victim = &range;
+					victimRange = value;
+					most = left;
+				}
+			}
+			if (victim == nullptr)
+				return false;
+			uint32_t end = (uint32_t)(victimRange >> 32);
+			uint32_t split = end - (most + 1) / 2;
+			if (victim->compare_exchange_strong(victimRange, (uint64_t)split << 32 | (uint32_t)victimRange))
+			{
+				own = (uint64_t)end << 32 | split;
+				return true;
+			}
+		}
+	}
+
+	void workerLoop()
+	{
+		currentPool = this;
+		for (;;)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(queueMutex);
+				wakeWorkers.wait(lock, [this] { return stopping || !jobs.empty(); });
+				if (stopping && jobs.empty())
+					return;
+				job = std::move(jobs.front());
+				jobs.pop();
+			}
+			job();
+		}
+	}
+
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex queueMutex;
+	std::condition_variable wakeWorkers;
+	bool stopping = false;
+	static inline thread_local const ThreadPool* currentPool = nullptr;	// Pool whose worker this thread is, if any
+};